@@ -73,7 +73,7 @@ public:
 int main(int argc, char* argv[])
 {
   if( argc >= 2 && std::strcmp( argv[1], "-h" ) == 0 ){
-        std::cout << "usage: OscDump [port]\n";
+        std::cout << "usage: OscDump [port [multicast-group [interface-address]]]\n";
         return 0;
     }
 
@@ -83,14 +83,29 @@ int main(int argc, char* argv[])
     port = std::atoi( argv[1] );
 
   OscDumpPacketListener listener;
+
+  if( argc >= 3 ){
+    IpEndpointName group( argv[2], port );
+    IpEndpointName localInterface;
+    if( argc >= 4 )
+      localInterface = IpEndpointName( argv[3] );
+
+    UdpListeningMulticastReceiveSocket s( group, &listener, localInterface );
+
+    std::cout << "listening for input to " << argv[2] << " on port " << port << "...\n";
+    std::cout << "press ctrl-c to end\n";
+
+    s.Run();
+  }else{
     UdpListeningReceiveSocket s(
             IpEndpointName( IpEndpointName::ANY_ADDRESS, port ),
             &listener );
 
-  std::cout << "listening for input on port " << port << "...\n";
-  std::cout << "press ctrl-c to end\n";
+    std::cout << "listening for input on port " << port << "...\n";
+    std::cout << "press ctrl-c to end\n";
 
-  s.Run();
+    s.Run();
+  }
 
   std::cout << "finishing.\n";
 
@@ -37,23 +37,37 @@
 #ifndef INCLUDED_OSCPACK_UDPSOCKET_H
 #define INCLUDED_OSCPACK_UDPSOCKET_H
 
+#include <algorithm>
 #include <cstring> // size_t
+#include <vector>
 
 #include "NetworkingUtils.h"
 #include "IpEndpointName.h"
+#include "Metrics.h"
+#include "PacketListener.h"
+#include "TimerListener.h"
 
 
 namespace oscpack
 {
-class PacketListener;
-class TimerListener;
+
+// a datagram queued for sending with BatchSender. error is set when the
+// batch is flushed: 0 if the datagram was sent, otherwise the errno (or
+// WSAGetLastError()) value reported for it.
+struct OutgoingDatagram{
+    IpEndpointName remoteEndpoint;
+    const char *data;
+    std::size_t size;
+    int error;
+};
 
 namespace detail
 {
 template<typename Impl_T>
-class SocketReceiveMultiplexer
+class SocketReceiveMultiplexer : public MultiplexerWakeup
 {
     typename Impl_T::socket_multiplexer_t impl_;
+    std::vector<ScheduledTimerListener*> scheduledTimerListeners_;
 
   public:
     using implementation_t = Impl_T;
@@ -61,6 +75,15 @@ class SocketReceiveMultiplexer
 
     SocketReceiveMultiplexer() = default;
 
+    ~SocketReceiveMultiplexer()
+    {
+      for( ScheduledTimerListener *listener : scheduledTimerListeners_ )
+        listener->ClearMultiplexerWakeup( this );
+    }
+
+    SocketReceiveMultiplexer( const SocketReceiveMultiplexer& ) = delete;
+    SocketReceiveMultiplexer& operator=( const SocketReceiveMultiplexer& ) = delete;
+
     // only call the attach/detach methods _before_ calling Run
 
     // only one listener per socket, each socket at most once
@@ -87,6 +110,52 @@ class SocketReceiveMultiplexer
       impl_.DetachPeriodicTimerListener( listener );
     }
 
+    // the listener is called whenever the expiry time it returns from
+    // ScheduledTimerListener::NextExpiryMs() has passed. it may wake the
+    // multiplexer (see ScheduledTimerListener::WakeMultiplexer()) until
+    // it is detached or the multiplexer is destroyed.
+    void AttachScheduledTimerListener( ScheduledTimerListener *listener )
+    {
+      impl_.AttachScheduledTimerListener( listener );
+      scheduledTimerListeners_.push_back( listener );
+      listener->SetMultiplexerWakeup( this );
+    }
+    void DetachScheduledTimerListener( ScheduledTimerListener *listener )
+    {
+      impl_.DetachScheduledTimerListener( listener );
+      scheduledTimerListeners_.erase( std::find( scheduledTimerListeners_.begin(),
+              scheduledTimerListeners_.end(), listener ) );
+      listener->ClearMultiplexerWakeup( this );
+    }
+
+    // Receive up to datagramCount datagrams per system call (recvmmsg() on
+    // Linux) and deliver them with PacketListener::ProcessPackets().
+    // The default is one datagram per call. Where there is no batched
+    // receive call (win32) the datagrams are received one at a time, but
+    // still delivered together.
+    void SetReceiveBatchSize( std::size_t datagramCount )
+    {
+      impl_.SetReceiveBatchSize( datagramCount );
+    }
+
+    // Set the size of the largest datagram which is delivered, by default
+    // DEFAULT_MAXIMUM_PACKET_SIZE. Larger datagrams are dropped and counted
+    // by the socket's TruncatedDatagramCount(). Each socket has receive
+    // buffers of this size for SetReceiveBatchSize() datagrams.
+    void SetMaximumPacketSize( std::size_t bytes )
+    {
+      impl_.SetMaximumPacketSize( bytes );
+    }
+
+    // The metrics of each attached socket, see Metrics.h. May be called
+    // from another thread while Run() executes, but not concurrently with
+    // attaching or detaching sockets. Reads as zero unless
+    // OSCPACK_ENABLE_METRICS is defined.
+    MultiplexerMetrics Metrics() const
+    {
+      return impl_.Metrics();
+    }
+
     void Run()
     {
       impl_.Run();
@@ -99,11 +168,24 @@ class SocketReceiveMultiplexer
     {
       impl_.AsynchronousBreak();
     } // call this from another thread or signal handler to exit the Run() state
+
+    // call this from another thread to make Run() check the timers again,
+    // e.g. after a scheduled timer listener's expiry was brought forward
+    void AsynchronousWakeup() override
+    {
+      impl_.AsynchronousWakeup();
+    }
 };
 
 
+template<typename Impl_T>
+class BatchSender;
+
+
 template<typename Impl_T>
 class UdpSocket{
+    friend class BatchSender<Impl_T>;
+
   protected:
     typename Impl_T::udp_socket_t impl_;
 
@@ -138,6 +220,167 @@ class UdpSocket{
         impl_.SetAllowReuse( allowReuse );
     }
 
+    // Allow several sockets to bind the same address and port with
+    // SO_REUSEPORT. On Linux the kernel then distributes incoming datagrams
+    // between the sockets by hashing the sender's address, which is what
+    // UdpReceiveGroup relies on. Must be called before Bind(). Throws
+    // std::runtime_error if the option isn't supported.
+    void SetReusePort( bool reusePort )
+    {
+        impl_.SetReusePort( reusePort );
+    }
+
+    // Request kernel receive and send buffers of the given size (SO_RCVBUF
+    // and SO_SNDBUF). A large receive buffer absorbs bursts which arrive
+    // while the receiving thread is busy. The system may adjust the
+    // size (Linux doubles it and limits it to net.core.rmem_max and
+    // wmem_max); the getters return the actual size. Throw
+    // std::runtime_error on failure.
+    void SetReceiveBufferSize( int bytes )
+    {
+        impl_.SetReceiveBufferSize( bytes );
+    }
+    int ReceiveBufferSize() const
+    {
+        return impl_.ReceiveBufferSize();
+    }
+    void SetSendBufferSize( int bytes )
+    {
+        impl_.SetSendBufferSize( bytes );
+    }
+    int SendBufferSize() const
+    {
+        return impl_.SendBufferSize();
+    }
+
+    // Busy poll the device queue for up to the given number of
+    // microseconds when receiving (SO_BUSY_POLL) to reduce latency at the
+    // cost of CPU time. Linux only, throws std::runtime_error elsewhere or
+    // if the option can't be set.
+    void SetBusyPoll( int microseconds )
+    {
+        impl_.SetBusyPoll( microseconds );
+    }
+
+    // Let the kernel coalesce datagrams from the same sender into a single
+    // buffer (UDP_GRO, Linux 5.0 or later). Multiplexers split the buffers
+    // and deliver each datagram separately, so this only reduces the number
+    // of receive calls. Linux only, throws std::runtime_error elsewhere or
+    // if the option can't be set.
+    void SetEnableReceiveOffload( bool enableReceiveOffload )
+    {
+        impl_.SetEnableReceiveOffload( enableReceiveOffload );
+    }
+
+    // Have the kernel record the time each datagram is received, which
+    // multiplexers pass on in ReceivedDatagram::receiveTimeNs (see
+    // PacketListener::ProcessDatagram()). This is the time the datagram
+    // arrived rather than the time it was processed: SO_TIMESTAMPNS on
+    // Linux, SO_TIMESTAMP (microseconds) on other posix systems. With
+    // preferHardware, SO_TIMESTAMPING is used on Linux, which reports the
+    // network device's timestamps when the device has hardware
+    // timestamping enabled, and software timestamps otherwise. Throws
+    // std::runtime_error if not supported.
+    void SetEnableReceiveTimestamps( bool enableReceiveTimestamps, bool preferHardware=false )
+    {
+        impl_.SetEnableReceiveTimestamps( enableReceiveTimestamps, preferHardware );
+    }
+
+    // Pass on the destination address of each datagram in
+    // ReceivedDatagram::localEndpoint (IP_PKTINFO, or IP_RECVDSTADDR on
+    // the BSDs), e.g. to reply from the address a request was sent to
+    // when bound to any address. Throws std::runtime_error if not
+    // supported.
+    void SetEnableReceiveLocalEndpoint( bool enableReceiveLocalEndpoint )
+    {
+        impl_.SetEnableReceiveLocalEndpoint( enableReceiveLocalEndpoint );
+    }
+
+    // On Linux a socket bound to a group's port receives the group's
+    // datagrams if any socket on the host joined it, on any interface
+    // (IP_MULTICAST_ALL). Enabling this restricts the socket to the
+    // groups it joined itself, on the interfaces it joined them on, as
+    // other systems do anyway. UdpMulticastReceiveSocket enables it.
+    // Throws std::runtime_error on failure.
+    void SetReceiveOwnMembershipsOnly( bool ownMembershipsOnly )
+    {
+        impl_.SetReceiveOwnMembershipsOnly( ownMembershipsOnly );
+    }
+
+    // Join or leave a multicast group (IP_ADD_MEMBERSHIP and
+    // IP_DROP_MEMBERSHIP) on the interface with the given local address,
+    // or on the interface the system chooses for ANY_ADDRESS. Join once
+    // for each interface to receive the group on several, or use one
+    // socket per interface with SetReceiveOwnMembershipsOnly(). The port
+    // of the endpoints is ignored. Throw std::runtime_error if group
+    // isn't a multicast address or the membership can't be changed.
+    void JoinMulticastGroup( const IpEndpointName& group,
+            const IpEndpointName& localInterface=IpEndpointName() )
+    {
+        impl_.JoinMulticastGroup( group, localInterface );
+    }
+    void LeaveMulticastGroup( const IpEndpointName& group,
+            const IpEndpointName& localInterface=IpEndpointName() )
+    {
+        impl_.LeaveMulticastGroup( group, localInterface );
+    }
+
+    // Source-specific multicast: receive only what source sends to group
+    // (IP_ADD_SOURCE_MEMBERSHIP and IP_DROP_SOURCE_MEMBERSHIP). May be
+    // called for several sources of the same group, but not for a group
+    // joined with JoinMulticastGroup(). Throw std::runtime_error on
+    // failure.
+    void JoinSourceGroup( const IpEndpointName& group, const IpEndpointName& source,
+            const IpEndpointName& localInterface=IpEndpointName() )
+    {
+        impl_.JoinSourceGroup( group, source, localInterface );
+    }
+    void LeaveSourceGroup( const IpEndpointName& group, const IpEndpointName& source,
+            const IpEndpointName& localInterface=IpEndpointName() )
+    {
+        impl_.LeaveSourceGroup( group, source, localInterface );
+    }
+
+    // Send multicast datagrams through the interface with the given local
+    // address (IP_MULTICAST_IF) rather than the one the routing table
+    // chooses. Throws std::runtime_error on failure.
+    void SetMulticastInterface( const IpEndpointName& localInterface )
+    {
+        impl_.SetMulticastInterface( localInterface );
+    }
+
+    // The number of routers multicast datagrams may cross, 0 to 255
+    // (IP_MULTICAST_TTL). The default of 1 keeps them on the local
+    // network. Throws std::runtime_error on failure.
+    void SetMulticastTtl( int ttl )
+    {
+        impl_.SetMulticastTtl( ttl );
+    }
+
+    // Whether multicast datagrams are also delivered to sockets on this
+    // host which joined the group (IP_MULTICAST_LOOP, enabled by
+    // default). On posix systems this is set on the sending socket, on
+    // win32 on the receiving one. Throws std::runtime_error on failure.
+    void SetMulticastLoopback( bool enableLoopback )
+    {
+        impl_.SetMulticastLoopback( enableLoopback );
+    }
+
+    // The number of datagrams received on this socket which were larger
+    // than the receive buffer and were truncated. Multiplexers drop them.
+    std::size_t TruncatedDatagramCount() const
+    {
+        return impl_.TruncatedDatagramCount();
+    }
+
+    // Receive counters of this socket, see Metrics.h. All but
+    // truncatedDatagramCount read as zero unless OSCPACK_ENABLE_METRICS
+    // is defined.
+    SocketMetrics Metrics() const
+    {
+        return impl_.Metrics();
+    }
+
 
     // The socket is created in an unbound, unconnected state
     // such a socket can only be used to send to an arbitrary
@@ -186,6 +429,73 @@ class UdpSocket{
 };
 
 
+// BatchSender collects datagrams for any number of endpoints and sends
+// them together with Flush(): with a few sendmmsg() calls on Linux (one
+// per 1024 datagrams), elsewhere with one sendto() per datagram.
+// Consecutive datagrams of the same size to the same endpoint are sent as
+// a single UDP GSO (UDP_SEGMENT) buffer where the kernel supports it.
+//
+// The datagram data isn't copied, it must remain valid until Flush()
+// returns. This makes fanning one packet out to many endpoints cheap:
+//
+//     BatchSender sender( socket );
+//     for( const IpEndpointName& peer : peers )
+//         sender.Add( peer, ps );
+//     if( sender.Flush() != 0 ){
+//         // check sender.Datagram( i ).error
+//     }
+//
+// Unlike Send() and SendTo(), which ignore errors, the result of every
+// datagram is reported. Different BatchSenders may flush to the same
+// socket from different threads.
+template<typename Impl_T>
+class BatchSender{
+    UdpSocket<Impl_T>& socket_;
+    typename Impl_T::send_batch_t batch_;
+    bool flushed_;
+
+  public:
+    explicit BatchSender( UdpSocket<Impl_T>& socket )
+      : socket_( socket )
+      , flushed_( false ) {}
+
+    // queue a datagram. the first Add() after Flush() starts a new batch.
+    void Add( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
+    {
+      if( flushed_ ){
+        batch_.Clear();
+        flushed_ = false;
+      }
+      batch_.Add( remoteEndpoint, data, size );
+    }
+
+    // queue the contents of a packet, e.g. an OutboundPacketStream
+    template<typename Packet_T>
+    void Add( const IpEndpointName& remoteEndpoint, const Packet_T& packet )
+    {
+      Add( remoteEndpoint, packet.Data(), packet.Size() );
+    }
+
+    // send all queued datagrams and return the number which failed. the
+    // datagrams, with their error codes, remain accessible until the
+    // next Add().
+    std::size_t Flush()
+    {
+      flushed_ = true;
+      return socket_.impl_.SendMany( batch_ );
+    }
+
+    void Clear()
+    {
+      batch_.Clear();
+      flushed_ = false;
+    }
+
+    std::size_t Size() const { return batch_.Size(); }
+    const OutgoingDatagram& Datagram( std::size_t i ) const { return batch_.Datagram( i ); }
+};
+
+
 // convenience classes for transmitting and receiving
 // they just call Connect and/or Bind in the ctor.
 // note that you can still use a receive socket
@@ -206,6 +516,44 @@ class UdpReceiveSocket : public UdpSocket<Impl_T>{
 };
 
 
+// UdpMulticastTransmitSocket sends to a multicast group through the
+// given interface, or the one the routing table chooses for ANY_ADDRESS.
+// loopback controls whether receivers on this host see the datagrams on
+// posix systems, see UdpSocket::SetMulticastLoopback().
+template<typename Impl_T>
+class UdpMulticastTransmitSocket : public UdpSocket<Impl_T>{
+  public:
+    UdpMulticastTransmitSocket( const IpEndpointName& group,
+            const IpEndpointName& localInterface=IpEndpointName(),
+            int ttl=1, bool loopback=true )
+    {
+      if( localInterface.address != IpEndpointName::ANY_ADDRESS )
+        this->SetMulticastInterface( localInterface );
+      this->SetMulticastTtl( ttl );
+      this->SetMulticastLoopback( loopback );
+      this->Connect( group );
+    }
+};
+
+
+// UdpMulticastReceiveSocket binds group's port, allowing reuse so
+// that several sockets (e.g. one per interface) and processes can
+// receive the same group, and joins group on the given interface. It
+// only receives its own memberships, see SetReceiveOwnMembershipsOnly().
+template<typename Impl_T>
+class UdpMulticastReceiveSocket : public UdpSocket<Impl_T>{
+  public:
+    UdpMulticastReceiveSocket( const IpEndpointName& group,
+            const IpEndpointName& localInterface=IpEndpointName() )
+    {
+      this->SetAllowReuse( true );
+      this->SetReceiveOwnMembershipsOnly( true );
+      this->Bind( Impl_T::udp_socket_t::MulticastBindEndpoint( group ) );
+      this->JoinMulticastGroup( group, localInterface );
+    }
+};
+
+
 // UdpListeningReceiveSocket provides a simple way to bind one listener
 // to a single socket without having to manually set up a SocketReceiveMultiplexer
 
@@ -225,6 +573,33 @@ class UdpListeningReceiveSocket : public UdpSocket<Impl_T>{
     { mux_.DetachSocketListener( &this->impl_, listener_ ); }
 
     // see SocketReceiveMultiplexer above for the behaviour of these methods...
+    void SetMaximumPacketSize( std::size_t bytes ) { mux_.SetMaximumPacketSize( bytes ); }
+    void Run() { mux_.Run(); }
+    void Break() { mux_.Break(); }
+    void AsynchronousBreak() { mux_.AsynchronousBreak(); }
+};
+
+
+// UdpListeningMulticastReceiveSocket is UdpListeningReceiveSocket for
+// a multicast group, see UdpMulticastReceiveSocket
+
+template<typename Impl_T>
+class UdpListeningMulticastReceiveSocket : public UdpMulticastReceiveSocket<Impl_T>{
+    SocketReceiveMultiplexer<Impl_T> mux_;
+    PacketListener *listener_;
+  public:
+    UdpListeningMulticastReceiveSocket( const IpEndpointName& group, PacketListener *listener,
+            const IpEndpointName& localInterface=IpEndpointName() )
+      : UdpMulticastReceiveSocket<Impl_T>( group, localInterface )
+      , listener_( listener )
+    {
+      mux_.AttachSocketListener( &this->impl_, listener_ );
+    }
+
+    ~UdpListeningMulticastReceiveSocket()
+    { mux_.DetachSocketListener( &this->impl_, listener_ ); }
+
+    void SetMaximumPacketSize( std::size_t bytes ) { mux_.SetMaximumPacketSize( bytes ); }
     void Run() { mux_.Run(); }
     void Break() { mux_.Break(); }
     void AsynchronousBreak() { mux_.AsynchronousBreak(); }
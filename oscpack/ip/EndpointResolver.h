@@ -0,0 +1,362 @@
+/*
+    oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files
+    (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and/or sell copies of the Software,
+    and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+    The text above constitutes the entire oscpack license; however,
+    the oscpack developer(s) also make the following non-binding requests:
+
+    Any person wishing to distribute modifications to the Software is
+    requested to send the modifications to the original developer so that
+    they can be incorporated into the canonical version. It is also
+    requested that these non-binding requests be included whenever the
+    above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_ENDPOINTRESOLVER_H
+#define INCLUDED_OSCPACK_ENDPOINTRESOLVER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "IpEndpointName.h"
+#include "NetworkingUtils.h"
+#include "TimerListener.h"
+#include "TimerQueue.h"
+
+
+namespace oscpack
+{
+
+class ResolveListener{
+public:
+    virtual ~ResolveListener() {}
+
+    // called by EndpointResolver::TimerExpired() when an asynchronous
+    // lookup completes. endpoint is only valid if succeeded is true.
+    virtual void EndpointResolved( const char *hostName,
+            const IpEndpointName& endpoint, bool succeeded ) = 0;
+};
+
+
+// Host name resolution with a cache, so that endpoints can be looked up
+// on a send path without blocking on DNS or allocating. Results are
+// cached for successTtlSeconds, and failures for failureTtlSeconds (so a
+// missing host isn't queried on every send). getaddrinfo() doesn't
+// report DNS record TTLs, so these are fixed.
+//
+// ResolveAsync() performs the lookup on a worker thread and delivers the
+// result on the thread which runs the multiplexer, by way of
+// TimerExpired(): attach the resolver with
+// AttachScheduledTimerListener(). Results wake the multiplexer, which
+// doesn't poll. Up to MAXIMUM_WORKER_COUNT lookups run at once, so a slow
+// lookup only delays the others once that many are in progress.
+//
+//     EndpointResolver resolver;
+//     mux.AttachScheduledTimerListener( &resolver );
+//     resolver.ResolveAsync( "synth.local", 57110, &listener );
+//
+// All methods are thread safe. Lookup() never blocks on DNS or allocates.
+// Host names longer than MAXIMUM_HOST_NAME_LENGTH are resolved but not
+// cached.
+class EndpointResolver : public ScheduledTimerListener{
+public:
+    static constexpr std::size_t MAXIMUM_HOST_NAME_LENGTH = 253;
+
+    // worker threads are started as lookups are requested, up to this many
+    static constexpr std::size_t MAXIMUM_WORKER_COUNT = 4;
+
+    // resolves a host name to an address in host byte order, see
+    // LookupHostAddress()
+    typedef bool (*LookupFunction)( const char *hostName, unsigned long& address );
+
+private:
+    struct Entry{
+        char hostName[ MAXIMUM_HOST_NAME_LENGTH + 1 ];
+        unsigned long address;
+        bool succeeded;
+        double expiryMs; // 0 for an unused entry
+    };
+
+    struct Request{
+        std::string hostName;
+        int port;
+        ResolveListener *listener;
+        IpEndpointName endpoint;
+        bool succeeded;
+    };
+
+    double successTtlMs_;
+    double failureTtlMs_;
+    LookupFunction lookup_;
+
+    std::mutex mutex_;
+    std::vector<Entry> entries_;
+    std::deque<Request> requests_;
+    std::vector<Request> completions_;
+    std::vector<Request> delivering_;
+    // the listener of each worker's lookup in progress, cleared by Cancel()
+    ResolveListener *inFlightListeners_[ MAXIMUM_WORKER_COUNT ] = {};
+    std::size_t idleWorkerCount_ = 0;
+    bool stop_ = false;
+    std::condition_variable requestAvailable_;
+    std::vector<std::thread> workers_;
+
+    // mutex_ must be held. returns true if the multiplexer has to be woken
+    // (after unlocking): it is woken once until the completions are
+    // delivered
+    bool Complete( Request&& request )
+    {
+        completions_.push_back( std::move( request ) );
+        return completions_.size() == 1;
+    }
+
+    // mutex_ must be held
+    Entry *Find( const char *hostName, double nowMs )
+    {
+        for( Entry& e : entries_ ){
+            if( e.expiryMs > nowMs && std::strcmp( e.hostName, hostName ) == 0 )
+                return &e;
+        }
+        return 0;
+    }
+
+    // mutex_ must be held. replaces the entry for hostName, else an expired
+    // entry, else the entry which expires first
+    void Store( const char *hostName, unsigned long address, bool succeeded, double nowMs )
+    {
+        std::size_t length = std::strlen( hostName );
+        if( length > MAXIMUM_HOST_NAME_LENGTH || entries_.empty() )
+            return;
+
+        Entry *slot = &entries_[0];
+        for( Entry& e : entries_ ){
+            if( std::strcmp( e.hostName, hostName ) == 0 ){
+                slot = &e;
+                break;
+            }
+            if( e.expiryMs <= nowMs || e.expiryMs < slot->expiryMs )
+                slot = &e;
+        }
+
+        std::memcpy( slot->hostName, hostName, length + 1 );
+        slot->address = address;
+        slot->succeeded = succeeded;
+        slot->expiryMs = nowMs + (succeeded ? successTtlMs_ : failureTtlMs_);
+    }
+
+    void RunWorker( std::size_t index )
+    {
+        std::unique_lock<std::mutex> lock( mutex_ );
+        for(;;){
+            ++idleWorkerCount_;
+            requestAvailable_.wait( lock, [this](){ return stop_ || !requests_.empty(); } );
+            --idleWorkerCount_;
+            if( stop_ )
+                return;
+
+            Request request = std::move( requests_.front() );
+            requests_.pop_front();
+            inFlightListeners_[index] = request.listener;
+
+            lock.unlock();
+            unsigned long address = 0;
+            request.succeeded = lookup_( request.hostName.c_str(), address );
+            request.endpoint = IpEndpointName( address, request.port );
+            lock.lock();
+
+            request.listener = inFlightListeners_[index];
+            inFlightListeners_[index] = 0;
+            Store( request.hostName.c_str(), address, request.succeeded, detail::SteadyTimeMs() );
+            if( request.listener && Complete( std::move( request ) ) ){
+                lock.unlock();
+                WakeMultiplexer();
+                lock.lock();
+            }
+        }
+    }
+
+public:
+    explicit EndpointResolver( double successTtlSeconds=60., double failureTtlSeconds=5.,
+            std::size_t cacheCapacity=64, LookupFunction lookup=&LookupHostAddress )
+        : successTtlMs_( successTtlSeconds * 1000. )
+        , failureTtlMs_( failureTtlSeconds * 1000. )
+        , lookup_( lookup )
+    {
+        entries_.resize( cacheCapacity );
+        workers_.reserve( MAXIMUM_WORKER_COUNT );
+        for( Entry& e : entries_ ){
+            e.hostName[0] = '\0';
+            e.expiryMs = 0;
+        }
+    }
+
+    ~EndpointResolver()
+    {
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            stop_ = true;
+        }
+        requestAvailable_.notify_all();
+        for( std::thread& worker : workers_ )
+            worker.join();
+    }
+
+    EndpointResolver( const EndpointResolver& ) = delete;
+    EndpointResolver& operator=( const EndpointResolver& ) = delete;
+
+    // returns true and sets endpoint if hostName has been resolved
+    // successfully within its TTL. never blocks on DNS or allocates.
+    bool Lookup( const char *hostName, int port, IpEndpointName& endpoint )
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        const Entry *e = Find( hostName, detail::SteadyTimeMs() );
+        if( !e || !e->succeeded )
+            return false;
+
+        endpoint = IpEndpointName( e->address, port );
+        return true;
+    }
+
+    // a cached result, or else a blocking lookup whose result is cached.
+    // returns false if hostName can't be resolved.
+    bool Resolve( const char *hostName, int port, IpEndpointName& endpoint )
+    {
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            if( const Entry *e = Find( hostName, detail::SteadyTimeMs() ) ){
+                if( e->succeeded )
+                    endpoint = IpEndpointName( e->address, port );
+                return e->succeeded;
+            }
+        }
+
+        unsigned long address = 0;
+        bool succeeded = lookup_( hostName, address );
+
+        std::lock_guard<std::mutex> lock( mutex_ );
+        Store( hostName, address, succeeded, detail::SteadyTimeMs() );
+        if( succeeded )
+            endpoint = IpEndpointName( address, port );
+        return succeeded;
+    }
+
+    // calls listener->EndpointResolved() from TimerExpired() once hostName
+    // is resolved: on the next call if it is cached, otherwise after a
+    // lookup on a worker thread. listener may be 0 to just fill the
+    // cache.
+    void ResolveAsync( const char *hostName, int port, ResolveListener *listener )
+    {
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            if( const Entry *e = Find( hostName, detail::SteadyTimeMs() ) ){
+                if( !listener || !Complete( Request{ hostName, port, listener,
+                        IpEndpointName( e->address, port ), e->succeeded } ) )
+                    return;
+            }else{
+                requests_.push_back( Request{ hostName, port, listener, IpEndpointName(), false } );
+                if( requests_.size() > idleWorkerCount_ && workers_.size() < MAXIMUM_WORKER_COUNT )
+                    workers_.emplace_back( &EndpointResolver::RunWorker, this, workers_.size() );
+                requestAvailable_.notify_one();
+                return; // the worker wakes the multiplexer
+            }
+        }
+        WakeMultiplexer();
+    }
+
+    // discards the pending notifications for listener, e.g. before it is
+    // destroyed, including that of a lookup in progress on a worker
+    // thread. lookups continue, and their results are still cached.
+    // call from the thread which calls TimerExpired() (it may be called
+    // from EndpointResolved()), or while TimerExpired() can't be called.
+    void Cancel( ResolveListener *listener )
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        for( Request& r : delivering_ ){
+            if( r.listener == listener )
+                r.listener = 0;
+        }
+        for( Request& r : requests_ ){
+            if( r.listener == listener )
+                r.listener = 0;
+        }
+        for( ResolveListener*& inFlight : inFlightListeners_ ){
+            if( inFlight == listener )
+                inFlight = 0;
+        }
+        for( std::size_t i=0; i < completions_.size(); ){
+            if( completions_[i].listener == listener )
+                completions_.erase( completions_.begin() + i );
+            else
+                ++i;
+        }
+    }
+
+    // removes every cached result
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        for( Entry& e : entries_ ){
+            e.hostName[0] = '\0';
+            e.expiryMs = 0;
+        }
+    }
+
+    bool NextExpiryMs( double& expiryMs ) override
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        if( completions_.empty() )
+            return false;
+        expiryMs = 0; // already due
+        return true;
+    }
+
+    // delivers completed lookups. called by the multiplexer, or call it
+    // directly to use the resolver without one.
+    void TimerExpired() override
+    {
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            delivering_.swap( completions_ );
+        }
+
+        for( std::size_t i=0; i < delivering_.size(); ++i ){
+            const Request& r = delivering_[i];
+            if( r.listener )
+                r.listener->EndpointResolved( r.hostName.c_str(), r.endpoint, r.succeeded );
+        }
+        delivering_.clear();
+    }
+};
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_ENDPOINTRESOLVER_H */
@@ -37,12 +37,54 @@
 #ifndef INCLUDED_OSCPACK_IPENDPOINTNAME_H
 #define INCLUDED_OSCPACK_IPENDPOINTNAME_H
 
-#include <cstdio>
+#include <cstring>
 
 #include "NetworkingUtils.h"
 
 namespace oscpack
 {
+namespace detail
+{
+// writes the decimal digits of value to s and returns the end of the
+// digits. s is not null terminated.
+inline char *FormatDecimal( char *s, long value )
+{
+    unsigned long magnitude = (unsigned long)value;
+    if( value < 0 ){
+        *s++ = '-';
+        magnitude = 0UL - magnitude;
+    }
+
+    char digits[20];
+    int count = 0;
+    do{
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    }while( magnitude );
+
+    while( count > 0 )
+        *s++ = digits[--count];
+    return s;
+}
+
+// writes the dotted quad form of an address in host byte order, or <any>
+// for IpEndpointName::ANY_ADDRESS, and returns the end
+inline char *FormatAddress( char *s, unsigned long address )
+{
+    if( address == 0xFFFFFFFF ){
+        std::memcpy( s, "<any>", 5 );
+        return s + 5;
+    }
+
+    for( int shift = 24; shift >= 0; shift -= 8 ){
+        s = FormatDecimal( s, (long)((address >> shift) & 0xFF) );
+        if( shift )
+            *s++ = '.';
+    }
+    return s;
+}
+}
+
 class IpEndpointName
 {
     static unsigned long GetHostByName( const char *s )
@@ -73,47 +115,26 @@ class IpEndpointName
 
     bool IsMulticastAddress() const { return ((address >> 24) & 0xFF) >= 224 && ((address >> 24) & 0xFF) <= 239; }
 
+    // the string forms are written without sprintf, so they are cheap
+    // enough to produce for every packet and don't depend on the locale
     enum { ADDRESS_STRING_LENGTH=17 };
     void AddressAsString( char *s ) const
     {
-      if( address == ANY_ADDRESS ){
-        std::sprintf( s, "<any>" );
-      }else{
-        std::sprintf( s, "%d.%d.%d.%d",
-                      (int)((address >> 24) & 0xFF),
-                      (int)((address >> 16) & 0xFF),
-                      (int)((address >> 8) & 0xFF),
-                      (int)(address & 0xFF) );
-      }
+      *detail::FormatAddress( s, address ) = '\0';
     }
 
     enum { ADDRESS_AND_PORT_STRING_LENGTH=23};
     void AddressAndPortAsString( char *s ) const
     {
+      s = detail::FormatAddress( s, address );
+      *s++ = ':';
       if( port == ANY_PORT ){
-        if( address == ANY_ADDRESS ){
-          std::sprintf( s, "<any>:<any>" );
-        }else{
-          std::sprintf( s, "%d.%d.%d.%d:<any>",
-                        (int)((address >> 24) & 0xFF),
-                        (int)((address >> 16) & 0xFF),
-                        (int)((address >> 8) & 0xFF),
-                        (int)(address & 0xFF) );
-        }
-      }
-      else
-      {
-        if( address == ANY_ADDRESS ){
-          std::sprintf( s, "<any>:%d", port );
-        }else{
-          std::sprintf( s, "%d.%d.%d.%d:%d",
-                        (int)((address >> 24) & 0xFF),
-                        (int)((address >> 16) & 0xFF),
-                        (int)((address >> 8) & 0xFF),
-                        (int)(address & 0xFF),
-                        (int)port );
-        }
+        std::memcpy( s, "<any>", 5 );
+        s += 5;
+      }else{
+        s = detail::FormatDecimal( s, port );
       }
+      *s = '\0';
     }
 };
 
@@ -0,0 +1,259 @@
+/*
+    oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files
+    (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and/or sell copies of the Software,
+    and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+    The text above constitutes the entire oscpack license; however,
+    the oscpack developer(s) also make the following non-binding requests:
+
+    Any person wishing to distribute modifications to the Software is
+    requested to send the modifications to the original developer so that
+    they can be incorporated into the canonical version. It is also
+    requested that these non-binding requests be included whenever the
+    above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_METRICS_H
+#define INCLUDED_OSCPACK_METRICS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Instrumentation of the sockets, multiplexers and OscPacketListener.
+//
+// Counters and histograms are only maintained if OSCPACK_ENABLE_METRICS
+// is defined when oscpack is compiled. Otherwise the metrics types are
+// empty, recording compiles to nothing, and snapshots read as zero.
+//
+// All recording uses relaxed atomic operations, so snapshots may be taken
+// from any thread (e.g. a monitoring thread) while a multiplexer runs.
+// A snapshot is not atomic as a whole: counters read at slightly
+// different times may be inconsistent with each other by a few events.
+
+namespace oscpack
+{
+
+#if defined(OSCPACK_ENABLE_METRICS)
+constexpr bool METRICS_ENABLED = true;
+#else
+constexpr bool METRICS_ENABLED = false;
+#endif
+
+
+// counters read from the sockets of a multiplexer
+struct SocketMetrics{
+    uint64_t receivedDatagramCount = 0;
+    uint64_t receivedByteCount = 0;
+
+    // receive calls which failed. empty datagrams aren't failures
+    uint64_t failedReceiveCount = 0;
+
+    // datagrams larger than the receive buffer, see TruncatedDatagramCount()
+    uint64_t truncatedDatagramCount = 0;
+
+    // datagrams dropped by the kernel because the socket receive buffer
+    // was full, as reported by SO_RXQ_OVFL (Linux only). the count is
+    // updated when a datagram is received after the drops.
+    uint64_t kernelDropCount = 0;
+
+    SocketMetrics& operator+=( const SocketMetrics& rhs )
+    {
+        receivedDatagramCount += rhs.receivedDatagramCount;
+        receivedByteCount += rhs.receivedByteCount;
+        failedReceiveCount += rhs.failedReceiveCount;
+        truncatedDatagramCount += rhs.truncatedDatagramCount;
+        kernelDropCount += rhs.kernelDropCount;
+        return *this;
+    }
+};
+
+struct MultiplexerMetrics{
+    // in the order the sockets were attached
+    std::vector<SocketMetrics> sockets;
+    SocketMetrics total;
+};
+
+
+// a bucketed distribution of durations in nanoseconds, after the HDR
+// histogram: buckets are linear within each power of two, so recorded
+// values are reported with a relative error of at most 1/SUB_BUCKET_COUNT.
+// values of 2^36 ns (about 68 seconds) and more fall in the last bucket.
+struct LatencyHistogramSnapshot{
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr std::size_t SUB_BUCKET_COUNT = std::size_t(1) << SUB_BUCKET_BITS;
+    static constexpr int MAXIMUM_VALUE_BITS = 36;
+    static constexpr std::size_t BUCKET_COUNT =
+            (MAXIMUM_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    static std::size_t BucketIndex( uint64_t ns )
+    {
+        if( ns >= (uint64_t(1) << MAXIMUM_VALUE_BITS) )
+            return BUCKET_COUNT - 1;
+
+        if( ns < 2 * SUB_BUCKET_COUNT )
+            return (std::size_t)ns;
+
+        int highestBit = 63;
+        while( !(ns & (uint64_t(1) << highestBit)) )
+            --highestBit;
+
+        int shift = highestBit - SUB_BUCKET_BITS;
+        return shift * SUB_BUCKET_COUNT + (std::size_t)(ns >> shift);
+    }
+
+    // the largest value which falls in bucket index
+    static uint64_t BucketUpperBound( std::size_t index )
+    {
+        if( index < 2 * SUB_BUCKET_COUNT )
+            return index;
+
+        std::size_t shift = index / SUB_BUCKET_COUNT - 1;
+        uint64_t subBucket = index - shift * SUB_BUCKET_COUNT;
+        return ((subBucket + 1) << shift) - 1;
+    }
+
+    uint64_t counts[ BUCKET_COUNT ] = {};
+    uint64_t count = 0;
+    uint64_t maximumNs = 0;
+
+    // the value below which fraction (0..1) of the recorded values fall,
+    // to within the bucket resolution. returns 0 if nothing was recorded.
+    uint64_t PercentileNs( double fraction ) const
+    {
+        if( count == 0 )
+            return 0;
+
+        uint64_t rank = (uint64_t)(fraction * (double)count + 0.5);
+        if( rank < 1 )
+            rank = 1;
+
+        uint64_t seen = 0;
+        for( std::size_t i=0; i < BUCKET_COUNT; ++i ){
+            seen += counts[i];
+            if( seen >= rank )
+                return std::min( BucketUpperBound( i ), maximumNs );
+        }
+        return maximumNs;
+    }
+};
+
+
+namespace detail
+{
+
+class MetricCounter{
+#if defined(OSCPACK_ENABLE_METRICS)
+    std::atomic<uint64_t> value_{ 0 };
+public:
+    void Add( uint64_t n=1 ) { value_.fetch_add( n, std::memory_order_relaxed ); }
+    void Set( uint64_t value ) { value_.store( value, std::memory_order_relaxed ); }
+    uint64_t Value() const { return value_.load( std::memory_order_relaxed ); }
+#else
+public:
+    void Add( uint64_t n=1 ) { (void) n; }
+    void Set( uint64_t value ) { (void) value; }
+    uint64_t Value() const { return 0; }
+#endif
+};
+
+
+// a lock-free LatencyHistogramSnapshot, recorded into by one or more
+// threads
+class LatencyHistogram{
+#if defined(OSCPACK_ENABLE_METRICS)
+    typedef LatencyHistogramSnapshot snapshot_type;
+
+    std::atomic<uint64_t> counts_[ snapshot_type::BUCKET_COUNT ] = {};
+    std::atomic<uint64_t> maximumNs_{ 0 };
+public:
+    void Record( uint64_t ns )
+    {
+        counts_[ snapshot_type::BucketIndex( ns ) ].fetch_add( 1, std::memory_order_relaxed );
+
+        uint64_t maximum = maximumNs_.load( std::memory_order_relaxed );
+        while( ns > maximum
+                && !maximumNs_.compare_exchange_weak( maximum, ns, std::memory_order_relaxed ) )
+            ;
+    }
+
+    void Read( LatencyHistogramSnapshot& snapshot ) const
+    {
+        snapshot.count = 0;
+        for( std::size_t i=0; i < snapshot_type::BUCKET_COUNT; ++i ){
+            snapshot.counts[i] = counts_[i].load( std::memory_order_relaxed );
+            snapshot.count += snapshot.counts[i];
+        }
+        snapshot.maximumNs = maximumNs_.load( std::memory_order_relaxed );
+    }
+#else
+public:
+    void Record( uint64_t ns ) { (void) ns; }
+    void Read( LatencyHistogramSnapshot& snapshot ) const { snapshot = LatencyHistogramSnapshot(); }
+#endif
+};
+
+
+// measures the time from construction to Stop() into a histogram. the
+// clock is not read if metrics are disabled.
+class LatencyTimer{
+    std::chrono::steady_clock::time_point start_;
+public:
+    LatencyTimer()
+    {
+        if( METRICS_ENABLED )
+            start_ = std::chrono::steady_clock::now();
+    }
+
+    void Stop( LatencyHistogram& histogram ) const
+    {
+        if( METRICS_ENABLED ){
+            using namespace std::chrono;
+            histogram.Record( (uint64_t)duration_cast<nanoseconds>( steady_clock::now() - start_ ).count() );
+        }
+    }
+};
+
+
+// the metrics of the sockets of a multiplexer's socketListeners_
+template<typename SocketListeners_T>
+MultiplexerMetrics CollectMultiplexerMetrics( const SocketListeners_T& socketListeners )
+{
+    MultiplexerMetrics result;
+    result.sockets.reserve( socketListeners.size() );
+    for( std::size_t i=0; i < socketListeners.size(); ++i ){
+        result.sockets.push_back( socketListeners[i].second->Metrics() );
+        result.total += result.sockets.back();
+    }
+    return result;
+}
+
+} // namespace detail
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_METRICS_H */
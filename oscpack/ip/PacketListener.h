@@ -37,15 +37,63 @@
 #ifndef INCLUDED_OSCPACK_PACKETLISTENER_H
 #define INCLUDED_OSCPACK_PACKETLISTENER_H
 
+#include <cstddef> // size_t
+#include <cstdint>
+
+#include "IpEndpointName.h"
+
 namespace oscpack
 {
-class IpEndpointName;
+
+// the size of the largest datagram received by a multiplexer unless
+// SocketReceiveMultiplexer::SetMaximumPacketSize() is called
+constexpr std::size_t DEFAULT_MAXIMUM_PACKET_SIZE = 4098;
+
+// a single datagram delivered by ProcessPackets() and ProcessDatagram().
+// data points into storage owned by the multiplexer and is only valid
+// for the duration of the call.
+struct ReceivedDatagram{
+    const char *data;
+    int size;
+    IpEndpointName remoteEndpoint;
+
+    // the address the datagram was sent to (which differs from the bound
+    // address for sockets bound to any address) and the socket's port.
+    // only set if enabled with UdpSocket::SetEnableReceiveLocalEndpoint()
+    IpEndpointName localEndpoint = IpEndpointName();
+
+    // the kernel's receive time in nanoseconds since the unix epoch on the
+    // system (realtime) clock, or the network device's clock for hardware
+    // timestamps. 0 unless enabled with
+    // UdpSocket::SetEnableReceiveTimestamps(). see TimeTagFromUnixTimeNs()
+    int64_t receiveTimeNs = 0;
+};
 
 class PacketListener{
   public:
     virtual ~PacketListener() {}
     virtual void ProcessPacket( const char *data, int size,
                                 const IpEndpointName& remoteEndpoint ) = 0;
+
+    // called by multiplexers that receive several datagrams with a single
+    // system call (see SocketReceiveMultiplexer::SetReceiveBatchSize()).
+    // override this to process a whole batch at once. the default
+    // implementation calls ProcessPacket() once per datagram, in order.
+    // note that a Break() issued while processing a batch takes effect
+    // once the whole batch has been delivered.
+    virtual void ProcessPackets( const ReceivedDatagram *datagrams, std::size_t count )
+    {
+        for( std::size_t i=0; i < count; ++i )
+            ProcessDatagram( datagrams[i] );
+    }
+
+    // called by the default ProcessPackets() for each datagram. override
+    // this for access to the receive time and local endpoint. the default
+    // implementation calls ProcessPacket().
+    virtual void ProcessDatagram( const ReceivedDatagram& datagram )
+    {
+        ProcessPacket( datagram.data, datagram.size, datagram.remoteEndpoint );
+    }
 };
 }
 #endif /* INCLUDED_OSCPACK_PACKETLISTENER_H */
@@ -0,0 +1,192 @@
+/*
+    oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files
+    (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and/or sell copies of the Software,
+    and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+    The text above constitutes the entire oscpack license; however,
+    the oscpack developer(s) also make the following non-binding requests:
+
+    Any person wishing to distribute modifications to the Software is
+    requested to send the modifications to the original developer so that
+    they can be incorporated into the canonical version. It is also
+    requested that these non-binding requests be included whenever the
+    above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_QUEUEDPACKETLISTENER_H
+#define INCLUDED_OSCPACK_QUEUEDPACKETLISTENER_H
+
+#include <atomic>
+#include <cstddef> // size_t
+#include <cstdint>
+#include <cstring> // memcpy
+#include <memory>
+
+#include "PacketListener.h"
+
+namespace oscpack
+{
+
+// QueuedPacketListener hands received datagrams from the socket thread to
+// another thread (e.g. an audio or render callback) through a bounded,
+// lock-free single-producer/single-consumer ring.
+//
+// ProcessPacket() runs on the receive thread: it copies the datagram into
+// the next free slot and returns immediately. Datagrams larger than
+// MaxPacketSize, or arriving while all SlotCount slots are full, are
+// dropped and counted. Poll() runs on the consuming thread: it is
+// wait-free and delivers queued datagrams to another listener, typically
+// an OscPacketListener.
+//
+// All storage is allocated by the constructor. Only one thread may call
+// ProcessPacket()/ProcessPackets() and only one (other) thread may call
+// Poll().
+
+template< std::size_t MaxPacketSize=DEFAULT_MAXIMUM_PACKET_SIZE, std::size_t SlotCount=256 >
+class QueuedPacketListener : public PacketListener{
+    static_assert( SlotCount > 0 && (SlotCount & (SlotCount - 1)) == 0,
+            "SlotCount must be a power of two" );
+
+    enum { CACHE_LINE_SIZE = 64 };
+
+    struct alignas(CACHE_LINE_SIZE) Slot{
+        char data[ MaxPacketSize ];
+        ReceivedDatagram datagram; // data points to the slot's data
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+
+    // producer and consumer indices are kept on separate cache lines. they
+    // increase monotonically and are masked when indexing slots_
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> writeIndex_;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> readIndex_;
+
+    // only written by the producer
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> overrunCount_;
+    std::atomic<uint64_t> oversizeCount_;
+
+    bool Push( const ReceivedDatagram& datagram, std::size_t writeIndex )
+    {
+        if( datagram.size < 0 || (std::size_t)datagram.size > MaxPacketSize ){
+            oversizeCount_.store( oversizeCount_.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+            return false;
+        }
+
+        if( writeIndex - readIndex_.load( std::memory_order_acquire ) == SlotCount ){
+            overrunCount_.store( overrunCount_.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+            return false;
+        }
+
+        Slot& slot = slots_[ writeIndex & (SlotCount - 1) ];
+        std::memcpy( slot.data, datagram.data, datagram.size );
+        slot.datagram = datagram;
+        slot.datagram.data = slot.data;
+        return true;
+    }
+
+  public:
+    QueuedPacketListener()
+      : slots_( new Slot[ SlotCount ] )
+      , writeIndex_( 0 )
+      , readIndex_( 0 )
+      , overrunCount_( 0 )
+      , oversizeCount_( 0 ) {}
+
+    QueuedPacketListener( const QueuedPacketListener& ) = delete;
+    QueuedPacketListener& operator=( const QueuedPacketListener& ) = delete;
+
+    void ProcessPacket( const char *data, int size,
+                        const IpEndpointName& remoteEndpoint ) override
+    {
+        ReceivedDatagram datagram;
+        datagram.data = data;
+        datagram.size = size;
+        datagram.remoteEndpoint = remoteEndpoint;
+        ProcessDatagram( datagram );
+    }
+
+    void ProcessDatagram( const ReceivedDatagram& datagram ) override
+    {
+        std::size_t writeIndex = writeIndex_.load( std::memory_order_relaxed );
+        if( Push( datagram, writeIndex ) )
+            writeIndex_.store( writeIndex + 1, std::memory_order_release );
+    }
+
+    // publishes the whole batch with a single release store
+    void ProcessPackets( const ReceivedDatagram *datagrams, std::size_t count ) override
+    {
+        std::size_t writeIndex = writeIndex_.load( std::memory_order_relaxed );
+        for( std::size_t i=0; i < count; ++i ){
+            if( Push( datagrams[i], writeIndex ) )
+                ++writeIndex;
+        }
+        writeIndex_.store( writeIndex, std::memory_order_release );
+    }
+
+    // Deliver at most maxPackets queued datagrams to listener with
+    // ProcessDatagram(), in arrival order, and return the number delivered.
+    // Each slot is released as soon as the listener returns (or throws) so
+    // the producer can reuse it.
+    std::size_t Poll( PacketListener& listener, std::size_t maxPackets=SlotCount )
+    {
+        std::size_t readIndex = readIndex_.load( std::memory_order_relaxed );
+        std::size_t available = writeIndex_.load( std::memory_order_acquire ) - readIndex;
+        std::size_t count = (available < maxPackets) ? available : maxPackets;
+
+        for( std::size_t i=0; i < count; ++i ){
+            // release the slot even if the listener throws
+            struct SlotRelease{
+                std::atomic<std::size_t>& index;
+                std::size_t value;
+                ~SlotRelease() { index.store( value, std::memory_order_release ); }
+            } release{ readIndex_, readIndex + 1 };
+
+            const Slot& slot = slots_[ readIndex & (SlotCount - 1) ];
+            listener.ProcessDatagram( slot.datagram );
+            ++readIndex;
+        }
+
+        return count;
+    }
+
+    // approximate when called while the producer is running
+    std::size_t QueuedCount() const
+    {
+        return writeIndex_.load( std::memory_order_acquire )
+                - readIndex_.load( std::memory_order_acquire );
+    }
+
+    static constexpr std::size_t Capacity() { return SlotCount; }
+    static constexpr std::size_t MaximumPacketSize() { return MaxPacketSize; }
+
+    // datagrams dropped because the ring was full
+    uint64_t OverrunCount() const { return overrunCount_.load( std::memory_order_relaxed ); }
+
+    // datagrams dropped because they were larger than MaxPacketSize
+    uint64_t OversizeCount() const { return oversizeCount_.load( std::memory_order_relaxed ); }
+};
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_QUEUEDPACKETLISTENER_H */
@@ -37,6 +37,8 @@
 #ifndef INCLUDED_OSCPACK_TIMERLISTENER_H
 #define INCLUDED_OSCPACK_TIMERLISTENER_H
 
+#include <mutex>
+
 namespace oscpack
 {
 class TimerListener{
@@ -44,5 +46,59 @@ public:
     virtual ~TimerListener() {}
     virtual void TimerExpired() = 0;
 };
+
+// Interrupts a multiplexer's wait from any thread, without stopping
+// Run(), so that it asks its scheduled timer listeners for their expiry
+// times again. Implemented by SocketReceiveMultiplexer.
+class MultiplexerWakeup{
+public:
+    virtual ~MultiplexerWakeup() {}
+    virtual void AsynchronousWakeup() = 0;
+};
+
+// A timer listener which chooses its own expiry times rather than using a
+// fixed period. The multiplexer asks for the next expiry time on every
+// iteration of Run(), so a listener that is also a PacketListener can
+// bring its expiry forward when it receives something. Times are in
+// milliseconds on std::chrono::steady_clock, see detail::SteadyTimeMs().
+//
+// The multiplexer only asks between events, so a listener whose expiry
+// is brought forward by another thread must call WakeMultiplexer().
+class ScheduledTimerListener : public TimerListener{
+    // held while the wakeup is called, so that clearing it waits for a
+    // call in progress on another thread
+    std::mutex wakeupMutex_;
+    MultiplexerWakeup *wakeup_ = nullptr;
+
+public:
+    // returns false if no expiry is pending
+    virtual bool NextExpiryMs( double& expiryMs ) = 0;
+
+    // set by SocketReceiveMultiplexer while the listener is attached
+    void SetMultiplexerWakeup( MultiplexerWakeup *wakeup )
+    {
+        std::lock_guard<std::mutex> lock( wakeupMutex_ );
+        wakeup_ = wakeup;
+    }
+
+    // clears the wakeup if it is still expected. once this returns the
+    // wakeup won't be called again, so it can be destroyed
+    void ClearMultiplexerWakeup( MultiplexerWakeup *expected )
+    {
+        std::lock_guard<std::mutex> lock( wakeupMutex_ );
+        if( wakeup_ == expected )
+            wakeup_ = nullptr;
+    }
+
+protected:
+    // makes the multiplexer the listener is attached to, if any, call
+    // NextExpiryMs() again. may be called from any thread
+    void WakeMultiplexer()
+    {
+        std::lock_guard<std::mutex> lock( wakeupMutex_ );
+        if( wakeup_ )
+            wakeup_->AsynchronousWakeup();
+    }
+};
 }
 #endif /* INCLUDED_OSCPACK_TIMERLISTENER_H */
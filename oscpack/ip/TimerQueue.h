@@ -0,0 +1,175 @@
+/*
+    oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files
+    (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and/or sell copies of the Software,
+    and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+    The text above constitutes the entire oscpack license; however,
+    the oscpack developer(s) also make the following non-binding requests:
+
+    Any person wishing to distribute modifications to the Software is
+    requested to send the modifications to the original developer so that
+    they can be incorporated into the canonical version. It is also
+    requested that these non-binding requests be included whenever the
+    above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_TIMERQUEUE_H
+#define INCLUDED_OSCPACK_TIMERQUEUE_H
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+#include "TimerListener.h"
+
+
+namespace oscpack
+{
+namespace detail
+{
+
+// the time base used by the multiplexers for timer expiry, in fractional
+// milliseconds on the monotonic clock
+inline double SteadyTimeMs()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>( steady_clock::now().time_since_epoch() ).count();
+}
+
+
+struct AttachedTimerListener{
+    AttachedTimerListener( int id, int p, TimerListener *tl )
+        : initialDelayMs( id )
+        , periodMs( p )
+        , listener( tl ) {}
+    int initialDelayMs;
+    int periodMs;
+    TimerListener *listener;
+};
+
+
+// The timer queue used by the socket multiplexer implementations while
+// running. Periodic timers are kept in a binary heap ordered by expiry
+// time, scheduled timers are polled for their next expiry.
+class TimerQueue{
+    struct Entry{
+        double expiryMs;
+        AttachedTimerListener timer;
+    };
+
+    std::vector<Entry> heap_;
+    std::vector<Entry> expired_;
+    std::vector<ScheduledTimerListener*> scheduled_;
+
+    // std heap functions build a max-heap, so order by later expiry
+    static bool Later( const Entry& lhs, const Entry& rhs )
+    {
+        return lhs.expiryMs > rhs.expiryMs;
+    }
+
+public:
+    void Reset( const std::vector<AttachedTimerListener>& timers,
+            const std::vector<ScheduledTimerListener*>& scheduled, double currentTimeMs )
+    {
+        heap_.clear();
+        for( std::size_t i=0; i < timers.size(); ++i )
+            heap_.push_back( Entry{ currentTimeMs + timers[i].initialDelayMs, timers[i] } );
+        std::make_heap( heap_.begin(), heap_.end(), Later );
+
+        scheduled_ = scheduled;
+    }
+
+    // returns false if no timer is pending
+    bool NextExpiryMs( double& expiryMs )
+    {
+        bool pending = false;
+        if( !heap_.empty() ){
+            expiryMs = heap_.front().expiryMs;
+            pending = true;
+        }
+
+        for( std::size_t i=0; i < scheduled_.size(); ++i ){
+            double t = 0;
+            if( scheduled_[i]->NextExpiryMs( t ) && (!pending || t < expiryMs) ){
+                expiryMs = t;
+                pending = true;
+            }
+        }
+
+        return pending;
+    }
+
+    // the time until the next expiry clamped to zero, or -1 if no timer is pending
+    double TimeoutMs( double currentTimeMs )
+    {
+        double expiryMs = 0;
+        if( !NextExpiryMs( expiryMs ) )
+            return -1;
+        return (expiryMs > currentTimeMs) ? expiryMs - currentTimeMs : 0;
+    }
+
+    // call TimerExpired() on each timer that is due at currentTimeMs. Each
+    // periodic timer is called at most once. Stops when breakRequested()
+    // returns true after a call.
+    template< class BreakPredicate >
+    void ExpireTimers( double currentTimeMs, BreakPredicate breakRequested )
+    {
+        expired_.clear();
+        while( !heap_.empty() && heap_.front().expiryMs <= currentTimeMs ){
+            std::pop_heap( heap_.begin(), heap_.end(), Later );
+            expired_.push_back( heap_.back() );
+            heap_.pop_back();
+        }
+
+        bool stop = false;
+        for( std::size_t i=0; i < expired_.size(); ++i ){
+            Entry& e = expired_[i];
+            if( !stop ){
+                e.timer.listener->TimerExpired();
+                if( breakRequested() )
+                    stop = true;
+                else
+                    e.expiryMs += e.timer.periodMs;
+            }
+
+            heap_.push_back( e );
+            std::push_heap( heap_.begin(), heap_.end(), Later );
+        }
+
+        for( std::size_t i=0; i < scheduled_.size() && !stop; ++i ){
+            double t = 0;
+            if( scheduled_[i]->NextExpiryMs( t ) && t <= currentTimeMs ){
+                scheduled_[i]->TimerExpired();
+                if( breakRequested() )
+                    stop = true;
+            }
+        }
+    }
+};
+
+} // namespace detail
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_TIMERQUEUE_H */
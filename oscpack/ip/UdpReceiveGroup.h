@@ -0,0 +1,305 @@
+/*
+    oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files
+    (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and/or sell copies of the Software,
+    and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+    The text above constitutes the entire oscpack license; however,
+    the oscpack developer(s) also make the following non-binding requests:
+
+    Any person wishing to distribute modifications to the Software is
+    requested to send the modifications to the original developer so that
+    they can be incorporated into the canonical version. It is also
+    requested that these non-binding requests be included whenever the
+    above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_UDPRECEIVEGROUP_H
+#define INCLUDED_OSCPACK_UDPRECEIVEGROUP_H
+
+#include <cassert>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef> // size_t
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "TimerListener.h"
+#include "UdpSocket.h"
+
+
+namespace oscpack
+{
+class PacketListener;
+
+namespace detail
+{
+
+// pin the calling thread to a single cpu. returns false if thread affinity
+// isn't supported on this platform or the request failed.
+inline bool SetCurrentThreadAffinity( unsigned int cpu )
+{
+#if defined(_WIN32)
+    if( cpu >= sizeof(DWORD_PTR) * 8 )
+        return false;
+    return SetThreadAffinityMask( GetCurrentThread(), ((DWORD_PTR)1) << cpu ) != 0;
+#elif defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO( &cpuSet );
+    CPU_SET( cpu, &cpuSet );
+    return pthread_setaffinity_np( pthread_self(), sizeof(cpuSet), &cpuSet ) == 0;
+#else
+    (void) cpu;
+    return false;
+#endif
+}
+
+
+// RunningLatch is attached to a multiplexer as a scheduled timer listener
+// that never expires. Run() first asks it for an expiry time after it has
+// cleared any earlier break, so once Wait() returns a break is no longer
+// lost.
+class RunningLatch : public ScheduledTimerListener{
+    std::atomic_bool set_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+
+public:
+    RunningLatch() : set_( false ) {}
+
+    void Set()
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        set_ = true;
+        changed_.notify_all();
+    }
+
+    // only call while the multiplexer isn't running
+    void Reset() { set_ = false; }
+
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock( mutex_ );
+        changed_.wait( lock, [this]() -> bool { return set_; } );
+    }
+
+    bool NextExpiryMs( double& ) override
+    {
+        if( !set_ )
+            Set();
+        return false;
+    }
+
+    void TimerExpired() override {}
+};
+
+
+// UdpReceiveGroup binds one socket per listener to the same local endpoint
+// using SO_REUSEPORT, and runs each socket in its own SocketReceiveMultiplexer
+// on its own thread. The kernel distributes incoming datagrams between the
+// sockets (by hashing the sender's address on Linux) so the listeners run in
+// parallel. A given sender is always delivered to the same listener, which
+// preserves per-sender packet ordering.
+//
+// Each listener is only ever called from its own thread. Listeners must
+// outlive the group.
+
+template<typename Impl_T>
+class UdpReceiveGroup{
+
+    class Member : public UdpSocket<Impl_T>{
+        SocketReceiveMultiplexer<Impl_T> mux_;
+        PacketListener *listener_;
+
+      public:
+        Member( const IpEndpointName& localEndpoint, PacketListener *listener )
+          : listener_( listener )
+        {
+          this->SetReusePort( true );
+          this->Bind( localEndpoint );
+          mux_.AttachSocketListener( &this->impl_, listener_ );
+          mux_.AttachScheduledTimerListener( &running );
+        }
+
+        ~Member()
+        {
+          mux_.DetachScheduledTimerListener( &running );
+          mux_.DetachSocketListener( &this->impl_, listener_ );
+        }
+
+        SocketReceiveMultiplexer<Impl_T>& Multiplexer() { return mux_; }
+
+        std::thread thread;
+        RunningLatch running; // set once Run() can be broken, or has exited
+        std::exception_ptr exception;
+    };
+
+    std::vector< std::unique_ptr<Member> > members_;
+    bool pinThreads_;
+    unsigned int firstCpu_;
+
+    void Join()
+    {
+        for( std::size_t i=0; i < members_.size(); ++i ){
+            Member *member = members_[i].get();
+            if( member->thread.joinable() ){
+                member->running.Wait();
+                member->Multiplexer().AsynchronousBreak();
+            }
+        }
+        for( std::size_t i=0; i < members_.size(); ++i ){
+            if( members_[i]->thread.joinable() )
+                members_[i]->thread.join();
+        }
+    }
+
+  public:
+    // The local endpoint must specify a port: all sockets of the group
+    // have to bind the same one. Throws std::runtime_error if a socket
+    // can't be created or bound.
+    UdpReceiveGroup( const IpEndpointName& localEndpoint,
+            const std::vector<PacketListener*>& listeners )
+      : pinThreads_( false )
+      , firstCpu_( 0 )
+    {
+        assert( localEndpoint.port != IpEndpointName::ANY_PORT );
+        assert( !listeners.empty() );
+
+        for( std::size_t i=0; i < listeners.size(); ++i )
+            members_.emplace_back( new Member( localEndpoint, listeners[i] ) );
+    }
+
+    ~UdpReceiveGroup()
+    { Join(); }
+
+    UdpReceiveGroup( const UdpReceiveGroup& ) = delete;
+    UdpReceiveGroup& operator=( const UdpReceiveGroup& ) = delete;
+
+    std::size_t Size() const { return members_.size(); }
+
+    // Pin the thread of the i'th socket to cpu (firstCpu + i) modulo the
+    // number of hardware threads. Only call before Start().
+    void SetThreadAffinity( bool pinThreads, unsigned int firstCpu=0 )
+    {
+        pinThreads_ = pinThreads;
+        firstCpu_ = firstCpu;
+    }
+
+    // see SocketReceiveMultiplexer, only call before Start()
+    void SetReceiveBatchSize( std::size_t datagramCount )
+    {
+        for( std::size_t i=0; i < members_.size(); ++i )
+            members_[i]->Multiplexer().SetReceiveBatchSize( datagramCount );
+    }
+
+    void SetMaximumPacketSize( std::size_t bytes )
+    {
+        for( std::size_t i=0; i < members_.size(); ++i )
+            members_[i]->Multiplexer().SetMaximumPacketSize( bytes );
+    }
+
+    // the i'th socket of the group, e.g. to set its buffer sizes before
+    // Start()
+    UdpSocket<Impl_T>& Socket( std::size_t i ) { return *members_[i]; }
+
+    // the metrics of the group's sockets, in listener order. may be called
+    // while the group runs.
+    MultiplexerMetrics Metrics() const
+    {
+        MultiplexerMetrics result;
+        for( std::size_t i=0; i < members_.size(); ++i ){
+            result.sockets.push_back( members_[i]->Metrics() );
+            result.total += result.sockets.back();
+        }
+        return result;
+    }
+
+    // start one receive thread per socket and return immediately
+    void Start()
+    {
+        unsigned int cpuCount = std::thread::hardware_concurrency();
+        if( cpuCount == 0 )
+            cpuCount = 1;
+
+        for( std::size_t i=0; i < members_.size(); ++i ){
+            Member *member = members_[i].get();
+            assert( !member->thread.joinable() );
+
+            bool pin = pinThreads_;
+            unsigned int cpu = (unsigned int)((firstCpu_ + i) % cpuCount);
+
+            member->exception = nullptr;
+            member->running.Reset();
+            member->thread = std::thread( [member, pin, cpu](){
+                if( pin )
+                    SetCurrentThreadAffinity( cpu );
+
+                try{
+                    member->Multiplexer().Run();
+                }catch(...){
+                    member->exception = std::current_exception();
+                }
+                // Run() may have thrown before it could be broken
+                member->running.Set();
+            } );
+        }
+    }
+
+    // break all multiplexers and wait for the receive threads to finish.
+    // if a receive thread exited with an exception, the first such
+    // exception is rethrown here.
+    void Stop()
+    {
+        Join();
+
+        for( std::size_t i=0; i < members_.size(); ++i ){
+            if( members_[i]->exception ){
+                std::exception_ptr e = members_[i]->exception;
+                members_[i]->exception = nullptr;
+                std::rethrow_exception( e );
+            }
+        }
+    }
+};
+
+} // namespace detail
+
+using UdpReceiveGroup = detail::UdpReceiveGroup<detail::Implementation>;
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_UDPRECEIVEGROUP_H */
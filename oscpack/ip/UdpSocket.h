@@ -21,5 +21,9 @@ using Implementation = oscpack::posix::Implementation;
 
 using UdpTransmitSocket = detail::UdpTransmitSocket<detail::Implementation>;
 using UdpReceiveSocket = detail::UdpReceiveSocket<detail::Implementation>;
+using UdpMulticastTransmitSocket = detail::UdpMulticastTransmitSocket<detail::Implementation>;
+using UdpMulticastReceiveSocket = detail::UdpMulticastReceiveSocket<detail::Implementation>;
 using UdpListeningReceiveSocket = detail::UdpListeningReceiveSocket<detail::Implementation>;
+using UdpListeningMulticastReceiveSocket = detail::UdpListeningMulticastReceiveSocket<detail::Implementation>;
+using BatchSender = detail::BatchSender<detail::Implementation>;
 }
@@ -0,0 +1,424 @@
+#pragma once
+/*
+    oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files
+    (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and/or sell copies of the Software,
+    and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+    The text above constitutes the entire oscpack license; however,
+    the oscpack developer(s) also make the following non-binding requests:
+
+    Any person wishing to distribute modifications to the Software is
+    requested to send the modifications to the original developer so that
+    they can be incorporated into the canonical version. It is also
+    requested that these non-binding requests be included whenever the
+    above license is reproduced.
+*/
+
+/*
+    An alternative posix socket multiplexer which waits with epoll (Linux)
+    or kqueue (OS X and the BSDs) instead of select(). It isn't limited to
+    FD_SETSIZE descriptors and the cost of each wakeup is proportional to
+    the number of ready sockets rather than the number of attached sockets.
+
+    It uses the same socket implementation as oscpack::posix::Implementation
+    so it can be used as a drop-in replacement:
+
+        using Impl = oscpack::posix::EventImplementation;
+        oscpack::detail::SocketReceiveMultiplexer<Impl> mux;
+*/
+#include <oscpack/ip/posix/UdpSocket.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#include <sys/event.h>
+#define OSCPACK_USE_KQUEUE 1
+#else
+#error "EventSocketReceiveMultiplexer.h requires epoll or kqueue"
+#endif
+
+namespace oscpack
+{
+
+namespace posix
+{
+
+template<typename UdpSocket_T>
+class EventSocketReceiveMultiplexerImplementation
+{
+    std::vector< std::pair< PacketListener*, UdpSocket_T* > > socketListeners_;
+    std::vector< AttachedTimerListener > timerListeners_;
+    std::vector< ScheduledTimerListener* > scheduledTimerListeners_;
+
+    std::size_t receiveBatchSize_;
+    std::size_t maximumPacketSize_;
+
+    std::atomic_bool break_;
+    int breakPipe_[2]; // [0] is the reader descriptor and [1] the writer
+    int eventFd_; // the epoll or kqueue descriptor
+#ifndef OSCPACK_USE_KQUEUE
+    // epoll_wait() only has millisecond timeouts, so timers are
+    // waited for with a timerfd instead
+    int timerFd_;
+    double timerFdExpiryMs_; // currently armed expiry, or -1
+#endif
+
+    // event user data for the break pipe and timerfd. sockets are
+    // identified by their index in socketListeners_
+    static constexpr std::size_t BREAK_PIPE_ID = ~(std::size_t)0;
+    static constexpr std::size_t TIMER_ID = ~(std::size_t)1;
+
+    double GetCurrentTimeMs() const
+    {
+      return detail::SteadyTimeMs();
+    }
+
+#ifndef OSCPACK_USE_KQUEUE
+    // arm the timerfd to expire at expiryMs on the steady clock
+    // (CLOCK_MONOTONIC), or -1 to disarm it
+    void SetTimerFdExpiry( double expiryMs )
+    {
+        if( expiryMs == timerFdExpiryMs_ )
+            return;
+
+        struct itimerspec spec;
+        std::memset( &spec, 0, sizeof(spec) );
+        if( expiryMs >= 0 ){
+            double seconds = std::floor( expiryMs * .001 );
+            spec.it_value.tv_sec = (time_t)seconds;
+            spec.it_value.tv_nsec = (long)((expiryMs - seconds * 1000.) * 1000000.);
+            if( spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0 )
+                spec.it_value.tv_nsec = 1; // zero would disarm the timer
+        }
+
+        if( timerfd_settime( timerFd_, TFD_TIMER_ABSTIME, &spec, 0 ) < 0 )
+            throw std::runtime_error( "unable to set timer\n" );
+        timerFdExpiryMs_ = expiryMs;
+    }
+#endif
+
+    void AddDescriptor( int fd, std::size_t id )
+    {
+#ifdef OSCPACK_USE_KQUEUE
+        struct kevent change;
+        EV_SET( &change, fd, EVFILT_READ, EV_ADD, 0, 0, (void*)id );
+        if( kevent( eventFd_, &change, 1, 0, 0, 0 ) < 0 )
+            throw std::runtime_error( "unable to add socket to kqueue\n" );
+#else
+        struct epoll_event event;
+        std::memset( &event, 0, sizeof(event) );
+        event.events = EPOLLIN;
+        event.data.u64 = id;
+        if( epoll_ctl( eventFd_, EPOLL_CTL_ADD, fd, &event ) < 0 )
+            throw std::runtime_error( "unable to add socket to epoll set\n" );
+#endif
+    }
+
+    void RemoveDescriptor( int fd )
+    {
+#ifdef OSCPACK_USE_KQUEUE
+        struct kevent change;
+        EV_SET( &change, fd, EVFILT_READ, EV_DELETE, 0, 0, 0 );
+        kevent( eventFd_, &change, 1, 0, 0, 0 );
+#else
+        struct epoll_event event; // ignored, but must be non-null before Linux 2.6.9
+        epoll_ctl( eventFd_, EPOLL_CTL_DEL, fd, &event );
+#endif
+    }
+
+    // registers the attached sockets for the duration of Run()
+    class Registration{
+        EventSocketReceiveMultiplexerImplementation& mux_;
+        std::size_t count_;
+    public:
+        explicit Registration( EventSocketReceiveMultiplexerImplementation& mux )
+            : mux_( mux )
+            , count_( 0 )
+        {
+            try{
+                for( ; count_ < mux_.socketListeners_.size(); ++count_ )
+                    mux_.AddDescriptor( mux_.socketListeners_[count_].second->Socket(), count_ );
+            }catch(...){
+                Unregister();
+                throw;
+            }
+        }
+
+        ~Registration() { Unregister(); }
+
+        void Unregister()
+        {
+            for( std::size_t i=0; i < count_; ++i )
+                mux_.RemoveDescriptor( mux_.socketListeners_[i].second->Socket() );
+            count_ = 0;
+        }
+    };
+
+public:
+    EventSocketReceiveMultiplexerImplementation()
+        : receiveBatchSize_( 1 )
+        , maximumPacketSize_( DEFAULT_MAXIMUM_PACKET_SIZE )
+    {
+        if( pipe(breakPipe_) != 0 )
+            throw std::runtime_error( "creation of asynchronous break pipes failed\n" );
+        // wakeups never block, a full pipe wakes the multiplexer anyway
+        fcntl( breakPipe_[1], F_SETFL, O_NONBLOCK );
+
+#ifdef OSCPACK_USE_KQUEUE
+        eventFd_ = kqueue();
+#else
+        eventFd_ = epoll_create1( EPOLL_CLOEXEC );
+#endif
+        if( eventFd_ < 0 ){
+            close( breakPipe_[0] );
+            close( breakPipe_[1] );
+            throw std::runtime_error( "creation of event queue failed\n" );
+        }
+
+#ifndef OSCPACK_USE_KQUEUE
+        timerFdExpiryMs_ = -1;
+        timerFd_ = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+        if( timerFd_ < 0 ){
+            close( eventFd_ );
+            close( breakPipe_[0] );
+            close( breakPipe_[1] );
+            throw std::runtime_error( "creation of timer failed\n" );
+        }
+#endif
+
+        try{
+            AddDescriptor( breakPipe_[0], BREAK_PIPE_ID );
+#ifndef OSCPACK_USE_KQUEUE
+            AddDescriptor( timerFd_, TIMER_ID );
+#endif
+        }catch(...){
+#ifndef OSCPACK_USE_KQUEUE
+            close( timerFd_ );
+#endif
+            close( eventFd_ );
+            close( breakPipe_[0] );
+            close( breakPipe_[1] );
+            throw;
+        }
+    }
+
+    ~EventSocketReceiveMultiplexerImplementation()
+    {
+#ifndef OSCPACK_USE_KQUEUE
+        close( timerFd_ );
+#endif
+        close( eventFd_ );
+        close( breakPipe_[0] );
+        close( breakPipe_[1] );
+    }
+
+    void AttachSocketListener( UdpSocket_T *socket, PacketListener *listener )
+    {
+        assert( std::find( socketListeners_.begin(), socketListeners_.end(), std::make_pair(listener, socket) ) == socketListeners_.end() );
+        // we don't check that the same socket has been added multiple times, even though this is an error
+        socketListeners_.push_back( std::make_pair( listener, socket ) );
+    }
+
+    void DetachSocketListener( UdpSocket_T *socket, PacketListener *listener )
+    {
+        auto i = std::find( socketListeners_.begin(), socketListeners_.end(), std::make_pair(listener, socket) );
+        assert( i != socketListeners_.end() );
+
+        socketListeners_.erase( i );
+    }
+
+    void AttachPeriodicTimerListener( int periodMilliseconds, TimerListener *listener )
+    {
+        timerListeners_.push_back( AttachedTimerListener( periodMilliseconds, periodMilliseconds, listener ) );
+    }
+
+    void AttachPeriodicTimerListener( int initialDelayMilliseconds, int periodMilliseconds, TimerListener *listener )
+    {
+        timerListeners_.push_back( AttachedTimerListener( initialDelayMilliseconds, periodMilliseconds, listener ) );
+    }
+
+    void DetachPeriodicTimerListener( TimerListener *listener )
+    {
+        std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
+        while( i != timerListeners_.end() ){
+            if( i->listener == listener )
+                break;
+            ++i;
+        }
+
+        assert( i != timerListeners_.end() );
+
+        timerListeners_.erase( i );
+    }
+
+    void AttachScheduledTimerListener( ScheduledTimerListener *listener )
+    {
+        scheduledTimerListeners_.push_back( listener );
+    }
+
+    void DetachScheduledTimerListener( ScheduledTimerListener *listener )
+    {
+        auto i = std::find( scheduledTimerListeners_.begin(), scheduledTimerListeners_.end(), listener );
+        assert( i != scheduledTimerListeners_.end() );
+
+        scheduledTimerListeners_.erase( i );
+    }
+
+    void SetReceiveBatchSize( std::size_t datagramCount )
+    {
+        assert( datagramCount > 0 );
+        receiveBatchSize_ = datagramCount;
+    }
+
+    void SetMaximumPacketSize( std::size_t bytes )
+    {
+        assert( bytes > 0 );
+        maximumPacketSize_ = bytes;
+    }
+
+    MultiplexerMetrics Metrics() const
+    {
+        return detail::CollectMultiplexerMetrics( socketListeners_ );
+    }
+
+    void Run()
+    {
+        break_ = false;
+
+        Registration registration( *this );
+
+        // configure the timer queue
+        detail::TimerQueue timerQueue;
+        timerQueue.Reset( timerListeners_, scheduledTimerListeners_, GetCurrentTimeMs() );
+
+        ReceiveBatch batch( receiveBatchSize_, ReceiveBufferSizeFor( socketListeners_, maximumPacketSize_ ) );
+
+        const int MAX_EVENTS = 64;
+#ifdef OSCPACK_USE_KQUEUE
+        struct kevent events[ MAX_EVENTS ];
+        struct timespec timeout;
+#else
+        struct epoll_event events[ MAX_EVENTS ];
+#endif
+
+        while( !break_ ){
+
+#ifdef OSCPACK_USE_KQUEUE
+            double timeoutMs = timerQueue.TimeoutMs( GetCurrentTimeMs() );
+
+            struct timespec *timeoutPtr = 0;
+            if( timeoutMs >= 0 ){
+                timeout.tv_sec = (time_t)(timeoutMs * .001);
+                timeout.tv_nsec = (long)((timeoutMs - (timeout.tv_sec * 1000.)) * 1000000.);
+                timeoutPtr = &timeout;
+            }
+
+            int eventCount = kevent( eventFd_, 0, 0, events, MAX_EVENTS, timeoutPtr );
+#else
+            int waitMs = -1;
+            double expiryMs = 0;
+            if( timerQueue.NextExpiryMs( expiryMs ) ){
+                if( expiryMs <= GetCurrentTimeMs() )
+                    waitMs = 0;
+                else
+                    SetTimerFdExpiry( expiryMs );
+            }
+
+            int eventCount = epoll_wait( eventFd_, events, MAX_EVENTS, waitMs );
+#endif
+            if( eventCount < 0 ){
+                if( break_ ){
+                    break;
+                }else if( errno == EINTR ){
+                    continue;
+                }else{
+                    throw std::runtime_error("event wait failed\n");
+                }
+            }
+
+            for( int i=0; i < eventCount && !break_; ++i ){
+#ifdef OSCPACK_USE_KQUEUE
+                std::size_t id = (std::size_t)events[i].udata;
+#else
+                std::size_t id = (std::size_t)events[i].data.u64;
+#endif
+                if( id == BREAK_PIPE_ID ){
+                    // clear pending data from the asynchronous break pipe
+                    char c;
+                    read( breakPipe_[0], &c, 1 );
+                    continue;
+                }
+#ifndef OSCPACK_USE_KQUEUE
+                if( id == TIMER_ID ){
+                    // the timer is one-shot, it is re-armed as needed above
+                    uint64_t expirations;
+                    read( timerFd_, &expirations, sizeof(expirations) );
+                    timerFdExpiryMs_ = -1;
+                    continue;
+                }
+#endif
+
+                std::size_t count = socketListeners_[id].second->ReceiveMany( batch );
+
+                if( DispatchReceivedDatagrams( socketListeners_[id].first, batch.Datagrams(), count ) )
+                    break_ = true;
+            }
+
+            if( break_ )
+                break;
+
+            // execute any expired timers
+            timerQueue.ExpireTimers( GetCurrentTimeMs(), [this]() -> bool { return break_; } );
+        }
+    }
+
+    void Break()
+    {
+        break_ = true;
+    }
+
+    void AsynchronousBreak()
+    {
+        break_ = true;
+        AsynchronousWakeup();
+    }
+
+    void AsynchronousWakeup()
+    {
+        // Send a message to the asynchronous break pipe, so the event wait will return
+        write( breakPipe_[1], "!", 1 );
+    }
+};
+
+struct EventImplementation
+{
+    using udp_socket_t = oscpack::posix::UdpSocketImplementation;
+    using send_batch_t = oscpack::posix::SendBatch;
+    using socket_multiplexer_t = oscpack::posix::EventSocketReceiveMultiplexerImplementation<udp_socket_t>;
+};
+}
+
+}
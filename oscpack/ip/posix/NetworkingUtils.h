@@ -15,11 +15,12 @@ namespace oscpack
         ~NetworkInitializer() {}
     };
 
-    // return ip address of host name in host byte order
-    inline unsigned long GetHostByName(const char *name)
+    // look up the ip address of host name, in host byte order. returns
+    // false if the name can't be resolved. thread safe, but may block
+    // while it queries DNS (see EndpointResolver for cached and
+    // asynchronous lookups).
+    inline bool LookupHostAddress(const char *name, unsigned long& address)
     {
-      unsigned long result = 0;
-
       addrinfo hints = {};
       hints.ai_family = AF_INET;
       hints.ai_socktype = SOCK_DGRAM;
@@ -28,20 +29,26 @@ namespace oscpack
       addrinfo* ai{};
       const int err = getaddrinfo(name, nullptr, &hints, &ai);
 
-      if (err != 0)
+      if (err != 0 || !ai)
       {
-        freeaddrinfo(ai);
-        return 0;
+        if (ai)
+          freeaddrinfo(ai);
+        return false;
       }
 
-      if(ai)
-      {
-        auto remote = reinterpret_cast<struct sockaddr_in *>(ai->ai_addr);
-        result = remote->sin_addr.s_addr;
-        result = ntohl(result);
+      auto remote = reinterpret_cast<struct sockaddr_in *>(ai->ai_addr);
+      address = ntohl(remote->sin_addr.s_addr);
 
-        freeaddrinfo(ai);
-      }
+      freeaddrinfo(ai);
+      return true;
+    }
+
+    // return ip address of host name in host byte order, or 0 if it can't
+    // be resolved
+    inline unsigned long GetHostByName(const char *name)
+    {
+      unsigned long result = 0;
+      LookupHostAddress(name, result);
       return result;
     }
 }
@@ -0,0 +1,1193 @@
+#pragma once
+/*
+    oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files
+    (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and/or sell copies of the Software,
+    and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+    The text above constitutes the entire oscpack license; however,
+    the oscpack developer(s) also make the following non-binding requests:
+
+    Any person wishing to distribute modifications to the Software is
+    requested to send the modifications to the original developer so that
+    they can be incorporated into the canonical version. It is also
+    requested that these non-binding requests be included whenever the
+    above license is reproduced.
+*/
+
+/*
+    A transport for peers on the same Linux host which passes datagrams
+    through shared memory instead of loopback UDP. Each bound socket owns
+    a ring in a POSIX shared memory object named after its port
+    ("/oscpack-7000"). Senders map the ring of the destination port and
+    copy each datagram into it once; the receiving multiplexer delivers
+    the datagrams to its listeners in place, so the data pointers passed
+    to PacketListener (and the ReceivedPacket of an OscPacketListener)
+    point straight into shared memory. Datagrams may be up to half the
+    ring size (UdpSocket::SetReceiveBufferSize(), 1MB by default), as long
+    as SocketReceiveMultiplexer::SetMaximumPacketSize() allows them.
+
+    Any number of threads and processes can send to a ring. Space is
+    reserved without locks, and a receiver which is waiting is woken
+    through a futex in the ring. The multiplexer waits for all of its
+    rings and timers with a single futex_waitv() call (Linux 5.16 or
+    later), which limits it to FUTEX_WAITV_MAX - 1 sockets.
+
+    Sockets are used like UDP sockets, except that only the port of an
+    endpoint matters: any address (e.g. 127.0.0.1) reaches the socket
+    bound to the port on this host, and datagrams are reported as sent
+    from 127.0.0.1 and the port the sender is bound to, or port 0 for an
+    unbound sender. As with UDP a datagram is dropped if no socket is
+    bound to its port or the ring is full.
+
+        using Impl = oscpack::posix::SharedMemoryImplementation;
+        oscpack::detail::UdpListeningReceiveSocket<Impl> socket(
+                IpEndpointName( "127.0.0.1", 7000 ), &listener );
+
+        oscpack::detail::UdpTransmitSocket<Impl> transmitSocket(
+                IpEndpointName( "127.0.0.1", 7000 ) );
+
+    The socket options which only make sense for a network (broadcast,
+    address reuse, multicast, offloads) aren't available.
+
+    Datagrams are delivered in order, so a sender which dies between
+    reserving space for a datagram and writing it would stall the ring.
+    The receiver skips such a record once it has waited for it for
+    SetAbandonedRecordTimeout() (1 second by default), along with any
+    other record that is still being written at that point. Peers are
+    expected to trust each other. Rings are created with mode 0600, so
+    only processes of the same user can connect. On glibc before 2.34 link with -lrt.
+*/
+#include <oscpack/ip/posix/UdpSocket.h>
+
+#if !defined(__linux__)
+#error "SharedMemorySocketReceiveMultiplexer.h requires Linux"
+#endif
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <linux/time_types.h>
+#include <sys/file.h> // for flock
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+
+#include <climits>
+#include <memory>
+#include <mutex>
+#include <new>
+
+#if !defined(__NR_futex_waitv)
+#error "SharedMemorySocketReceiveMultiplexer.h requires Linux 5.16 or later kernel headers"
+#endif
+
+namespace oscpack
+{
+
+namespace posix
+{
+
+// the data capacity of the ring of a bound socket unless
+// UdpSocket::SetReceiveBufferSize() is called
+constexpr std::size_t DEFAULT_SHARED_MEMORY_RING_SIZE = 1 << 20;
+
+// how long a receiver waits for a reserved record to be written unless
+// SharedMemoryUdpSocketImplementation::SetAbandonedRecordTimeout() is called
+constexpr int DEFAULT_SHARED_MEMORY_ABANDONED_RECORD_TIMEOUT_MS = 1000;
+
+// each datagram in a ring is preceded by a record header. records are
+// padded to a multiple of its size, and one which doesn't fit at the
+// end of the ring is preceded by a padding record taking up the rest.
+struct SharedMemoryRecord{
+    // the ring position the record was written at, stored last. a record
+    // is readable once its position matches the reader's, which also
+    // distinguishes it from an older record at the same offset, so the
+    // reader doesn't have to clear consumed records.
+    std::atomic<uint64_t> position;
+    uint32_t size;
+    uint32_t flags;
+    uint32_t address; // of the sender
+    int32_t port;
+    int64_t sendTimeNs; // if the receiver enabled timestamps
+};
+
+static_assert( sizeof(SharedMemoryRecord) == 32, "unexpected record layout" );
+static_assert( std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+        "shared memory rings need lock-free atomics" );
+
+struct SharedMemoryRingHeader{
+    std::atomic<uint32_t> magic; // set last when the ring is created
+    uint32_t version;
+    uint64_t capacity;
+
+    // set when the owner unbinds, senders then look up the port again
+    std::atomic<uint32_t> closed;
+    std::atomic<uint32_t> timestamps;
+
+    std::atomic<uint64_t> droppedCount; // because the ring was full
+    std::atomic<uint64_t> oversizeCount; // larger than MaximumDatagramSize()
+    std::atomic<uint64_t> abandonedCount; // reserved but never written
+
+    alignas(64) std::atomic<uint64_t> tail; // advanced by senders
+    alignas(64) std::atomic<uint64_t> head; // advanced by the receiver
+
+    // the receiver sets waiting before it sleeps on signal, senders then
+    // increment signal and wake it
+    std::atomic<uint32_t> waiting;
+    std::atomic<uint32_t> signal;
+};
+
+
+// a mapping of a ring, either by the socket which owns it or by a sender
+class SharedMemoryRing{
+    SharedMemoryRingHeader *header_;
+    char *data_;
+    std::size_t mappingSize_;
+    uint64_t mask_;
+
+    static constexpr uint32_t MAGIC = 0x6F736372; // "oscr"
+    static constexpr uint32_t VERSION = 2;
+    static constexpr uint32_t PADDING_RECORD = 1;
+    static constexpr std::size_t DATA_OFFSET = 256; // after the header, cache line aligned
+
+    static_assert( sizeof(SharedMemoryRingHeader) <= DATA_OFFSET, "ring header too large" );
+
+    static uint64_t Stride( std::size_t size )
+    {
+        const uint64_t alignment = sizeof(SharedMemoryRecord);
+        return ( sizeof(SharedMemoryRecord) + size + alignment - 1 ) & ~(alignment - 1);
+    }
+
+    SharedMemoryRecord *RecordAt( uint64_t position ) const
+    {
+        return (SharedMemoryRecord*)(void*)( data_ + ( position & mask_ ) );
+    }
+
+    bool MapDescriptor( int fd, std::size_t mappingSize )
+    {
+        void *mapping = mmap( 0, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        if( mapping == MAP_FAILED )
+            return false;
+
+        header_ = (SharedMemoryRingHeader*)mapping;
+        data_ = (char*)mapping + DATA_OFFSET;
+        mappingSize_ = mappingSize;
+        return true;
+    }
+
+    static int64_t RealtimeNs()
+    {
+        struct timespec now;
+        clock_gettime( CLOCK_REALTIME, &now );
+        return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+    }
+
+public:
+    SharedMemoryRing()
+        : header_( 0 )
+        , data_( 0 )
+        , mappingSize_( 0 )
+        , mask_( 0 ) {}
+
+    ~SharedMemoryRing() { Unmap(); }
+
+    SharedMemoryRing( const SharedMemoryRing& ) = delete;
+    SharedMemoryRing& operator=( const SharedMemoryRing& ) = delete;
+
+    enum { NAME_LENGTH=16 };
+    static void Name( char *s, int port )
+    {
+        std::memcpy( s, "/oscpack-", 9 );
+        *detail::FormatDecimal( s + 9, port ) = '\0';
+    }
+
+    // the ring size used for a requested size of bytes: a power of two
+    // of at least 64k
+    static std::size_t CapacityFor( std::size_t bytes )
+    {
+        std::size_t result = 1 << 16;
+        while( result < bytes && result < ((std::size_t)1 << 30) )
+            result <<= 1;
+        return result;
+    }
+
+    // size and initialize the new shared memory object fd
+    bool Create( int fd, std::size_t capacity )
+    {
+        assert( !IsMapped() && capacity == CapacityFor( capacity ) );
+
+        if( ftruncate( fd, (off_t)(DATA_OFFSET + capacity) ) != 0
+                || !MapDescriptor( fd, DATA_OFFSET + capacity ) )
+            return false;
+
+        new (header_) SharedMemoryRingHeader();
+        header_->version = VERSION;
+        header_->capacity = capacity;
+        // positions start at capacity so that the zeroed records don't
+        // match the first read position
+        header_->tail.store( capacity, std::memory_order_relaxed );
+        header_->head.store( capacity, std::memory_order_relaxed );
+        mask_ = capacity - 1;
+        header_->magic.store( MAGIC, std::memory_order_release );
+        return true;
+    }
+
+    // map the ring in fd. returns false unless it is a complete ring
+    bool OpenDescriptor( int fd )
+    {
+        assert( !IsMapped() );
+
+        struct stat status;
+        if( fstat( fd, &status ) != 0 || (std::size_t)status.st_size <= DATA_OFFSET
+                || !MapDescriptor( fd, (std::size_t)status.st_size ) )
+            return false;
+
+        uint64_t capacity = header_->capacity;
+        if( header_->magic.load( std::memory_order_acquire ) != MAGIC || header_->version != VERSION
+                || capacity != CapacityFor( capacity ) || DATA_OFFSET + capacity != mappingSize_ ){
+            Unmap();
+            return false;
+        }
+
+        mask_ = capacity - 1;
+        return true;
+    }
+
+    // map the ring of the socket bound to port
+    bool Open( int port )
+    {
+        char name[ NAME_LENGTH ];
+        Name( name, port );
+        int fd = shm_open( name, O_RDWR | O_CLOEXEC, 0 );
+        if( fd < 0 )
+            return false;
+
+        bool result = OpenDescriptor( fd );
+        close( fd );
+        return result;
+    }
+
+    void Unmap()
+    {
+        if( header_ )
+            munmap( header_, mappingSize_ );
+        header_ = 0;
+        data_ = 0;
+    }
+
+    bool IsMapped() const { return header_ != 0; }
+    SharedMemoryRingHeader& Header() const { return *header_; }
+    std::size_t Capacity() const { return (std::size_t)( mask_ + 1 ); }
+
+    // a datagram together with the padding in front of it has to fit
+    // into an empty ring wherever the ring's positions are
+    std::size_t MaximumDatagramSize() const { return Capacity() / 2 - sizeof(SharedMemoryRecord); }
+
+    // Copy a datagram into the ring. Returns 0 on success, EMSGSIZE if
+    // it is larger than MaximumDatagramSize() or ENOBUFS if the ring is
+    // full. Call Wake() afterwards. May be called from any number of
+    // threads and processes.
+    int Push( const char *data, std::size_t size, const IpEndpointName& from )
+    {
+        if( size > MaximumDatagramSize() ){
+            header_->oversizeCount.fetch_add( 1, std::memory_order_relaxed );
+            return EMSGSIZE;
+        }
+
+        const uint64_t capacity = mask_ + 1;
+        const uint64_t stride = Stride( size );
+
+        // reserve the record, and padding up to the end of the ring if
+        // it doesn't fit in front of the end
+        uint64_t position = header_->tail.load( std::memory_order_relaxed );
+        uint64_t padding;
+        for(;;){
+            // acquire the reader's reads of the space we are going to reuse
+            uint64_t head = header_->head.load( std::memory_order_acquire );
+            if( head > position ){
+                position = header_->tail.load( std::memory_order_relaxed ); // stale
+                continue;
+            }
+
+            uint64_t offset = position & mask_;
+            padding = ( offset + stride > capacity ) ? capacity - offset : 0;
+            if( position + padding + stride - head > capacity ){
+                header_->droppedCount.fetch_add( 1, std::memory_order_relaxed );
+                return ENOBUFS;
+            }
+
+            if( header_->tail.compare_exchange_weak( position, position + padding + stride,
+                    std::memory_order_relaxed, std::memory_order_relaxed ) )
+                break;
+        }
+
+        if( padding ){
+            SharedMemoryRecord *record = RecordAt( position );
+            record->size = 0;
+            record->flags = PADDING_RECORD;
+            record->position.store( position, std::memory_order_release );
+            position += padding;
+        }
+
+        SharedMemoryRecord *record = RecordAt( position );
+        record->size = (uint32_t)size;
+        record->flags = 0;
+        record->address = (uint32_t)from.address;
+        record->port = from.port;
+        record->sendTimeNs = header_->timestamps.load( std::memory_order_relaxed ) ? RealtimeNs() : 0;
+        std::memcpy( (char*)(void*)( record + 1 ), data, size );
+        record->position.store( position, std::memory_order_release );
+        return 0;
+    }
+
+    // wake the receiver if it is waiting for the ring
+    void Wake()
+    {
+        // orders the record stores of Push() before the load of waiting,
+        // paired with the fence in PrepareWait()
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        if( header_->waiting.load( std::memory_order_relaxed ) ){
+            header_->signal.fetch_add( 1, std::memory_order_release );
+            syscall( SYS_futex, &header_->signal, FUTEX_WAKE, INT_MAX, 0, 0, 0 );
+        }
+    }
+
+    // the readable record at position, or null if there is none. padding
+    // records are skipped by advancing position. only used by the owner.
+    const SharedMemoryRecord *Next( uint64_t& position ) const
+    {
+        for(;;){
+            const SharedMemoryRecord *record = RecordAt( position );
+            if( record->position.load( std::memory_order_acquire ) != position )
+                return 0;
+            if( !( record->flags & PADDING_RECORD ) )
+                return record;
+            position += Capacity() - ( position & mask_ );
+        }
+    }
+
+    static uint64_t PositionAfter( uint64_t position, const SharedMemoryRecord& record )
+    {
+        return position + Stride( record.size );
+    }
+
+    // true if a sender has reserved the space at position, whether or
+    // not the record has been written yet
+    bool IsReserved( uint64_t position ) const
+    {
+        return header_->tail.load( std::memory_order_acquire ) > position;
+    }
+
+    // Skip the reserved record at position which hasn't been written,
+    // presumably because its sender died, by advancing position to the
+    // next written record or else to the end of the reserved space.
+    // Records start at multiples of the record header size, and a
+    // written one holds its own position, which can't be left over from
+    // an earlier pass through the ring. only used by the owner.
+    void SkipAbandoned( uint64_t& position ) const
+    {
+        const uint64_t tail = header_->tail.load( std::memory_order_acquire );
+        uint64_t next = position + sizeof(SharedMemoryRecord);
+        while( next < tail && RecordAt( next )->position.load( std::memory_order_acquire ) != next )
+            next += sizeof(SharedMemoryRecord);
+        position = std::min( next, tail );
+        header_->abandonedCount.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    // make the space up to position available to senders
+    void Release( uint64_t position )
+    {
+        header_->head.store( position, std::memory_order_release );
+    }
+
+    uint64_t Head() const { return header_->head.load( std::memory_order_relaxed ); }
+
+    // Announce that the receiver is about to sleep. Returns the value to
+    // pass to the futex wait on SignalAddress(), which returns
+    // immediately if a datagram has been committed since. Check Next()
+    // after this and before waiting, then call FinishWait().
+    uint32_t PrepareWait()
+    {
+        header_->waiting.store( 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        return header_->signal.load( std::memory_order_acquire );
+    }
+
+    void FinishWait()
+    {
+        header_->waiting.store( 0, std::memory_order_relaxed );
+    }
+
+    uint32_t *SignalAddress() const { return (uint32_t*)(void*)&header_->signal; }
+};
+
+
+// the datagrams queued by a BatchSender, see SharedMemoryUdpSocketImplementation::SendMany()
+class SharedMemorySendBatch{
+    friend class SharedMemoryUdpSocketImplementation;
+
+    std::vector<OutgoingDatagram> datagrams_;
+
+public:
+    void Clear() { datagrams_.clear(); }
+
+    void Add( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
+    {
+        OutgoingDatagram datagram = { remoteEndpoint, data, size, 0 };
+        datagrams_.push_back( datagram );
+    }
+
+    std::size_t Size() const { return datagrams_.size(); }
+    const OutgoingDatagram& Datagram( std::size_t i ) const { return datagrams_[i]; }
+};
+
+
+class SharedMemoryUdpSocketImplementation{
+    bool isBound_{};
+    bool isConnected_{};
+    int localPort_{};
+    int connectedPort_{};
+
+    SharedMemoryRing ring_; // of the bound port
+    int ringFd_{ -1 }; // kept open and locked with flock() while bound
+    std::size_t ringSize_{ DEFAULT_SHARED_MEMORY_RING_SIZE };
+    uint64_t readPosition_{}; // the position of the next datagram
+
+    bool receiveTimestamps_{};
+    bool receiveLocalEndpoint_{};
+    int busyPollMicroseconds_{};
+
+    // the reserved record at stalledPosition_ hasn't been written since
+    // stalledSinceMs_
+    int abandonedRecordTimeoutMs_{ DEFAULT_SHARED_MEMORY_ABANDONED_RECORD_TIMEOUT_MS };
+    bool stalled_{};
+    uint64_t stalledPosition_{};
+    double stalledSinceMs_{};
+
+    // the rings of the ports sent to
+    std::mutex sendMutex_;
+    std::vector< std::pair< int, std::unique_ptr<SharedMemoryRing> > > peerRings_;
+
+    std::atomic<std::size_t> truncatedDatagramCount_{ 0 };
+    detail::MetricCounter receivedDatagramCount_;
+    detail::MetricCounter receivedByteCount_;
+
+    static constexpr unsigned long LOOPBACK_ADDRESS = 0x7F000001;
+
+    static void CheckPort( int port )
+    {
+        if( port < 0 || port > 65535 )
+            throw std::runtime_error( "invalid shared memory socket port\n" );
+    }
+
+    // the mapping of the ring bound to port, or null if there is none.
+    // called with sendMutex_ held
+    SharedMemoryRing *PeerRing( int port )
+    {
+        for( std::size_t i=0; i < peerRings_.size(); ++i ){
+            if( peerRings_[i].first == port ){
+                if( !peerRings_[i].second->Header().closed.load( std::memory_order_acquire ) )
+                    return peerRings_[i].second.get();
+
+                // unbound since, perhaps bound again
+                peerRings_.erase( peerRings_.begin() + i );
+                break;
+            }
+        }
+
+        std::unique_ptr<SharedMemoryRing> ring( new SharedMemoryRing );
+        if( !ring->Open( port ) )
+            return 0;
+
+        peerRings_.emplace_back( port, std::move( ring ) );
+        return peerRings_.back().second.get();
+    }
+
+    // the readable record at position, like SharedMemoryRing::Next(),
+    // skipping a reserved record which hasn't been written within the
+    // abandoned record timeout
+    const SharedMemoryRecord *NextRecord( uint64_t& position )
+    {
+        for(;;){
+            const SharedMemoryRecord *record = ring_.Next( position );
+            if( record || !ring_.IsReserved( position ) ){
+                stalled_ = false;
+                return record;
+            }
+
+            const double nowMs = detail::SteadyTimeMs();
+            if( !stalled_ || stalledPosition_ != position ){
+                stalled_ = true;
+                stalledPosition_ = position;
+                stalledSinceMs_ = nowMs;
+                return 0;
+            }
+            if( nowMs < stalledSinceMs_ + abandonedRecordTimeoutMs_ )
+                return 0;
+
+            ring_.SkipAbandoned( position );
+            stalled_ = false;
+        }
+    }
+
+    IpEndpointName SenderEndpoint() const
+    {
+        return IpEndpointName( LOOPBACK_ADDRESS, isBound_ ? localPort_ : 0 );
+    }
+
+    int SendToPort( int port, const char *data, std::size_t size )
+    {
+        std::lock_guard<std::mutex> lock( sendMutex_ );
+
+        SharedMemoryRing *ring = PeerRing( port );
+        if( !ring )
+            return ECONNREFUSED;
+
+        int result = ring->Push( data, size, SenderEndpoint() );
+        if( result == 0 )
+            ring->Wake();
+        return result;
+    }
+
+    // Removes the ring called name if the socket which created it has
+    // gone without unbinding, i.e. nobody holds its lock. Returns false
+    // if it's in use.
+    static bool RemoveStaleRing( const char *name )
+    {
+        int fd = shm_open( name, O_RDWR | O_CLOEXEC, 0 );
+        if( fd < 0 )
+            return errno == ENOENT; // removed meanwhile
+
+        bool stale = ( flock( fd, LOCK_EX | LOCK_NB ) == 0 );
+        if( stale ){
+            // senders which still map it have to look up the port again
+            SharedMemoryRing ring;
+            if( ring.OpenDescriptor( fd ) )
+                ring.Header().closed.store( 1, std::memory_order_release );
+
+            // unless another socket has replaced it in the meantime
+            int currentFd = shm_open( name, O_RDWR | O_CLOEXEC, 0 );
+            struct stat status, currentStatus;
+            if( currentFd >= 0 ){
+                if( fstat( fd, &status ) == 0 && fstat( currentFd, &currentStatus ) == 0
+                        && status.st_ino == currentStatus.st_ino )
+                    shm_unlink( name );
+                close( currentFd );
+            }
+        }
+
+        close( fd );
+        return stale;
+    }
+
+    // returns false if another socket is bound to port
+    bool TryBind( int port )
+    {
+        char name[ SharedMemoryRing::NAME_LENGTH ];
+        SharedMemoryRing::Name( name, port );
+
+        for( int attempt=0; attempt < 2; ++attempt ){
+            int fd = shm_open( name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600 );
+            if( fd >= 0 ){
+                if( flock( fd, LOCK_EX | LOCK_NB ) != 0
+                        || !ring_.Create( fd, SharedMemoryRing::CapacityFor( ringSize_ ) ) ){
+                    shm_unlink( name );
+                    close( fd );
+                    throw std::runtime_error( "unable to create shared memory ring\n" );
+                }
+
+                ringFd_ = fd;
+                ring_.Header().timestamps.store( receiveTimestamps_, std::memory_order_relaxed );
+                readPosition_ = ring_.Head();
+                localPort_ = port;
+                isBound_ = true;
+                return true;
+            }
+
+            if( errno != EEXIST )
+                throw std::runtime_error( "unable to create shared memory ring\n" );
+            if( !RemoveStaleRing( name ) )
+                return false;
+        }
+        return false;
+    }
+
+    void Unbind()
+    {
+        if( !isBound_ )
+            return;
+
+        char name[ SharedMemoryRing::NAME_LENGTH ];
+        SharedMemoryRing::Name( name, localPort_ );
+        shm_unlink( name );
+        ring_.Header().closed.store( 1, std::memory_order_release );
+        ring_.Unmap();
+        close( ringFd_ ); // releases the lock
+        ringFd_ = -1;
+        isBound_ = false;
+    }
+
+public:
+    SharedMemoryUdpSocketImplementation() = default;
+
+    ~SharedMemoryUdpSocketImplementation()
+    {
+        Unbind();
+    }
+
+    // the data capacity of the ring created by Bind(), rounded up to a
+    // power of two of at least 64k. throws std::runtime_error once bound.
+    void SetReceiveBufferSize( int bytes )
+    {
+        if( isBound_ || bytes <= 0 )
+            throw std::runtime_error( "unable to set shared memory ring size\n" );
+        ringSize_ = SharedMemoryRing::CapacityFor( (std::size_t)bytes );
+    }
+
+    int ReceiveBufferSize() const
+    {
+        return (int)( isBound_ ? ring_.Capacity() : SharedMemoryRing::CapacityFor( ringSize_ ) );
+    }
+
+    // datagrams no larger than this can be sent to the socket
+    std::size_t MaximumDatagramSize() const
+    {
+        assert( isBound_ );
+        return ring_.MaximumDatagramSize();
+    }
+
+    // the multiplexer polls the ring for up to this long before it sleeps,
+    // which saves senders the wakeup system call
+    void SetBusyPoll( int microseconds )
+    {
+        if( microseconds < 0 )
+            throw std::runtime_error( "unable to set busy poll\n" );
+        busyPollMicroseconds_ = microseconds;
+    }
+
+    int BusyPollMicroseconds() const { return busyPollMicroseconds_; }
+
+    // how long to wait for a record which a sender has reserved but not
+    // written before skipping it, see the comment at the top of this file
+    void SetAbandonedRecordTimeout( int milliseconds )
+    {
+        if( milliseconds < 0 )
+            throw std::runtime_error( "unable to set abandoned record timeout\n" );
+        abandonedRecordTimeoutMs_ = milliseconds;
+    }
+
+    // the steady clock time (see detail::SteadyTimeMs()) at which a
+    // stalled record will be skipped. returns false if none is pending
+    bool AbandonedRecordExpiryMs( double& expiryMs ) const
+    {
+        if( !stalled_ )
+            return false;
+        expiryMs = stalledSinceMs_ + abandonedRecordTimeoutMs_;
+        return true;
+    }
+
+    // the receive time of a datagram is the time it was sent, the
+    // realtime clock being the same for every process on the host.
+    // preferHardware is ignored.
+    void SetEnableReceiveTimestamps( bool enableReceiveTimestamps, bool preferHardware )
+    {
+        (void) preferHardware;
+        receiveTimestamps_ = enableReceiveTimestamps;
+        if( isBound_ )
+            ring_.Header().timestamps.store( receiveTimestamps_, std::memory_order_relaxed );
+    }
+
+    void SetEnableReceiveLocalEndpoint( bool enableReceiveLocalEndpoint )
+    {
+        receiveLocalEndpoint_ = enableReceiveLocalEndpoint;
+    }
+
+    std::size_t TruncatedDatagramCount() const
+    {
+        std::size_t result = truncatedDatagramCount_;
+        if( isBound_ )
+            result += (std::size_t)ring_.Header().oversizeCount.load( std::memory_order_relaxed );
+        return result;
+    }
+
+    // datagrams dropped because the ring was full, and abandoned records,
+    // are reported as kernelDropCount
+    SocketMetrics Metrics() const
+    {
+        SocketMetrics result;
+        result.receivedDatagramCount = receivedDatagramCount_.Value();
+        result.receivedByteCount = receivedByteCount_.Value();
+        result.truncatedDatagramCount = TruncatedDatagramCount();
+        if( METRICS_ENABLED && isBound_ )
+            result.kernelDropCount = ring_.Header().droppedCount.load( std::memory_order_relaxed )
+                    + ring_.Header().abandonedCount.load( std::memory_order_relaxed );
+        return result;
+    }
+
+    // the number of reserved records which were skipped because they
+    // weren't written in time
+    uint64_t AbandonedRecordCount() const
+    {
+        return isBound_ ? ring_.Header().abandonedCount.load( std::memory_order_relaxed ) : 0;
+    }
+
+    IpEndpointName LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
+    {
+        (void) remoteEndpoint;
+        assert( isBound_ );
+        return IpEndpointName( LOOPBACK_ADDRESS, localPort_ );
+    }
+
+    void Connect( const IpEndpointName& remoteEndpoint )
+    {
+        CheckPort( remoteEndpoint.port );
+        connectedPort_ = remoteEndpoint.port;
+        isConnected_ = true;
+    }
+
+    int LocalPort() const
+    {
+        return localPort_;
+    }
+
+    // like UDP, errors are ignored
+    void Send( const char *data, std::size_t size )
+    {
+        assert( isConnected_ );
+
+        SendToPort( connectedPort_, data, size );
+    }
+
+    void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
+    {
+        SendToPort( remoteEndpoint.port, data, size );
+    }
+
+    // Send all datagrams of batch and set their error fields: ECONNREFUSED
+    // if no socket is bound to the port, ENOBUFS if its ring is full and
+    // EMSGSIZE if the datagram is too large for it. Receivers are woken
+    // once per run of datagrams to the same port. Returns the number of
+    // datagrams which couldn't be sent.
+    std::size_t SendMany( SharedMemorySendBatch& batch )
+    {
+        std::lock_guard<std::mutex> lock( sendMutex_ );
+
+        std::size_t failedCount = 0;
+        SharedMemoryRing *pendingWake = 0;
+        for( OutgoingDatagram& datagram : batch.datagrams_ ){
+            SharedMemoryRing *ring = PeerRing( datagram.remoteEndpoint.port );
+            if( ring != pendingWake && pendingWake ){
+                pendingWake->Wake();
+                pendingWake = 0;
+            }
+
+            datagram.error = ring ? ring->Push( datagram.data, datagram.size, SenderEndpoint() ) : ECONNREFUSED;
+            if( datagram.error == 0 )
+                pendingWake = ring;
+            else
+                ++failedCount;
+        }
+        if( pendingWake )
+            pendingWake->Wake();
+
+        return failedCount;
+    }
+
+    // Create the ring of the endpoint's port, or of a free port from the
+    // ephemeral range for ANY_PORT. The address is ignored. Throws
+    // std::runtime_error if another socket is bound to the port.
+    void Bind( const IpEndpointName& localEndpoint )
+    {
+        if( isBound_ )
+            throw std::runtime_error( "unable to bind shared memory socket\n" );
+
+        if( localEndpoint.port == IpEndpointName::ANY_PORT ){
+            const int FIRST_EPHEMERAL_PORT = 49152;
+            const int EPHEMERAL_PORT_COUNT = 16384;
+            int start = (int)( getpid() % EPHEMERAL_PORT_COUNT );
+            for( int i=0; i < EPHEMERAL_PORT_COUNT; ++i ){
+                if( TryBind( FIRST_EPHEMERAL_PORT + ( start + i ) % EPHEMERAL_PORT_COUNT ) )
+                    return;
+            }
+            throw std::runtime_error( "unable to bind shared memory socket\n" );
+        }
+
+        CheckPort( localEndpoint.port );
+        if( !TryBind( localEndpoint.port ) )
+            throw std::runtime_error( "unable to bind shared memory socket\n" );
+    }
+
+    bool IsBound() const { return isBound_; }
+
+    // Block until a datagram arrives and copy it to data. Datagrams larger
+    // than size are truncated to size bytes, and counted by
+    // TruncatedDatagramCount().
+    std::size_t ReceiveFrom( IpEndpointName& remoteEndpoint, char *data, std::size_t size )
+    {
+        assert( isBound_ );
+
+        uint64_t position = ring_.Head();
+        const SharedMemoryRecord *record = NextRecord( position );
+        while( !record ){
+            uint32_t signal = ring_.PrepareWait();
+            position = ring_.Head();
+            record = NextRecord( position );
+            if( !record ){
+                // wake up to skip a stalled record
+                double expiryMs;
+                struct timespec timeout;
+                bool hasTimeout = AbandonedRecordExpiryMs( expiryMs );
+                if( hasTimeout ){
+                    double timeoutMs = std::max( 0., expiryMs - detail::SteadyTimeMs() );
+                    timeout.tv_sec = (time_t)( timeoutMs * .001 );
+                    timeout.tv_nsec = (long)( ( timeoutMs - timeout.tv_sec * 1000. ) * 1000000. );
+                }
+                syscall( SYS_futex, ring_.SignalAddress(), FUTEX_WAIT, signal, hasTimeout ? &timeout : 0, 0, 0 );
+            }
+            ring_.FinishWait();
+        }
+
+        std::size_t result = std::min( size, (std::size_t)record->size );
+        std::memcpy( data, record + 1, result );
+        if( record->size > size )
+            ++truncatedDatagramCount_;
+        receivedDatagramCount_.Add();
+        receivedByteCount_.Add( result );
+        remoteEndpoint = IpEndpointName( record->address, record->port );
+
+        readPosition_ = SharedMemoryRing::PositionAfter( position, *record );
+        ring_.Release( readPosition_ );
+        return result;
+    }
+
+    // Store up to maximumCount datagrams which are readable in datagrams,
+    // without copying them. The datagrams remain valid, and are delivered
+    // again by the next call, until ReleaseReceived() is called. Empty
+    // datagrams are not stored, ones larger than maximumPacketSize are
+    // counted by TruncatedDatagramCount() and dropped.
+    std::size_t ReceiveAvailable( ReceivedDatagram *datagrams, std::size_t maximumCount,
+            std::size_t maximumPacketSize )
+    {
+        assert( isBound_ );
+
+        uint64_t position = ring_.Head();
+        std::size_t count = 0;
+        while( count < maximumCount ){
+            const SharedMemoryRecord *record = NextRecord( position );
+            if( !record )
+                break;
+            position = SharedMemoryRing::PositionAfter( position, *record );
+
+            if( record->size > maximumPacketSize ){
+                ++truncatedDatagramCount_;
+                continue;
+            }
+            if( record->size == 0 )
+                continue;
+
+            ReceivedDatagram& datagram = datagrams[ count++ ];
+            datagram.data = (const char*)( record + 1 );
+            datagram.size = (int)record->size;
+            datagram.remoteEndpoint = IpEndpointName( record->address, record->port );
+            datagram.localEndpoint = receiveLocalEndpoint_
+                    ? IpEndpointName( LOOPBACK_ADDRESS, localPort_ ) : IpEndpointName();
+            datagram.receiveTimeNs = record->sendTimeNs;
+            receivedByteCount_.Add( record->size );
+        }
+
+        receivedDatagramCount_.Add( count );
+        readPosition_ = position;
+        return count;
+    }
+
+    void ReleaseReceived()
+    {
+        if( readPosition_ != ring_.Head() )
+            ring_.Release( readPosition_ );
+    }
+
+    bool IsReadable() const
+    {
+        uint64_t position = ring_.Head();
+        return ring_.Next( position ) != 0;
+    }
+
+    SharedMemoryRing& Ring() { return ring_; }
+};
+
+
+template<typename UdpSocket_T>
+class SharedMemorySocketReceiveMultiplexerImplementation
+{
+    std::vector< std::pair< PacketListener*, UdpSocket_T* > > socketListeners_;
+    std::vector< AttachedTimerListener > timerListeners_;
+    std::vector< ScheduledTimerListener* > scheduledTimerListeners_;
+
+    std::size_t receiveBatchSize_;
+    std::size_t maximumPacketSize_;
+
+    std::atomic_bool break_;
+    std::atomic<uint32_t> breakSignal_; // a private futex, incremented by AsynchronousBreak()
+
+    double GetCurrentTimeMs() const
+    {
+      return detail::SteadyTimeMs();
+    }
+
+    // deliver the readable datagrams of each socket, returns false if
+    // there were none
+    bool ReceiveAvailable( std::vector<ReceivedDatagram>& datagrams )
+    {
+        bool received = false;
+        for( std::size_t i=0; i < socketListeners_.size() && !break_; ++i ){
+            UdpSocket_T *socket = socketListeners_[i].second;
+            std::size_t count = socket->ReceiveAvailable( &datagrams[0], datagrams.size(), maximumPacketSize_ );
+            if( count > 0 ){
+                received = true;
+                try{
+                    if( DispatchReceivedDatagrams( socketListeners_[i].first, &datagrams[0], count ) )
+                        break_ = true;
+                }catch(...){
+                    socket->ReleaseReceived();
+                    throw;
+                }
+            }
+            socket->ReleaseReceived();
+        }
+        return received;
+    }
+
+    bool IsAnySocketReadable() const
+    {
+        for( std::size_t i=0; i < socketListeners_.size(); ++i ){
+            if( socketListeners_[i].second->IsReadable() )
+                return true;
+        }
+        return false;
+    }
+
+    // Sleep until a datagram is written to one of the rings,
+    // AsynchronousBreak() is called or the steady clock reaches
+    // expiryMs (if not null). Returns at once if a socket is readable.
+    void Wait( std::vector<struct futex_waitv>& waiters, const double *expiryMs )
+    {
+        const std::size_t socketCount = socketListeners_.size();
+
+        struct futex_waitv& breakWaiter = waiters[ socketCount ];
+        breakWaiter.val = breakSignal_.load();
+        breakWaiter.uaddr = (uintptr_t)(void*)&breakSignal_;
+        breakWaiter.flags = FUTEX_32 | FUTEX_PRIVATE_FLAG;
+        breakWaiter.__reserved = 0;
+
+        bool readable = false;
+        for( std::size_t i=0; i < socketCount; ++i ){
+            SharedMemoryRing& ring = socketListeners_[i].second->Ring();
+            waiters[i].val = ring.PrepareWait();
+            waiters[i].uaddr = (uintptr_t)(void*)ring.SignalAddress();
+            waiters[i].flags = FUTEX_32;
+            waiters[i].__reserved = 0;
+            readable = readable || socketListeners_[i].second->IsReadable();
+        }
+
+        long result = 0;
+        if( !readable && !break_ ){
+            struct __kernel_timespec timeout;
+            if( expiryMs ){
+                double seconds = std::floor( *expiryMs * .001 );
+                timeout.tv_sec = (long long)seconds;
+                timeout.tv_nsec = (long long)((*expiryMs - seconds * 1000.) * 1000000.);
+            }
+            result = syscall( __NR_futex_waitv, &waiters[0], (unsigned int)( socketCount + 1 ), 0,
+                    expiryMs ? &timeout : 0, CLOCK_MONOTONIC );
+        }
+        int error = errno;
+
+        for( std::size_t i=0; i < socketCount; ++i )
+            socketListeners_[i].second->Ring().FinishWait();
+
+        // EAGAIN if a value changed before the wait started
+        if( result < 0 && error != EAGAIN && error != EINTR && error != ETIMEDOUT )
+            throw std::runtime_error( "unable to wait for shared memory rings (futex_waitv requires Linux 5.16)\n" );
+    }
+
+public:
+    SharedMemorySocketReceiveMultiplexerImplementation()
+        : receiveBatchSize_( 1 )
+        , maximumPacketSize_( DEFAULT_MAXIMUM_PACKET_SIZE )
+        , break_( false )
+        , breakSignal_( 0 ) {}
+
+    void AttachSocketListener( UdpSocket_T *socket, PacketListener *listener )
+    {
+        assert( std::find( socketListeners_.begin(), socketListeners_.end(), std::make_pair(listener, socket) ) == socketListeners_.end() );
+        // we don't check that the same socket has been added multiple times, even though this is an error
+        socketListeners_.push_back( std::make_pair( listener, socket ) );
+    }
+
+    void DetachSocketListener( UdpSocket_T *socket, PacketListener *listener )
+    {
+        auto i = std::find( socketListeners_.begin(), socketListeners_.end(), std::make_pair(listener, socket) );
+        assert( i != socketListeners_.end() );
+
+        socketListeners_.erase( i );
+    }
+
+    void AttachPeriodicTimerListener( int periodMilliseconds, TimerListener *listener )
+    {
+        timerListeners_.push_back( AttachedTimerListener( periodMilliseconds, periodMilliseconds, listener ) );
+    }
+
+    void AttachPeriodicTimerListener( int initialDelayMilliseconds, int periodMilliseconds, TimerListener *listener )
+    {
+        timerListeners_.push_back( AttachedTimerListener( initialDelayMilliseconds, periodMilliseconds, listener ) );
+    }
+
+    void DetachPeriodicTimerListener( TimerListener *listener )
+    {
+        std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
+        while( i != timerListeners_.end() ){
+            if( i->listener == listener )
+                break;
+            ++i;
+        }
+
+        assert( i != timerListeners_.end() );
+
+        timerListeners_.erase( i );
+    }
+
+    void AttachScheduledTimerListener( ScheduledTimerListener *listener )
+    {
+        scheduledTimerListeners_.push_back( listener );
+    }
+
+    void DetachScheduledTimerListener( ScheduledTimerListener *listener )
+    {
+        auto i = std::find( scheduledTimerListeners_.begin(), scheduledTimerListeners_.end(), listener );
+        assert( i != scheduledTimerListeners_.end() );
+
+        scheduledTimerListeners_.erase( i );
+    }
+
+    // the number of datagrams delivered with each ProcessPackets() call at most
+    void SetReceiveBatchSize( std::size_t datagramCount )
+    {
+        assert( datagramCount > 0 );
+        receiveBatchSize_ = datagramCount;
+    }
+
+    void SetMaximumPacketSize( std::size_t bytes )
+    {
+        assert( bytes > 0 );
+        maximumPacketSize_ = bytes;
+    }
+
+    MultiplexerMetrics Metrics() const
+    {
+        return detail::CollectMultiplexerMetrics( socketListeners_ );
+    }
+
+    void Run()
+    {
+        break_ = false;
+
+        if( socketListeners_.size() >= FUTEX_WAITV_MAX )
+            throw std::runtime_error( "too many shared memory sockets attached to multiplexer\n" );
+
+        // configure the timer queue
+        detail::TimerQueue timerQueue;
+        timerQueue.Reset( timerListeners_, scheduledTimerListeners_, GetCurrentTimeMs() );
+
+        std::vector<ReceivedDatagram> datagrams( receiveBatchSize_ );
+        std::vector<struct futex_waitv> waiters( socketListeners_.size() + 1 );
+
+        int busyPollMicroseconds = 0;
+        for( std::size_t i=0; i < socketListeners_.size(); ++i )
+            busyPollMicroseconds = std::max( busyPollMicroseconds, socketListeners_[i].second->BusyPollMicroseconds() );
+
+        while( !break_ ){
+
+            bool received = ReceiveAvailable( datagrams );
+            if( break_ )
+                break;
+
+            // execute any expired timers
+            timerQueue.ExpireTimers( GetCurrentTimeMs(), [this]() -> bool { return break_; } );
+            if( received || break_ )
+                continue;
+
+            double expiryMs = 0;
+            bool hasExpiry = timerQueue.NextExpiryMs( expiryMs );
+            for( std::size_t i=0; i < socketListeners_.size(); ++i ){
+                double abandonedExpiryMs;
+                if( socketListeners_[i].second->AbandonedRecordExpiryMs( abandonedExpiryMs )
+                        && ( !hasExpiry || abandonedExpiryMs < expiryMs ) ){
+                    expiryMs = abandonedExpiryMs;
+                    hasExpiry = true;
+                }
+            }
+
+            if( busyPollMicroseconds > 0 ){
+                double pollEndMs = GetCurrentTimeMs() + busyPollMicroseconds * .001;
+                if( hasExpiry )
+                    pollEndMs = std::min( pollEndMs, expiryMs );
+                while( !break_ && !IsAnySocketReadable() && GetCurrentTimeMs() < pollEndMs )
+                    ;
+                if( break_ || IsAnySocketReadable() )
+                    continue;
+            }
+
+            Wait( waiters, hasExpiry ? &expiryMs : 0 );
+        }
+    }
+
+    void Break()
+    {
+        break_ = true;
+    }
+
+    // may be called from another thread or a signal handler
+    void AsynchronousBreak()
+    {
+        break_ = true;
+        AsynchronousWakeup();
+    }
+
+    void AsynchronousWakeup()
+    {
+        breakSignal_.fetch_add( 1 );
+        syscall( SYS_futex, &breakSignal_, FUTEX_WAKE_PRIVATE, 1, 0, 0, 0 );
+    }
+};
+
+struct SharedMemoryImplementation
+{
+    using udp_socket_t = oscpack::posix::SharedMemoryUdpSocketImplementation;
+    using send_batch_t = oscpack::posix::SharedMemorySendBatch;
+    using socket_multiplexer_t = oscpack::posix::SharedMemorySocketReceiveMultiplexerImplementation<udp_socket_t>;
+};
+}
+
+}
@@ -39,6 +39,7 @@
 #include <atomic>
 #include <pthread.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <netdb.h>
@@ -46,6 +47,11 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <netinet/in.h> // for sockaddr_in
+#include <sys/uio.h> // for iovec
+#if defined(__linux__)
+#include <netinet/udp.h> // for UDP_SEGMENT and UDP_GRO
+#include <linux/net_tstamp.h> // for SO_TIMESTAMPING flags
+#endif
 
 #include <signal.h>
 #include <math.h>
@@ -61,6 +67,7 @@
 
 #include <oscpack/ip/PacketListener.h>
 #include <oscpack/ip/TimerListener.h>
+#include <oscpack/ip/TimerQueue.h>
 
 namespace oscpack
 {
@@ -84,6 +91,16 @@ inline void SockaddrFromIpEndpointName( struct sockaddr_in& sockAddr, const IpEn
       : htons( endpoint.port );
 }
 
+// unlike SockaddrFromIpEndpointName() the endpoint is used as is, so that
+// sending to ANY_ADDRESS (0xFFFFFFFF) sends to the broadcast address
+inline void SendToSockaddrFromIpEndpointName( struct sockaddr_in& sockAddr, const IpEndpointName& endpoint )
+{
+  std::memset( (char *)&sockAddr, 0, sizeof(sockAddr ) );
+  sockAddr.sin_family = AF_INET;
+  sockAddr.sin_addr.s_addr = htonl( endpoint.address );
+  sockAddr.sin_port = htons( endpoint.port );
+}
+
 inline IpEndpointName IpEndpointNameFromSockaddr( const struct sockaddr_in& sockAddr )
 {
   return IpEndpointName(
@@ -96,28 +113,281 @@ inline IpEndpointName IpEndpointNameFromSockaddr( const struct sockaddr_in& sock
           );
 }
 
+// preallocated storage used by UdpSocketImplementation::ReceiveMany() to
+// receive up to Capacity() datagrams of at most BufferSize() bytes each
+// with a single system call. all storage is allocated by the constructor,
+// except when a receive offload (UDP_GRO) buffer splits into more
+// datagrams than were received before.
+class ReceiveBatch{
+    friend class UdpSocketImplementation;
+
+    std::size_t capacity_;
+    std::size_t bufferSize_;
+    std::size_t bufferStride_; // buffers are kept 16 byte aligned
+    std::vector<char> buffers_;
+    std::vector<struct sockaddr_in> addresses_;
+    std::vector<ReceivedDatagram> datagrams_;
+    std::size_t datagramCount_;
+
+    // ancillary data: the UDP_GRO segment size, a timestamp (up to three
+    // for SO_TIMESTAMPING), the destination address and the SO_RXQ_OVFL
+    // drop count
+    union Control{
+        char buffer[ CMSG_SPACE(sizeof(int)) + CMSG_SPACE(3 * sizeof(struct timespec))
+                + CMSG_SPACE(sizeof(struct sockaddr_in)) + CMSG_SPACE(sizeof(uint32_t)) ];
+        struct cmsghdr align;
+    };
+    std::vector<Control> controls_;
+#if defined(__linux__)
+    std::vector<struct iovec> iovecs_;
+    std::vector<struct mmsghdr> headers_;
+#endif
+
+    void AddDatagram( const char *data, std::size_t size, const struct sockaddr_in& fromAddr,
+            const IpEndpointName& localEndpoint, int64_t receiveTimeNs )
+    {
+        if( datagramCount_ == datagrams_.size() )
+            datagrams_.resize( datagrams_.size() * 2 );
+
+        ReceivedDatagram& datagram = datagrams_[ datagramCount_++ ];
+        datagram.data = data;
+        datagram.size = (int)size;
+        datagram.remoteEndpoint.address = ntohl( fromAddr.sin_addr.s_addr );
+        datagram.remoteEndpoint.port = ntohs( fromAddr.sin_port );
+        datagram.localEndpoint = localEndpoint;
+        datagram.receiveTimeNs = receiveTimeNs;
+    }
+
+public:
+    ReceiveBatch( std::size_t capacity, std::size_t bufferSize )
+        : capacity_( capacity )
+        , bufferSize_( bufferSize )
+        , bufferStride_( (bufferSize + 15) & ~((std::size_t)15) )
+        , buffers_( capacity * bufferStride_ )
+        , addresses_( capacity )
+        , datagrams_( capacity )
+        , datagramCount_( 0 )
+        , controls_( capacity )
+    {
+        assert( capacity > 0 );
+        assert( bufferSize > 0 );
+
+#if defined(__linux__)
+        iovecs_.resize( capacity );
+        headers_.resize( capacity );
+        for( std::size_t i=0; i < capacity; ++i ){
+            iovecs_[i].iov_base = Buffer( i );
+            iovecs_[i].iov_len = bufferSize_;
+
+            std::memset( &headers_[i], 0, sizeof(headers_[i]) );
+            headers_[i].msg_hdr.msg_name = &addresses_[i];
+            headers_[i].msg_hdr.msg_namelen = sizeof(addresses_[i]);
+            headers_[i].msg_hdr.msg_iov = &iovecs_[i];
+            headers_[i].msg_hdr.msg_iovlen = 1;
+        }
+#endif
+    }
+
+    std::size_t Capacity() const { return capacity_; }
+    std::size_t BufferSize() const { return bufferSize_; }
+
+    char *Buffer( std::size_t i ) { return &buffers_[ i * bufferStride_ ]; }
+
+    // the space reserved for the ancillary data of each datagram
+    static constexpr std::size_t CONTROL_SIZE = sizeof(Control);
+
+    // the datagrams stored by the last call to ReceiveMany()
+    const ReceivedDatagram *Datagrams() const { return &datagrams_[0]; }
+};
+
+
+// the datagrams queued by a BatchSender, plus the storage used by
+// UdpSocketImplementation::SendMany() to send them. the storage is reused
+// by later batches.
+class SendBatch{
+    friend class UdpSocketImplementation;
+
+    std::vector<OutgoingDatagram> datagrams_;
+#if defined(__linux__)
+    union Control{
+        char buffer[ CMSG_SPACE(sizeof(uint16_t)) ];
+        struct cmsghdr align;
+    };
+
+    std::vector<struct sockaddr_in> addresses_;
+    std::vector<struct iovec> iovecs_;
+    std::vector<struct mmsghdr> headers_;
+    std::vector<Control> controls_;
+    std::vector<std::size_t> firstDatagrams_; // of each header
+#endif
+
+public:
+    void Clear() { datagrams_.clear(); }
+
+    void Add( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
+    {
+        OutgoingDatagram datagram = { remoteEndpoint, data, size, 0 };
+        datagrams_.push_back( datagram );
+    }
+
+    std::size_t Size() const { return datagrams_.size(); }
+    const OutgoingDatagram& Datagram( std::size_t i ) const { return datagrams_[i]; }
+};
+
+
 class UdpSocketImplementation{
     bool isBound_{};
     bool isConnected_{};
 
     int socket_{};
     struct sockaddr_in connectedAddr_;
-    struct sockaddr_in sendToAddr_;
     int localPort_{};
 
+    bool receiveOffload_{};
+    std::atomic<std::size_t> truncatedDatagramCount_;
+
+    detail::MetricCounter receivedDatagramCount_;
+    detail::MetricCounter receivedByteCount_;
+    detail::MetricCounter failedReceiveCount_;
+    detail::MetricCounter kernelDropCount_;
+
+    // cleared if the kernel rejects UDP_SEGMENT, SendMany() then sends
+    // each datagram separately
+    std::atomic_bool segmentationOffload_;
+
+    static int64_t NanosecondsFromTimespec( const struct timespec& t )
+    {
+        return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+    }
+
+#if defined(__linux__)
+    static bool IsSegmentationOffloadUnsupportedError( int error )
+    {
+        return error == EIO || error == ENOPROTOOPT || error == EOPNOTSUPP;
+    }
+
+    // build the sendmmsg() headers for the datagrams starting at first,
+    // grouping runs of equal sized datagrams to the same endpoint if
+    // segmentation offload is enabled. returns the number of headers.
+    std::size_t BuildSendHeaders( SendBatch& batch, std::size_t first, bool segment ) const
+    {
+        const std::size_t MAX_HEADERS = 1024; // UIO_MAXIOV
+        const std::size_t MAX_SEGMENTS = 64; // UDP_MAX_SEGMENTS on older kernels
+        const std::size_t MAX_SEGMENTED_SIZE = 65507; // maximum IPv4 UDP payload
+
+        std::size_t count = batch.datagrams_.size();
+        std::size_t headerCount = 0;
+        std::size_t i = first;
+        while( i < count && headerCount < MAX_HEADERS ){
+            const OutgoingDatagram& datagram = batch.datagrams_[i];
+
+            std::size_t j = i + 1;
+            if( segment ){
+                std::size_t totalSize = datagram.size;
+                while( j < count && j - i < MAX_SEGMENTS
+                        && batch.datagrams_[j].size == datagram.size
+                        && batch.datagrams_[j].remoteEndpoint == datagram.remoteEndpoint
+                        && totalSize + datagram.size <= MAX_SEGMENTED_SIZE ){
+                    totalSize += datagram.size;
+                    ++j;
+                }
+            }
+
+            SendToSockaddrFromIpEndpointName( batch.addresses_[headerCount], datagram.remoteEndpoint );
+
+            for( std::size_t k=i; k < j; ++k ){
+                batch.iovecs_[k].iov_base = const_cast<char*>( batch.datagrams_[k].data );
+                batch.iovecs_[k].iov_len = batch.datagrams_[k].size;
+            }
+
+            struct msghdr& header = batch.headers_[headerCount].msg_hdr;
+            std::memset( &batch.headers_[headerCount], 0, sizeof(batch.headers_[headerCount]) );
+            header.msg_name = &batch.addresses_[headerCount];
+            header.msg_namelen = sizeof(batch.addresses_[headerCount]);
+            header.msg_iov = &batch.iovecs_[i];
+            header.msg_iovlen = j - i;
+
+            if( j - i > 1 ){
+                SendBatch::Control& control = batch.controls_[headerCount];
+                std::memset( &control, 0, sizeof(control) );
+                header.msg_control = control.buffer;
+                header.msg_controllen = sizeof(control.buffer);
+
+                struct cmsghdr *cmsg = CMSG_FIRSTHDR( &header );
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN( sizeof(uint16_t) );
+                uint16_t segmentSize = (uint16_t)datagram.size;
+                std::memcpy( CMSG_DATA( cmsg ), &segmentSize, sizeof(segmentSize) );
+            }
+
+            batch.firstDatagrams_[headerCount] = i;
+            ++headerCount;
+            i = j;
+        }
+
+        return headerCount;
+    }
+#endif
+
+    static in_addr_t InterfaceAddress( const IpEndpointName& localInterface )
+    {
+        return (localInterface.address == IpEndpointName::ANY_ADDRESS)
+                ? htonl( INADDR_ANY )
+                : htonl( localInterface.address );
+    }
+
+    void SetMulticastMembership( int option, const IpEndpointName& group,
+            const IpEndpointName& localInterface, const char *errorMessage )
+    {
+        if( !group.IsMulticastAddress() )
+            throw std::runtime_error("not a multicast group address\n");
+
+        struct ip_mreq request;
+        std::memset( &request, 0, sizeof(request) );
+        request.imr_multiaddr.s_addr = htonl( group.address );
+        request.imr_interface.s_addr = InterfaceAddress( localInterface );
+        if( setsockopt(socket_, IPPROTO_IP, option, &request, sizeof(request)) < 0 )
+            throw std::runtime_error(errorMessage);
+    }
+
+    void SetSourceMembership( int option, const IpEndpointName& group, const IpEndpointName& source,
+            const IpEndpointName& localInterface, const char *errorMessage )
+    {
+        if( !group.IsMulticastAddress() )
+            throw std::runtime_error("not a multicast group address\n");
+        if( source.address == IpEndpointName::ANY_ADDRESS )
+            throw std::runtime_error("source-specific multicast needs a source address\n");
+
+        struct ip_mreq_source request;
+        std::memset( &request, 0, sizeof(request) );
+        request.imr_multiaddr.s_addr = htonl( group.address );
+        request.imr_sourceaddr.s_addr = htonl( source.address );
+        request.imr_interface.s_addr = InterfaceAddress( localInterface );
+        if( setsockopt(socket_, IPPROTO_IP, option, &request, sizeof(request)) < 0 )
+            throw std::runtime_error(errorMessage);
+    }
+
 public:
 
     UdpSocketImplementation()
         : isBound_( false )
         , isConnected_( false )
         , socket_( -1 )
+        , truncatedDatagramCount_( 0 )
+        , segmentationOffload_( true )
     {
         if( (socket_ = socket( AF_INET, SOCK_DGRAM, 0 )) == -1 ){
             throw std::runtime_error("unable to create udp socket\n");
         }
 
-        std::memset( &sendToAddr_, 0, sizeof(sendToAddr_) );
-        sendToAddr_.sin_family = AF_INET;
+#if defined(__linux__)
+        if( METRICS_ENABLED ){
+            // report kernel drops with each datagram, see SocketMetrics
+            int value = 1;
+            setsockopt(socket_, SOL_SOCKET, SO_RXQ_OVFL, &value, sizeof(value));
+        }
+#endif
     }
 
     ~UdpSocketImplementation()
@@ -143,6 +413,260 @@ public:
 #endif
     }
 
+    void SetReusePort( bool reusePort )
+    {
+        int value = (reusePort) ? 1 : 0; // int on posix
+        if( setsockopt(socket_, SOL_SOCKET, SO_REUSEPORT, &value, sizeof(value)) < 0 )
+            throw std::runtime_error("unable to set SO_REUSEPORT\n");
+    }
+
+    void SetReceiveBufferSize( int bytes )
+    {
+        if( setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes)) < 0 )
+            throw std::runtime_error("unable to set SO_RCVBUF\n");
+    }
+
+    int ReceiveBufferSize() const
+    {
+        int bytes = 0;
+        socklen_t length = sizeof(bytes);
+        if( getsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &bytes, &length) < 0 )
+            throw std::runtime_error("unable to get SO_RCVBUF\n");
+        return bytes;
+    }
+
+    void SetSendBufferSize( int bytes )
+    {
+        if( setsockopt(socket_, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes)) < 0 )
+            throw std::runtime_error("unable to set SO_SNDBUF\n");
+    }
+
+    int SendBufferSize() const
+    {
+        int bytes = 0;
+        socklen_t length = sizeof(bytes);
+        if( getsockopt(socket_, SOL_SOCKET, SO_SNDBUF, &bytes, &length) < 0 )
+            throw std::runtime_error("unable to get SO_SNDBUF\n");
+        return bytes;
+    }
+
+    void SetBusyPoll( int microseconds )
+    {
+#if defined(__linux__)
+        if( setsockopt(socket_, SOL_SOCKET, SO_BUSY_POLL, &microseconds, sizeof(microseconds)) < 0 )
+            throw std::runtime_error("unable to set SO_BUSY_POLL\n");
+#else
+        (void) microseconds;
+        throw std::runtime_error("SO_BUSY_POLL is not supported on this platform\n");
+#endif
+    }
+
+    void SetEnableReceiveOffload( bool enableReceiveOffload )
+    {
+#if defined(__linux__)
+        int value = (enableReceiveOffload) ? 1 : 0;
+        if( setsockopt(socket_, SOL_UDP, UDP_GRO, &value, sizeof(value)) < 0 )
+            throw std::runtime_error("unable to set UDP_GRO\n");
+        receiveOffload_ = enableReceiveOffload;
+#else
+        if( enableReceiveOffload )
+            throw std::runtime_error("UDP_GRO is not supported on this platform\n");
+#endif
+    }
+
+    bool IsReceiveOffloadEnabled() const { return receiveOffload_; }
+
+    void SetEnableReceiveTimestamps( bool enableReceiveTimestamps, bool preferHardware )
+    {
+#if defined(__linux__)
+        int timestampNs = (enableReceiveTimestamps && !preferHardware) ? 1 : 0;
+        int timestamping = (enableReceiveTimestamps && preferHardware)
+                ? (SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE
+                    | SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE)
+                : 0;
+
+        // clear the option which isn't used first
+        if( timestampNs ){
+            setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMPING, &timestamping, sizeof(timestamping));
+            if( setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMPNS, &timestampNs, sizeof(timestampNs)) < 0 )
+                throw std::runtime_error("unable to set SO_TIMESTAMPNS\n");
+        }else{
+            setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMPNS, &timestampNs, sizeof(timestampNs));
+            if( setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMPING, &timestamping, sizeof(timestamping)) < 0 )
+                throw std::runtime_error("unable to set SO_TIMESTAMPING\n");
+        }
+#elif defined(SO_TIMESTAMP)
+        if( enableReceiveTimestamps && preferHardware )
+            throw std::runtime_error("hardware timestamps are not supported on this platform\n");
+
+        int value = (enableReceiveTimestamps) ? 1 : 0;
+        if( setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMP, &value, sizeof(value)) < 0 )
+            throw std::runtime_error("unable to set SO_TIMESTAMP\n");
+#else
+        (void) preferHardware;
+        if( enableReceiveTimestamps )
+            throw std::runtime_error("receive timestamps are not supported on this platform\n");
+#endif
+    }
+
+    void SetEnableReceiveLocalEndpoint( bool enableReceiveLocalEndpoint )
+    {
+        int value = (enableReceiveLocalEndpoint) ? 1 : 0;
+#if defined(__linux__)
+        if( setsockopt(socket_, IPPROTO_IP, IP_PKTINFO, &value, sizeof(value)) < 0 )
+            throw std::runtime_error("unable to set IP_PKTINFO\n");
+#elif defined(IP_RECVDSTADDR)
+        if( setsockopt(socket_, IPPROTO_IP, IP_RECVDSTADDR, &value, sizeof(value)) < 0 )
+            throw std::runtime_error("unable to set IP_RECVDSTADDR\n");
+#else
+        if( enableReceiveLocalEndpoint )
+            throw std::runtime_error("IP_PKTINFO is not supported on this platform\n");
+#endif
+    }
+
+    // clears IP_MULTICAST_ALL on Linux. other systems only deliver a
+    // socket's own memberships anyway
+    void SetReceiveOwnMembershipsOnly( bool ownMembershipsOnly )
+    {
+#if defined(IP_MULTICAST_ALL)
+        int value = ownMembershipsOnly ? 0 : 1;
+        if( setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_ALL, &value, sizeof(value)) < 0 )
+            throw std::runtime_error("unable to set IP_MULTICAST_ALL\n");
+#else
+        (void) ownMembershipsOnly;
+#endif
+    }
+
+    void JoinMulticastGroup( const IpEndpointName& group, const IpEndpointName& localInterface )
+    {
+        SetMulticastMembership( IP_ADD_MEMBERSHIP, group, localInterface, "unable to join multicast group\n" );
+    }
+
+    void LeaveMulticastGroup( const IpEndpointName& group, const IpEndpointName& localInterface )
+    {
+        SetMulticastMembership( IP_DROP_MEMBERSHIP, group, localInterface, "unable to leave multicast group\n" );
+    }
+
+    void JoinSourceGroup( const IpEndpointName& group, const IpEndpointName& source, const IpEndpointName& localInterface )
+    {
+        SetSourceMembership( IP_ADD_SOURCE_MEMBERSHIP, group, source, localInterface,
+                "unable to join source-specific multicast group\n" );
+    }
+
+    void LeaveSourceGroup( const IpEndpointName& group, const IpEndpointName& source, const IpEndpointName& localInterface )
+    {
+        SetSourceMembership( IP_DROP_SOURCE_MEMBERSHIP, group, source, localInterface,
+                "unable to leave source-specific multicast group\n" );
+    }
+
+    void SetMulticastInterface( const IpEndpointName& localInterface )
+    {
+        struct in_addr interfaceAddr;
+        interfaceAddr.s_addr = InterfaceAddress( localInterface );
+        if( setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_IF, &interfaceAddr, sizeof(interfaceAddr)) < 0 )
+            throw std::runtime_error("unable to set IP_MULTICAST_IF\n");
+    }
+
+    void SetMulticastTtl( int ttl )
+    {
+        if( ttl < 0 || ttl > 255 )
+            throw std::runtime_error("multicast ttl must be between 0 and 255\n");
+        unsigned char value = (unsigned char)ttl; // u_char on the BSDs, Linux also accepts it
+        if( setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_TTL, &value, sizeof(value)) < 0 )
+            throw std::runtime_error("unable to set IP_MULTICAST_TTL\n");
+    }
+
+    void SetMulticastLoopback( bool enableLoopback )
+    {
+        unsigned char value = (unsigned char)((enableLoopback) ? 1 : 0);
+        if( setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_LOOP, &value, sizeof(value)) < 0 )
+            throw std::runtime_error("unable to set IP_MULTICAST_LOOP\n");
+    }
+
+    // bound to the group address so that unicast datagrams and other
+    // groups sent to the same port aren't received
+    static IpEndpointName MulticastBindEndpoint( const IpEndpointName& group )
+    {
+        return group;
+    }
+
+    // read the ancillary data of a received datagram. segmentSize is only
+    // changed if the kernel coalesced several datagrams. also used by
+    // multiplexers which receive without ReceiveMany()
+    void ParseControlMessages( struct msghdr& header, std::size_t& segmentSize,
+            IpEndpointName& localEndpoint, int64_t& receiveTimeNs )
+    {
+        if( header.msg_controllen == 0 )
+            return;
+
+        for( struct cmsghdr *cmsg = CMSG_FIRSTHDR( &header ); cmsg; cmsg = CMSG_NXTHDR( &header, cmsg ) ){
+#if defined(__linux__)
+            if( cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO ){
+                int gsoSize;
+                std::memcpy( &gsoSize, CMSG_DATA( cmsg ), sizeof(gsoSize) );
+                if( gsoSize > 0 )
+                    segmentSize = (std::size_t)gsoSize;
+            }else if( cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS ){
+                struct timespec t;
+                std::memcpy( &t, CMSG_DATA( cmsg ), sizeof(t) );
+                receiveTimeNs = NanosecondsFromTimespec( t );
+            }else if( cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING ){
+                // software, (deprecated) and raw hardware timestamps
+                struct timespec t[3];
+                std::memcpy( t, CMSG_DATA( cmsg ), sizeof(t) );
+                receiveTimeNs = NanosecondsFromTimespec( (t[2].tv_sec != 0 || t[2].tv_nsec != 0) ? t[2] : t[0] );
+            }else if( cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO ){
+                struct in_pktinfo info;
+                std::memcpy( &info, CMSG_DATA( cmsg ), sizeof(info) );
+                localEndpoint = IpEndpointName( ntohl( info.ipi_addr.s_addr ), localPort_ );
+            }else if( cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL ){
+                // the number of datagrams dropped by the socket so far
+                uint32_t dropCount;
+                std::memcpy( &dropCount, CMSG_DATA( cmsg ), sizeof(dropCount) );
+                kernelDropCount_.Set( dropCount );
+            }
+#else
+#if defined(SCM_TIMESTAMP)
+            if( cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMP ){
+                struct timeval t;
+                std::memcpy( &t, CMSG_DATA( cmsg ), sizeof(t) );
+                receiveTimeNs = (int64_t)t.tv_sec * 1000000000 + (int64_t)t.tv_usec * 1000;
+            }
+#endif
+#if defined(IP_RECVDSTADDR)
+            if( cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_RECVDSTADDR ){
+                struct in_addr address;
+                std::memcpy( &address, CMSG_DATA( cmsg ), sizeof(address) );
+                localEndpoint = IpEndpointName( ntohl( address.s_addr ), localPort_ );
+            }
+#endif
+            (void) segmentSize;
+#endif
+        }
+    }
+
+    // used by multiplexers which receive without ReceiveMany()
+    void CountTruncatedDatagram() { ++truncatedDatagramCount_; }
+    void CountReceivedDatagram( std::size_t size )
+    {
+        receivedDatagramCount_.Add();
+        receivedByteCount_.Add( size );
+    }
+    void CountFailedReceive() { failedReceiveCount_.Add(); }
+
+    std::size_t TruncatedDatagramCount() const { return truncatedDatagramCount_; }
+
+    SocketMetrics Metrics() const
+    {
+        SocketMetrics result;
+        result.receivedDatagramCount = receivedDatagramCount_.Value();
+        result.receivedByteCount = receivedByteCount_.Value();
+        result.failedReceiveCount = failedReceiveCount_.Value();
+        result.truncatedDatagramCount = truncatedDatagramCount_;
+        result.kernelDropCount = kernelDropCount_.Value();
+        return result;
+    }
+
     IpEndpointName LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
     {
         assert( isBound_ );
@@ -218,10 +742,88 @@ public:
 
     void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
     {
-        sendToAddr_.sin_addr.s_addr = htonl( remoteEndpoint.address );
-        sendToAddr_.sin_port = htons( remoteEndpoint.port );
+        struct sockaddr_in sendToAddr;
+        SendToSockaddrFromIpEndpointName( sendToAddr, remoteEndpoint );
+
+        sendto( socket_, data, size, 0, (sockaddr*)&sendToAddr, sizeof(sendToAddr) );
+    }
+
+    // Send all datagrams of batch and set their error fields. Returns the
+    // number of datagrams which couldn't be sent. See BatchSender.
+    std::size_t SendMany( SendBatch& batch )
+    {
+        std::size_t count = batch.datagrams_.size();
+        std::size_t failedCount = 0;
+
+        for( std::size_t i=0; i < count; ++i )
+            batch.datagrams_[i].error = 0;
+
+#if defined(__linux__)
+        batch.addresses_.resize( std::min<std::size_t>( count, 1024 ) );
+        batch.iovecs_.resize( count );
+        batch.headers_.resize( batch.addresses_.size() );
+        batch.controls_.resize( batch.addresses_.size() );
+        batch.firstDatagrams_.resize( batch.addresses_.size() );
+
+        std::size_t next = 0;
+        bool retryWithoutSegmentation = false;
+        while( next < count ){
+            bool segment = segmentationOffload_ && !retryWithoutSegmentation;
+            retryWithoutSegmentation = false;
+            std::size_t headerCount = BuildSendHeaders( batch, next, segment );
+
+            int result = sendmmsg( socket_, &batch.headers_[0], (unsigned int)headerCount, 0 );
+
+            if( result > 0 ){
+                // the datagrams of the first result headers were sent
+                std::size_t lastHeader = (std::size_t)result - 1;
+                next = batch.firstDatagrams_[lastHeader] + batch.headers_[lastHeader].msg_hdr.msg_iovlen;
+                // (error fields are already zero)
+                continue;
+            }
+
+            int error = errno;
+            if( error == EINTR )
+                continue;
+
+            std::size_t first = batch.firstDatagrams_[0];
+            std::size_t end = first + batch.headers_[0].msg_hdr.msg_iovlen;
+            if( end - first > 1 ){
+                // UDP_SEGMENT was rejected: unsupported by the kernel or the
+                // device, or e.g. the segments exceed the path MTU. retry
+                // the datagrams separately, and stop segmenting if the
+                // kernel or device doesn't support it.
+                if( IsSegmentationOffloadUnsupportedError( error ) )
+                    segmentationOffload_ = false;
+                retryWithoutSegmentation = true;
+                continue;
+            }
+
+            for( std::size_t i=first; i < end; ++i )
+                batch.datagrams_[i].error = error;
+            failedCount += end - first;
+            next = end;
+        }
+#else
+        for( std::size_t i=0; i < count; ++i ){
+            OutgoingDatagram& datagram = batch.datagrams_[i];
+
+            struct sockaddr_in sendToAddr;
+            SendToSockaddrFromIpEndpointName( sendToAddr, datagram.remoteEndpoint );
 
-        sendto( socket_, data, size, 0, (sockaddr*)&sendToAddr_, sizeof(sendToAddr_) );
+            ssize_t result;
+            do{
+                result = sendto( socket_, datagram.data, datagram.size, 0, (sockaddr*)&sendToAddr, sizeof(sendToAddr) );
+            }while( result < 0 && errno == EINTR );
+
+            if( result < 0 ){
+                datagram.error = errno;
+                ++failedCount;
+            }
+        }
+#endif
+
+        return failedCount;
     }
 
     void Bind( const IpEndpointName& localEndpoint )
@@ -233,22 +835,61 @@ public:
             throw std::runtime_error("unable to bind udp socket\n");
         }
 
+        // the port chosen by the system if the endpoint was ANY_PORT
+        sockaddr_in local_sock;
+        socklen_t len = sizeof(local_sock);
+        if( getsockname(socket_, (struct sockaddr *) &local_sock, &len) == 0 && len == sizeof(local_sock) )
+          localPort_ = ntohs(local_sock.sin_port);
+
         isBound_ = true;
     }
 
     bool IsBound() const { return isBound_; }
 
+    // Datagrams larger than size are truncated to size bytes, and counted
+    // by TruncatedDatagramCount(). With receive offload enabled a call may
+    // return several coalesced datagrams, use a multiplexer instead.
     std::size_t ReceiveFrom( IpEndpointName& remoteEndpoint, char *data, std::size_t size )
     {
         assert( isBound_ );
 
         struct sockaddr_in fromAddr;
-        socklen_t fromAddrLen = sizeof(fromAddr);
+        struct iovec iov;
+        iov.iov_base = data;
+        iov.iov_len = size;
+
+        ReceiveBatch::Control control;
+
+        struct msghdr header;
+        std::memset( &header, 0, sizeof(header) );
+        header.msg_name = &fromAddr;
+        header.msg_namelen = sizeof(fromAddr);
+        header.msg_iov = &iov;
+        header.msg_iovlen = 1;
+        if( METRICS_ENABLED ){
+            header.msg_control = control.buffer;
+            header.msg_controllen = sizeof(control.buffer);
+        }
 
-        ssize_t result = recvfrom(socket_, data, size, 0,
-                    (struct sockaddr *) &fromAddr, (socklen_t*)&fromAddrLen);
-        if( result < 0 )
+        // an empty datagram is received like any other
+        ssize_t result = recvmsg( socket_, &header, 0 );
+        if( result < 0 ){
+            failedReceiveCount_.Add();
             return 0;
+        }
+        receivedDatagramCount_.Add();
+        receivedByteCount_.Add( (uint64_t)result );
+
+        if( header.msg_flags & MSG_TRUNC )
+            ++truncatedDatagramCount_;
+
+        if( METRICS_ENABLED ){
+            // for the SO_RXQ_OVFL drop count
+            std::size_t segmentSize = (std::size_t)result;
+            IpEndpointName localEndpoint;
+            int64_t receiveTimeNs = 0;
+            ParseControlMessages( header, segmentSize, localEndpoint, receiveTimeNs );
+        }
 
         remoteEndpoint.address = ntohl(fromAddr.sin_addr.s_addr);
         remoteEndpoint.port = ntohs(fromAddr.sin_port);
@@ -256,49 +897,170 @@ public:
         return (std::size_t)result;
     }
 
+    // Receive up to batch.Capacity() datagrams. On Linux this is a single
+    // recvmmsg() call which blocks until at least one datagram is available,
+    // and buffers coalesced by receive offload are split into their
+    // datagrams. Elsewhere one datagram is received. Returns the number of
+    // datagrams stored in batch.Datagrams(), with their receive time and
+    // local endpoint if enabled. Empty datagrams are not stored, truncated
+    // ones are counted by TruncatedDatagramCount() and dropped.
+    std::size_t ReceiveMany( ReceiveBatch& batch )
+    {
+        assert( isBound_ );
+
+        batch.datagramCount_ = 0;
+
+#if defined(__linux__)
+        for( std::size_t i=0; i < batch.capacity_; ++i ){
+            struct msghdr& header = batch.headers_[i].msg_hdr;
+            header.msg_namelen = sizeof(batch.addresses_[i]);
+            header.msg_control = batch.controls_[i].buffer;
+            header.msg_controllen = sizeof(batch.controls_[i].buffer);
+            header.msg_flags = 0;
+        }
+
+        int result = recvmmsg( socket_, &batch.headers_[0], (unsigned int)batch.capacity_,
+                    MSG_WAITFORONE, 0 );
+        if( result < 0 ){
+            failedReceiveCount_.Add();
+            return 0;
+        }
+
+        for( int i=0; i < result; ++i ){
+            struct msghdr& header = batch.headers_[i].msg_hdr;
+            std::size_t size = batch.headers_[i].msg_len;
+
+            if( header.msg_flags & MSG_TRUNC ){
+                ++truncatedDatagramCount_;
+                continue;
+            }
+
+            receivedByteCount_.Add( size );
+
+            std::size_t segmentSize = size;
+            IpEndpointName localEndpoint;
+            int64_t receiveTimeNs = 0;
+            ParseControlMessages( header, segmentSize, localEndpoint, receiveTimeNs );
+
+            // the last segment may be shorter than the others
+            const char *data = batch.Buffer( i );
+            for( std::size_t offset=0; offset < size; offset += segmentSize ){
+                batch.AddDatagram( data + offset, std::min( segmentSize, size - offset ), batch.addresses_[i],
+                        localEndpoint, receiveTimeNs );
+            }
+        }
+#else
+        struct iovec iov;
+        iov.iov_base = batch.Buffer( 0 );
+        iov.iov_len = batch.bufferSize_;
+
+        struct msghdr header;
+        std::memset( &header, 0, sizeof(header) );
+        header.msg_name = &batch.addresses_[0];
+        header.msg_namelen = sizeof(batch.addresses_[0]);
+        header.msg_iov = &iov;
+        header.msg_iovlen = 1;
+        header.msg_control = batch.controls_[0].buffer;
+        header.msg_controllen = sizeof(batch.controls_[0].buffer);
+
+        ssize_t result = recvmsg( socket_, &header, 0 );
+        if( result < 0 ){
+            failedReceiveCount_.Add();
+            return 0;
+        }
+
+        if( header.msg_flags & MSG_TRUNC ){
+            ++truncatedDatagramCount_;
+        }else if( result > 0 ){ // empty datagrams aren't stored
+            receivedByteCount_.Add( (uint64_t)result );
+            std::size_t segmentSize = (std::size_t)result;
+            IpEndpointName localEndpoint;
+            int64_t receiveTimeNs = 0;
+            ParseControlMessages( header, segmentSize, localEndpoint, receiveTimeNs );
+            batch.AddDatagram( batch.Buffer( 0 ), (std::size_t)result, batch.addresses_[0],
+                    localEndpoint, receiveTimeNs );
+        }
+#endif
+
+        receivedDatagramCount_.Add( batch.datagramCount_ );
+        return batch.datagramCount_;
+    }
+
     int Socket() { return socket_; }
 };
 
 
 
-struct AttachedTimerListener{
-    AttachedTimerListener( int id, int p, TimerListener *tl )
-        : initialDelayMs( id )
-        , periodMs( p )
-        , listener( tl ) {}
-    int initialDelayMs;
-    int periodMs;
-    TimerListener *listener;
-};
+using detail::AttachedTimerListener;
+
+// the "__stop_" packet makes Run() exit, as if Break() had been called
+inline bool IsStopPacket( const char *data, std::size_t size )
+{
+    return size == 8 && std::memcmp( data, "__stop_", 8 ) == 0;
+}
 
 
-inline bool CompareScheduledTimerCalls(
-        const std::pair< double, AttachedTimerListener > & lhs, const std::pair< double, AttachedTimerListener > & rhs )
+// deliver count received datagrams to listener, up to (but not including)
+// the first stop packet. returns true if a stop packet was received.
+inline bool DispatchReceivedDatagrams( PacketListener *listener,
+        const ReceivedDatagram *datagrams, std::size_t count )
 {
-    return lhs.first < rhs.first;
+    std::size_t dispatchCount = 0;
+    while( dispatchCount < count
+            && !IsStopPacket( datagrams[dispatchCount].data, datagrams[dispatchCount].size ) )
+        ++dispatchCount;
+
+    if( dispatchCount > 0 )
+        listener->ProcessPackets( datagrams, dispatchCount );
+
+    return dispatchCount < count;
 }
 
+
+// the size of the receive buffers used when receiving from the sockets of
+// socketListeners. buffers of sockets with receive offload enabled have to
+// hold a coalesced buffer of up to 64k, otherwise it's truncated.
+template<typename SocketListeners_T>
+std::size_t ReceiveBufferSizeFor( const SocketListeners_T& socketListeners, std::size_t maximumPacketSize )
+{
+    const std::size_t MAX_COALESCED_SIZE = 65535;
+
+    std::size_t result = maximumPacketSize;
+    for( std::size_t i=0; i < socketListeners.size(); ++i ){
+        if( socketListeners[i].second->IsReceiveOffloadEnabled() )
+            result = std::max( result, MAX_COALESCED_SIZE );
+    }
+    return result;
+}
+
+
 template<typename UdpSocket_T>
 class SocketReceiveMultiplexerImplementation
 {
     std::vector< std::pair< PacketListener*, UdpSocket_T* > > socketListeners_;
     std::vector< AttachedTimerListener > timerListeners_;
+    std::vector< ScheduledTimerListener* > scheduledTimerListeners_;
+
+    std::size_t receiveBatchSize_;
+    std::size_t maximumPacketSize_;
 
     std::atomic_bool break_;
     int breakPipe_[2]; // [0] is the reader descriptor and [1] the writer
 
     double GetCurrentTimeMs() const
     {
-      using namespace std::chrono;
-      using clk = steady_clock;
-      return duration_cast<milliseconds>(clk::now().time_since_epoch()).count();
+      return detail::SteadyTimeMs();
     }
 
 public:
     SocketReceiveMultiplexerImplementation()
+        : receiveBatchSize_( 1 )
+        , maximumPacketSize_( DEFAULT_MAXIMUM_PACKET_SIZE )
     {
         if( pipe(breakPipe_) != 0 )
             throw std::runtime_error( "creation of asynchronous break pipes failed\n" );
+        // wakeups never block, a full pipe wakes the multiplexer anyway
+        fcntl( breakPipe_[1], F_SETFL, O_NONBLOCK );
     }
 
     ~SocketReceiveMultiplexerImplementation()
@@ -346,132 +1108,122 @@ public:
         timerListeners_.erase( i );
     }
 
-    void Run()
+    void AttachScheduledTimerListener( ScheduledTimerListener *listener )
     {
-        break_ = false;
-        char *data = 0;
+        scheduledTimerListeners_.push_back( listener );
+    }
+
+    void DetachScheduledTimerListener( ScheduledTimerListener *listener )
+    {
+        auto i = std::find( scheduledTimerListeners_.begin(), scheduledTimerListeners_.end(), listener );
+        assert( i != scheduledTimerListeners_.end() );
 
-        try{
+        scheduledTimerListeners_.erase( i );
+    }
 
-            // configure the master fd_set for select()
+    void SetReceiveBatchSize( std::size_t datagramCount )
+    {
+        assert( datagramCount > 0 );
+        receiveBatchSize_ = datagramCount;
+    }
 
-            fd_set masterfds, tempfds;
-            FD_ZERO( &masterfds );
-            FD_ZERO( &tempfds );
+    void SetMaximumPacketSize( std::size_t bytes )
+    {
+        assert( bytes > 0 );
+        maximumPacketSize_ = bytes;
+    }
 
-            // in addition to listening to the inbound sockets we
-            // also listen to the asynchronous break pipe, so that AsynchronousBreak()
-            // can break us out of select() from another thread.
-            FD_SET( breakPipe_[0], &masterfds );
-            int fdmax = breakPipe_[0];
+    MultiplexerMetrics Metrics() const
+    {
+        return detail::CollectMultiplexerMetrics( socketListeners_ );
+    }
 
-            for( auto i = socketListeners_.begin();
-                    i != socketListeners_.end(); ++i ){
+    void Run()
+    {
+        break_ = false;
 
-                if( fdmax < i->second->Socket() )
-                    fdmax = i->second->Socket();
-                FD_SET( i->second->Socket(), &masterfds );
-            }
+        // configure the master fd_set for select()
 
+        fd_set masterfds, tempfds;
+        FD_ZERO( &masterfds );
+        FD_ZERO( &tempfds );
 
-            // configure the timer queue
-            double currentTimeMs = GetCurrentTimeMs();
+        // in addition to listening to the inbound sockets we
+        // also listen to the asynchronous break pipe, so that AsynchronousBreak()
+        // can break us out of select() from another thread.
+        FD_SET( breakPipe_[0], &masterfds );
+        int fdmax = breakPipe_[0];
 
-            // expiry time ms, listener
-            std::vector< std::pair< double, AttachedTimerListener > > timerQueue_;
-            for( auto i = timerListeners_.begin();
-                    i != timerListeners_.end(); ++i )
-                timerQueue_.push_back( std::make_pair( currentTimeMs + i->initialDelayMs, *i ) );
-            std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
+        for( auto i = socketListeners_.begin();
+                i != socketListeners_.end(); ++i ){
 
-            const int MAX_BUFFER_SIZE = 4098;
-            data = new char[ MAX_BUFFER_SIZE ];
-            IpEndpointName remoteEndpoint;
+            if( fdmax < i->second->Socket() )
+                fdmax = i->second->Socket();
+            FD_SET( i->second->Socket(), &masterfds );
+        }
 
-            struct timeval timeout;
 
-            while( !break_ ){
-                tempfds = masterfds;
+        // configure the timer queue
+        detail::TimerQueue timerQueue;
+        timerQueue.Reset( timerListeners_, scheduledTimerListeners_, GetCurrentTimeMs() );
 
-                struct timeval *timeoutPtr = 0;
-                if( !timerQueue_.empty() ){
-                    double timeoutMs = timerQueue_.front().first - GetCurrentTimeMs();
-                    if( timeoutMs < 0 )
-                        timeoutMs = 0;
+        ReceiveBatch batch( receiveBatchSize_, ReceiveBufferSizeFor( socketListeners_, maximumPacketSize_ ) );
 
-                    long timoutSecondsPart = (long)(timeoutMs * .001);
-                    timeout.tv_sec = (time_t)timoutSecondsPart;
-                    // 1000000 microseconds in a second
-                    timeout.tv_usec = (suseconds_t)((timeoutMs - (timoutSecondsPart * 1000)) * 1000);
-                    timeoutPtr = &timeout;
-                }
+        struct timeval timeout;
 
-                if( select( fdmax + 1, &tempfds, 0, 0, timeoutPtr ) < 0 ){
-                    if( break_ ){
-                        break;
-                    }else if( errno == EINTR ){
-                        // on returning an error, select() doesn't clear tempfds.
-                        // so tempfds would remain all set, which would cause read( breakPipe_[0]...
-                        // below to block indefinitely. therefore if select returns EINTR we restart
-                        // the while() loop instead of continuing on to below.
-                        continue;
-                    }else{
-                        throw std::runtime_error("select failed\n");
-                    }
-                }
+        while( !break_ ){
+            tempfds = masterfds;
 
-                if( FD_ISSET( breakPipe_[0], &tempfds ) ){
-                    // clear pending data from the asynchronous break pipe
-                    char c;
-                    read( breakPipe_[0], &c, 1 );
-                }
+            struct timeval *timeoutPtr = 0;
+            double timeoutMs = timerQueue.TimeoutMs( GetCurrentTimeMs() );
+            if( timeoutMs >= 0 ){
+                long timoutSecondsPart = (long)(timeoutMs * .001);
+                timeout.tv_sec = (time_t)timoutSecondsPart;
+                // 1000000 microseconds in a second
+                timeout.tv_usec = (suseconds_t)((timeoutMs - (timoutSecondsPart * 1000)) * 1000);
+                timeoutPtr = &timeout;
+            }
 
-                if( break_ )
+            if( select( fdmax + 1, &tempfds, 0, 0, timeoutPtr ) < 0 ){
+                if( break_ ){
                     break;
+                }else if( errno == EINTR ){
+                    // on returning an error, select() doesn't clear tempfds.
+                    // so tempfds would remain all set, which would cause read( breakPipe_[0]...
+                    // below to block indefinitely. therefore if select returns EINTR we restart
+                    // the while() loop instead of continuing on to below.
+                    continue;
+                }else{
+                    throw std::runtime_error("select failed\n");
+                }
+            }
 
-                for( auto i = socketListeners_.begin();
-                        i != socketListeners_.end(); ++i ){
+            if( FD_ISSET( breakPipe_[0], &tempfds ) ){
+                // clear pending data from the asynchronous break pipe
+                char c;
+                read( breakPipe_[0], &c, 1 );
+            }
 
-                    if( FD_ISSET( i->second->Socket(), &tempfds ) ){
+            if( break_ )
+                break;
 
-                        std::size_t size = i->second->ReceiveFrom( remoteEndpoint, data, MAX_BUFFER_SIZE );
+            for( auto i = socketListeners_.begin();
+                    i != socketListeners_.end(); ++i ){
 
-                        if(size == 8 && strcmp(data, "__stop_") == 0)
-                        {
-                            break_ = true;
-                            break;
-                        }
+                if( FD_ISSET( i->second->Socket(), &tempfds ) ){
 
-                        if( size > 0 ){
-                            i->first->ProcessPacket( data, (int)size, remoteEndpoint );
-                            if( break_ )
-                                break;
-                        }
-                    }
-                }
+                    std::size_t count = i->second->ReceiveMany( batch );
 
-                // execute any expired timers
-                currentTimeMs = GetCurrentTimeMs();
-                bool resort = false;
-                for( std::vector< std::pair< double, AttachedTimerListener > >::iterator i = timerQueue_.begin();
-                        i != timerQueue_.end() && i->first <= currentTimeMs; ++i ){
+                    if( DispatchReceivedDatagrams( i->first, batch.Datagrams(), count ) )
+                        break_ = true;
 
-                    i->second.listener->TimerExpired();
                     if( break_ )
                         break;
-
-                    i->first += i->second.periodMs;
-                    resort = true;
                 }
-                if( resort )
-                    std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
             }
 
-            delete [] data;
-        }catch(...){
-            if( data )
-                delete [] data;
-            throw;
+            // execute any expired timers
+            timerQueue.ExpireTimers( GetCurrentTimeMs(), [this]() -> bool { return break_; } );
         }
     }
 
@@ -483,8 +1235,12 @@ public:
     void AsynchronousBreak()
     {
         break_ = true;
+        AsynchronousWakeup();
+    }
 
-        // Send a termination message to the asynchronous break pipe, so select() will return
+    void AsynchronousWakeup()
+    {
+        // Send a message to the asynchronous break pipe, so select() will return
         write( breakPipe_[1], "!", 1 );
     }
 };
@@ -492,6 +1248,7 @@ public:
 struct Implementation
 {
     using udp_socket_t = oscpack::posix::UdpSocketImplementation;
+    using send_batch_t = oscpack::posix::SendBatch;
     using socket_multiplexer_t = oscpack::posix::SocketReceiveMultiplexerImplementation<udp_socket_t>;
 };
 }
@@ -0,0 +1,953 @@
+#pragma once
+/*
+    oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files
+    (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and/or sell copies of the Software,
+    and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+    The text above constitutes the entire oscpack license; however,
+    the oscpack developer(s) also make the following non-binding requests:
+
+    Any person wishing to distribute modifications to the Software is
+    requested to send the modifications to the original developer so that
+    they can be incorporated into the canonical version. It is also
+    requested that these non-binding requests be included whenever the
+    above license is reproduced.
+*/
+
+/*
+    A Linux socket multiplexer built on io_uring (Linux 6.0 or later).
+    Each attached socket has a multishot recvmsg request which the kernel
+    completes for every datagram, writing it into buffers taken from a
+    provided buffer ring, so that a single io_uring_enter() call both
+    waits for and receives any number of datagrams. Timers are waited
+    for with an IORING_OP_TIMEOUT request.
+
+    Send() and SendTo() calls made by listeners and timers, i.e. on the
+    thread executing Run(), are copied and queued as sendmsg requests which
+    are submitted with the next io_uring_enter(). Calls from other threads,
+    datagrams larger than URING_SEND_SLOT_SIZE and BatchSender use the
+    usual system calls, so they may overtake datagrams still queued.
+
+    It needs its own socket implementation but is otherwise a drop-in
+    replacement for the other multiplexers:
+
+        using Impl = oscpack::posix::UringImplementation;
+        oscpack::detail::SocketReceiveMultiplexer<Impl> mux;
+
+    The multiplexer's constructor throws std::runtime_error if io_uring
+    isn't available (e.g. disabled by seccomp or kernel.io_uring_disabled),
+    in which case posix::EventImplementation can be used instead.
+*/
+#include <oscpack/ip/posix/UdpSocket.h>
+
+#if !defined(__linux__)
+#error "UringSocketReceiveMultiplexer.h requires Linux"
+#endif
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <thread>
+
+#if !defined(IORING_RECV_MULTISHOT)
+#error "UringSocketReceiveMultiplexer.h requires Linux 6.0 or later kernel headers"
+#endif
+
+namespace oscpack
+{
+
+namespace posix
+{
+
+// a minimal io_uring wrapper using the raw system calls. all methods must
+// be called by one thread at a time.
+class IoUring{
+    int fd_;
+    unsigned char *sqRing_;
+    std::size_t sqRingSize_;
+    unsigned char *cqRing_;
+    std::size_t cqRingSize_;
+    struct io_uring_sqe *sqes_;
+    std::size_t sqesSize_;
+
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned cqMask_;
+    struct io_uring_cqe *cqes_;
+
+    unsigned unsubmittedCount_;
+
+    void Unmap()
+    {
+        if( sqes_ )
+            munmap( sqes_, sqesSize_ );
+        if( cqRing_ && cqRing_ != sqRing_ )
+            munmap( cqRing_, cqRingSize_ );
+        if( sqRing_ )
+            munmap( sqRing_, sqRingSize_ );
+    }
+
+public:
+    IoUring( unsigned entries, unsigned completionEntries )
+        : fd_( -1 )
+        , sqRing_( 0 )
+        , cqRing_( 0 )
+        , sqes_( 0 )
+        , unsubmittedCount_( 0 )
+    {
+        struct io_uring_params params;
+        std::memset( &params, 0, sizeof(params) );
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+        params.cq_entries = completionEntries;
+        fd_ = (int)syscall( __NR_io_uring_setup, entries, &params );
+        if( fd_ < 0 && errno == EINVAL ){
+            // IORING_SETUP_COOP_TASKRUN needs Linux 5.19
+            std::memset( &params, 0, sizeof(params) );
+            params.flags = IORING_SETUP_CQSIZE;
+            params.cq_entries = completionEntries;
+            fd_ = (int)syscall( __NR_io_uring_setup, entries, &params );
+        }
+        if( fd_ < 0 )
+            throw std::runtime_error( "unable to create io_uring\n" );
+
+        sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if( params.features & IORING_FEAT_SINGLE_MMAP )
+            sqRingSize_ = cqRingSize_ = std::max( sqRingSize_, cqRingSize_ );
+        sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+
+        void *sqRing = mmap( 0, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                fd_, IORING_OFF_SQ_RING );
+        void *cqRing = (params.features & IORING_FEAT_SINGLE_MMAP) ? sqRing
+                : mmap( 0, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        fd_, IORING_OFF_CQ_RING );
+        void *sqes = mmap( 0, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                fd_, IORING_OFF_SQES );
+        sqRing_ = (sqRing == MAP_FAILED) ? 0 : (unsigned char*)sqRing;
+        cqRing_ = (cqRing == MAP_FAILED) ? 0 : (unsigned char*)cqRing;
+        sqes_ = (sqes == MAP_FAILED) ? 0 : (struct io_uring_sqe*)sqes;
+        if( !sqRing_ || !cqRing_ || !sqes_ ){
+            Unmap();
+            close( fd_ );
+            throw std::runtime_error( "unable to map io_uring\n" );
+        }
+
+        sqHead_ = (unsigned*)(sqRing_ + params.sq_off.head);
+        sqTail_ = (unsigned*)(sqRing_ + params.sq_off.tail);
+        sqMask_ = *(unsigned*)(sqRing_ + params.sq_off.ring_mask);
+        sqEntries_ = params.sq_entries;
+        cqHead_ = (unsigned*)(cqRing_ + params.cq_off.head);
+        cqTail_ = (unsigned*)(cqRing_ + params.cq_off.tail);
+        cqMask_ = *(unsigned*)(cqRing_ + params.cq_off.ring_mask);
+        cqes_ = (struct io_uring_cqe*)(cqRing_ + params.cq_off.cqes);
+
+        // submission queue entries are used in order
+        unsigned *sqArray = (unsigned*)(sqRing_ + params.sq_off.array);
+        for( unsigned i=0; i < sqEntries_; ++i )
+            sqArray[i] = i;
+    }
+
+    ~IoUring()
+    {
+        Unmap();
+        close( fd_ );
+    }
+
+    IoUring( const IoUring& ) = delete;
+    IoUring& operator=( const IoUring& ) = delete;
+
+    int Descriptor() const { return fd_; }
+
+    // a cleared submission queue entry, which is submitted by the next
+    // call to Submit(). submits the queued entries first if the queue is
+    // full.
+    struct io_uring_sqe *NextSubmission()
+    {
+        unsigned tail = *sqTail_;
+        if( tail - __atomic_load_n( sqHead_, __ATOMIC_ACQUIRE ) == sqEntries_ ){
+            Submit( 0 );
+            if( tail - __atomic_load_n( sqHead_, __ATOMIC_ACQUIRE ) == sqEntries_ )
+                throw std::runtime_error( "io_uring submission queue is full\n" );
+        }
+
+        struct io_uring_sqe *sqe = &sqes_[ tail & sqMask_ ];
+        std::memset( sqe, 0, sizeof(*sqe) );
+        __atomic_store_n( sqTail_, tail + 1, __ATOMIC_RELEASE );
+        ++unsubmittedCount_;
+        return sqe;
+    }
+
+    // submit the queued entries and wait until at least waitCount
+    // completions are available. returns a negative errno on failure,
+    // e.g. -EINTR if interrupted by a signal.
+    int Submit( unsigned waitCount )
+    {
+        int result = (int)syscall( __NR_io_uring_enter, fd_, unsubmittedCount_, waitCount,
+                (waitCount > 0) ? IORING_ENTER_GETEVENTS : 0, 0, 0 );
+        if( result < 0 )
+            return -errno;
+        unsubmittedCount_ -= std::min( (unsigned)result, unsubmittedCount_ );
+        return result;
+    }
+
+    // call f with each available completion. the completion is consumed
+    // before f is called so f may throw.
+    template< class F >
+    void ForEachCompletion( F f )
+    {
+        unsigned head = *cqHead_;
+        while( head != __atomic_load_n( cqTail_, __ATOMIC_ACQUIRE ) ){
+            struct io_uring_cqe cqe = cqes_[ head & cqMask_ ];
+            __atomic_store_n( cqHead_, ++head, __ATOMIC_RELEASE );
+            f( cqe );
+        }
+    }
+
+    int Register( unsigned opcode, void *arg, unsigned argCount )
+    {
+        int result = (int)syscall( __NR_io_uring_register, fd_, opcode, arg, argCount );
+        return (result < 0) ? -errno : result;
+    }
+};
+
+
+// the provided buffers which multishot receives write datagrams to,
+// registered as buffer group 0 while the multiplexer runs. each buffer
+// holds an io_uring_recvmsg_out header, the source address, the ancillary
+// data and the payload.
+class UringReceiveBuffers{
+    IoUring& ring_;
+    unsigned count_;
+    std::size_t bufferSize_;
+    std::size_t ringSize_;
+    struct io_uring_buf_ring *bufferRing_;
+    std::vector<char> buffers_;
+    unsigned short tail_;
+
+public:
+    static constexpr unsigned short GROUP_ID = 0;
+
+    // count must be a power of two no larger than 32768
+    UringReceiveBuffers( IoUring& ring, unsigned count, std::size_t bufferSize )
+        : ring_( ring )
+        , count_( count )
+        , bufferSize_( (bufferSize + 15) & ~((std::size_t)15) )
+        , ringSize_( count * sizeof(struct io_uring_buf) )
+        , buffers_( count * bufferSize_ )
+        , tail_( 0 )
+    {
+        void *bufferRing = mmap( 0, ringSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if( bufferRing == MAP_FAILED )
+            throw std::runtime_error( "unable to allocate io_uring buffer ring\n" );
+        bufferRing_ = (struct io_uring_buf_ring*)bufferRing;
+
+        struct io_uring_buf_reg registration;
+        std::memset( &registration, 0, sizeof(registration) );
+        registration.ring_addr = (uint64_t)(uintptr_t)bufferRing_;
+        registration.ring_entries = count_;
+        registration.bgid = GROUP_ID;
+        if( ring_.Register( IORING_REGISTER_PBUF_RING, &registration, 1 ) < 0 ){
+            munmap( bufferRing_, ringSize_ );
+            throw std::runtime_error( "unable to register io_uring buffer ring\n" );
+        }
+
+        for( unsigned i=0; i < count_; ++i )
+            Add( (unsigned short)i );
+        Publish();
+    }
+
+    ~UringReceiveBuffers()
+    {
+        struct io_uring_buf_reg registration;
+        std::memset( &registration, 0, sizeof(registration) );
+        registration.bgid = GROUP_ID;
+        ring_.Register( IORING_UNREGISTER_PBUF_RING, &registration, 1 );
+        munmap( bufferRing_, ringSize_ );
+    }
+
+    UringReceiveBuffers( const UringReceiveBuffers& ) = delete;
+    UringReceiveBuffers& operator=( const UringReceiveBuffers& ) = delete;
+
+    char *Buffer( unsigned short id ) { return &buffers_[ id * bufferSize_ ]; }
+
+    // return a buffer to the kernel, which takes effect with Publish()
+    void Add( unsigned short id )
+    {
+        // not bufferRing_->bufs, which C++ compilers place after an empty
+        // struct member of one byte rather than at the start of the ring
+        struct io_uring_buf *buffer = (struct io_uring_buf*)(void*)bufferRing_ + (tail_ & (count_ - 1));
+        buffer->addr = (uint64_t)(uintptr_t)Buffer( id );
+        buffer->len = (uint32_t)bufferSize_;
+        buffer->bid = id;
+        ++tail_;
+    }
+
+    void Publish()
+    {
+        __atomic_store_n( &bufferRing_->tail, tail_, __ATOMIC_RELEASE );
+    }
+};
+
+
+constexpr std::size_t URING_SEND_SLOT_SIZE = 2048;
+constexpr std::size_t URING_SEND_SLOT_COUNT = 128;
+
+// the datagrams sent by the thread executing the multiplexer's Run(),
+// copied so that the caller's buffer can be reused as soon as Send()
+// returns
+class UringSendQueue{
+    struct Slot{
+        char data[ URING_SEND_SLOT_SIZE ];
+        struct sockaddr_in address;
+        struct iovec iov;
+        struct msghdr header;
+    };
+
+    IoUring *ring_;
+    std::atomic<std::thread::id> runningThread_;
+    std::vector<Slot> slots_;
+    std::vector<unsigned> freeSlots_;
+
+public:
+    UringSendQueue()
+        : ring_( 0 )
+        , slots_( URING_SEND_SLOT_COUNT )
+    {
+        for( unsigned i=0; i < URING_SEND_SLOT_COUNT; ++i )
+            freeSlots_.push_back( URING_SEND_SLOT_COUNT - 1 - i );
+    }
+
+    // called by the multiplexer at the start and end of Run()
+    void Start( IoUring *ring )
+    {
+        ring_ = ring;
+        runningThread_.store( std::this_thread::get_id(), std::memory_order_release );
+    }
+    void Stop()
+    {
+        runningThread_.store( std::thread::id(), std::memory_order_release );
+        ring_ = 0;
+    }
+
+    std::size_t InFlightCount() const { return URING_SEND_SLOT_COUNT - freeSlots_.size(); }
+
+    // queue a datagram to the given address, or the connected address if
+    // address is null. returns false if the caller has to send it itself:
+    // if not called by the running thread, the datagram is too large or
+    // all slots are in use. the datagrams queued so far are submitted
+    // first in the latter cases, but ordering isn't guaranteed: a queued
+    // send which can't complete during submission (e.g. because the
+    // socket's send buffer is full) is retried by the kernel later and
+    // can be overtaken by the caller's synchronous send.
+    bool Send( int socket, const struct sockaddr_in *address, const char *data, std::size_t size,
+            uint64_t userData )
+    {
+        if( runningThread_.load( std::memory_order_acquire ) != std::this_thread::get_id() )
+            return false;
+
+        if( size > URING_SEND_SLOT_SIZE || freeSlots_.empty() ){
+            ring_->Submit( 0 );
+            return false;
+        }
+
+        unsigned index = freeSlots_.back();
+        freeSlots_.pop_back();
+
+        Slot& slot = slots_[ index ];
+        std::memcpy( slot.data, data, size );
+        slot.iov.iov_base = slot.data;
+        slot.iov.iov_len = size;
+        std::memset( &slot.header, 0, sizeof(slot.header) );
+        if( address ){
+            slot.address = *address;
+            slot.header.msg_name = &slot.address;
+            slot.header.msg_namelen = sizeof(slot.address);
+        }
+        slot.header.msg_iov = &slot.iov;
+        slot.header.msg_iovlen = 1;
+
+        struct io_uring_sqe *sqe = ring_->NextSubmission();
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = socket;
+        sqe->addr = (uint64_t)(uintptr_t)&slot.header;
+        sqe->len = 1;
+        sqe->user_data = userData | index;
+        return true;
+    }
+
+    // errors are ignored, as they are by UdpSocket::Send()
+    void Complete( unsigned index )
+    {
+        freeSlots_.push_back( index );
+    }
+};
+
+
+// posix::UdpSocketImplementation which sends through the multiplexer's
+// io_uring while it runs, see the comment at the top of this file
+class UringUdpSocketImplementation : public UdpSocketImplementation{
+    std::atomic<UringSendQueue*> sendQueue_;
+    uint64_t sendUserData_;
+
+public:
+    UringUdpSocketImplementation()
+        : sendQueue_( nullptr )
+        , sendUserData_( 0 ) {}
+
+    // called by the multiplexer at the start and end of Run()
+    void SetSendQueue( UringSendQueue *sendQueue, uint64_t sendUserData )
+    {
+        sendUserData_ = sendUserData;
+        sendQueue_.store( sendQueue, std::memory_order_release );
+    }
+
+    void Send( const char *data, std::size_t size )
+    {
+        UringSendQueue *sendQueue = sendQueue_.load( std::memory_order_acquire );
+        if( !sendQueue || !sendQueue->Send( Socket(), 0, data, size, sendUserData_ ) )
+            UdpSocketImplementation::Send( data, size );
+    }
+
+    void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
+    {
+        UringSendQueue *sendQueue = sendQueue_.load( std::memory_order_acquire );
+        if( sendQueue ){
+            struct sockaddr_in sendToAddr;
+            SendToSockaddrFromIpEndpointName( sendToAddr, remoteEndpoint );
+            if( sendQueue->Send( Socket(), &sendToAddr, data, size, sendUserData_ ) )
+                return;
+        }
+        UdpSocketImplementation::SendTo( remoteEndpoint, data, size );
+    }
+};
+
+
+template<typename UdpSocket_T>
+class UringSocketReceiveMultiplexerImplementation
+{
+    std::vector< std::pair< PacketListener*, UdpSocket_T* > > socketListeners_;
+    std::vector< AttachedTimerListener > timerListeners_;
+    std::vector< ScheduledTimerListener* > scheduledTimerListeners_;
+
+    std::size_t receiveBatchSize_;
+    std::size_t maximumPacketSize_;
+
+    std::atomic_bool break_;
+    int breakPipe_[2]; // [0] is the reader descriptor and [1] the writer
+
+    IoUring ring_;
+    UringSendQueue sendQueue_;
+
+    // the requests in flight while running
+    std::vector<bool> receiving_; // by socket index
+    bool breakPolling_;
+    bool receiveUnsupported_;
+    bool timeoutArmed_;
+    double timeoutExpiryMs_;
+    std::size_t pendingControlCount_; // timeout updates and cancellations
+    struct __kernel_timespec timeout_;
+
+    // the template for the multishot receives. the kernel only uses the
+    // name and control lengths.
+    struct msghdr receiveHeader_;
+
+    // the datagrams received from one socket which are delivered
+    // together, and the buffers they occupy
+    std::vector<ReceivedDatagram> datagrams_;
+    std::vector<unsigned short> datagramBuffers_;
+    std::size_t datagramsSocket_;
+
+    // request user data: the kind in the top byte, for receives and sends
+    // the socket index or send slot below
+    static constexpr uint64_t RECEIVE = (uint64_t)1 << 56;
+    static constexpr uint64_t SEND = (uint64_t)2 << 56;
+    static constexpr uint64_t BREAK_PIPE = (uint64_t)3 << 56;
+    static constexpr uint64_t TIMEOUT = (uint64_t)4 << 56;
+    static constexpr uint64_t CONTROL = (uint64_t)5 << 56;
+    static constexpr uint64_t KIND_MASK = (uint64_t)0xFF << 56;
+
+    static constexpr unsigned SUBMISSION_ENTRIES = 256;
+    static constexpr unsigned COMPLETION_ENTRIES = 4096;
+
+    double GetCurrentTimeMs() const
+    {
+      return detail::SteadyTimeMs();
+    }
+
+    // enough buffers for a few batches from every socket
+    unsigned ReceiveBufferCount() const
+    {
+        std::size_t wanted = std::max<std::size_t>( 64, 4 * receiveBatchSize_ * socketListeners_.size() );
+        unsigned count = 64;
+        while( count < wanted && count < COMPLETION_ENTRIES )
+            count *= 2;
+        return count;
+    }
+
+    void ArmReceive( std::size_t socketIndex )
+    {
+        struct io_uring_sqe *sqe = ring_.NextSubmission();
+        sqe->opcode = IORING_OP_RECVMSG;
+        sqe->fd = socketListeners_[ socketIndex ].second->Socket();
+        sqe->addr = (uint64_t)(uintptr_t)&receiveHeader_;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = UringReceiveBuffers::GROUP_ID;
+        sqe->user_data = RECEIVE | socketIndex;
+        receiving_[ socketIndex ] = true;
+    }
+
+    void ArmBreakPoll()
+    {
+        struct io_uring_sqe *sqe = ring_.NextSubmission();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = breakPipe_[0];
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = BREAK_PIPE;
+        breakPolling_ = true;
+    }
+
+    // arm the timeout request to complete at expiryMs on the steady
+    // clock (CLOCK_MONOTONIC), or move it if it is already armed
+    void SetTimeoutExpiry( double expiryMs )
+    {
+        if( timeoutArmed_ && expiryMs == timeoutExpiryMs_ )
+            return;
+
+        double seconds = std::floor( expiryMs * .001 );
+        timeout_.tv_sec = (long long)seconds;
+        timeout_.tv_nsec = (long long)((expiryMs - seconds * 1000.) * 1000000.);
+
+        struct io_uring_sqe *sqe = ring_.NextSubmission();
+        if( timeoutArmed_ ){
+            sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+            sqe->addr = TIMEOUT;
+            sqe->addr2 = (uint64_t)(uintptr_t)&timeout_;
+            sqe->timeout_flags = IORING_TIMEOUT_UPDATE | IORING_TIMEOUT_ABS;
+            sqe->user_data = CONTROL;
+            ++pendingControlCount_;
+        }else{
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->addr = (uint64_t)(uintptr_t)&timeout_;
+            sqe->len = 1;
+            sqe->timeout_flags = IORING_TIMEOUT_ABS;
+            sqe->user_data = TIMEOUT;
+            timeoutArmed_ = true;
+        }
+        timeoutExpiryMs_ = expiryMs;
+    }
+
+    void Cancel( uint64_t userData )
+    {
+        struct io_uring_sqe *sqe = ring_.NextSubmission();
+        if( userData == TIMEOUT ){
+            sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+        }else{
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+        }
+        sqe->addr = userData;
+        sqe->user_data = CONTROL;
+        ++pendingControlCount_;
+    }
+
+    bool HasRequestsInFlight() const
+    {
+        if( breakPolling_ || timeoutArmed_ || pendingControlCount_ > 0 || sendQueue_.InFlightCount() > 0 )
+            return true;
+        return std::find( receiving_.begin(), receiving_.end(), true ) != receiving_.end();
+    }
+
+    // deliver the collected datagrams (unless breaking) and return their
+    // buffers to the kernel
+    void DispatchDatagrams( UringReceiveBuffers& buffers )
+    {
+        if( !datagrams_.empty() && !break_ ){
+            if( DispatchReceivedDatagrams( socketListeners_[ datagramsSocket_ ].first,
+                    &datagrams_[0], datagrams_.size() ) )
+                break_ = true;
+        }
+        datagrams_.clear();
+
+        for( std::size_t i=0; i < datagramBuffers_.size(); ++i )
+            buffers.Add( datagramBuffers_[i] );
+        if( !datagramBuffers_.empty() )
+            buffers.Publish();
+        datagramBuffers_.clear();
+    }
+
+    // handle a receive completion: collect the datagram it carries, or
+    // note that the request has to be armed again
+    void Received( const struct io_uring_cqe& cqe, UringReceiveBuffers& buffers )
+    {
+        std::size_t socketIndex = (std::size_t)(cqe.user_data & ~KIND_MASK);
+        UdpSocket_T *socket = socketListeners_[ socketIndex ].second;
+
+        if( !(cqe.flags & IORING_CQE_F_MORE) )
+            receiving_[ socketIndex ] = false;
+
+        if( cqe.res < 0 ){
+            // ENOBUFS: all buffers are in use until the next dispatch
+            if( cqe.res == -EINVAL )
+                receiveUnsupported_ = true;
+            else if( cqe.res != -ENOBUFS && cqe.res != -ECANCELED )
+                socket->CountFailedReceive();
+            return;
+        }
+
+        if( !(cqe.flags & IORING_CQE_F_BUFFER) )
+            return;
+
+        if( socketIndex != datagramsSocket_ || datagrams_.size() >= receiveBatchSize_ )
+            DispatchDatagrams( buffers );
+        datagramsSocket_ = socketIndex;
+
+        unsigned short bufferId = (unsigned short)(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        datagramBuffers_.push_back( bufferId );
+
+        char *buffer = buffers.Buffer( bufferId );
+        struct io_uring_recvmsg_out out;
+        std::memcpy( &out, buffer, sizeof(out) );
+        if( out.flags & MSG_TRUNC ){
+            socket->CountTruncatedDatagram();
+            return;
+        }
+
+        char *name = buffer + sizeof(struct io_uring_recvmsg_out);
+        char *control = name + receiveHeader_.msg_namelen;
+        const char *payload = control + receiveHeader_.msg_controllen;
+        std::size_t size = out.payloadlen;
+
+        struct sockaddr_in fromAddr;
+        std::memcpy( &fromAddr, name, sizeof(fromAddr) );
+
+        struct msghdr header;
+        std::memset( &header, 0, sizeof(header) );
+        header.msg_control = control;
+        header.msg_controllen = out.controllen;
+
+        std::size_t segmentSize = size;
+        IpEndpointName localEndpoint;
+        int64_t receiveTimeNs = 0;
+        socket->ParseControlMessages( header, segmentSize, localEndpoint, receiveTimeNs );
+
+        // the last segment may be shorter than the others
+        for( std::size_t offset=0; offset < size; offset += segmentSize ){
+            ReceivedDatagram datagram;
+            datagram.data = payload + offset;
+            datagram.size = (int)std::min( segmentSize, size - offset );
+            datagram.remoteEndpoint.address = ntohl( fromAddr.sin_addr.s_addr );
+            datagram.remoteEndpoint.port = ntohs( fromAddr.sin_port );
+            datagram.localEndpoint = localEndpoint;
+            datagram.receiveTimeNs = receiveTimeNs;
+            datagrams_.push_back( datagram );
+            socket->CountReceivedDatagram( (std::size_t)datagram.size );
+        }
+    }
+
+    void Completed( const struct io_uring_cqe& cqe, UringReceiveBuffers& buffers )
+    {
+        switch( cqe.user_data & KIND_MASK ){
+        case RECEIVE:
+            Received( cqe, buffers );
+            break;
+        case SEND:
+            sendQueue_.Complete( (unsigned)(cqe.user_data & ~KIND_MASK) );
+            break;
+        case BREAK_PIPE:
+            if( cqe.res > 0 ){
+                // clear pending data from the asynchronous break pipe
+                char c;
+                read( breakPipe_[0], &c, 1 );
+            }
+            breakPolling_ = false;
+            break;
+        case TIMEOUT:
+            timeoutArmed_ = false;
+            break;
+        case CONTROL:
+            --pendingControlCount_;
+            break;
+        }
+    }
+
+    // arms the requests for the duration of Run(), and cancels them and
+    // waits for them to finish when Run() returns
+    class Registration{
+        UringSocketReceiveMultiplexerImplementation& mux_;
+        UringReceiveBuffers& buffers_;
+    public:
+        Registration( UringSocketReceiveMultiplexerImplementation& mux, UringReceiveBuffers& buffers )
+            : mux_( mux )
+            , buffers_( buffers )
+        {
+            mux_.receiving_.assign( mux_.socketListeners_.size(), false );
+            mux_.breakPolling_ = false;
+            mux_.receiveUnsupported_ = false;
+            mux_.timeoutArmed_ = false;
+            mux_.pendingControlCount_ = 0;
+            mux_.datagrams_.clear();
+            mux_.datagramBuffers_.clear();
+            mux_.datagramsSocket_ = 0;
+
+            mux_.sendQueue_.Start( &mux_.ring_ );
+            for( std::size_t i=0; i < mux_.socketListeners_.size(); ++i )
+                mux_.socketListeners_[i].second->SetSendQueue( &mux_.sendQueue_, SEND );
+            try{
+                mux_.ArmBreakPoll();
+                for( std::size_t i=0; i < mux_.socketListeners_.size(); ++i )
+                    mux_.ArmReceive( i );
+            }catch(...){
+                Unregister();
+                throw;
+            }
+        }
+
+        ~Registration() { Unregister(); }
+
+        // datagrams which arrive until the receives are cancelled are
+        // discarded
+        void Unregister()
+        {
+            for( std::size_t i=0; i < mux_.socketListeners_.size(); ++i )
+                mux_.socketListeners_[i].second->SetSendQueue( 0, 0 );
+            mux_.sendQueue_.Stop();
+
+            mux_.break_ = true;
+            mux_.datagrams_.clear();
+            try{
+                if( mux_.breakPolling_ )
+                    mux_.Cancel( BREAK_PIPE );
+                if( mux_.timeoutArmed_ )
+                    mux_.Cancel( TIMEOUT );
+                for( std::size_t i=0; i < mux_.receiving_.size(); ++i ){
+                    if( mux_.receiving_[i] )
+                        mux_.Cancel( RECEIVE | i );
+                }
+
+                while( mux_.HasRequestsInFlight() ){
+                    int result = mux_.ring_.Submit( 1 );
+                    if( result < 0 && result != -EINTR && result != -EBUSY && result != -EAGAIN )
+                        break;
+                    mux_.ring_.ForEachCompletion( [this]( const struct io_uring_cqe& cqe ){
+                        mux_.Completed( cqe, buffers_ );
+                    } );
+                    mux_.DispatchDatagrams( buffers_ );
+                }
+            }catch(...){
+                // only thrown for unexpected failures, the buffers are
+                // unregistered anyway
+            }
+        }
+    };
+
+public:
+    UringSocketReceiveMultiplexerImplementation()
+        : receiveBatchSize_( 1 )
+        , maximumPacketSize_( DEFAULT_MAXIMUM_PACKET_SIZE )
+        , ring_( SUBMISSION_ENTRIES, COMPLETION_ENTRIES )
+    {
+        if( pipe(breakPipe_) != 0 )
+            throw std::runtime_error( "creation of asynchronous break pipes failed\n" );
+        // wakeups never block, a full pipe wakes the multiplexer anyway
+        fcntl( breakPipe_[1], F_SETFL, O_NONBLOCK );
+
+        std::memset( &receiveHeader_, 0, sizeof(receiveHeader_) );
+        receiveHeader_.msg_namelen = sizeof(struct sockaddr_in);
+        receiveHeader_.msg_controllen = ReceiveBatch::CONTROL_SIZE;
+    }
+
+    ~UringSocketReceiveMultiplexerImplementation()
+    {
+        close( breakPipe_[0] );
+        close( breakPipe_[1] );
+    }
+
+    void AttachSocketListener( UdpSocket_T *socket, PacketListener *listener )
+    {
+        assert( std::find( socketListeners_.begin(), socketListeners_.end(), std::make_pair(listener, socket) ) == socketListeners_.end() );
+        // we don't check that the same socket has been added multiple times, even though this is an error
+        socketListeners_.push_back( std::make_pair( listener, socket ) );
+    }
+
+    void DetachSocketListener( UdpSocket_T *socket, PacketListener *listener )
+    {
+        auto i = std::find( socketListeners_.begin(), socketListeners_.end(), std::make_pair(listener, socket) );
+        assert( i != socketListeners_.end() );
+
+        socketListeners_.erase( i );
+    }
+
+    void AttachPeriodicTimerListener( int periodMilliseconds, TimerListener *listener )
+    {
+        timerListeners_.push_back( AttachedTimerListener( periodMilliseconds, periodMilliseconds, listener ) );
+    }
+
+    void AttachPeriodicTimerListener( int initialDelayMilliseconds, int periodMilliseconds, TimerListener *listener )
+    {
+        timerListeners_.push_back( AttachedTimerListener( initialDelayMilliseconds, periodMilliseconds, listener ) );
+    }
+
+    void DetachPeriodicTimerListener( TimerListener *listener )
+    {
+        std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
+        while( i != timerListeners_.end() ){
+            if( i->listener == listener )
+                break;
+            ++i;
+        }
+
+        assert( i != timerListeners_.end() );
+
+        timerListeners_.erase( i );
+    }
+
+    void AttachScheduledTimerListener( ScheduledTimerListener *listener )
+    {
+        scheduledTimerListeners_.push_back( listener );
+    }
+
+    void DetachScheduledTimerListener( ScheduledTimerListener *listener )
+    {
+        auto i = std::find( scheduledTimerListeners_.begin(), scheduledTimerListeners_.end(), listener );
+        assert( i != scheduledTimerListeners_.end() );
+
+        scheduledTimerListeners_.erase( i );
+    }
+
+    // the maximum number of datagrams delivered with one
+    // PacketListener::ProcessPackets() call
+    void SetReceiveBatchSize( std::size_t datagramCount )
+    {
+        assert( datagramCount > 0 );
+        receiveBatchSize_ = datagramCount;
+    }
+
+    void SetMaximumPacketSize( std::size_t bytes )
+    {
+        assert( bytes > 0 );
+        maximumPacketSize_ = bytes;
+    }
+
+    MultiplexerMetrics Metrics() const
+    {
+        return detail::CollectMultiplexerMetrics( socketListeners_ );
+    }
+
+    void Run()
+    {
+        break_ = false;
+
+        UringReceiveBuffers buffers( ring_, ReceiveBufferCount(),
+                sizeof(struct io_uring_recvmsg_out) + receiveHeader_.msg_namelen
+                + receiveHeader_.msg_controllen + ReceiveBufferSizeFor( socketListeners_, maximumPacketSize_ ) );
+        datagrams_.reserve( receiveBatchSize_ );
+
+        Registration registration( *this, buffers );
+
+        // configure the timer queue
+        detail::TimerQueue timerQueue;
+        timerQueue.Reset( timerListeners_, scheduledTimerListeners_, GetCurrentTimeMs() );
+
+        while( !break_ ){
+
+            unsigned waitCount = 1;
+            double expiryMs = 0;
+            if( timerQueue.NextExpiryMs( expiryMs ) ){
+                if( expiryMs <= GetCurrentTimeMs() )
+                    waitCount = 0;
+                else
+                    SetTimeoutExpiry( expiryMs );
+            }
+
+            int result = ring_.Submit( waitCount );
+            if( result < 0 ){
+                if( break_ ){
+                    break;
+                }else if( result != -EINTR && result != -EBUSY && result != -EAGAIN ){
+                    // EBUSY and EAGAIN: the completion queue is full or
+                    // the kernel is short of memory, reap first
+                    throw std::runtime_error("io_uring wait failed\n");
+                }
+            }
+
+            ring_.ForEachCompletion( [this, &buffers]( const struct io_uring_cqe& cqe ){
+                Completed( cqe, buffers );
+            } );
+            DispatchDatagrams( buffers );
+
+            if( receiveUnsupported_ )
+                throw std::runtime_error( "multishot recvmsg is not supported, io_uring receive requires Linux 6.0 or later\n" );
+
+            if( break_ )
+                break;
+
+            // re-arm receives which ended, e.g. because all buffers were
+            // in use, now that the buffers have been returned
+            if( !breakPolling_ )
+                ArmBreakPoll();
+            for( std::size_t i=0; i < receiving_.size(); ++i ){
+                if( !receiving_[i] )
+                    ArmReceive( i );
+            }
+
+            // execute any expired timers
+            timerQueue.ExpireTimers( GetCurrentTimeMs(), [this]() -> bool { return break_; } );
+        }
+    }
+
+    void Break()
+    {
+        break_ = true;
+    }
+
+    void AsynchronousBreak()
+    {
+        break_ = true;
+        AsynchronousWakeup();
+    }
+
+    void AsynchronousWakeup()
+    {
+        // Send a message to the asynchronous break pipe, so the wait will return
+        write( breakPipe_[1], "!", 1 );
+    }
+};
+
+struct UringImplementation
+{
+    using udp_socket_t = oscpack::posix::UringUdpSocketImplementation;
+    using send_batch_t = oscpack::posix::SendBatch;
+    using socket_multiplexer_t = oscpack::posix::UringSocketReceiveMultiplexerImplementation<udp_socket_t>;
+};
+}
+
+}
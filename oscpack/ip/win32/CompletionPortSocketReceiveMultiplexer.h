@@ -0,0 +1,412 @@
+#pragma once
+/*
+    oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files
+    (the "Software"), to deal in the Software without restriction,
+    including without limitation the rights to use, copy, modify, merge,
+    publish, distribute, sublicense, and/or sell copies of the Software,
+    and to permit persons to whom the Software is furnished to do so,
+    subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be
+    included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+    MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+    IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+    ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+    CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+    WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+    The text above constitutes the entire oscpack license; however,
+    the oscpack developer(s) also make the following non-binding requests:
+
+    Any person wishing to distribute modifications to the Software is
+    requested to send the modifications to the original developer so that
+    they can be incorporated into the canonical version. It is also
+    requested that these non-binding requests be included whenever the
+    above license is reproduced.
+*/
+
+/*
+    An alternative win32 socket multiplexer built on an I/O completion
+    port instead of WSAEventSelect() and WaitForMultipleObjects(). It isn't
+    limited to MAXIMUM_WAIT_OBJECTS (64) sockets, keeps several overlapped
+    receives outstanding on each socket and dequeues many completed
+    receives per wakeup with GetQueuedCompletionStatusEx(), so it requires
+    Windows Vista or later.
+
+    It uses the same socket implementation as oscpack::win32::Implementation
+    so it can be used as a drop-in replacement:
+
+        using Impl = oscpack::win32::CompletionPortImplementation;
+        oscpack::detail::SocketReceiveMultiplexer<Impl> mux;
+
+    SetReceiveBatchSize() sets the number of receives kept outstanding on
+    each socket. Note that a socket can't be removed from a completion port
+    once Run() has added it: it may be attached to this multiplexer again,
+    but not to another CompletionPortImplementation multiplexer. Datagrams
+    which have been received but not yet delivered when Run() exits are
+    discarded.
+*/
+#include <oscpack/ip/win32/UdpSocket.h>
+
+namespace oscpack
+{
+namespace win32
+{
+
+template<typename UdpSocket_T>
+class CompletionPortSocketReceiveMultiplexerImplementation
+{
+    std::vector< std::pair< PacketListener*, UdpSocket_T* > > socketListeners_;
+    std::vector< AttachedTimerListener > timerListeners_;
+    std::vector< ScheduledTimerListener* > scheduledTimerListeners_;
+
+    std::size_t receiveBatchSize_;
+    std::size_t maximumPacketSize_;
+
+    std::atomic_bool break_;
+    HANDLE completionPort_;
+    std::vector<SOCKET> associatedSockets_; // sockets added to completionPort_
+
+    // completion key of the packets posted by AsynchronousBreak()
+    static constexpr ULONG_PTR BREAK_KEY = 1;
+
+    double GetCurrentTimeMs() const
+    {
+        return detail::SteadyTimeMs();
+    }
+
+    void Associate( SOCKET socket )
+    {
+        if( std::find( associatedSockets_.begin(), associatedSockets_.end(), socket ) != associatedSockets_.end() )
+            return;
+
+        if( CreateIoCompletionPort( (HANDLE)socket, completionPort_, 0, 0 ) == NULL )
+            throw std::runtime_error( "unable to add socket to completion port\n" );
+        associatedSockets_.push_back( socket );
+    }
+
+    // an overlapped receive. receives are identified by their OVERLAPPED
+    // structure, which comes first.
+    struct Receive{
+        OVERLAPPED overlapped;
+        WSABUF buffer;
+        struct sockaddr_in fromAddr;
+        INT fromAddrLength;
+        DWORD flags;
+        std::size_t listenerIndex;
+    };
+
+    // the receives outstanding during Run(). they are cancelled, and their
+    // completions waited for, before the buffers are freed.
+    class PendingReceives{
+        CompletionPortSocketReceiveMultiplexerImplementation& mux_;
+        std::vector<Receive> receives_;
+        std::vector<char> buffers_;
+        std::size_t outstandingCount_;
+
+    public:
+        PendingReceives( CompletionPortSocketReceiveMultiplexerImplementation& mux,
+                std::size_t receivesPerSocket, std::size_t bufferSize )
+            : mux_( mux )
+            , receives_( mux.socketListeners_.size() * receivesPerSocket )
+            , buffers_( receives_.size() * bufferSize )
+            , outstandingCount_( 0 )
+        {
+            for( std::size_t i=0; i < receives_.size(); ++i ){
+                receives_[i].buffer.buf = &buffers_[ i * bufferSize ];
+                receives_[i].buffer.len = (ULONG)bufferSize;
+                receives_[i].listenerIndex = i / receivesPerSocket;
+            }
+
+            try{
+                for( std::size_t i=0; i < receives_.size(); ++i )
+                    Post( &receives_[i] );
+            }catch(...){
+                Cancel();
+                throw;
+            }
+        }
+
+        ~PendingReceives() { Cancel(); }
+
+        PendingReceives( const PendingReceives& ) = delete;
+        PendingReceives& operator=( const PendingReceives& ) = delete;
+
+        void Post( Receive *receive )
+        {
+            SOCKET socket = mux_.socketListeners_[ receive->listenerIndex ].second->Socket();
+
+            for(;;){
+                std::memset( &receive->overlapped, 0, sizeof(receive->overlapped) );
+                receive->fromAddrLength = sizeof(receive->fromAddr);
+                receive->flags = 0;
+
+                // a completion is queued even if the receive completes
+                // immediately, unless it fails immediately
+                if( WSARecvFrom( socket, &receive->buffer, 1, NULL, &receive->flags,
+                        (struct sockaddr*)&receive->fromAddr, &receive->fromAddrLength,
+                        &receive->overlapped, NULL ) == 0 ){
+                    break;
+                }
+
+                int error = WSAGetLastError();
+                if( error == WSA_IO_PENDING )
+                    break;
+                // reported for an ICMP port unreachable message caused by
+                // an earlier send, or for an oversized datagram. try again
+                if( error != WSAECONNRESET && error != WSAEMSGSIZE )
+                    throw std::runtime_error( "unable to receive from udp socket\n" );
+            }
+
+            ++outstandingCount_;
+        }
+
+        // account for the completions dequeued by the caller
+        void Completed( const OVERLAPPED_ENTRY *entries, ULONG count )
+        {
+            for( ULONG i=0; i < count; ++i ){
+                if( entries[i].lpOverlapped != NULL ){
+                    assert( outstandingCount_ > 0 );
+                    --outstandingCount_;
+                }
+            }
+        }
+
+        void Cancel()
+        {
+            if( outstandingCount_ == 0 )
+                return;
+
+            for( std::size_t i=0; i < mux_.socketListeners_.size(); ++i )
+                CancelIoEx( (HANDLE)mux_.socketListeners_[i].second->Socket(), NULL );
+
+            while( outstandingCount_ > 0 ){
+                DWORD size;
+                ULONG_PTR key;
+                OVERLAPPED *overlapped = NULL;
+                GetQueuedCompletionStatus( mux_.completionPort_, &size, &key, &overlapped, INFINITE );
+                if( overlapped != NULL )
+                    --outstandingCount_;
+            }
+        }
+    };
+
+public:
+    CompletionPortSocketReceiveMultiplexerImplementation()
+        : receiveBatchSize_( 1 )
+        , maximumPacketSize_( DEFAULT_MAXIMUM_PACKET_SIZE )
+        , break_( false )
+    {
+        NetworkInitializer::instance();
+
+        completionPort_ = CreateIoCompletionPort( INVALID_HANDLE_VALUE, NULL, 0, 1 );
+        if( completionPort_ == NULL )
+            throw std::runtime_error( "creation of completion port failed\n" );
+    }
+
+    ~CompletionPortSocketReceiveMultiplexerImplementation()
+    {
+        CloseHandle( completionPort_ );
+    }
+
+    void AttachSocketListener( UdpSocket_T *socket, PacketListener *listener )
+    {
+        assert( std::find( socketListeners_.begin(), socketListeners_.end(), std::make_pair(listener, socket) ) == socketListeners_.end() );
+        // we don't check that the same socket has been added multiple times, even though this is an error
+        socketListeners_.push_back( std::make_pair( listener, socket ) );
+    }
+
+    void DetachSocketListener( UdpSocket_T *socket, PacketListener *listener )
+    {
+        auto i = std::find( socketListeners_.begin(), socketListeners_.end(), std::make_pair(listener, socket) );
+        assert( i != socketListeners_.end() );
+
+        socketListeners_.erase( i );
+    }
+
+    void AttachPeriodicTimerListener( int periodMilliseconds, TimerListener *listener )
+    {
+        timerListeners_.push_back( AttachedTimerListener( periodMilliseconds, periodMilliseconds, listener ) );
+    }
+
+    void AttachPeriodicTimerListener( int initialDelayMilliseconds, int periodMilliseconds, TimerListener *listener )
+    {
+        timerListeners_.push_back( AttachedTimerListener( initialDelayMilliseconds, periodMilliseconds, listener ) );
+    }
+
+    void DetachPeriodicTimerListener( TimerListener *listener )
+    {
+        std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
+        while( i != timerListeners_.end() ){
+            if( i->listener == listener )
+                break;
+            ++i;
+        }
+
+        assert( i != timerListeners_.end() );
+
+        timerListeners_.erase( i );
+    }
+
+    void AttachScheduledTimerListener( ScheduledTimerListener *listener )
+    {
+        scheduledTimerListeners_.push_back( listener );
+    }
+
+    void DetachScheduledTimerListener( ScheduledTimerListener *listener )
+    {
+        auto i = std::find( scheduledTimerListeners_.begin(), scheduledTimerListeners_.end(), listener );
+        assert( i != scheduledTimerListeners_.end() );
+
+        scheduledTimerListeners_.erase( i );
+    }
+
+    void SetReceiveBatchSize( std::size_t datagramCount )
+    {
+        assert( datagramCount > 0 );
+        receiveBatchSize_ = datagramCount;
+    }
+
+    void SetMaximumPacketSize( std::size_t bytes )
+    {
+        assert( bytes > 0 );
+        maximumPacketSize_ = bytes;
+    }
+
+    MultiplexerMetrics Metrics() const
+    {
+        return detail::CollectMultiplexerMetrics( socketListeners_ );
+    }
+
+    void Run()
+    {
+        break_ = false;
+
+        for( std::size_t i=0; i < socketListeners_.size(); ++i )
+            Associate( socketListeners_[i].second->Socket() );
+
+        // configure the timer queue
+        detail::TimerQueue timerQueue;
+        timerQueue.Reset( timerListeners_, scheduledTimerListeners_, GetCurrentTimeMs() );
+
+        PendingReceives receives( *this, receiveBatchSize_, maximumPacketSize_ );
+
+        const ULONG MAX_ENTRIES = 64;
+        OVERLAPPED_ENTRY entries[ MAX_ENTRIES ];
+        std::vector<ReceivedDatagram> datagrams;
+        std::vector<Receive*> completed;
+
+        while( !break_ ){
+
+            // round up so that we don't wake before the first timer is due
+            DWORD waitTime = INFINITE;
+            double timeoutMs = timerQueue.TimeoutMs( GetCurrentTimeMs() );
+            if( timeoutMs >= 0 )
+                waitTime = (DWORD)std::ceil( timeoutMs );
+
+            ULONG entryCount = 0;
+            if( !GetQueuedCompletionStatusEx( completionPort_, entries, MAX_ENTRIES, &entryCount, waitTime, FALSE ) ){
+                if( GetLastError() != WAIT_TIMEOUT )
+                    throw std::runtime_error( "completion port wait failed\n" );
+                entryCount = 0;
+            }
+            receives.Completed( entries, entryCount );
+
+            // deliver consecutive datagrams for the same listener together,
+            // then reissue their receives
+            ULONG i = 0;
+            while( i < entryCount && !break_ ){
+                if( entries[i].lpOverlapped == NULL ){ // BREAK_KEY
+                    ++i;
+                    continue;
+                }
+
+                Receive *receive = reinterpret_cast<Receive*>( entries[i].lpOverlapped );
+                std::size_t listenerIndex = receive->listenerIndex;
+
+                datagrams.clear();
+                completed.clear();
+                for(;;){
+                    // failed receives are dropped. oversized datagrams
+                    // complete with STATUS_BUFFER_OVERFLOW
+                    const ULONG_PTR STATUS_BUFFER_OVERFLOW_ = 0x80000005;
+                    UdpSocket_T *socket = socketListeners_[listenerIndex].second;
+                    if( entries[i].Internal == STATUS_BUFFER_OVERFLOW_ )
+                        socket->CountTruncatedDatagram();
+                    else if( entries[i].Internal != 0 )
+                        socket->CountFailedReceive();
+
+                    if( entries[i].Internal == 0 ){
+                        socket->CountReceivedDatagram( entries[i].dwNumberOfBytesTransferred );
+                        ReceivedDatagram datagram;
+                        datagram.data = receive->buffer.buf;
+                        datagram.size = (int)entries[i].dwNumberOfBytesTransferred;
+                        datagram.remoteEndpoint = IpEndpointName(
+                                ntohl( receive->fromAddr.sin_addr.s_addr ),
+                                ntohs( receive->fromAddr.sin_port ) );
+                        datagrams.push_back( datagram );
+                    }
+                    completed.push_back( receive );
+
+                    if( ++i == entryCount || entries[i].lpOverlapped == NULL )
+                        break;
+                    receive = reinterpret_cast<Receive*>( entries[i].lpOverlapped );
+                    if( receive->listenerIndex != listenerIndex )
+                        break;
+                }
+
+                if( !datagrams.empty()
+                        && DispatchReceivedDatagrams( socketListeners_[listenerIndex].first, &datagrams[0], datagrams.size() ) )
+                    break_ = true;
+
+                if( !break_ ){
+                    for( std::size_t j=0; j < completed.size(); ++j )
+                        receives.Post( completed[j] );
+                }
+            }
+
+            if( break_ )
+                break;
+
+            // execute any expired timers
+            timerQueue.ExpireTimers( GetCurrentTimeMs(), [this]() -> bool { return break_; } );
+        }
+    }
+
+    void Break()
+    {
+        break_ = true;
+    }
+
+    void AsynchronousBreak()
+    {
+        break_ = true;
+        AsynchronousWakeup();
+    }
+
+    void AsynchronousWakeup()
+    {
+        // post a completion packet so that the wait returns
+        PostQueuedCompletionStatus( completionPort_, 0, BREAK_KEY, NULL );
+    }
+};
+
+struct CompletionPortImplementation
+{
+    using udp_socket_t = oscpack::win32::UdpSocketImplementation;
+    using send_batch_t = oscpack::win32::SendBatch;
+    using socket_multiplexer_t = oscpack::win32::CompletionPortSocketReceiveMultiplexerImplementation<udp_socket_t>;
+};
+}
+}
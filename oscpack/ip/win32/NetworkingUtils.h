@@ -37,6 +37,7 @@
 #include <oscpack/ip/NetworkingUtils.h>
 
 #include <winsock2.h>   // this must come first to prevent errors with MSVC7
+#include <ws2tcpip.h>
 #include <windows.h>
 
 #include <cstring>
@@ -65,19 +66,39 @@ class NetworkInitializer
     }
 };
 
-inline unsigned long GetHostByName( const char *name )
+// look up the ip address of host name, in host byte order. returns false
+// if the name can't be resolved. thread safe, but may block while it
+// queries DNS (see EndpointResolver for cached and asynchronous lookups).
+inline bool LookupHostAddress( const char *name, unsigned long& address )
 {
   NetworkInitializer::instance();
 
-  unsigned long result = 0;
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_protocol = IPPROTO_UDP;
 
-  struct hostent *h = gethostbyname( name );
-  if( h ){
-    struct in_addr a;
-    std::memcpy( &a, h->h_addr_list[0], h->h_length );
-    result = ntohl(a.s_addr);
+  addrinfo *ai = 0;
+  if( getaddrinfo( name, 0, &hints, &ai ) != 0 || !ai ){
+    if( ai )
+      freeaddrinfo( ai );
+    return false;
   }
 
+  struct sockaddr_in remote;
+  std::memcpy( &remote, ai->ai_addr, sizeof(remote) );
+  address = ntohl( remote.sin_addr.s_addr );
+
+  freeaddrinfo( ai );
+  return true;
+}
+
+// return ip address of host name in host byte order, or 0 if it can't be
+// resolved
+inline unsigned long GetHostByName( const char *name )
+{
+  unsigned long result = 0;
+  LookupHostAddress( name, result );
   return result;
 }
 }
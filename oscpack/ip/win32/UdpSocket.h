@@ -39,23 +39,27 @@
 #define WIN32_LEAN_AND_MEAN
 #endif
 #include <winsock2.h>   // this must come first to prevent errors with MSVC7
+#include <ws2tcpip.h> // for ip_mreq_source
 #include <windows.h>
-#include <mmsystem.h>   // for timeGetTime()
 
 #ifndef WINCE
 #include <signal.h>
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
 #include <cstring> // for memset
 #include <stdexcept>
 #include <vector>
 
 
+#include <oscpack/ip/AbstractUdpSocket.h>
 #include <oscpack/ip/NetworkingUtils.h>
 #include <oscpack/ip/PacketListener.h>
 #include <oscpack/ip/TimerListener.h>
+#include <oscpack/ip/TimerQueue.h>
 
 
 typedef int socklen_t;
@@ -94,6 +98,37 @@ static IpEndpointName IpEndpointNameFromSockaddr( const struct sockaddr_in& sock
 }
 
 
+// unlike SockaddrFromIpEndpointName() the endpoint is used as is, so that
+// sending to ANY_ADDRESS (0xFFFFFFFF) sends to the broadcast address
+static void SendToSockaddrFromIpEndpointName( struct sockaddr_in& sockAddr, const IpEndpointName& endpoint )
+{
+  std::memset( (char *)&sockAddr, 0, sizeof(sockAddr ) );
+  sockAddr.sin_family = AF_INET;
+  sockAddr.sin_addr.s_addr = htonl( endpoint.address );
+  sockAddr.sin_port = htons( (short)endpoint.port );
+}
+
+
+// the datagrams queued by a BatchSender
+class SendBatch{
+  friend class UdpSocketImplementation;
+
+  std::vector<OutgoingDatagram> datagrams_;
+
+public:
+  void Clear() { datagrams_.clear(); }
+
+  void Add( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
+  {
+    OutgoingDatagram datagram = { remoteEndpoint, data, size, 0 };
+    datagrams_.push_back( datagram );
+  }
+
+  std::size_t Size() const { return datagrams_.size(); }
+  const OutgoingDatagram& Datagram( std::size_t i ) const { return datagrams_[i]; }
+};
+
+
 class UdpSocketImplementation{
 
   bool isBound_;
@@ -101,23 +136,64 @@ class UdpSocketImplementation{
 
   SOCKET socket_;
   struct sockaddr_in connectedAddr_;
-  struct sockaddr_in sendToAddr_;
   int localPort_{};
 
+  std::atomic<std::size_t> truncatedDatagramCount_;
+
+  detail::MetricCounter receivedDatagramCount_;
+  detail::MetricCounter receivedByteCount_;
+  detail::MetricCounter failedReceiveCount_;
+
+  static u_long InterfaceAddress( const IpEndpointName& localInterface )
+  {
+    return (localInterface.address == IpEndpointName::ANY_ADDRESS)
+        ? htonl( INADDR_ANY )
+        : htonl( localInterface.address );
+  }
+
+  void SetMulticastMembership( int option, const IpEndpointName& group,
+      const IpEndpointName& localInterface, const char *errorMessage )
+  {
+    if( !group.IsMulticastAddress() )
+      throw std::runtime_error("not a multicast group address\n");
+
+    struct ip_mreq request;
+    std::memset( &request, 0, sizeof(request) );
+    request.imr_multiaddr.s_addr = htonl( group.address );
+    request.imr_interface.s_addr = InterfaceAddress( localInterface );
+    if( setsockopt(socket_, IPPROTO_IP, option, (const char*)&request, sizeof(request)) == SOCKET_ERROR )
+      throw std::runtime_error(errorMessage);
+  }
+
+  void SetSourceMembership( int option, const IpEndpointName& group, const IpEndpointName& source,
+      const IpEndpointName& localInterface, const char *errorMessage )
+  {
+    if( !group.IsMulticastAddress() )
+      throw std::runtime_error("not a multicast group address\n");
+    if( source.address == IpEndpointName::ANY_ADDRESS )
+      throw std::runtime_error("source-specific multicast needs a source address\n");
+
+    struct ip_mreq_source request;
+    std::memset( &request, 0, sizeof(request) );
+    request.imr_multiaddr.s_addr = htonl( group.address );
+    request.imr_sourceaddr.s_addr = htonl( source.address );
+    request.imr_interface.s_addr = InterfaceAddress( localInterface );
+    if( setsockopt(socket_, IPPROTO_IP, option, (const char*)&request, sizeof(request)) == SOCKET_ERROR )
+      throw std::runtime_error(errorMessage);
+  }
+
 public:
 
     UdpSocketImplementation()
     : isBound_( false )
     , isConnected_( false )
     , socket_( INVALID_SOCKET )
+    , truncatedDatagramCount_( 0 )
   {
     NetworkInitializer::instance();
     if( (socket_ = socket( AF_INET, SOCK_DGRAM, 0 )) == INVALID_SOCKET ){
             throw std::runtime_error("unable to create udp socket\n");
         }
-
-    std::memset( &sendToAddr_, 0, sizeof(sendToAddr_) );
-        sendToAddr_.sin_family = AF_INET;
   }
 
   ~UdpSocketImplementation()
@@ -141,6 +217,151 @@ public:
     setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &reuseAddr, sizeof(reuseAddr));
   }
 
+  void SetReusePort( bool reusePort )
+  {
+    // there is no equivalent of SO_REUSEPORT load balancing on Win32
+    if( reusePort )
+      throw std::runtime_error("SO_REUSEPORT is not supported on win32\n");
+  }
+
+  void SetReceiveBufferSize( int bytes )
+  {
+    if( setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, (const char*)&bytes, sizeof(bytes)) == SOCKET_ERROR )
+      throw std::runtime_error("unable to set SO_RCVBUF\n");
+  }
+
+  int ReceiveBufferSize() const
+  {
+    int bytes = 0;
+    int length = sizeof(bytes);
+    if( getsockopt(socket_, SOL_SOCKET, SO_RCVBUF, (char*)&bytes, &length) == SOCKET_ERROR )
+      throw std::runtime_error("unable to get SO_RCVBUF\n");
+    return bytes;
+  }
+
+  void SetSendBufferSize( int bytes )
+  {
+    if( setsockopt(socket_, SOL_SOCKET, SO_SNDBUF, (const char*)&bytes, sizeof(bytes)) == SOCKET_ERROR )
+      throw std::runtime_error("unable to set SO_SNDBUF\n");
+  }
+
+  int SendBufferSize() const
+  {
+    int bytes = 0;
+    int length = sizeof(bytes);
+    if( getsockopt(socket_, SOL_SOCKET, SO_SNDBUF, (char*)&bytes, &length) == SOCKET_ERROR )
+      throw std::runtime_error("unable to get SO_SNDBUF\n");
+    return bytes;
+  }
+
+  void SetBusyPoll( int microseconds )
+  {
+    (void) microseconds;
+    throw std::runtime_error("SO_BUSY_POLL is not supported on win32\n");
+  }
+
+  void SetEnableReceiveOffload( bool enableReceiveOffload )
+  {
+    if( enableReceiveOffload )
+      throw std::runtime_error("UDP_GRO is not supported on win32\n");
+  }
+
+  bool IsReceiveOffloadEnabled() const { return false; }
+
+  void SetEnableReceiveTimestamps( bool enableReceiveTimestamps, bool preferHardware )
+  {
+    (void) preferHardware;
+    if( enableReceiveTimestamps )
+      throw std::runtime_error("receive timestamps are not supported on win32\n");
+  }
+
+  void SetEnableReceiveLocalEndpoint( bool enableReceiveLocalEndpoint )
+  {
+    if( enableReceiveLocalEndpoint )
+      throw std::runtime_error("IP_PKTINFO is not supported on win32\n");
+  }
+
+  // a win32 socket only receives the groups it joined itself
+  void SetReceiveOwnMembershipsOnly( bool ownMembershipsOnly )
+  {
+    (void) ownMembershipsOnly;
+  }
+
+  void JoinMulticastGroup( const IpEndpointName& group, const IpEndpointName& localInterface )
+  {
+    SetMulticastMembership( IP_ADD_MEMBERSHIP, group, localInterface, "unable to join multicast group\n" );
+  }
+
+  void LeaveMulticastGroup( const IpEndpointName& group, const IpEndpointName& localInterface )
+  {
+    SetMulticastMembership( IP_DROP_MEMBERSHIP, group, localInterface, "unable to leave multicast group\n" );
+  }
+
+  void JoinSourceGroup( const IpEndpointName& group, const IpEndpointName& source, const IpEndpointName& localInterface )
+  {
+    SetSourceMembership( IP_ADD_SOURCE_MEMBERSHIP, group, source, localInterface,
+        "unable to join source-specific multicast group\n" );
+  }
+
+  void LeaveSourceGroup( const IpEndpointName& group, const IpEndpointName& source, const IpEndpointName& localInterface )
+  {
+    SetSourceMembership( IP_DROP_SOURCE_MEMBERSHIP, group, source, localInterface,
+        "unable to leave source-specific multicast group\n" );
+  }
+
+  void SetMulticastInterface( const IpEndpointName& localInterface )
+  {
+    DWORD interfaceAddr = InterfaceAddress( localInterface ); // network byte order
+    if( setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_IF, (const char*)&interfaceAddr, sizeof(interfaceAddr)) == SOCKET_ERROR )
+      throw std::runtime_error("unable to set IP_MULTICAST_IF\n");
+  }
+
+  void SetMulticastTtl( int ttl )
+  {
+    if( ttl < 0 || ttl > 255 )
+      throw std::runtime_error("multicast ttl must be between 0 and 255\n");
+    DWORD value = (DWORD)ttl; // DWORD on win32
+    if( setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&value, sizeof(value)) == SOCKET_ERROR )
+      throw std::runtime_error("unable to set IP_MULTICAST_TTL\n");
+  }
+
+  // note that on win32 IP_MULTICAST_LOOP applies to the receiving socket
+  void SetMulticastLoopback( bool enableLoopback )
+  {
+    DWORD value = (enableLoopback) ? 1 : 0; // DWORD on win32
+    if( setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_LOOP, (const char*)&value, sizeof(value)) == SOCKET_ERROR )
+      throw std::runtime_error("unable to set IP_MULTICAST_LOOP\n");
+  }
+
+  // win32 can't bind to a multicast address, the socket only receives
+  // the groups it joined and unicast datagrams to the port
+  static IpEndpointName MulticastBindEndpoint( const IpEndpointName& group )
+  {
+    return IpEndpointName( IpEndpointName::ANY_ADDRESS, group.port );
+  }
+
+  std::size_t TruncatedDatagramCount() const { return truncatedDatagramCount_; }
+
+  // kernel drop counts aren't available on win32
+  SocketMetrics Metrics() const
+  {
+    SocketMetrics result;
+    result.receivedDatagramCount = receivedDatagramCount_.Value();
+    result.receivedByteCount = receivedByteCount_.Value();
+    result.failedReceiveCount = failedReceiveCount_.Value();
+    result.truncatedDatagramCount = truncatedDatagramCount_;
+    return result;
+  }
+
+  // used by multiplexers which receive without ReceiveFrom()
+  void CountTruncatedDatagram() { ++truncatedDatagramCount_; }
+  void CountReceivedDatagram( std::size_t size )
+  {
+    receivedDatagramCount_.Add();
+    receivedByteCount_.Add( size );
+  }
+  void CountFailedReceive() { failedReceiveCount_.Add(); }
+
   IpEndpointName LocalEndpointFor( const IpEndpointName& remoteEndpoint ) const
   {
     assert( isBound_ );
@@ -216,10 +437,35 @@ public:
 
     void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
   {
-    sendToAddr_.sin_addr.s_addr = htonl( remoteEndpoint.address );
-        sendToAddr_.sin_port = htons( (short)remoteEndpoint.port );
+    struct sockaddr_in sendToAddr;
+    SendToSockaddrFromIpEndpointName( sendToAddr, remoteEndpoint );
 
-        sendto( socket_, data, (int)size, 0, (sockaddr*)&sendToAddr_, sizeof(sendToAddr_) );
+        sendto( socket_, data, (int)size, 0, (sockaddr*)&sendToAddr, sizeof(sendToAddr) );
+  }
+
+  // Send all datagrams of batch and set their error fields. Returns the
+  // number of datagrams which couldn't be sent. Winsock has no call which
+  // sends several datagrams at once (WSASendMsg also sends one), so this
+  // is one sendto() per datagram. See BatchSender.
+  std::size_t SendMany( SendBatch& batch )
+  {
+    std::size_t failedCount = 0;
+
+    for( std::size_t i=0; i < batch.datagrams_.size(); ++i ){
+      OutgoingDatagram& datagram = batch.datagrams_[i];
+
+      struct sockaddr_in sendToAddr;
+      SendToSockaddrFromIpEndpointName( sendToAddr, datagram.remoteEndpoint );
+
+      datagram.error = 0;
+      if( sendto( socket_, datagram.data, (int)datagram.size, 0,
+              (sockaddr*)&sendToAddr, sizeof(sendToAddr) ) == SOCKET_ERROR ){
+        datagram.error = WSAGetLastError();
+        ++failedCount;
+      }
+    }
+
+    return failedCount;
   }
 
   void Bind( const IpEndpointName& localEndpoint )
@@ -245,8 +491,17 @@ public:
 
         int result = recvfrom(socket_, data, (int)size, 0,
                     (struct sockaddr *) &fromAddr, (socklen_t*)&fromAddrLen);
-    if( result < 0 )
+    if( result < 0 ){
+      // the datagram was larger than size. it is truncated, and not returned
+      if( WSAGetLastError() == WSAEMSGSIZE )
+        ++truncatedDatagramCount_;
+      else
+        CountFailedReceive();
       return 0;
+    }
+
+    // an empty datagram is received like any other
+    CountReceivedDatagram( (std::size_t)result );
 
     remoteEndpoint.address = ntohl(fromAddr.sin_addr.s_addr);
     remoteEndpoint.port = ntohs(fromAddr.sin_port);
@@ -254,24 +509,62 @@ public:
     return result;
   }
 
+  // a non-blocking ReceiveFrom() for SocketReceiveMultiplexerImplementation,
+  // whose sockets are non-blocking while it runs. returns -1 if no datagram
+  // is pending, and 0 for one which was larger than size (counted by
+  // TruncatedDatagramCount()) or empty
+  int TryReceiveFrom( IpEndpointName& remoteEndpoint, char *data, std::size_t size )
+  {
+    assert( isBound_ );
+
+    struct sockaddr_in fromAddr;
+    socklen_t fromAddrLen = sizeof(fromAddr);
+
+    int result = recvfrom( socket_, data, (int)size, 0,
+        (struct sockaddr *) &fromAddr, (socklen_t*)&fromAddrLen );
+    if( result < 0 ){
+      int error = WSAGetLastError();
+      if( error == WSAEWOULDBLOCK )
+        return -1;
+      if( error == WSAEMSGSIZE )
+        ++truncatedDatagramCount_;
+      else
+        CountFailedReceive();
+      return 0;
+    }
+
+    CountReceivedDatagram( (std::size_t)result );
+    remoteEndpoint.address = ntohl(fromAddr.sin_addr.s_addr);
+    remoteEndpoint.port = ntohs(fromAddr.sin_port);
+    return result;
+  }
+
   SOCKET& Socket() { return socket_; }
 };
 
-struct AttachedTimerListener{
-  AttachedTimerListener( int id, int p, TimerListener *tl )
-    : initialDelayMs( id )
-    , periodMs( p )
-    , listener( tl ) {}
-  int initialDelayMs;
-  int periodMs;
-  TimerListener *listener;
-};
+using detail::AttachedTimerListener;
+
+// the "__stop_" packet makes Run() exit, as if Break() had been called
+inline bool IsStopPacket( const char *data, std::size_t size )
+{
+  return size == 8 && std::memcmp( data, "__stop_", 8 ) == 0;
+}
 
 
-static bool CompareScheduledTimerCalls(
-    const std::pair< double, AttachedTimerListener > & lhs, const std::pair< double, AttachedTimerListener > & rhs )
+// deliver count received datagrams to listener, up to (but not including)
+// the first stop packet. returns true if a stop packet was received.
+inline bool DispatchReceivedDatagrams( PacketListener *listener,
+    const ReceivedDatagram *datagrams, std::size_t count )
 {
-  return lhs.first < rhs.first;
+  std::size_t dispatchCount = 0;
+  while( dispatchCount < count
+      && !IsStopPacket( datagrams[dispatchCount].data, datagrams[dispatchCount].size ) )
+    ++dispatchCount;
+
+  if( dispatchCount > 0 )
+    listener->ProcessPackets( datagrams, dispatchCount );
+
+  return dispatchCount < count;
 }
 
 template<typename UdpSocket_T>
@@ -279,17 +572,24 @@ class SocketReceiveMultiplexerImplementation {
 
   std::vector< std::pair< PacketListener*, UdpSocket_T* > > socketListeners_;
   std::vector< AttachedTimerListener > timerListeners_;
+  std::vector< ScheduledTimerListener* > scheduledTimerListeners_;
+
+  std::size_t receiveBatchSize_;
+  std::size_t maximumPacketSize_;
 
-  volatile bool break_;
+  std::atomic_bool break_;
   HANDLE breakEvent_;
 
   double GetCurrentTimeMs() const
   {
-    return timeGetTime(); // FIXME: bad choice if you want to run for more than 40 days
-    }
+    return detail::SteadyTimeMs();
+  }
 
 public:
     SocketReceiveMultiplexerImplementation()
+    : receiveBatchSize_( 1 )
+    , maximumPacketSize_( DEFAULT_MAXIMUM_PACKET_SIZE )
+    , break_( false )
   {
     NetworkInitializer::instance();
     breakEvent_ = CreateEvent( NULL, FALSE, FALSE, NULL );
@@ -339,6 +639,38 @@ public:
     timerListeners_.erase( i );
   }
 
+  void AttachScheduledTimerListener( ScheduledTimerListener *listener )
+  {
+    scheduledTimerListeners_.push_back( listener );
+  }
+
+  void DetachScheduledTimerListener( ScheduledTimerListener *listener )
+  {
+    auto i = std::find( scheduledTimerListeners_.begin(), scheduledTimerListeners_.end(), listener );
+    assert( i != scheduledTimerListeners_.end() );
+
+    scheduledTimerListeners_.erase( i );
+  }
+
+  // the number of datagrams delivered with each ProcessPackets() call at
+  // most. they are received one recvfrom() call at a time
+  void SetReceiveBatchSize( std::size_t datagramCount )
+  {
+    assert( datagramCount > 0 );
+    receiveBatchSize_ = datagramCount;
+  }
+
+  void SetMaximumPacketSize( std::size_t bytes )
+  {
+    assert( bytes > 0 );
+    maximumPacketSize_ = bytes;
+  }
+
+  MultiplexerMetrics Metrics() const
+  {
+    return detail::CollectMultiplexerMetrics( socketListeners_ );
+  }
+
     void Run()
   {
     break_ = false;
@@ -362,52 +694,44 @@ public:
 
 
     // configure the timer queue
-    double currentTimeMs = GetCurrentTimeMs();
-
-    // expiry time ms, listener
-    std::vector< std::pair< double, AttachedTimerListener > > timerQueue_;
-    for( std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
-        i != timerListeners_.end(); ++i )
-      timerQueue_.push_back( std::make_pair( currentTimeMs + i->initialDelayMs, *i ) );
-    std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
+    detail::TimerQueue timerQueue;
+    timerQueue.Reset( timerListeners_, scheduledTimerListeners_, GetCurrentTimeMs() );
 
-    const int MAX_BUFFER_SIZE = 4098;
-    char *data = new char[ MAX_BUFFER_SIZE ];
-    IpEndpointName remoteEndpoint;
+    std::vector<char> buffers( receiveBatchSize_ * maximumPacketSize_ );
+    std::vector<ReceivedDatagram> datagrams( receiveBatchSize_ );
 
     while( !break_ ){
 
-      double currentTimeMs = GetCurrentTimeMs();
-
-            DWORD waitTime = INFINITE;
-            if( !timerQueue_.empty() ){
-
-                waitTime = (DWORD)( timerQueue_.front().first >= currentTimeMs
-                            ? timerQueue_.front().first - currentTimeMs
-                            : 0 );
-            }
+      // round up so that we don't wake before the first timer is due
+      DWORD waitTime = INFINITE;
+      double timeoutMs = timerQueue.TimeoutMs( GetCurrentTimeMs() );
+      if( timeoutMs >= 0 )
+        waitTime = (DWORD)std::ceil( timeoutMs );
 
       DWORD waitResult = WaitForMultipleObjects( (DWORD)socketListeners_.size() + 1, &events[0], FALSE, waitTime );
       if( break_ )
         break;
 
       if( waitResult != WAIT_TIMEOUT ){
-        for( int i = waitResult - WAIT_OBJECT_0; i < (int)socketListeners_.size(); ++i ){
-          std::size_t size = socketListeners_[i].second->ReceiveFrom( remoteEndpoint, data, MAX_BUFFER_SIZE );
-
-          if (size == 8 && strcmp(data, "__stop_") == 0)
-          {
-            break_ = true;
-            break;
-          }
-
-          if( size > 0 ){
-            if (break_)
-              break;
-            socketListeners_[i].first->ProcessPacket( data, (int)size, remoteEndpoint );
-            if( break_ )
+        for( int i = waitResult - WAIT_OBJECT_0; i < (int)socketListeners_.size() && !break_; ++i ){
+          // receive up to a batch of the pending datagrams, skipping
+          // truncated and empty ones
+          std::size_t count = 0;
+          while( count < receiveBatchSize_ ){
+            ReceivedDatagram& datagram = datagrams[count];
+            char *data = &buffers[ count * maximumPacketSize_ ];
+            int size = socketListeners_[i].second->TryReceiveFrom( datagram.remoteEndpoint, data, maximumPacketSize_ );
+            if( size < 0 )
               break;
+            if( size == 0 )
+              continue;
+            datagram.data = data;
+            datagram.size = size;
+            ++count;
           }
+
+          if( count > 0 && DispatchReceivedDatagrams( socketListeners_[i].first, &datagrams[0], count ) )
+            break_ = true;
         }
       }
 
@@ -415,24 +739,9 @@ public:
         break;
 
       // execute any expired timers
-      currentTimeMs = GetCurrentTimeMs();
-      bool resort = false;
-      for( std::vector< std::pair< double, AttachedTimerListener > >::iterator i = timerQueue_.begin();
-          i != timerQueue_.end() && i->first <= currentTimeMs; ++i ){
-
-        i->second.listener->TimerExpired();
-        if( break_ )
-          break;
-
-        i->first += i->second.periodMs;
-        resort = true;
-      }
-      if( resort )
-        std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
+      timerQueue.ExpireTimers( GetCurrentTimeMs(), [this]() -> bool { return break_; } );
     }
 
-    delete [] data;
-
     // free events
     j = 0;
     for(auto i = socketListeners_.begin();
@@ -453,6 +762,11 @@ public:
     void AsynchronousBreak()
   {
     break_ = true;
+    AsynchronousWakeup();
+  }
+
+    void AsynchronousWakeup()
+  {
     SetEvent( breakEvent_ );
   }
 };
@@ -460,6 +774,7 @@ public:
 struct Implementation
 {
     using udp_socket_t = oscpack::win32::UdpSocketImplementation;
+    using send_batch_t = oscpack::win32::SendBatch;
     using socket_multiplexer_t = oscpack::win32::SocketReceiveMultiplexerImplementation<udp_socket_t>;
 };
 }
@@ -0,0 +1,258 @@
+/*
+  oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+  The text above constitutes the entire oscpack license; however,
+  the oscpack developer(s) also make the following non-binding requests:
+
+  Any person wishing to distribute modifications to the Software is
+  requested to send the modifications to the original developer so that
+  they can be incorporated into the canonical version. It is also
+  requested that these non-binding requests be included whenever the
+  above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_COALESCINGOSCPACKETLISTENER_H
+#define INCLUDED_OSCPACK_COALESCINGOSCPACKETLISTENER_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "OscAddressTable.h"
+#include "OscPacketListener.h"
+#include "../ip/TimerListener.h"
+
+
+namespace oscpack{
+
+// An OscPacketListener which keeps only the latest message for each
+// address (or for each address and sender) and passes the messages that
+// changed on to listener when Drain() is called, e.g. once per frame.
+// Controllers often send updates faster than their consumers can use
+// them; intermediate values are discarded instead of being dispatched:
+//
+//     MyMessageMappingListener handlers;
+//     CoalescingOscPacketListener coalescer( &handlers );
+//     mux.AttachSocketListener( &socket, &coalescer );
+//
+//     // on the consumer's thread, once per frame
+//     coalescer.Drain();
+//
+// or attach the coalescer to a multiplexer as a periodic timer listener,
+// which drains it on the multiplexer's thread:
+//
+//     mux.AttachPeriodicTimerListener( 16, &coalescer );
+//
+// Each drained message is passed to listener->ProcessPacket() as a
+// packet of its own, so any PacketListener (usually an OscPacketListener
+// such as MessageMappingOscPacketListener) can consume them unchanged.
+// Messages are drained in the order their slot first changed since the
+// previous Drain(). Bundle time tags are ignored, as by
+// OscPacketListener, and messages leave their bundles.
+//
+// Received messages may be coalesced on one thread while another drains.
+// Each message is copied into a buffer kept by its slot (which is swapped
+// with a drained buffer by Drain()), so once the slots have seen their
+// largest messages coalescing doesn't allocate. Memory is bounded by
+// maximumSlotCount: messages for further addresses (or senders) are
+// discarded, see DroppedCount().
+class CoalescingOscPacketListener : public OscPacketListener, public TimerListener{
+    struct Slot{
+        std::vector<char> message;
+        IpEndpointName remoteEndpoint;
+        uint32_t nextSource; // index + 1 of the next slot for the same address, with coalesceBySource_
+        bool changed;
+    };
+
+    struct DrainedMessage{
+        std::vector<char> message;
+        IpEndpointName remoteEndpoint;
+    };
+
+    PacketListener *listener_;
+    bool coalesceBySource_;
+    std::size_t maximumSlotCount_;
+
+    AddressTable<uint32_t> addresses_; // the (first) slot of each address
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> changedSlots_;
+    std::vector<DrainedMessage> drained_; // only used by Drain(), never shrinks
+
+    std::size_t supersededCount_;
+    std::size_t droppedCount_;
+
+    mutable std::mutex mutex_; // guards all but drained_
+    std::mutex drainMutex_;
+
+    // returns the index of a new slot, or -1 if there are maximumSlotCount_
+    long NewSlot( const IpEndpointName& remoteEndpoint )
+    {
+        if( slots_.size() >= maximumSlotCount_ )
+            return -1;
+        slots_.push_back( Slot{ std::vector<char>(), remoteEndpoint, 0, false } );
+        return (long)slots_.size() - 1;
+    }
+
+    // the slot for m, or -1 if there's no room for another
+    long FindSlot( const ReceivedMessage& m, const IpEndpointName& remoteEndpoint )
+    {
+        const uint32_t *first = addresses_.Find( m.AddressPattern() );
+        if( !first ){
+            long slot = NewSlot( remoteEndpoint );
+            if( slot >= 0 )
+                addresses_.Insert( m.AddressPattern(), (uint32_t)slot );
+            return slot;
+        }
+
+        if( !coalesceBySource_ )
+            return (long)*first;
+
+        // senders of an address are few, so they are searched in turn
+        uint32_t slot = *first;
+        for(;;){
+            if( slots_[slot].remoteEndpoint == remoteEndpoint )
+                return (long)slot;
+            if( slots_[slot].nextSource == 0 )
+                break;
+            slot = slots_[slot].nextSource - 1;
+        }
+
+        long next = NewSlot( remoteEndpoint );
+        if( next >= 0 )
+            slots_[slot].nextSource = (uint32_t)next + 1;
+        return next;
+    }
+
+protected:
+    // called with mutex_ held, see ProcessPacket()
+    void ProcessMessage( const oscpack::ReceivedMessage& m,
+        const IpEndpointName& remoteEndpoint ) override
+    {
+        long index = FindSlot( m, remoteEndpoint );
+        if( index < 0 ){
+            ++droppedCount_;
+            return;
+        }
+
+        Slot& slot = slots_[ (std::size_t)index ];
+        if( slot.changed )
+            ++supersededCount_;
+        else{
+            slot.changed = true;
+            changedSlots_.push_back( (uint32_t)index );
+        }
+
+        slot.message.assign( m.data(), m.data() + m.size() );
+        slot.remoteEndpoint = remoteEndpoint;
+    }
+
+public:
+    // with coalesceBySource, the latest message of each sender of an
+    // address is kept, rather than the latest message of any sender
+    explicit CoalescingOscPacketListener( PacketListener *listener, bool coalesceBySource=false,
+            std::size_t maximumSlotCount=1024 )
+        : listener_( listener )
+        , coalesceBySource_( coalesceBySource )
+        , maximumSlotCount_( maximumSlotCount )
+        , supersededCount_( 0 )
+        , droppedCount_( 0 )
+    {
+        slots_.reserve( maximumSlotCount );
+        changedSlots_.reserve( maximumSlotCount );
+        drained_.reserve( maximumSlotCount );
+    }
+
+    void ProcessPacket( const char *data, int size,
+        const IpEndpointName& remoteEndpoint ) override
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        OscPacketListener::ProcessPacket( data, size, remoteEndpoint );
+    }
+
+    // pass the latest message of each slot which changed since the
+    // previous call to listener->ProcessPacket(), on the calling thread.
+    // returns the number of messages passed on
+    std::size_t Drain()
+    {
+        std::lock_guard<std::mutex> drainLock( drainMutex_ );
+        std::size_t count;
+        {
+            // swap the messages out so that the listener runs without
+            // blocking the receiving thread
+            std::lock_guard<std::mutex> lock( mutex_ );
+            count = changedSlots_.size();
+            if( drained_.size() < count )
+                drained_.resize( count );
+            for( std::size_t i=0; i < count; ++i ){
+                Slot& slot = slots_[ changedSlots_[i] ];
+                drained_[i].message.swap( slot.message );
+                drained_[i].remoteEndpoint = slot.remoteEndpoint;
+                slot.changed = false;
+            }
+            changedSlots_.clear();
+        }
+
+        for( std::size_t i=0; i < count; ++i ){
+            const DrainedMessage& d = drained_[i];
+            listener_->ProcessPacket( &d.message[0], (int)d.message.size(), d.remoteEndpoint );
+        }
+        return count;
+    }
+
+    void TimerExpired() override { Drain(); }
+
+    // the number of slots with a message waiting for Drain()
+    std::size_t ChangedCount() const
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        return changedSlots_.size();
+    }
+
+    // the number of addresses (or address and sender pairs) seen
+    std::size_t SlotCount() const
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        return slots_.size();
+    }
+
+    // the number of messages replaced by a later message before being drained
+    std::size_t SupersededCount() const
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        return supersededCount_;
+    }
+
+    // the number of messages discarded because all slots were in use
+    std::size_t DroppedCount() const
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        return droppedCount_;
+    }
+};
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_COALESCINGOSCPACKETLISTENER_H */
@@ -0,0 +1,287 @@
+/*
+  oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+  The text above constitutes the entire oscpack license; however,
+  the oscpack developer(s) also make the following non-binding requests:
+
+  Any person wishing to distribute modifications to the Software is
+  requested to send the modifications to the original developer so that
+  they can be incorporated into the canonical version. It is also
+  requested that these non-binding requests be included whenever the
+  above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_COALESCINGTRANSMITTER_H
+#define INCLUDED_OSCPACK_COALESCINGTRANSMITTER_H
+
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "OscOutboundPacketStream.h"
+#include "OscMessageWriter.h"
+#include "OscReceivedElements.h"
+#include "../ip/TimerListener.h"
+#include "../ip/TimerQueue.h"
+#include "../ip/UdpSocket.h"
+
+
+namespace oscpack{
+
+namespace detail{
+
+// prevents deduction of a template argument from a parameter
+template< class T >
+struct NonDeducedType{ typedef T type; };
+
+} // namespace detail
+
+
+// Accumulates messages into an immediate bundle and sends the bundle as a
+// single packet once the next message wouldn't fit in maximumPacketSize
+// bytes (1472 is the UDP payload of a 1500 byte Ethernet MTU), once the
+// oldest pending message has waited maximumDelayMs, or on Flush(). A
+// bundle holding a single message is sent as the bare message. Messages
+// larger than a packet are sent on their own, in order.
+//
+// The delay is driven by a multiplexer: attach the transmitter with
+// AttachScheduledTimerListener() to flush exactly maximumDelayMs after
+// the first pending message.
+//
+//     CoalescingTransmitter transmitter( socket );
+//     mux.AttachScheduledTimerListener( &transmitter );
+//
+// Sending a message which starts a new bundle wakes the multiplexer, so
+// messages may also be sent from threads other than the multiplexer's.
+//
+// Socket_T is anything with a Send( const char*, std::size_t ) method,
+// usually UdpTransmitSocket. The methods may be called from any thread.
+template< class Socket_T >
+class BasicCoalescingTransmitter : public ScheduledTimerListener{
+    // "#bundle\0" and the time tag, and the size slot of each element
+    static const constexpr std::size_t BUNDLE_HEADER_SIZE = 16;
+    static const constexpr std::size_t ELEMENT_SIZE_SLOT_SIZE = 4;
+    // an address pattern and an empty type tag string
+    static const constexpr std::size_t MINIMUM_MESSAGE_SIZE = 8;
+
+    Socket_T& socket_;
+    std::vector<char> buffer_;
+    OutboundPacketStream stream_;
+    double maximumDelayMs_;
+
+    std::size_t messageCount_; // in the pending bundle
+    double deadlineMs_;
+    std::size_t packetCount_;
+    std::size_t sentMessageCount_;
+
+    mutable std::mutex mutex_;
+
+    void SendPacket( const char *data, std::size_t size, std::size_t messageCount )
+    {
+        socket_.Send( data, size );
+        ++packetCount_;
+        sentMessageCount_ += messageCount;
+    }
+
+    void FlushPending()
+    {
+        if( messageCount_ == 0 )
+            return;
+
+        stream_ << EndBundle();
+        if( messageCount_ == 1 ){
+            const std::size_t offset = BUNDLE_HEADER_SIZE + ELEMENT_SIZE_SLOT_SIZE;
+            SendPacket( stream_.Data() + offset, stream_.Size() - offset, 1 );
+        }else{
+            SendPacket( stream_.Data(), stream_.Size(), messageCount_ );
+        }
+
+        stream_.Clear();
+        messageCount_ = 0;
+    }
+
+    // prepare the pending bundle for an element of elementSize bytes,
+    // sending it first if the element doesn't fit. returns false if the
+    // element is too large for any bundle.
+    bool BeginElement( std::size_t elementSize )
+    {
+        if( BUNDLE_HEADER_SIZE + ELEMENT_SIZE_SLOT_SIZE + elementSize > buffer_.size() )
+            return false;
+
+        if( messageCount_ > 0
+                && stream_.Size() + ELEMENT_SIZE_SLOT_SIZE + elementSize > buffer_.size() )
+            FlushPending();
+
+        if( messageCount_ == 0 ){
+            stream_ << BeginBundleImmediate();
+            deadlineMs_ = detail::SteadyTimeMs() + maximumDelayMs_;
+        }
+
+        return true;
+    }
+
+    // returns true if the element started a pending bundle, whose
+    // deadline the multiplexer must be woken to notice
+    bool EndElement()
+    {
+        ++messageCount_;
+
+        // send now if no other message would fit
+        if( stream_.Size() + ELEMENT_SIZE_SLOT_SIZE + MINIMUM_MESSAGE_SIZE > buffer_.size() ){
+            FlushPending();
+            return false;
+        }
+
+        return messageCount_ == 1;
+    }
+
+public:
+    explicit BasicCoalescingTransmitter( Socket_T& socket,
+            std::size_t maximumPacketSize=1472, double maximumDelayMs=2. )
+        : socket_( socket )
+        , buffer_( maximumPacketSize )
+        , stream_( &buffer_[0], buffer_.size() )
+        , maximumDelayMs_( maximumDelayMs )
+        , messageCount_( 0 )
+        , deadlineMs_( 0 )
+        , packetCount_( 0 )
+        , sentMessageCount_( 0 )
+    {
+        assert( maximumPacketSize >= BUNDLE_HEADER_SIZE + ELEMENT_SIZE_SLOT_SIZE + MINIMUM_MESSAGE_SIZE );
+    }
+
+    // pending messages are sent
+    ~BasicCoalescingTransmitter()
+    {
+        Flush();
+    }
+
+    BasicCoalescingTransmitter( const BasicCoalescingTransmitter& ) = delete;
+    BasicCoalescingTransmitter& operator=( const BasicCoalescingTransmitter& ) = delete;
+
+    // queue a complete message (or bundle) of size bytes. throws
+    // MalformedPacketException if size isn't a non-zero multiple of 4
+    void Send( const char *data, std::size_t size )
+    {
+        if( size == 0 || (size & 0x3) != 0 )
+            throw MalformedPacketException( "packet size is not a non-zero multiple of 4" );
+
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+
+            if( !BeginElement( size ) ){
+                FlushPending();
+                SendPacket( data, size, 1 );
+                return;
+            }
+
+            std::memcpy( stream_.ReserveMessage( size ), data, size );
+            if( !EndElement() )
+                return;
+        }
+        WakeMultiplexer();
+    }
+
+    // queue the contents of a packet, e.g. a complete OutboundPacketStream
+    template< class Packet_T >
+    void Send( const Packet_T& packet )
+    {
+        Send( packet.Data(), packet.Size() );
+    }
+
+    // encode a message directly into the pending bundle
+    template< class... Ts >
+    void Send( const MessageWriter<Ts...>& writer, const typename detail::NonDeducedType<Ts>::type&... args )
+    {
+        std::unique_lock<std::mutex> lock( mutex_ );
+
+        std::size_t size = writer.Size( args... );
+        if( !BeginElement( size ) ){
+            FlushPending();
+
+            std::vector<char> buffer( size );
+            OutboundPacketStream ps( &buffer[0], size );
+            writer.Write( ps, args... );
+            SendPacket( ps.Data(), ps.Size(), 1 );
+            return;
+        }
+
+        writer.Write( stream_, args... );
+        if( EndElement() ){
+            lock.unlock();
+            WakeMultiplexer();
+        }
+    }
+
+    // send the pending messages now
+    void Flush()
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        FlushPending();
+    }
+
+    std::size_t PendingMessageCount() const
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        return messageCount_;
+    }
+
+    // the number of packets sent, and the number of messages they held
+    std::size_t PacketCount() const
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        return packetCount_;
+    }
+
+    std::size_t SentMessageCount() const
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        return sentMessageCount_;
+    }
+
+    // ScheduledTimerListener
+
+    bool NextExpiryMs( double& expiryMs ) override
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        if( messageCount_ == 0 )
+            return false;
+
+        expiryMs = deadlineMs_;
+        return true;
+    }
+
+    void TimerExpired() override
+    {
+        Flush();
+    }
+};
+
+typedef BasicCoalescingTransmitter<UdpTransmitSocket> CoalescingTransmitter;
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_COALESCINGTRANSMITTER_H */
@@ -37,42 +37,93 @@
 #ifndef INCLUDED_OSCPACK_MESSAGEMAPPINGOSCPACKETLISTENER_H
 #define INCLUDED_OSCPACK_MESSAGEMAPPINGOSCPACKETLISTENER_H
 
-#include <cstring>
-#include <map>
-
 #include "OscPacketListener.h"
+#include "OscAddressTable.h"
+#include "OscAddressPattern.h"
+#include "OscAddressMatchCache.h"
 
 
 
 namespace oscpack{
 
+// Dispatches received messages to member functions of T registered by
+// address. T must derive from MessageMappingOscPacketListener<T>.
+//
+// Exact addresses are resolved with a single hash lookup. Incoming
+// messages whose address is an OSC pattern (containing *, ?, [] or {})
+// are matched against every registered address and invoke each matching
+// function in registration order. The matches for recently seen patterns
+// are cached, see SetPatternCacheCapacity().
 template< class T >
 class MessageMappingOscPacketListener : public OscPacketListener{
 public:
     typedef void (T::*function_type)(const oscpack::ReceivedMessage&, const IpEndpointName&);
 
 protected:
+    MessageMappingOscPacketListener()
+        : patternCacheValid_( true ) {}
+
+    // the address is copied. registering the same address twice keeps
+    // the first function.
     void RegisterMessageFunction( const char *addressPattern, function_type f )
     {
-        functions_.insert( std::make_pair( addressPattern, f ) );
+        functions_.Insert( addressPattern, f );
+
+        // cleared on the next message rather than here, since this may be
+        // called from a handler that is iterating a cached match set
+        patternCacheValid_ = false;
+    }
+
+    // the number of distinct incoming patterns whose matches are remembered.
+    // the default is 256.
+    void SetPatternCacheCapacity( std::size_t capacity )
+    {
+        patternCache_ = AddressMatchCache<function_type>( capacity );
     }
 
     virtual void ProcessMessage( const oscpack::ReceivedMessage& m,
 		const IpEndpointName& remoteEndpoint )
     {
-        typename function_map_type::iterator i = functions_.find( m.AddressPattern() );
-        if( i != functions_.end() )
-            (dynamic_cast<T*>(this)->*(i->second))( m, remoteEndpoint );
+        T *self = static_cast<T*>(this);
+
+        const char *address = m.AddressPattern();
+        if( const function_type *f = functions_.Find( address ) ){
+            (self->**f)( m, remoteEndpoint );
+            return;
+        }
+
+        if( !IsAddressPattern( address ) ){
+            CountUnmatchedMessage();
+            return;
+        }
+
+        if( !patternCacheValid_ ){
+            patternCache_.Clear();
+            patternCacheValid_ = true;
+        }
+
+        const std::vector<function_type> *matches = patternCache_.Find( address );
+        if( !matches ){
+            std::vector<function_type>& newMatches = patternCache_.Insert( address );
+            CompiledAddressPattern pattern( address );
+            functions_.ForEach( [&]( const char *registeredAddress, function_type f ){
+                if( pattern.Matches( registeredAddress ) )
+                    newMatches.push_back( f );
+            } );
+            matches = &newMatches;
+        }
+
+        if( matches->empty() )
+            CountUnmatchedMessage();
+
+        for( std::size_t i=0; i < matches->size(); ++i )
+            (self->*(*matches)[i])( m, remoteEndpoint );
     }
     
 private:
-    struct cstr_compare{
-        bool operator()( const char *lhs, const char *rhs ) const
-            { return std::strcmp( lhs, rhs ) < 0; }
-    };
-
-    typedef std::map<const char*, function_type, cstr_compare> function_map_type;
-    function_map_type functions_;
+    AddressTable<function_type> functions_;
+    AddressMatchCache<function_type> patternCache_;
+    bool patternCacheValid_;
 };
 
 } // namespace osc
@@ -0,0 +1,124 @@
+/*
+  oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+  The text above constitutes the entire oscpack license; however,
+  the oscpack developer(s) also make the following non-binding requests:
+
+  Any person wishing to distribute modifications to the Software is
+  requested to send the modifications to the original developer so that
+  they can be incorporated into the canonical version. It is also
+  requested that these non-binding requests be included whenever the
+  above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCADDRESSMATCHCACHE_H
+#define INCLUDED_OSCPACK_OSCADDRESSMATCHCACHE_H
+
+#include <cassert>
+#include <cstring>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+namespace oscpack{
+
+// A bounded least-recently-used cache from incoming address strings to
+// the set of values (usually handlers) that they matched. Used to avoid
+// re-matching address patterns that arrive repeatedly.
+//
+// Lookups that hit don't allocate. When the cache is full, Insert()
+// reuses the storage of the least recently used entry.
+template< class Value >
+class AddressMatchCache{
+    struct Node{
+        std::string address;
+        std::vector<Value> matches;
+    };
+
+    typedef std::list<Node> list_type;  // most recently used first
+    typedef std::unordered_map< std::string_view, typename list_type::iterator > map_type;
+
+    std::size_t capacity_;
+    list_type nodes_;
+    map_type index_;
+
+public:
+    explicit AddressMatchCache( std::size_t capacity=256 )
+        : capacity_( capacity )
+    {
+        assert( capacity > 0 );
+        index_.reserve( capacity );
+    }
+
+    // returns the cached matches for address, or 0 if address isn't cached
+    const std::vector<Value>* Find( const char *address )
+    {
+        typename map_type::iterator i = index_.find( std::string_view( address ) );
+        if( i == index_.end() )
+            return 0;
+
+        nodes_.splice( nodes_.begin(), nodes_, i->second );
+        return &i->second->matches;
+    }
+
+    // adds address, which must not already be cached, and returns an
+    // empty match set for the caller to fill. evicts the least recently
+    // used entry if the cache is full.
+    std::vector<Value>& Insert( const char *address )
+    {
+        assert( index_.find( std::string_view( address ) ) == index_.end() );
+
+        if( nodes_.size() == capacity_ ){
+            typename list_type::iterator last = --nodes_.end();
+            index_.erase( std::string_view( last->address ) );
+            nodes_.splice( nodes_.begin(), nodes_, last );
+        }else{
+            nodes_.emplace_front();
+        }
+
+        Node& node = nodes_.front();
+        node.address.assign( address );
+        node.matches.clear();
+        index_.emplace( std::string_view( node.address ), nodes_.begin() );
+        return node.matches;
+    }
+
+    void Clear()
+    {
+        index_.clear();
+        nodes_.clear();
+    }
+
+    std::size_t Size() const { return nodes_.size(); }
+    std::size_t Capacity() const { return capacity_; }
+};
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_OSCADDRESSMATCHCACHE_H */
@@ -0,0 +1,373 @@
+/*
+  oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+  The text above constitutes the entire oscpack license; however,
+  the oscpack developer(s) also make the following non-binding requests:
+
+  Any person wishing to distribute modifications to the Software is
+  requested to send the modifications to the original developer so that
+  they can be incorporated into the canonical version. It is also
+  requested that these non-binding requests be included whenever the
+  above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCADDRESSPATTERN_H
+#define INCLUDED_OSCPACK_OSCADDRESSPATTERN_H
+
+#include <bitset>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace oscpack{
+
+// OSC 1.0 address pattern matching.
+//
+//   ?          matches any single character except '/'
+//   *          matches any sequence of zero or more characters except '/'
+//   [abc]      matches any character in the set, [a-z] ranges are permitted
+//   [!abc]     matches any character not in the set
+//   {foo,bar}  matches any of the comma separated strings
+//
+// Other characters match themselves. A malformed pattern (e.g. an
+// unterminated '[' or '{', or one with more than
+// MAX_ADDRESS_PATTERN_ALTERNATIVES alternatives in all) doesn't match
+// anything.
+
+// returns true if s contains any of the pattern special characters
+inline bool IsAddressPattern( const char *s )
+{
+    return std::strpbrk( s, "*?[{" ) != 0;
+}
+
+
+// bounds the work of matching a pattern received from an untrusted sender
+constexpr std::size_t MAX_ADDRESS_PATTERN_ALTERNATIVES = 256;
+
+
+namespace detail{
+
+// matches the single character c against the set beginning after the '['
+// at pattern. returns the position after the closing ']', or 0 if the set
+// is unterminated. matched receives the result.
+inline const char* MatchAddressPatternSet( const char *pattern, char c, bool& matched )
+{
+    bool negate = false;
+    if( *pattern == '!' ){
+        negate = true;
+        ++pattern;
+    }
+
+    matched = false;
+    bool first = true;
+    while( *pattern != ']' || first ){
+        if( *pattern == '\0' )
+            return 0;
+
+        char lo = *pattern++;
+        char hi = lo;
+        if( *pattern == '-' && pattern[1] != ']' && pattern[1] != '\0' ){
+            hi = pattern[1];
+            pattern += 2;
+        }
+
+        if( (lo <= c && c <= hi) || (hi <= c && c <= lo) )
+            matched = true;
+
+        first = false;
+    }
+
+    if( negate )
+        matched = !matched;
+
+    return pattern + 1; // skip ']'
+}
+
+} // namespace detail
+
+
+// A pattern compiled once into a small state machine (a nondeterministic
+// finite automaton), for patterns that are matched against many addresses.
+// Matches() follows all ways the pattern can match at once, one address
+// character at a time, so it takes at most (pattern states x address
+// length) steps whatever the pattern, which is what makes it safe for
+// patterns from untrusted senders. MatchAddressPattern() uses it too.
+class CompiledAddressPattern{
+    enum OpCode{
+        CHARACTER,      // c
+        ANY_CHARACTER,
+        ANY_SEQUENCE,   // consumes characters in place, or continues
+        CHARACTER_SET,  // sets_[begin]
+        ALTERNATIVES,   // continues at each of targets_[begin, end)
+        JUMP,           // continues at begin
+        MATCH           // the final state
+    };
+
+    // consuming states continue at the next state. all other transitions
+    // lead to later states, so a single pass in state order follows them
+    struct State{
+        OpCode code;
+        char c;
+        uint32_t begin, end;
+    };
+
+    std::vector<State> states_;
+    std::vector< std::bitset<256> > sets_;
+    std::vector<uint32_t> targets_;
+    std::string literal_; // the whole pattern if IsLiteral()
+    bool valid_;
+    bool isLiteral_;
+
+    void Append( OpCode code, char c=0, uint32_t begin=0, uint32_t end=0 )
+    {
+        State state = { code, c, begin, end };
+        states_.push_back( state );
+    }
+
+    bool Compile( const char *pattern )
+    {
+        while( *pattern ){
+            switch( *pattern ){
+                case '?':
+                    Append( ANY_CHARACTER );
+                    ++pattern;
+                    break;
+
+                case '*':
+                    while( *pattern == '*' )
+                        ++pattern;
+                    Append( ANY_SEQUENCE );
+                    break;
+
+                case '[':
+                    {
+                        // evaluate the set for every character once, '/'
+                        // and the terminator are never members
+                        std::bitset<256> set;
+                        const char *next = 0;
+                        for( int c=1; c < 256; ++c ){
+                            bool matched;
+                            next = detail::MatchAddressPatternSet( pattern + 1, (char)c, matched );
+                            if( !next )
+                                return false;
+                            if( matched && c != '/' )
+                                set.set( c );
+                        }
+                        Append( CHARACTER_SET, 0, (uint32_t)sets_.size() );
+                        sets_.push_back( set );
+                        pattern = next;
+                    }
+                    break;
+
+                case '{':
+                    {
+                        const char *close = std::strchr( pattern, '}' );
+                        if( !close )
+                            return false;
+
+                        // each alternative is a run of characters followed
+                        // by a jump to the end of the group
+                        std::size_t alternatives = states_.size();
+                        Append( ALTERNATIVES, 0, (uint32_t)targets_.size() );
+                        std::vector<std::size_t> jumps;
+                        const char *alternative = pattern + 1;
+                        for(;;){
+                            const char *alternativeEnd = alternative;
+                            while( alternativeEnd != close && *alternativeEnd != ',' )
+                                ++alternativeEnd;
+
+                            if( targets_.size() == MAX_ADDRESS_PATTERN_ALTERNATIVES )
+                                return false;
+                            targets_.push_back( (uint32_t)states_.size() );
+                            for( const char *c = alternative; c != alternativeEnd; ++c )
+                                Append( CHARACTER, *c );
+                            jumps.push_back( states_.size() );
+                            Append( JUMP );
+
+                            if( alternativeEnd == close )
+                                break;
+                            alternative = alternativeEnd + 1;
+                        }
+                        states_[alternatives].end = (uint32_t)targets_.size();
+                        for( std::size_t jump : jumps )
+                            states_[jump].begin = (uint32_t)states_.size();
+                        pattern = close + 1;
+                    }
+                    break;
+
+                default:
+                    Append( CHARACTER, *pattern++ );
+                    break;
+            }
+        }
+
+        Append( MATCH );
+        return true;
+    }
+
+    // state sets are bitsets of words
+    static bool Test( const uint64_t *set, std::size_t i ) { return (set[i >> 6] >> (i & 63)) & 1; }
+    static void Set( uint64_t *set, std::size_t i ) { set[i >> 6] |= (uint64_t)1 << (i & 63); }
+
+    // add the states reached from the states of set without consuming a
+    // character
+    void Follow( uint64_t *set ) const
+    {
+        for( std::size_t i=0; i < states_.size(); ++i ){
+            if( !Test( set, i ) )
+                continue;
+
+            const State& state = states_[i];
+            switch( state.code ){
+                case ANY_SEQUENCE:
+                    Set( set, i + 1 );
+                    break;
+                case ALTERNATIVES:
+                    for( uint32_t j = state.begin; j < state.end; ++j )
+                        Set( set, targets_[j] );
+                    break;
+                case JUMP:
+                    Set( set, state.begin );
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    // the states reached from current by consuming c. returns false if
+    // there are none
+    bool Consume( const uint64_t *current, uint64_t *next, std::size_t wordCount, char c ) const
+    {
+        std::memset( next, 0, wordCount * sizeof(uint64_t) );
+        bool any = false;
+        for( std::size_t i=0; i < states_.size(); ++i ){
+            if( !Test( current, i ) )
+                continue;
+
+            const State& state = states_[i];
+            switch( state.code ){
+                case CHARACTER:
+                    if( c == state.c ){
+                        Set( next, i + 1 );
+                        any = true;
+                    }
+                    break;
+                case ANY_CHARACTER:
+                    if( c != '/' ){
+                        Set( next, i + 1 );
+                        any = true;
+                    }
+                    break;
+                case CHARACTER_SET:
+                    if( sets_[state.begin].test( (unsigned char)c ) ){
+                        Set( next, i + 1 );
+                        any = true;
+                    }
+                    break;
+                case ANY_SEQUENCE:
+                    if( c != '/' ){
+                        Set( next, i );
+                        any = true;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        if( any )
+            Follow( next );
+        return any;
+    }
+
+public:
+    explicit CompiledAddressPattern( const char *pattern )
+    {
+        valid_ = Compile( pattern );
+        isLiteral_ = valid_;
+        for( const State& state : states_ ){
+            if( state.code == CHARACTER )
+                literal_ += state.c;
+            else if( state.code != MATCH )
+                isLiteral_ = false;
+        }
+        if( !isLiteral_ )
+            literal_.clear();
+    }
+
+    bool IsValid() const { return valid_; }
+
+    // true if the pattern contains no special characters
+    bool IsLiteral() const { return isLiteral_; }
+
+    bool Matches( const char *address ) const
+    {
+        if( !valid_ )
+            return false;
+        if( isLiteral_ )
+            return literal_ == address;
+
+        // the current and next state sets, on the stack for most patterns
+        const std::size_t wordCount = ( states_.size() + 63 ) / 64;
+        const std::size_t LOCAL_WORD_COUNT = 4;
+        uint64_t local[ 2 * LOCAL_WORD_COUNT ];
+        std::vector<uint64_t> allocated;
+        uint64_t *current = local;
+        if( wordCount > LOCAL_WORD_COUNT ){
+            allocated.resize( 2 * wordCount );
+            current = &allocated[0];
+        }
+        uint64_t *next = current + wordCount;
+
+        std::memset( current, 0, wordCount * sizeof(uint64_t) );
+        Set( current, 0 );
+        Follow( current );
+
+        for( ; *address; ++address ){
+            if( !Consume( current, next, wordCount, *address ) )
+                return false;
+            std::swap( current, next );
+        }
+
+        return Test( current, states_.size() - 1 );
+    }
+};
+
+// returns true if the NUL terminated address matches the NUL terminated
+// pattern. the pattern is compiled for each call, so use a
+// CompiledAddressPattern to match one pattern against many addresses.
+inline bool MatchAddressPattern( const char *pattern, const char *address )
+{
+    return CompiledAddressPattern( pattern ).Matches( address );
+}
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_OSCADDRESSPATTERN_H */
@@ -0,0 +1,227 @@
+/*
+  oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+  The text above constitutes the entire oscpack license; however,
+  the oscpack developer(s) also make the following non-binding requests:
+
+  Any person wishing to distribute modifications to the Software is
+  requested to send the modifications to the original developer so that
+  they can be incorporated into the canonical version. It is also
+  requested that these non-binding requests be included whenever the
+  above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCADDRESSTABLE_H
+#define INCLUDED_OSCPACK_OSCADDRESSTABLE_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+namespace oscpack{
+
+namespace detail{
+
+// An OSC string viewed as a sequence of 32-bit words, ending with the
+// first word that contains the terminator. Any bytes following the
+// terminator in that word are cleared in lastWord so that non-zero
+// padding doesn't affect comparison.
+struct Str4Key{
+    const char *words;
+    std::size_t wordCount;
+    uint32_t lastWord;
+    uint32_t hash;
+};
+
+inline bool HasZeroByte( uint32_t x )
+{
+    return ((x - 0x01010101u) & ~x & 0x80808080u) != 0;
+}
+
+// s must be readable up to the 4 byte boundary following its terminator,
+// which is always the case for strings inside a validated received packet.
+inline Str4Key MakeStr4Key( const char *s )
+{
+    Str4Key result;
+    result.words = s;
+    result.wordCount = 0;
+
+    uint32_t h = 2166136261u;
+    for(;;){
+        uint32_t word;
+        std::memcpy( &word, s + result.wordCount * 4, 4 );
+        ++result.wordCount;
+
+        if( HasZeroByte( word ) ){
+            char c[4];
+            std::memcpy( c, &word, 4 );
+            bool terminated = false;
+            for( int i=0; i < 4; ++i ){
+                if( terminated )
+                    c[i] = '\0';
+                else if( c[i] == '\0' )
+                    terminated = true;
+            }
+            std::memcpy( &word, c, 4 );
+
+            result.lastWord = word;
+            h = (h ^ word) * 0x9E3779B1u;
+            break;
+        }
+
+        h = (h ^ word) * 0x9E3779B1u;
+        h ^= h >> 15;
+    }
+
+    h ^= h >> 16;
+    result.hash = h;
+    return result;
+}
+
+} // namespace detail
+
+
+// A flat, open-addressed hash table keyed by OSC address strings.
+// Keys are stored back to back in their 4-byte-padded wire form so that
+// Find() compares whole words against the address of a received message
+// without computing its length first. Entries are kept in insertion order
+// for ForEach().
+template< class Value >
+class AddressTable{
+    struct Entry{
+        uint32_t keyOffset;
+        uint32_t keyWordCount;
+        Value value;
+    };
+
+    struct Slot{
+        uint32_t hash;
+        uint32_t entry; // index + 1 into entries_, 0 for an empty slot
+    };
+
+    std::vector<char> keys_;
+    std::vector<Entry> entries_;
+    std::vector<Slot> slots_; // size is zero or a power of two
+
+    bool KeyEquals( const Entry& e, const detail::Str4Key& key ) const
+    {
+        if( e.keyWordCount != key.wordCount )
+            return false;
+
+        const char *k = &keys_[ e.keyOffset ];
+        std::size_t leadingBytes = (key.wordCount - 1) * 4;
+        return std::memcmp( k, key.words, leadingBytes ) == 0
+                && std::memcmp( k + leadingBytes, &key.lastWord, 4 ) == 0;
+    }
+
+    std::size_t FindSlot( const detail::Str4Key& key ) const
+    {
+        std::size_t mask = slots_.size() - 1;
+        std::size_t i = key.hash & mask;
+        while( slots_[i].entry != 0 ){
+            if( slots_[i].hash == key.hash
+                    && KeyEquals( entries_[ slots_[i].entry - 1 ], key ) )
+                break;
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    void Grow()
+    {
+        std::size_t newSize = slots_.empty() ? 16 : slots_.size() * 2;
+        std::vector<Slot> old( newSize, Slot{ 0, 0 } );
+        old.swap( slots_ );
+
+        std::size_t mask = newSize - 1;
+        for( std::size_t j=0; j < old.size(); ++j ){
+            if( old[j].entry == 0 )
+                continue;
+            std::size_t i = old[j].hash & mask;
+            while( slots_[i].entry != 0 )
+                i = (i + 1) & mask;
+            slots_[i] = old[j];
+        }
+    }
+
+public:
+    // returns false, leaving the existing value in place, if address
+    // is already present
+    bool Insert( const char *address, const Value& value )
+    {
+        // copy the address into its padded form before hashing it
+        std::size_t length = std::strlen( address );
+        std::size_t paddedLength = (length + 4) & ~(std::size_t)3;
+        std::size_t offset = keys_.size();
+        keys_.resize( offset + paddedLength, '\0' );
+        std::memcpy( &keys_[offset], address, length );
+
+        detail::Str4Key key = detail::MakeStr4Key( &keys_[offset] );
+
+        if( (entries_.size() + 1) * 2 > slots_.size() )
+            Grow();
+
+        std::size_t i = FindSlot( key );
+        if( slots_[i].entry != 0 ){
+            keys_.resize( offset );
+            return false;
+        }
+
+        entries_.push_back( Entry{ (uint32_t)offset, (uint32_t)key.wordCount, value } );
+        slots_[i].hash = key.hash;
+        slots_[i].entry = (uint32_t)entries_.size();
+        return true;
+    }
+
+    // paddedAddress must be readable up to the 4 byte boundary following
+    // its terminator, see detail::MakeStr4Key(). returns 0 if not found.
+    const Value* Find( const char *paddedAddress ) const
+    {
+        if( entries_.empty() )
+            return 0;
+
+        std::size_t i = FindSlot( detail::MakeStr4Key( paddedAddress ) );
+        if( slots_[i].entry == 0 )
+            return 0;
+        return &entries_[ slots_[i].entry - 1 ].value;
+    }
+
+    // calls f( const char *address, const Value& value ) for each entry
+    template< class F >
+    void ForEach( F f ) const
+    {
+        for( const Entry& e : entries_ )
+            f( &keys_[ e.keyOffset ], e.value );
+    }
+
+    std::size_t Size() const { return entries_.size(); }
+    bool Empty() const { return entries_.empty(); }
+};
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_OSCADDRESSTABLE_H */
@@ -0,0 +1,264 @@
+/*
+  oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+  The text above constitutes the entire oscpack license; however,
+  the oscpack developer(s) also make the following non-binding requests:
+
+  Any person wishing to distribute modifications to the Software is
+  requested to send the modifications to the original developer so that
+  they can be incorporated into the canonical version. It is also
+  requested that these non-binding requests be included whenever the
+  above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCALLOCATORS_H
+#define INCLUDED_OSCPACK_OSCALLOCATORS_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+
+namespace oscpack{
+
+// Allocation without the global heap, for retaining received messages on
+// real-time threads (see BasicOwnedMessage).
+//
+// FixedBlockPool and BumpArena return 0 when they can't satisfy a request.
+// PoolAllocator and ArenaAllocator then fall back to operator new, so an
+// undersized pool degrades to heap allocation rather than failing.
+
+
+// A pool of equally sized blocks allocated up front. Allocate() and
+// Deallocate() are lock-free and may be called from any thread.
+class FixedBlockPool{
+    std::size_t blockSize_;
+    std::size_t blockCount_;
+    std::unique_ptr<char[]> storage_;
+
+    // each free block stores the index + 1 of the next free block,
+    // 0 terminates the list
+    std::unique_ptr< std::atomic<uint32_t>[] > next_;
+
+    // free list head: a change counter in the upper 32 bits (to prevent
+    // ABA problems) and the index + 1 of the first free block in the lower
+    std::atomic<uint64_t> head_;
+
+    static uint64_t MakeHead( uint64_t previous, uint32_t index )
+    {
+        return ((previous >> 32) + 1) << 32 | index;
+    }
+
+public:
+    FixedBlockPool( std::size_t blockSize, std::size_t blockCount )
+        : blockSize_( (blockSize + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1) )
+        , blockCount_( blockCount )
+        , storage_( new char[ blockSize_ * blockCount ] )
+        , next_( new std::atomic<uint32_t>[ blockCount ] )
+        , head_( blockCount > 0 ? 1 : 0 )
+    {
+        assert( blockSize > 0 );
+        assert( blockCount < 0xFFFFFFFFu );
+
+        for( std::size_t i=0; i < blockCount; ++i )
+            next_[i].store( (i + 1 < blockCount) ? (uint32_t)(i + 2) : 0, std::memory_order_relaxed );
+    }
+
+    FixedBlockPool( const FixedBlockPool& ) = delete;
+    FixedBlockPool& operator=( const FixedBlockPool& ) = delete;
+
+    // returns 0 if the pool is exhausted
+    void* Allocate()
+    {
+        uint64_t head = head_.load( std::memory_order_acquire );
+        for(;;){
+            uint32_t index = (uint32_t)head;
+            if( index == 0 )
+                return 0;
+
+            uint32_t next = next_[index - 1].load( std::memory_order_relaxed );
+            if( head_.compare_exchange_weak( head, MakeHead( head, next ),
+                    std::memory_order_acq_rel, std::memory_order_acquire ) )
+                return storage_.get() + (index - 1) * blockSize_;
+        }
+    }
+
+    // p must have been returned by Allocate()
+    void Deallocate( void *p )
+    {
+        assert( Owns( p ) );
+
+        uint32_t index = (uint32_t)(((char*)p - storage_.get()) / blockSize_) + 1;
+        uint64_t head = head_.load( std::memory_order_relaxed );
+        do{
+            next_[index - 1].store( (uint32_t)head, std::memory_order_relaxed );
+        }while( !head_.compare_exchange_weak( head, MakeHead( head, index ),
+                std::memory_order_release, std::memory_order_relaxed ) );
+    }
+
+    bool Owns( const void *p ) const
+    {
+        const char *c = static_cast<const char*>( p );
+        return c >= storage_.get() && c < storage_.get() + blockSize_ * blockCount_;
+    }
+
+    std::size_t BlockSize() const { return blockSize_; }
+    std::size_t BlockCount() const { return blockCount_; }
+};
+
+
+// A region which is allocated from by advancing a pointer and freed all
+// at once by Reset(), e.g. once per audio block. Not thread safe.
+class BumpArena{
+    std::unique_ptr<char[]> storage_;
+    std::size_t capacity_;
+    std::size_t used_;
+
+public:
+    explicit BumpArena( std::size_t capacity )
+        : storage_( new char[ capacity ] )
+        , capacity_( capacity )
+        , used_( 0 ) {}
+
+    BumpArena( const BumpArena& ) = delete;
+    BumpArena& operator=( const BumpArena& ) = delete;
+
+    // returns 0 if there isn't enough space left. alignment must be a
+    // power of two no greater than alignof(std::max_align_t)
+    void* Allocate( std::size_t size, std::size_t alignment=alignof(std::max_align_t) )
+    {
+        std::size_t offset = (used_ + alignment - 1) & ~(alignment - 1);
+        if( offset > capacity_ || size > capacity_ - offset )
+            return 0;
+
+        used_ = offset + size;
+        return storage_.get() + offset;
+    }
+
+    // releases every allocation. nothing allocated from the arena may be
+    // used afterwards.
+    void Reset() { used_ = 0; }
+
+    bool Owns( const void *p ) const
+    {
+        const char *c = static_cast<const char*>( p );
+        return c >= storage_.get() && c < storage_.get() + capacity_;
+    }
+
+    std::size_t Used() const { return used_; }
+    std::size_t Capacity() const { return capacity_; }
+};
+
+
+// Standard allocator which takes memory from a FixedBlockPool. Requests
+// larger than the pool's block size, or made when the pool is exhausted,
+// are satisfied with operator new.
+template< class T >
+class PoolAllocator{
+    FixedBlockPool *pool_;
+
+    template< class U > friend class PoolAllocator;
+
+public:
+    typedef T value_type;
+
+    explicit PoolAllocator( FixedBlockPool *pool ) : pool_( pool ) {}
+
+    template< class U >
+    PoolAllocator( const PoolAllocator<U>& other ) : pool_( other.pool_ ) {}
+
+    T* allocate( std::size_t n )
+    {
+        void *p = 0;
+        if( n * sizeof(T) <= pool_->BlockSize() )
+            p = pool_->Allocate();
+        if( !p )
+            p = ::operator new( n * sizeof(T) );
+        return static_cast<T*>( p );
+    }
+
+    void deallocate( T *p, std::size_t )
+    {
+        if( pool_->Owns( p ) )
+            pool_->Deallocate( p );
+        else
+            ::operator delete( p );
+    }
+
+    FixedBlockPool* Pool() const { return pool_; }
+
+    template< class U >
+    bool operator==( const PoolAllocator<U>& rhs ) const { return pool_ == rhs.pool_; }
+    template< class U >
+    bool operator!=( const PoolAllocator<U>& rhs ) const { return pool_ != rhs.pool_; }
+};
+
+
+// Standard allocator which takes memory from a BumpArena. deallocate()
+// does nothing for arena memory, it is reclaimed by BumpArena::Reset().
+// When the arena is full, operator new is used instead.
+template< class T >
+class ArenaAllocator{
+    BumpArena *arena_;
+
+    template< class U > friend class ArenaAllocator;
+
+public:
+    typedef T value_type;
+
+    explicit ArenaAllocator( BumpArena *arena ) : arena_( arena ) {}
+
+    template< class U >
+    ArenaAllocator( const ArenaAllocator<U>& other ) : arena_( other.arena_ ) {}
+
+    T* allocate( std::size_t n )
+    {
+        void *p = arena_->Allocate( n * sizeof(T), alignof(T) );
+        if( !p )
+            p = ::operator new( n * sizeof(T) );
+        return static_cast<T*>( p );
+    }
+
+    void deallocate( T *p, std::size_t )
+    {
+        if( !arena_->Owns( p ) )
+            ::operator delete( p );
+    }
+
+    BumpArena* Arena() const { return arena_; }
+
+    template< class U >
+    bool operator==( const ArenaAllocator<U>& rhs ) const { return arena_ == rhs.arena_; }
+    template< class U >
+    bool operator!=( const ArenaAllocator<U>& rhs ) const { return arena_ != rhs.arena_; }
+};
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_OSCALLOCATORS_H */
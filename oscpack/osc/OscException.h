@@ -37,8 +37,20 @@
 #ifndef INCLUDED_OSCPACK_OSCEXCEPTION_H
 #define INCLUDED_OSCPACK_OSCEXCEPTION_H
 
+#include <cstdlib>
 #include <exception>
 
+// the receive side (OscReceivedElements.h) throws through OSCPACK_THROW so
+// that it can be built with exceptions disabled (e.g. -fno-exceptions). in
+// such builds errors that would throw call std::abort() instead, use the
+// non-throwing TryParse() and TryAs*() functions to avoid them.
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define OSCPACK_HAS_EXCEPTIONS 1
+#define OSCPACK_THROW( e ) throw e
+#else
+#define OSCPACK_THROW( e ) std::abort()
+#endif
+
 namespace oscpack{
 
 class Exception : public std::exception {
@@ -0,0 +1,154 @@
+/*
+  oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+  The text above constitutes the entire oscpack license; however,
+  the oscpack developer(s) also make the following non-binding requests:
+
+  Any person wishing to distribute modifications to the Software is
+  requested to send the modifications to the original developer so that
+  they can be incorporated into the canonical version. It is also
+  requested that these non-binding requests be included whenever the
+  above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCGROWABLEOUTBOUNDPACKETSTREAM_H
+#define INCLUDED_OSCPACK_OSCGROWABLEOUTBOUNDPACKETSTREAM_H
+
+#include <cstddef>
+#include <memory>
+
+#include "OscOutboundPacketStream.h"
+
+
+namespace oscpack{
+
+namespace detail{
+
+// owns the buffer of a BasicGrowableOutboundPacketStream. a base class so
+// that the buffer exists before the OutboundPacketStream is constructed.
+template< class Allocator >
+class GrowableStreamBuffer{
+protected:
+    typedef std::allocator_traits<Allocator> traits_type;
+
+    Allocator allocator_;
+    char *buffer_;
+    std::size_t bufferCapacity_;
+
+    GrowableStreamBuffer( std::size_t capacity, const Allocator& allocator )
+        : allocator_( allocator )
+        , buffer_( traits_type::allocate( allocator_, capacity ) )
+        , bufferCapacity_( capacity ) {}
+
+    ~GrowableStreamBuffer()
+    {
+        traits_type::deallocate( allocator_, buffer_, bufferCapacity_ );
+    }
+
+    GrowableStreamBuffer( const GrowableStreamBuffer& ) = delete;
+    GrowableStreamBuffer& operator=( const GrowableStreamBuffer& ) = delete;
+};
+
+} // namespace detail
+
+
+// An OutboundPacketStream which owns its buffer. The buffer starts at
+// initialCapacity bytes and at least doubles whenever more space is
+// needed, up to maximumCapacity, beyond which OutOfBufferMemoryException
+// is thrown as usual. Growing invalidates pointers returned by Data().
+//
+// Clear() keeps the buffer, so a long-lived stream settles at the size of
+// the largest packet written to it:
+//
+//     GrowableOutboundPacketStream ps;
+//     ps << BeginBundleImmediate();
+//     for( const Voice& v : voices )
+//         ps << BeginMessage( "/voice" ) << v.id << v.gain << EndMessage();
+//     ps << EndBundle();
+//     socket.Send( ps.Data(), ps.Size() );
+template< class Allocator = std::allocator<char> >
+class BasicGrowableOutboundPacketStream
+        : private detail::GrowableStreamBuffer<Allocator>
+        , public OutboundPacketStream{
+
+    typedef detail::GrowableStreamBuffer<Allocator> buffer_type;
+
+    std::size_t maximumCapacity_;
+
+    void Reallocate( std::size_t capacity )
+    {
+        char *buffer = buffer_type::traits_type::allocate( this->allocator_, capacity );
+        Rebase( buffer, capacity );
+        buffer_type::traits_type::deallocate( this->allocator_, this->buffer_, this->bufferCapacity_ );
+
+        this->buffer_ = buffer;
+        this->bufferCapacity_ = capacity;
+    }
+
+protected:
+    bool GrowBuffer( std::size_t requiredCapacity ) override
+    {
+        if( requiredCapacity > maximumCapacity_ )
+            return false;
+
+        std::size_t capacity = Capacity();
+        capacity = (capacity > maximumCapacity_ / 2) ? maximumCapacity_ : capacity * 2;
+        if( capacity < requiredCapacity )
+            capacity = requiredCapacity;
+
+        Reallocate( capacity );
+        return true;
+    }
+
+public:
+    explicit BasicGrowableOutboundPacketStream( std::size_t initialCapacity=256,
+            std::size_t maximumCapacity=0x7FFFFFFF, const Allocator& allocator=Allocator() )
+        : buffer_type( initialCapacity, allocator )
+        , OutboundPacketStream( this->buffer_, initialCapacity )
+        , maximumCapacity_( maximumCapacity )
+    {
+        assert( initialCapacity > 0 && initialCapacity <= maximumCapacity );
+    }
+
+    // grow the buffer to at least capacity bytes now, rather than while
+    // writing. throws OutOfBufferMemoryException if capacity exceeds
+    // MaximumCapacity()
+    void Reserve( std::size_t capacity )
+    {
+        if( capacity > maximumCapacity_ )
+            throw OutOfBufferMemoryException();
+        if( capacity > Capacity() )
+            Reallocate( capacity );
+    }
+
+    std::size_t MaximumCapacity() const { return maximumCapacity_; }
+};
+
+typedef BasicGrowableOutboundPacketStream<> GrowableOutboundPacketStream;
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_OSCGROWABLEOUTBOUNDPACKETSTREAM_H */
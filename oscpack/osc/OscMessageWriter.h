@@ -0,0 +1,108 @@
+/*
+  oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+  The text above constitutes the entire oscpack license; however,
+  the oscpack developer(s) also make the following non-binding requests:
+
+  Any person wishing to distribute modifications to the Software is
+  requested to send the modifications to the original developer so that
+  they can be incorporated into the canonical version. It is also
+  requested that these non-binding requests be included whenever the
+  above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCMESSAGEWRITER_H
+#define INCLUDED_OSCPACK_OSCMESSAGEWRITER_H
+
+#include <cstring>
+#include <string>
+
+#include "OscOutboundPacketStream.h"
+#include "OscTypesTraits.h"
+
+
+namespace oscpack{
+
+// Writes messages of a fixed shape: an address pattern given on
+// construction and arguments of types Ts. The type tag string and the size
+// of the fixed-size arguments are computed at compile time, the padded
+// address pattern and type tags once on construction, so writing a message
+// takes a single bounds check and no per-argument type tag handling.
+//
+//     MessageWriter<int32_t, float, float> fader( "/fader" );
+//     fader.Write( ps, channel, x, y );
+//
+// Supported argument types are those with an OscArgumentTraits
+// specialization (see OscTypesTraits.h).
+template< class... Ts >
+class MessageWriter{
+    // slot size includes comma and null terminator
+    static constexpr std::size_t typeTagSlotSize_ = (sizeof...(Ts) + 2 + 3) & ~(std::size_t)3;
+    static constexpr std::size_t fixedArgumentsSize_ = (std::size_t(0) + ... + OscArgumentTraits<Ts>::fixed_size);
+
+    std::string prefix_; // padded address pattern followed by padded type tags
+
+public:
+    explicit MessageWriter( const char *addressPattern )
+    {
+        std::size_t addressPatternLength = std::strlen( addressPattern );
+        std::size_t addressPatternSlotSize = RoundUp4( (uint32_t)addressPatternLength + 1 );
+
+        prefix_.assign( addressPatternSlotSize + typeTagSlotSize_, '\0' );
+        std::memcpy( &prefix_[0], addressPattern, addressPatternLength );
+
+        const char typeTags[] = { ',', OscArgumentTraits<Ts>::type_tag... };
+        std::memcpy( &prefix_[addressPatternSlotSize], typeTags, sizeof(typeTags) );
+    }
+
+    // the encoded size of a message with these arguments, not including
+    // the size slot of a bundle element
+    std::size_t Size( const Ts&... args ) const
+    {
+        return prefix_.size() + fixedArgumentsSize_
+                + (std::size_t(0) + ... + OscArgumentTraits<Ts>::VariableSize( args ));
+    }
+
+    // Append a message to ps, in the open bundle if there is one. Throws
+    // OutOfBufferMemoryException if the message doesn't fit, and
+    // MessageInProgressException if ps is in the middle of a message.
+    void Write( OutboundPacketStream& ps, const Ts&... args ) const
+    {
+        char *p = ps.ReserveMessage( Size( args... ) );
+
+        std::memcpy( p, prefix_.data(), prefix_.size() );
+        p += prefix_.size();
+
+        ((p = OscArgumentTraits<Ts>::Write( p, args )), ...);
+        (void) p; // suppress unused variable warning when there are no arguments
+    }
+
+    const char *AddressPattern() const { return prefix_.c_str(); }
+};
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_OSCMESSAGEWRITER_H */
@@ -86,6 +86,13 @@ public:
         : Exception( w ) {}
 };
 
+class TypeTagMismatchException : public Exception{
+public:
+    TypeTagMismatchException(
+            const char *w="argument doesn't match the type tags given to BeginTypedMessage" )
+        : Exception( w ) {}
+};
+
 class MessageNotInProgressException : public Exception{
 public:
     MessageNotInProgressException(
@@ -114,6 +121,7 @@ public:
       , messageCursor_( data_ )
       , argumentCurrent_( data_ )
       , elementSizePtr_( 0 )
+      , typeTagCursor_( 0 )
       , messageIsInProgress_( false )
     {
       // sanity check integer types declared in OscTypes.h
@@ -123,7 +131,7 @@ public:
       assert( sizeof(int64_t) == 8 );
       assert( sizeof(uint64_t) == 8 );
     }
-    ~OutboundPacketStream()
+    virtual ~OutboundPacketStream()
     {
 
     }
@@ -134,6 +142,7 @@ public:
       messageCursor_ = data_;
       argumentCurrent_ = data_;
       elementSizePtr_ = 0;
+      typeTagCursor_ = 0;
       messageIsInProgress_ = false;
     }
 
@@ -146,7 +155,7 @@ public:
     std::size_t Size() const
     {
       std::size_t result = argumentCurrent_ - data_;
-      if( IsMessageInProgress() ){
+      if( IsMessageInProgress() && !typeTagCursor_ ){
         // account for the length of the type tag string. the total type tag
         // includes an initial comma, plus at least one terminating \0
         result += RoundUp4( (end_ - typeTagsCurrent_) + 2 );
@@ -176,6 +185,31 @@ public:
       return (elementSizePtr_ != 0);
     }
 
+    // Discard the message in progress, e.g. after an exception while
+    // writing its arguments, and restore the stream to its state before
+    // the BeginMessage. Throws MessageNotInProgressException if there is
+    // no message in progress.
+    void RollbackMessage()
+    {
+      if( !IsMessageInProgress() )
+        throw MessageNotInProgressException( "call to RollbackMessage when message is not in progress" );
+
+      // undo BeginElement(). the message's size slot still holds the
+      // offset of the containing element's slot
+      if( elementSizePtr_ == reinterpret_cast<uint32_t*>(data_) ){
+        messageCursor_ = data_;
+        elementSizePtr_ = 0;
+      }else{
+        messageCursor_ = reinterpret_cast<char*>(elementSizePtr_);
+        elementSizePtr_ = reinterpret_cast<uint32_t*>(data_ + *elementSizePtr_);
+      }
+
+      argumentCurrent_ = messageCursor_;
+      typeTagsCurrent_ = end_;
+      typeTagCursor_ = 0;
+      messageIsInProgress_ = false;
+    }
+
 
     template<typename T, typename std::enable_if_t<!std::is_same<char, std::remove_const_t<T>>::value>* = nullptr>
     OutboundPacketStream& operator<<( T* rhs ) = delete;
@@ -268,6 +302,43 @@ public:
 
       return *this;
     }
+    OutboundPacketStream& operator<<(BeginTypedMessage rhs )
+    {
+        if( IsMessageInProgress() )
+            throw MessageInProgressException();
+
+        const char *typeTags = rhs.typeTags;
+        if( *typeTags == ',' )
+            ++typeTags;
+
+        std::size_t addressPatternLength = std::strlen(rhs.addressPattern);
+        std::size_t addressPatternSlotSize = RoundUp4( addressPatternLength + 1 );
+        std::size_t typeTagsLength = std::strlen(typeTags);
+        // slot size includes comma and null terminator
+        std::size_t typeTagSlotSize = RoundUp4( typeTagsLength + 2 );
+        CheckForAvailableTypedMessageSpace( addressPatternSlotSize + typeTagSlotSize );
+
+        messageCursor_ = BeginElement( messageCursor_ );
+
+        // zero the last word of each slot for padding, then copy the strings over
+        char *p = messageCursor_;
+        std::memset( p + addressPatternSlotSize - 4, 0, 4 );
+        std::memcpy( p, rhs.addressPattern, addressPatternLength );
+        p += addressPatternSlotSize;
+
+        std::memset( p + typeTagSlotSize - 4, 0, 4 );
+        p[0] = ',';
+        std::memcpy( p + 1, typeTags, typeTagsLength );
+
+        typeTagCursor_ = p + 1;
+        argumentCurrent_ = p + typeTagSlotSize;
+        typeTagsCurrent_ = end_;
+
+        messageIsInProgress_ = true;
+
+        return *this;
+    }
+
     OutboundPacketStream& operator<<(MessageTerminator rhs )
     {
         (void) rhs;
@@ -275,6 +346,21 @@ public:
         if( !IsMessageInProgress() )
             throw MessageNotInProgressException();
 
+        if( typeTagCursor_ ){
+            // the type tags and arguments are already in place
+            if( *typeTagCursor_ != '\0' )
+                throw TypeTagMismatchException( "fewer arguments than type tags given to BeginTypedMessage" );
+
+            typeTagCursor_ = 0;
+            messageCursor_ = argumentCurrent_;
+
+            EndElement( messageCursor_ );
+
+            messageIsInProgress_ = false;
+
+            return *this;
+        }
+
         std::size_t typeTagsCount = end_ - typeTagsCurrent_;
 
         if( typeTagsCount ){
@@ -291,8 +377,7 @@ public:
 
             messageCursor_[0] = ',';
             // copy type tags in reverse (really forward) order
-            for( std::size_t i=0; i < typeTagsCount; ++i )
-                messageCursor_[i+1] = tempTypeTags[ (typeTagsCount-1) - i ];
+            detail::CopyReversed( messageCursor_ + 1, tempTypeTags, typeTagsCount );
 
             char *p = messageCursor_ + 1 + typeTagsCount;
             for( std::size_t i=0; i < (typeTagSlotSize - (typeTagsCount + 1)); ++i )
@@ -325,7 +410,7 @@ public:
     {
         CheckForAvailableArgumentSpace(0);
 
-        *(--typeTagsCurrent_) = (char)((rhs) ? TRUE_TYPE_TAG : FALSE_TYPE_TAG);
+        WriteTypeTag( (char)((rhs) ? TRUE_TYPE_TAG : FALSE_TYPE_TAG) );
 
         return *this;
     }
@@ -335,7 +420,7 @@ public:
         (void) rhs;
         CheckForAvailableArgumentSpace(0);
 
-        *(--typeTagsCurrent_) = INFINITUM_TYPE_TAG;
+        WriteTypeTag( INFINITUM_TYPE_TAG );
 
         return *this;
     }
@@ -345,7 +430,7 @@ public:
         (void) rhs;
         CheckForAvailableArgumentSpace(0);
 
-        *(--typeTagsCurrent_) = NIL_TYPE_TAG;
+        WriteTypeTag( NIL_TYPE_TAG );
 
         return *this;
     }
@@ -355,7 +440,7 @@ public:
     {
         CheckForAvailableArgumentSpace(4);
 
-        *(--typeTagsCurrent_) = INT32_TYPE_TAG;
+        WriteTypeTag( INT32_TYPE_TAG );
         FromInt32( argumentCurrent_, rhs );
         argumentCurrent_ += 4;
 
@@ -366,7 +451,7 @@ public:
     {
         CheckForAvailableArgumentSpace(4);
 
-        *(--typeTagsCurrent_) = FLOAT_TYPE_TAG;
+        WriteTypeTag( FLOAT_TYPE_TAG );
 
     #ifdef OSC_HOST_LITTLE_ENDIAN
         union{
@@ -392,7 +477,7 @@ public:
     {
         CheckForAvailableArgumentSpace(4);
 
-        *(--typeTagsCurrent_) = CHAR_TYPE_TAG;
+        WriteTypeTag( CHAR_TYPE_TAG );
         FromInt32( argumentCurrent_, rhs );
         argumentCurrent_ += 4;
 
@@ -403,7 +488,7 @@ public:
     {
         CheckForAvailableArgumentSpace(4);
 
-        *(--typeTagsCurrent_) = RGBA_COLOR_TYPE_TAG;
+        WriteTypeTag( RGBA_COLOR_TYPE_TAG );
         FromUInt32( argumentCurrent_, rhs );
         argumentCurrent_ += 4;
 
@@ -414,7 +499,7 @@ public:
     {
         CheckForAvailableArgumentSpace(4);
 
-        *(--typeTagsCurrent_) = MIDI_MESSAGE_TYPE_TAG;
+        WriteTypeTag( MIDI_MESSAGE_TYPE_TAG );
         FromUInt32( argumentCurrent_, rhs );
         argumentCurrent_ += 4;
 
@@ -426,7 +511,7 @@ public:
     {
         CheckForAvailableArgumentSpace(8);
 
-        *(--typeTagsCurrent_) = INT64_TYPE_TAG;
+        WriteTypeTag( INT64_TYPE_TAG );
         FromInt64( argumentCurrent_, rhs );
         argumentCurrent_ += 8;
 
@@ -437,7 +522,7 @@ public:
     {
         CheckForAvailableArgumentSpace(8);
 
-        *(--typeTagsCurrent_) = TIME_TAG_TYPE_TAG;
+        WriteTypeTag( TIME_TAG_TYPE_TAG );
         FromUInt64( argumentCurrent_, rhs );
         argumentCurrent_ += 8;
 
@@ -448,7 +533,7 @@ public:
     {
         CheckForAvailableArgumentSpace(8);
 
-        *(--typeTagsCurrent_) = DOUBLE_TYPE_TAG;
+        WriteTypeTag( DOUBLE_TYPE_TAG );
 
     #ifdef OSC_HOST_LITTLE_ENDIAN
         union{
@@ -480,7 +565,7 @@ public:
     {
       CheckForAvailableArgumentSpace( RoundUp4(rhs.size() + 1) );
 
-      *(--typeTagsCurrent_) = STRING_TYPE_TAG;
+      WriteTypeTag( STRING_TYPE_TAG );
       if(!rhs.empty())
         std::memcpy( argumentCurrent_, rhs.data(), rhs.size() );
       argumentCurrent_ += rhs.size();
@@ -509,7 +594,7 @@ public:
     {
       CheckForAvailableArgumentSpace( RoundUp4(N) );
 
-      *(--typeTagsCurrent_) = STRING_TYPE_TAG;
+      WriteTypeTag( STRING_TYPE_TAG );
       std::memcpy( argumentCurrent_, ref, N );
       argumentCurrent_ += N; // already 0-terminated
 
@@ -528,7 +613,7 @@ public:
     {
         CheckForAvailableArgumentSpace( RoundUp4(std::strlen(rhs) + 1) );
 
-        *(--typeTagsCurrent_) = SYMBOL_TYPE_TAG;
+        WriteTypeTag( SYMBOL_TYPE_TAG );
         std::strcpy( argumentCurrent_, rhs );
         std::size_t rhsLength = std::strlen(rhs);
         argumentCurrent_ += rhsLength + 1;
@@ -547,7 +632,7 @@ public:
     {
         CheckForAvailableArgumentSpace( 4 + RoundUp4(rhs.size) );
 
-        *(--typeTagsCurrent_) = BLOB_TYPE_TAG;
+        WriteTypeTag( BLOB_TYPE_TAG );
         FromUInt32( argumentCurrent_, rhs.size );
         argumentCurrent_ += 4;
 
@@ -569,7 +654,7 @@ public:
         (void) rhs;
         CheckForAvailableArgumentSpace(0);
 
-        *(--typeTagsCurrent_) = ARRAY_BEGIN_TYPE_TAG;
+        WriteTypeTag( ARRAY_BEGIN_TYPE_TAG );
 
         return *this;
     }
@@ -579,14 +664,117 @@ public:
         (void) rhs;
         CheckForAvailableArgumentSpace(0);
 
-        *(--typeTagsCurrent_) = ARRAY_END_TYPE_TAG;
+        WriteTypeTag( ARRAY_END_TYPE_TAG );
 
         return *this;
     }
 
 
+    // Write count float or int32 arguments at once, which is faster than
+    // streaming them one at a time: the space is checked once, the type
+    // tags written with a single memset and the values converted to
+    // network byte order as a block. The Array versions enclose the values
+    // in BeginArray()/EndArray() brackets.
+
+    OutboundPacketStream& WriteFloats( const float *values, std::size_t count )
+    {
+        WriteValues32( FLOAT_TYPE_TAG, values, count, false );
+        return *this;
+    }
+
+    OutboundPacketStream& WriteInt32s( const int32_t *values, std::size_t count )
+    {
+        WriteValues32( INT32_TYPE_TAG, values, count, false );
+        return *this;
+    }
+
+    OutboundPacketStream& WriteFloatArray( const float *values, std::size_t count )
+    {
+        WriteValues32( FLOAT_TYPE_TAG, values, count, true );
+        return *this;
+    }
+
+    OutboundPacketStream& WriteInt32Array( const int32_t *values, std::size_t count )
+    {
+        WriteValues32( INT32_TYPE_TAG, values, count, true );
+        return *this;
+    }
+
+
+    // Reserve space for a complete message of messageSize bytes (a multiple
+    // of 4) in the current bundle, or as the packet if no bundle is open,
+    // and return a pointer to it for the caller to encode the message into.
+    // Used by encoders which know the message size up front, such as
+    // MessageWriter, to bounds check once per message.
+    char *ReserveMessage( std::size_t messageSize )
+    {
+        if( IsMessageInProgress() )
+            throw MessageInProgressException();
+
+        assert( (messageSize & 0x3) == 0 );
+
+        std::size_t required = Size() + ((ElementSizeSlotRequired())?4:0) + messageSize;
+        CheckCapacity( required );
+
+        messageCursor_ = BeginElement( messageCursor_ );
+        char *result = messageCursor_;
+
+        messageCursor_ += messageSize;
+        argumentCurrent_ = messageCursor_;
+
+        EndElement( messageCursor_ );
+
+        return result;
+    }
+
+
+protected:
+
+    // Called when an operation needs requiredCapacity bytes of buffer
+    // space in total. A subclass may move the stream to a larger buffer
+    // with Rebase() and return true; the default returns false, causing
+    // OutOfBufferMemoryException to be thrown.
+    virtual bool GrowBuffer( std::size_t requiredCapacity )
+    {
+      (void) requiredCapacity;
+      return false;
+    }
+
+    // Copy the stream's contents to buffer, which has room for at least
+    // the bytes written so far plus the pending type tags, and continue
+    // writing there. Pointers previously returned by Data() become invalid.
+    void Rebase( char *buffer, std::size_t capacity )
+    {
+      std::size_t used = argumentCurrent_ - data_;
+      std::size_t typeTagsCount = end_ - typeTagsCurrent_;
+      assert( used + typeTagsCount <= capacity );
+
+      std::memcpy( buffer, data_, used );
+      std::memcpy( buffer + capacity - typeTagsCount, typeTagsCurrent_, typeTagsCount );
+
+      // the element size slots hold offsets from data_, so only the
+      // pointers need to be moved
+      messageCursor_ = buffer + (messageCursor_ - data_);
+      argumentCurrent_ = buffer + used;
+      if( elementSizePtr_ )
+        elementSizePtr_ = reinterpret_cast<uint32_t*>(
+            buffer + (reinterpret_cast<char*>(elementSizePtr_) - data_));
+      if( typeTagCursor_ )
+        typeTagCursor_ = buffer + (typeTagCursor_ - data_);
+
+      data_ = buffer;
+      end_ = buffer + capacity;
+      typeTagsCurrent_ = end_ - typeTagsCount;
+    }
+
 private:
 
+    void CheckCapacity( std::size_t required )
+    {
+      if( required > Capacity() && (!GrowBuffer( required ) || required > Capacity()) )
+        throw OutOfBufferMemoryException();
+    }
+
     char *BeginElement( char *beginPtr )
     {
       if( elementSizePtr_ == 0 ){
@@ -635,6 +823,47 @@ private:
       }
     }
 
+    void WriteTypeTag( char typeTag )
+    {
+      if( typeTagCursor_ ){
+        // the terminator never matches, so this also catches excess arguments
+        if( *typeTagCursor_ != typeTag )
+          throw TypeTagMismatchException();
+        ++typeTagCursor_;
+      }else{
+        *(--typeTagsCurrent_) = typeTag;
+      }
+    }
+
+    // write count copies of typeTag
+    void WriteTypeTags( char typeTag, std::size_t count )
+    {
+      if( typeTagCursor_ ){
+        // (the declared type tags are followed by at least count bytes of
+        // their slot and argument space, which was checked by the caller)
+        if( detail::CountLeadingBytes( typeTagCursor_, count, typeTag ) != count )
+          throw TypeTagMismatchException();
+        typeTagCursor_ += count;
+      }else{
+        typeTagsCurrent_ -= count;
+        std::memset( typeTagsCurrent_, typeTag, count );
+      }
+    }
+
+    void WriteValues32( char typeTag, const void *values, std::size_t count, bool brackets )
+    {
+      CheckForAvailableArgumentSpace( count * 4, count + (brackets ? 2 : 0) );
+
+      if( brackets )
+        WriteTypeTag( ARRAY_BEGIN_TYPE_TAG );
+      WriteTypeTags( typeTag, count );
+      if( brackets )
+        WriteTypeTag( ARRAY_END_TYPE_TAG );
+
+      FromUInt32s( argumentCurrent_, values, count );
+      argumentCurrent_ += count * 4;
+    }
+
     bool ElementSizeSlotRequired() const
     {
       return (elementSizePtr_ != 0);
@@ -643,8 +872,7 @@ private:
     {
       std::size_t required = Size() + ((ElementSizeSlotRequired())?4:0) + 16;
 
-      if( required > Capacity() )
-        throw OutOfBufferMemoryException();
+      CheckCapacity( required );
     }
     void CheckForAvailableMessageSpace( std::size_t addressPatternSize )
     {
@@ -652,21 +880,28 @@ private:
       std::size_t required = Size() + ((ElementSizeSlotRequired())?4:0)
           + RoundUp4(addressPatternSize + 1) + 4;
 
-      if( required > Capacity() )
-        throw OutOfBufferMemoryException();
+      CheckCapacity( required );
     }
-    void CheckForAvailableArgumentSpace( std::size_t argumentLength )
+    void CheckForAvailableTypedMessageSpace( std::size_t slotsSize )
     {
-      // plus three for extra type tag, comma and null terminator
-      std::size_t required = (argumentCurrent_ - data_) + argumentLength
-          + RoundUp4( (end_ - typeTagsCurrent_) + 3 );
+      std::size_t required = Size() + ((ElementSizeSlotRequired())?4:0) + slotsSize;
 
-      if( required > Capacity() )
-        throw OutOfBufferMemoryException();
+      CheckCapacity( required );
+    }
+    void CheckForAvailableArgumentSpace( std::size_t argumentLength, std::size_t typeTagCount=1 )
+    {
+      std::size_t required = (argumentCurrent_ - data_) + argumentLength;
+
+      // plus the extra type tags, comma and null terminator, unless
+      // the type tags were written by BeginTypedMessage
+      if( !typeTagCursor_ )
+        required += RoundUp4( (end_ - typeTagsCurrent_) + typeTagCount + 2 );
+
+      CheckCapacity( required );
     }
 
-    char * const data_;
-    char * const end_;
+    char *data_;
+    char *end_;
 
     char *typeTagsCurrent_; // stored in reverse order
     char *messageCursor_;
@@ -677,6 +912,10 @@ private:
     // open but that it doesn't have a size slot (ie the outermost bundle)
     uint32_t *elementSizePtr_;
 
+    // the next type tag expected in a message begun with BeginTypedMessage,
+    // 0 for other messages
+    const char *typeTagCursor_;
+
     bool messageIsInProgress_;
 };
 
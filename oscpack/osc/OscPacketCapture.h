@@ -0,0 +1,720 @@
+/*
+  oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+  The text above constitutes the entire oscpack license; however,
+  the oscpack developer(s) also make the following non-binding requests:
+
+  Any person wishing to distribute modifications to the Software is
+  requested to send the modifications to the original developer so that
+  they can be incorporated into the canonical version. It is also
+  requested that these non-binding requests be included whenever the
+  above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCPACKETCAPTURE_H
+#define INCLUDED_OSCPACK_OSCPACKETCAPTURE_H
+
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "OscTimeTag.h"
+#include "OscUtilities.h"
+#include "../ip/PacketListener.h"
+
+
+/*
+    Recording of received datagrams into capture files, and replay of
+    capture files to listeners or sockets, e.g. to reproduce show traffic
+    in performance tests:
+
+        PacketCaptureWriter writer( "show.oscpcap" );
+        PacketCaptureListener recorder( writer, &listener );
+        mux.AttachSocketListener( socket, &recorder );
+
+        PacketCaptureReader reader( "show.oscpcap" );
+        PacketCaptureReplayer replayer( reader );
+        replayer.SetSpeed( 10 );
+        replayer.Deliver( listener );
+
+    A capture file is a stream of OSC packets, each preceded by its size
+    as a big-endian int32 (the framing of OSC 1.0 streams), so it can be
+    read with the usual OSC receive classes:
+
+    - a "/capture" message with the format version (int32), the offset
+      of the index packet (int64, 0 while the file is being written) and
+      the number of records (int64)
+    - one bundle per datagram whose time tag is the receive time, holding
+      a "/capture/datagram" message with the remote address, remote port,
+      local address and local port (int32 each, address in host order)
+      and the datagram as a blob
+    - a "/capture/index" message with a blob of big-endian (time tag,
+      file offset) int64 pairs, one every CAPTURE_INDEX_INTERVAL records
+
+    The writer maps the file into memory and grows it as needed, so
+    recording a datagram is a copy without a system call. A file which
+    wasn't closed (e.g. after a crash) has no index; it is readable up to
+    the last complete record.
+*/
+
+namespace oscpack{
+
+// the number of records between entries of the index of a capture
+constexpr std::size_t CAPTURE_INDEX_INTERVAL = 1024;
+
+namespace detail{
+
+// the fixed parts of capture files, see above
+struct CaptureFormat{
+    static constexpr int32_t VERSION = 1;
+
+    // size, "/capture", ",ihh", version, index offset, record count
+    static constexpr std::size_t HEADER_SIZE = 4 + 12 + 8 + 4 + 8 + 8;
+    static constexpr std::size_t INDEX_OFFSET_OFFSET = 4 + 12 + 8 + 4;
+    static constexpr std::size_t RECORD_COUNT_OFFSET = INDEX_OFFSET_OFFSET + 8;
+
+    // size, "#bundle", time tag, element size, "/capture/datagram",
+    // ",iiiib", four int32s and the blob size
+    static constexpr std::size_t RECORD_HEADER_SIZE = 4 + 8 + 8 + 4 + 20 + 8 + 16 + 4;
+    static constexpr std::size_t TIME_TAG_OFFSET = 12;
+    static constexpr std::size_t ELEMENT_SIZE_OFFSET = 20;
+    static constexpr std::size_t MESSAGE_OFFSET = 24;
+    static constexpr std::size_t ENDPOINTS_OFFSET = 52;
+    static constexpr std::size_t BLOB_SIZE_OFFSET = 68;
+
+    // size, "/capture/index", ",b", blob size
+    static constexpr std::size_t INDEX_HEADER_SIZE = 4 + 16 + 4 + 4;
+    static constexpr std::size_t INDEX_ENTRY_SIZE = 16;
+
+    static const char *HeaderPrefix() { return "/capture\0\0\0\0,ihh\0\0\0"; } // 20 bytes
+    static const char *MessagePrefix() { return "/capture/datagram\0\0\0,iiiib\0\0"; } // 28 bytes
+    static const char *IndexPrefix() { return "/capture/index\0\0,b\0\0"; } // 20 bytes
+};
+
+
+// a file mapped into memory, read-only or growable for writing
+class CaptureFileMapping{
+#if defined(_WIN32)
+    HANDLE file_;
+    HANDLE mapping_;
+#else
+    int fd_;
+#endif
+    char *data_;
+    std::size_t size_;
+
+    void Unmap()
+    {
+#if defined(_WIN32)
+        if( data_ )
+            UnmapViewOfFile( data_ );
+        if( mapping_ )
+            CloseHandle( mapping_ );
+        mapping_ = 0;
+#else
+        if( data_ )
+            munmap( data_, size_ );
+#endif
+        data_ = 0;
+    }
+
+public:
+    CaptureFileMapping()
+#if defined(_WIN32)
+        : file_( INVALID_HANDLE_VALUE )
+        , mapping_( 0 )
+#else
+        : fd_( -1 )
+#endif
+        , data_( 0 )
+        , size_( 0 ) {}
+
+    ~CaptureFileMapping() { Close( size_ ); }
+
+    CaptureFileMapping( const CaptureFileMapping& ) = delete;
+    CaptureFileMapping& operator=( const CaptureFileMapping& ) = delete;
+
+    // create or truncate path for writing, and map size bytes of it
+    bool Create( const char *path, std::size_t size )
+    {
+#if defined(_WIN32)
+        file_ = CreateFileA( path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, 0,
+                CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0 );
+        if( file_ == INVALID_HANDLE_VALUE )
+            return false;
+#else
+        fd_ = open( path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+        if( fd_ < 0 )
+            return false;
+#endif
+        return Resize( size );
+    }
+
+    bool OpenForReading( const char *path )
+    {
+#if defined(_WIN32)
+        file_ = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0,
+                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0 );
+        LARGE_INTEGER fileSize;
+        if( file_ == INVALID_HANDLE_VALUE || !GetFileSizeEx( file_, &fileSize ) || fileSize.QuadPart == 0 )
+            return false;
+        mapping_ = CreateFileMappingA( file_, 0, PAGE_READONLY, 0, 0, 0 );
+        if( !mapping_ )
+            return false;
+        data_ = (char*)MapViewOfFile( mapping_, FILE_MAP_READ, 0, 0, 0 );
+        size_ = (std::size_t)fileSize.QuadPart;
+#else
+        fd_ = open( path, O_RDONLY | O_CLOEXEC );
+        struct stat status;
+        if( fd_ < 0 || fstat( fd_, &status ) != 0 || status.st_size == 0 )
+            return false;
+        void *data = mmap( 0, (std::size_t)status.st_size, PROT_READ, MAP_SHARED, fd_, 0 );
+        if( data == MAP_FAILED )
+            return false;
+        data_ = (char*)data;
+        size_ = (std::size_t)status.st_size;
+#endif
+        return data_ != 0;
+    }
+
+    // grow a file opened with Create() to size bytes. the mapping may
+    // move. the disk space is allocated before it is mapped, so a full
+    // disk fails here rather than raising SIGBUS on a later write. on
+    // failure the previous mapping and Size() are unchanged
+    bool Resize( std::size_t size )
+    {
+#if defined(_WIN32)
+        // the mapping extends the file
+        HANDLE mapping = CreateFileMappingA( file_, 0, PAGE_READWRITE,
+                (DWORD)((uint64_t)size >> 32), (DWORD)(size & 0xFFFFFFFFu), 0 );
+        if( !mapping )
+            return false;
+        char *data = (char*)MapViewOfFile( mapping, FILE_MAP_WRITE, 0, 0, size );
+        if( !data ){
+            CloseHandle( mapping );
+            return false;
+        }
+        Unmap();
+        mapping_ = mapping;
+#else
+#if defined(__APPLE__)
+        // there is no posix_fallocate on macOS
+        fstore_t store = { F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)( size - size_ ), 0 };
+        if( fcntl( fd_, F_PREALLOCATE, &store ) == -1 || ftruncate( fd_, (off_t)size ) != 0 )
+            return false;
+#else
+        if( posix_fallocate( fd_, 0, (off_t)size ) != 0 )
+            return false;
+#endif
+        void *mapped = mmap( 0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0 );
+        if( mapped == MAP_FAILED )
+            return false;
+        char *data = (char*)mapped;
+        Unmap();
+#endif
+        data_ = data;
+        size_ = size;
+        return true;
+    }
+
+    // unmap and close the file, truncating a file opened with Create()
+    // to fileSize bytes
+    void Close( std::size_t fileSize )
+    {
+        Unmap();
+#if defined(_WIN32)
+        if( file_ != INVALID_HANDLE_VALUE ){
+            LARGE_INTEGER position;
+            position.QuadPart = (LONGLONG)fileSize;
+            if( fileSize < size_ && SetFilePointerEx( file_, position, 0, FILE_BEGIN ) )
+                SetEndOfFile( file_ );
+            CloseHandle( file_ );
+        }
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if( fd_ >= 0 ){
+            if( fileSize < size_ && ftruncate( fd_, (off_t)fileSize ) != 0 ){
+                // the file keeps its zero filled tail, which readers ignore
+            }
+            close( fd_ );
+        }
+        fd_ = -1;
+#endif
+        size_ = 0;
+    }
+
+    char *Data() const { return data_; }
+    std::size_t Size() const { return size_; }
+};
+
+} // namespace detail
+
+
+// PacketCaptureWriter appends datagrams to a new capture file. The
+// methods must be called by one thread at a time. Throw
+// std::runtime_error if the file can't be created or grown.
+class PacketCaptureWriter{
+    typedef detail::CaptureFormat format;
+
+    detail::CaptureFileMapping file_;
+    std::size_t size_; // of the data written
+    std::size_t recordCount_;
+    std::vector< std::pair<uint64_t, uint64_t> > index_; // time tag, offset
+    bool closed_;
+
+    static constexpr std::size_t INITIAL_FILE_SIZE = 1 << 22;
+
+    void Reserve( std::size_t bytes )
+    {
+        if( size_ + bytes <= file_.Size() )
+            return;
+
+        std::size_t fileSize = file_.Size();
+        while( fileSize < size_ + bytes )
+            fileSize *= 2;
+        if( !file_.Resize( fileSize ) )
+            throw std::runtime_error( "unable to extend capture file\n" );
+    }
+
+    void WriteHeader( uint64_t indexOffset )
+    {
+        char *p = file_.Data();
+        FromInt32( p, (int32_t)( format::HEADER_SIZE - 4 ) );
+        std::memcpy( p + 4, format::HeaderPrefix(), 20 );
+        FromInt32( p + 24, format::VERSION );
+        FromUInt64( p + format::INDEX_OFFSET_OFFSET, indexOffset );
+        FromUInt64( p + format::RECORD_COUNT_OFFSET, (uint64_t)recordCount_ );
+    }
+
+public:
+    explicit PacketCaptureWriter( const char *path )
+        : size_( format::HEADER_SIZE )
+        , recordCount_( 0 )
+        , closed_( false )
+    {
+        if( !file_.Create( path, INITIAL_FILE_SIZE ) )
+            throw std::runtime_error( "unable to create capture file\n" );
+        WriteHeader( 0 );
+    }
+
+    ~PacketCaptureWriter()
+    {
+        try{
+            Close();
+        }catch( std::runtime_error& ){
+            // the file remains readable without the index
+        }
+    }
+
+    PacketCaptureWriter( const PacketCaptureWriter& ) = delete;
+    PacketCaptureWriter& operator=( const PacketCaptureWriter& ) = delete;
+
+    // append a datagram. a receiveTimeNs of 0 (receive timestamps not
+    // enabled) is replaced by the current time
+    void Write( const ReceivedDatagram& datagram )
+    {
+        assert( !closed_ && datagram.size >= 0 );
+
+        int64_t receiveTimeNs = datagram.receiveTimeNs;
+        if( receiveTimeNs == 0 ){
+            using namespace std::chrono;
+            receiveTimeNs = duration_cast<nanoseconds>( system_clock::now().time_since_epoch() ).count();
+        }
+        const uint64_t timeTag = TimeTagFromUnixTimeNs( receiveTimeNs );
+
+        const std::size_t blobSize = RoundUp4( (uint32_t)datagram.size );
+        Reserve( format::RECORD_HEADER_SIZE + blobSize );
+
+        char *p = file_.Data() + size_;
+        std::memcpy( p + 4, "#bundle\0", 8 );
+        FromUInt64( p + format::TIME_TAG_OFFSET, timeTag );
+        FromInt32( p + format::ELEMENT_SIZE_OFFSET,
+                (int32_t)( format::RECORD_HEADER_SIZE - format::MESSAGE_OFFSET + blobSize ) );
+        std::memcpy( p + format::MESSAGE_OFFSET, format::MessagePrefix(), 28 );
+        FromInt32( p + format::ENDPOINTS_OFFSET, (int32_t)datagram.remoteEndpoint.address );
+        FromInt32( p + format::ENDPOINTS_OFFSET + 4, datagram.remoteEndpoint.port );
+        FromInt32( p + format::ENDPOINTS_OFFSET + 8, (int32_t)datagram.localEndpoint.address );
+        FromInt32( p + format::ENDPOINTS_OFFSET + 12, datagram.localEndpoint.port );
+        FromInt32( p + format::BLOB_SIZE_OFFSET, datagram.size );
+        std::memcpy( p + format::RECORD_HEADER_SIZE, datagram.data, (std::size_t)datagram.size );
+        std::memset( p + format::RECORD_HEADER_SIZE + datagram.size, 0, blobSize - (std::size_t)datagram.size );
+        // the size is written last, readers of an unclosed file stop at a zero size
+        FromInt32( p, (int32_t)( format::RECORD_HEADER_SIZE - 4 + blobSize ) );
+
+        if( recordCount_ % CAPTURE_INDEX_INTERVAL == 0 )
+            index_.push_back( std::make_pair( timeTag, (uint64_t)size_ ) );
+
+        size_ += format::RECORD_HEADER_SIZE + blobSize;
+        ++recordCount_;
+    }
+
+    // append the index, complete the header and close the file. called by
+    // the destructor
+    void Close()
+    {
+        if( closed_ )
+            return;
+        closed_ = true;
+
+        const std::size_t indexSize = format::INDEX_HEADER_SIZE + index_.size() * format::INDEX_ENTRY_SIZE;
+        Reserve( indexSize );
+
+        char *p = file_.Data() + size_;
+        FromInt32( p, (int32_t)( indexSize - 4 ) );
+        std::memcpy( p + 4, format::IndexPrefix(), 20 );
+        FromInt32( p + 24, (int32_t)( index_.size() * format::INDEX_ENTRY_SIZE ) );
+        p += format::INDEX_HEADER_SIZE;
+        for( std::size_t i=0; i < index_.size(); ++i, p += format::INDEX_ENTRY_SIZE ){
+            FromUInt64( p, index_[i].first );
+            FromUInt64( p + 8, index_[i].second );
+        }
+
+        WriteHeader( (uint64_t)size_ );
+        file_.Close( size_ + indexSize );
+    }
+
+    std::size_t RecordCount() const { return recordCount_; }
+};
+
+
+// PacketCaptureListener records the datagrams it receives with a
+// PacketCaptureWriter before passing them on to listener, if any
+class PacketCaptureListener : public PacketListener{
+    PacketCaptureWriter& writer_;
+    PacketListener *listener_;
+
+public:
+    explicit PacketCaptureListener( PacketCaptureWriter& writer, PacketListener *listener=0 )
+        : writer_( writer )
+        , listener_( listener ) {}
+
+    void ProcessPacket( const char *data, int size, const IpEndpointName& remoteEndpoint ) override
+    {
+        ReceivedDatagram datagram = { data, size, remoteEndpoint };
+        writer_.Write( datagram );
+        if( listener_ )
+            listener_->ProcessPacket( data, size, remoteEndpoint );
+    }
+
+    void ProcessPackets( const ReceivedDatagram *datagrams, std::size_t count ) override
+    {
+        for( std::size_t i=0; i < count; ++i )
+            writer_.Write( datagrams[i] );
+        if( listener_ )
+            listener_->ProcessPackets( datagrams, count );
+    }
+
+    void ProcessDatagram( const ReceivedDatagram& datagram ) override
+    {
+        writer_.Write( datagram );
+        if( listener_ )
+            listener_->ProcessDatagram( datagram );
+    }
+};
+
+
+// PacketCaptureReader maps a capture file for reading. Records are
+// addressed by their file offset, from Begin() to End(). The datagrams
+// it returns point into the mapping and remain valid as long as the
+// reader.
+class PacketCaptureReader{
+    typedef detail::CaptureFormat format;
+
+    detail::CaptureFileMapping file_;
+    std::size_t end_;
+    std::size_t recordCount_;
+    std::vector< std::pair<uint64_t, uint64_t> > index_; // time tag, offset
+
+    // the size of the record at offset, or 0 if there is no valid record
+    std::size_t RecordSize( std::size_t offset ) const
+    {
+        if( offset > file_.Size() || file_.Size() - offset < format::RECORD_HEADER_SIZE )
+            return 0;
+
+        const char *p = file_.Data() + offset;
+        const std::size_t size = (std::size_t)(uint32_t)ToInt32( p ) + 4;
+        const std::size_t blobSize = (std::size_t)(uint32_t)ToInt32( p + format::BLOB_SIZE_OFFSET );
+        if( size < format::RECORD_HEADER_SIZE || size > file_.Size() - offset
+                || blobSize > size - format::RECORD_HEADER_SIZE
+                || std::memcmp( p + 4, "#bundle\0", 8 ) != 0
+                || std::memcmp( p + format::MESSAGE_OFFSET, format::MessagePrefix(), 28 ) != 0 )
+            return 0;
+        return size;
+    }
+
+    // find the end of the records and build the index of a file without one
+    void Scan()
+    {
+        std::size_t offset = format::HEADER_SIZE;
+        recordCount_ = 0;
+        while( std::size_t size = RecordSize( offset ) ){
+            if( recordCount_ % CAPTURE_INDEX_INTERVAL == 0 )
+                index_.push_back( std::make_pair( ToUInt64( file_.Data() + offset + format::TIME_TAG_OFFSET ), (uint64_t)offset ) );
+            offset += size;
+            ++recordCount_;
+        }
+        end_ = offset;
+    }
+
+    // read the index written by Close(). returns false unless the index
+    // and every entry in it are valid
+    bool ReadIndex()
+    {
+        const std::size_t fileSize = file_.Size();
+        const uint64_t indexOffset = ToUInt64( file_.Data() + format::INDEX_OFFSET_OFFSET );
+        if( indexOffset < format::HEADER_SIZE || indexOffset > fileSize
+                || fileSize - indexOffset < format::INDEX_HEADER_SIZE )
+            return false;
+
+        const char *p = file_.Data() + indexOffset;
+        if( std::memcmp( p + 4, format::IndexPrefix(), 20 ) != 0 )
+            return false;
+
+        const std::size_t entryCount = (std::size_t)(uint32_t)ToInt32( p + 24 ) / format::INDEX_ENTRY_SIZE;
+        if( entryCount > ( fileSize - indexOffset - format::INDEX_HEADER_SIZE ) / format::INDEX_ENTRY_SIZE )
+            return false;
+
+        end_ = (std::size_t)indexOffset;
+        p += format::INDEX_HEADER_SIZE;
+        index_.reserve( entryCount );
+        for( std::size_t i=0; i < entryCount; ++i, p += format::INDEX_ENTRY_SIZE ){
+            const uint64_t offset = ToUInt64( p + 8 );
+            if( offset < format::HEADER_SIZE || offset >= end_
+                    || ( !index_.empty() && offset <= index_.back().second ) )
+                return false;
+            const std::size_t size = RecordSize( (std::size_t)offset );
+            if( size == 0 || size > end_ - (std::size_t)offset )
+                return false;
+            index_.push_back( std::make_pair( ToUInt64( p ), offset ) );
+        }
+
+        recordCount_ = (std::size_t)ToUInt64( file_.Data() + format::RECORD_COUNT_OFFSET );
+        return true;
+    }
+
+public:
+    // throws std::runtime_error if path can't be opened or isn't a capture file
+    explicit PacketCaptureReader( const char *path )
+        : end_( 0 )
+        , recordCount_( 0 )
+    {
+        if( !file_.OpenForReading( path ) || file_.Size() < format::HEADER_SIZE
+                || ToInt32( file_.Data() ) != (int32_t)( format::HEADER_SIZE - 4 )
+                || std::memcmp( file_.Data() + 4, format::HeaderPrefix(), 20 ) != 0 )
+            throw std::runtime_error( "unable to open capture file\n" );
+        if( ToInt32( file_.Data() + 24 ) != format::VERSION )
+            throw std::runtime_error( "unsupported capture file version\n" );
+
+        // the header and index of a damaged or unclosed file can't be
+        // trusted, fall back to scanning the records
+        if( !ReadIndex() ){
+            index_.clear();
+            Scan();
+        }
+    }
+
+    std::size_t RecordCount() const { return recordCount_; }
+
+    std::size_t Begin() const { return format::HEADER_SIZE; }
+    std::size_t End() const { return end_; }
+
+    // Decode the record at offset and advance offset to the next one.
+    // Returns false at End() or at a malformed record.
+    bool Next( std::size_t& offset, ReceivedDatagram& datagram, uint64_t& timeTag ) const
+    {
+        if( offset >= end_ )
+            return false;
+        const std::size_t size = RecordSize( offset );
+        if( size == 0 || size > end_ - offset )
+            return false;
+
+        const char *p = file_.Data() + offset;
+        timeTag = ToUInt64( p + format::TIME_TAG_OFFSET );
+        datagram.data = p + format::RECORD_HEADER_SIZE;
+        datagram.size = ToInt32( p + format::BLOB_SIZE_OFFSET );
+        datagram.remoteEndpoint = IpEndpointName( (unsigned long)(uint32_t)ToInt32( p + format::ENDPOINTS_OFFSET ),
+                ToInt32( p + format::ENDPOINTS_OFFSET + 4 ) );
+        datagram.localEndpoint = IpEndpointName( (unsigned long)(uint32_t)ToInt32( p + format::ENDPOINTS_OFFSET + 8 ),
+                ToInt32( p + format::ENDPOINTS_OFFSET + 12 ) );
+        datagram.receiveTimeNs = UnixTimeNsFromTimeTag( timeTag );
+
+        offset += size;
+        return true;
+    }
+
+    // The offset of the first record received at or after timeTag, or
+    // End(). Uses the index, so receive times are expected to increase
+    // through the file.
+    std::size_t Seek( uint64_t timeTag ) const
+    {
+        std::size_t first = 0;
+        while( first + 1 < index_.size() && TimeTagDifferenceSeconds( index_[first + 1].first, timeTag ) < 0 )
+            ++first;
+
+        std::size_t offset = index_.empty() ? end_ : (std::size_t)index_[first].second;
+        for(;;){
+            std::size_t next = offset;
+            ReceivedDatagram datagram;
+            uint64_t recordTimeTag;
+            if( !Next( next, datagram, recordTimeTag ) || TimeTagDifferenceSeconds( recordTimeTag, timeTag ) >= 0 )
+                return offset < end_ ? offset : end_;
+            offset = next;
+        }
+    }
+};
+
+
+// PacketCaptureReplayer replays the records of a capture, in process to
+// a PacketListener (such as an OscPacketListener) without sockets, or
+// through a socket. By default the recorded timing is reproduced.
+class PacketCaptureReplayer{
+    const PacketCaptureReader& reader_;
+    double speed_;
+    std::size_t batchSize_;
+    std::size_t begin_;
+    std::size_t end_;
+
+    // pass the records from begin_ to end_ to deliver( datagrams, count )
+    // in batches. returns the number of records
+    template< class Deliver_T >
+    std::size_t Replay( Deliver_T deliver ) const
+    {
+        std::vector<ReceivedDatagram> batch( batchSize_ );
+        std::size_t count = 0;
+        std::size_t total = 0;
+
+        const auto startTime = std::chrono::steady_clock::now();
+        uint64_t firstTimeTag = 0;
+
+        std::size_t offset = begin_;
+        ReceivedDatagram datagram;
+        uint64_t timeTag;
+        while( offset < end_ && reader_.Next( offset, datagram, timeTag ) ){
+            if( total + count == 0 )
+                firstTimeTag = timeTag;
+
+            if( speed_ > 0 ){
+                // deliver the pending datagrams before waiting for this one
+                auto dueTime = startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>( TimeTagDifferenceSeconds( timeTag, firstTimeTag ) / speed_ ) );
+                if( dueTime > std::chrono::steady_clock::now() ){
+                    if( count > 0 ){
+                        deliver( &batch[0], count );
+                        total += count;
+                        count = 0;
+                    }
+                    std::this_thread::sleep_until( dueTime );
+                }
+            }
+
+            batch[ count++ ] = datagram;
+            if( count == batchSize_ ){
+                deliver( &batch[0], count );
+                total += count;
+                count = 0;
+            }
+        }
+
+        if( count > 0 ){
+            deliver( &batch[0], count );
+            total += count;
+        }
+        return total;
+    }
+
+public:
+    explicit PacketCaptureReplayer( const PacketCaptureReader& reader )
+        : reader_( reader )
+        , speed_( 1 )
+        , batchSize_( 64 )
+        , begin_( reader.Begin() )
+        , end_( reader.End() ) {}
+
+    // 1 reproduces the recorded timing, 10 replays ten times faster and
+    // 0 as fast as possible
+    void SetSpeed( double speed )
+    {
+        assert( speed >= 0 );
+        speed_ = speed;
+    }
+
+    // the largest number of datagrams passed to each
+    // PacketListener::ProcessPackets() call. datagrams which are due at
+    // the same time are delivered together
+    void SetBatchSize( std::size_t datagramCount )
+    {
+        assert( datagramCount > 0 );
+        batchSize_ = datagramCount;
+    }
+
+    // replay only the records received from beginTimeTag up to (but
+    // excluding) endTimeTag
+    void SetTimeRange( uint64_t beginTimeTag, uint64_t endTimeTag )
+    {
+        begin_ = reader_.Seek( beginTimeTag );
+        end_ = reader_.Seek( endTimeTag );
+    }
+
+    // deliver the records to listener with ProcessPackets(), on the
+    // calling thread. returns the number of datagrams delivered
+    std::size_t Deliver( PacketListener& listener ) const
+    {
+        return Replay( [&listener]( const ReceivedDatagram *datagrams, std::size_t count ){
+            listener.ProcessPackets( datagrams, count );
+        } );
+    }
+
+    // send the datagrams with socket.Send(). Socket_T is anything with a
+    // Send( const char*, std::size_t ) method, usually UdpTransmitSocket.
+    // returns the number of datagrams sent
+    template< class Socket_T >
+    std::size_t Transmit( Socket_T& socket ) const
+    {
+        return Replay( [&socket]( const ReceivedDatagram *datagrams, std::size_t count ){
+            for( std::size_t i=0; i < count; ++i )
+                socket.Send( datagrams[i].data, (std::size_t)datagrams[i].size );
+        } );
+    }
+};
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_OSCPACKETCAPTURE_H */
@@ -37,40 +37,203 @@
 #ifndef INCLUDED_OSCPACK_OSCPACKETLISTENER_H
 #define INCLUDED_OSCPACK_OSCPACKETLISTENER_H
 
+#include <cstddef>
+#include <vector>
+
 #include "OscReceivedElements.h"
+#include "../ip/Metrics.h"
 #include "../ip/PacketListener.h"
 
 
 namespace oscpack{
 
+// bundles may be nested at most this deep (a packet that is a bundle
+// containing only messages has depth 1) before dispatch stops with a
+// MalformedBundleException.
+constexpr std::size_t DEFAULT_MAXIMUM_BUNDLE_DEPTH = 32;
+
+// a snapshot of the counters of an OscPacketListener, see Metrics.h. all
+// values are zero unless OSCPACK_ENABLE_METRICS is defined.
+struct OscPacketListenerMetrics{
+    uint64_t packetCount = 0;
+
+    // messages passed to ProcessMessage() (including scheduled messages)
+    uint64_t messageCount = 0;
+
+    // packets whose dispatch stopped with the corresponding exception
+    uint64_t malformedPacketCount = 0;
+    uint64_t malformedMessageCount = 0;
+    uint64_t malformedBundleCount = 0;
+
+    // messages for which no handler was found, see CountUnmatchedMessage()
+    uint64_t unmatchedMessageCount = 0;
+
+    // the time spent in each call to ProcessMessage()
+    LatencyHistogramSnapshot handlerLatency;
+};
+
 class OscPacketListener : public PacketListener{
+    std::size_t maximumBundleDepth_ = DEFAULT_MAXIMUM_BUNDLE_DEPTH;
+    bool lazyBundleValidation_ = false;
+
+    detail::MetricCounter packetCount_;
+    detail::MetricCounter messageCount_;
+    detail::MetricCounter malformedPacketCount_;
+    detail::MetricCounter malformedMessageCount_;
+    detail::MetricCounter malformedBundleCount_;
+    detail::MetricCounter unmatchedMessageCount_;
+    detail::LatencyHistogram handlerLatency_;
+
+    void DispatchPacket( const char *data, int size,
+            const IpEndpointName& remoteEndpoint )
+    {
+        oscpack::ReceivedPacket p( data, size );
+        if( p.IsBundle() )
+            ProcessBundle( MakeBundle(p), remoteEndpoint );
+        else
+            DispatchMessage( ReceivedMessage(p), remoteEndpoint );
+    }
+
 protected:
+    // calls ProcessMessage(), counting the message and timing the call
+    void DispatchMessage( const oscpack::ReceivedMessage& m,
+        const IpEndpointName& remoteEndpoint )
+    {
+        messageCount_.Add();
+        detail::LatencyTimer timer;
+        ProcessMessage( m, remoteEndpoint );
+        timer.Stop( handlerLatency_ );
+    }
+
+    // for subclasses to call when a message matches no handler
+    void CountUnmatchedMessage() { unmatchedMessageCount_.Add(); }
+
+    // constructs a bundle with the validation mode selected by
+    // SetLazyBundleValidation()
+    ReceivedBundle MakeBundle( const ReceivedPacket& p ) const
+    {
+        return lazyBundleValidation_
+                ? ReceivedBundle( p, LazyBundleValidation() ) : ReceivedBundle( p );
+    }
+
+    ReceivedBundle MakeBundle( const ReceivedBundleElement& e ) const
+    {
+        return lazyBundleValidation_
+                ? ReceivedBundle( e, LazyBundleValidation() ) : ReceivedBundle( e );
+    }
+
     virtual void ProcessBundle( const oscpack::ReceivedBundle& b,
         const IpEndpointName& remoteEndpoint )
     {
-        // ignore bundle time tag for now
-
-        for( ReceivedBundle::const_iterator i = b.ElementsBegin();
-        i != b.ElementsEnd(); ++i ){
-            if( i->IsBundle() )
-                ProcessBundle( ReceivedBundle(*i), remoteEndpoint );
-            else
-                ProcessMessage( ReceivedMessage(*i), remoteEndpoint );
+        // the time tag is ignored, bundles are dispatched on arrival.
+        // see ScheduledOscPacketListener for time tag scheduling.
+
+        // nested bundles are walked with an explicit stack of the
+        // iterators of their enclosing bundles rather than by recursion,
+        // so that the nesting depth is bounded by maximumBundleDepth_
+        // instead of by the size of the call stack. the stack is only
+        // allocated if b contains a nested bundle.
+        struct Level{
+            ReceivedBundle::const_iterator i, end;
+        };
+        std::vector<Level> enclosing;
+
+        Level level = { b.ElementsBegin(), b.ElementsEnd() };
+        for(;;){
+            if( level.i == level.end ){
+                if( enclosing.empty() )
+                    break;
+                level = enclosing.back();
+                enclosing.pop_back();
+                continue;
+            }
+
+            ReceivedBundleElement e = *level.i;
+            ++level.i;
+            if( e.IsBundle() ){
+                ReceivedBundle nested = MakeBundle( e );
+                if( enclosing.size() + 2 > maximumBundleDepth_ )
+                    OSCPACK_THROW( MalformedBundleException( "bundles nested too deeply" ) );
+
+                if( ProcessNestedBundle( nested, remoteEndpoint, enclosing.size() + 2 ) ){
+                    enclosing.push_back( level );
+                    level = Level{ nested.ElementsBegin(), nested.ElementsEnd() };
+                }
+            }else{
+                DispatchMessage( ReceivedMessage(e), remoteEndpoint );
+            }
         }
     }
 
+    // called by ProcessBundle() for each bundle nested within the bundle
+    // being dispatched, before its elements are visited. depth is the
+    // nesting depth of b, the outermost bundle having depth 1. return
+    // false to skip its elements, e.g. because they have been scheduled
+    // for later.
+    virtual bool ProcessNestedBundle( const oscpack::ReceivedBundle& b,
+        const IpEndpointName& remoteEndpoint, std::size_t depth )
+    {
+        (void) b; // suppress unused parameter warnings
+        (void) remoteEndpoint;
+        (void) depth;
+        return true;
+    }
+
     virtual void ProcessMessage( const oscpack::ReceivedMessage& m,
         const IpEndpointName& remoteEndpoint ) = 0;
 
 public:
+    // the maximum depth of bundle nesting accepted by ProcessBundle(),
+    // default DEFAULT_MAXIMUM_BUNDLE_DEPTH. must be at least 1.
+    void SetMaximumBundleDepth( std::size_t maximumBundleDepth )
+    {
+        maximumBundleDepth_ = maximumBundleDepth;
+    }
+    std::size_t MaximumBundleDepth() const { return maximumBundleDepth_; }
+
+    // when enabled, received bundles are constructed with
+    // LazyBundleValidation: each element is validated as it is
+    // dispatched, so a malformed element stops dispatch part way through
+    // a bundle rather than rejecting the whole bundle up front.
+    void SetLazyBundleValidation( bool enabled ) { lazyBundleValidation_ = enabled; }
+    bool LazyBundleValidationEnabled() const { return lazyBundleValidation_; }
+
+    // may be called from any thread
+    OscPacketListenerMetrics Metrics() const
+    {
+        OscPacketListenerMetrics result;
+        result.packetCount = packetCount_.Value();
+        result.messageCount = messageCount_.Value();
+        result.malformedPacketCount = malformedPacketCount_.Value();
+        result.malformedMessageCount = malformedMessageCount_.Value();
+        result.malformedBundleCount = malformedBundleCount_.Value();
+        result.unmatchedMessageCount = unmatchedMessageCount_.Value();
+        handlerLatency_.Read( result.handlerLatency );
+        return result;
+    }
+
   void ProcessPacket( const char *data, int size,
       const IpEndpointName& remoteEndpoint ) override
     {
-        oscpack::ReceivedPacket p( data, size );
-        if( p.IsBundle() )
-            ProcessBundle( ReceivedBundle(p), remoteEndpoint );
-        else
-            ProcessMessage( ReceivedMessage(p), remoteEndpoint );
+        packetCount_.Add();
+#if defined(OSCPACK_ENABLE_METRICS) && defined(OSCPACK_HAS_EXCEPTIONS)
+        // count malformed packets by the exception which stopped their
+        // dispatch. the exception still propagates to the caller.
+        try{
+            DispatchPacket( data, size, remoteEndpoint );
+        }catch( MalformedPacketException& ){
+            malformedPacketCount_.Add();
+            throw;
+        }catch( MalformedMessageException& ){
+            malformedMessageCount_.Add();
+            throw;
+        }catch( MalformedBundleException& ){
+            malformedBundleCount_.Add();
+            throw;
+        }
+#else
+        DispatchPacket( data, size, remoteEndpoint );
+#endif
     }
 };
 
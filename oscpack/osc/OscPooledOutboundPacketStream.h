@@ -0,0 +1,172 @@
+/*
+  oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+  The text above constitutes the entire oscpack license; however,
+  the oscpack developer(s) also make the following non-binding requests:
+
+  Any person wishing to distribute modifications to the Software is
+  requested to send the modifications to the original developer so that
+  they can be incorporated into the canonical version. It is also
+  requested that these non-binding requests be included whenever the
+  above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCPOOLEDOUTBOUNDPACKETSTREAM_H
+#define INCLUDED_OSCPACK_OSCPOOLEDOUTBOUNDPACKETSTREAM_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "OscOutboundPacketStream.h"
+
+
+namespace oscpack{
+
+constexpr std::size_t DEFAULT_POOLED_STREAM_CAPACITY = 1536; // an ethernet MTU
+
+namespace detail{
+
+// the free buffers of the calling thread's PooledOutboundPacketStreams.
+// each thread has its own pool, so acquiring and releasing a buffer never
+// contends with other threads, and only allocates when the thread has
+// more streams in use at once than ever before.
+class ThreadStreamBufferPool{
+    struct Buffer{
+        std::unique_ptr<char[]> data;
+        std::size_t capacity;
+    };
+    std::vector<Buffer> free_;
+
+public:
+    static ThreadStreamBufferPool& Instance()
+    {
+        thread_local ThreadStreamBufferPool pool;
+        return pool;
+    }
+
+    // returns the smallest free buffer of at least capacity bytes, or a
+    // new buffer of exactly capacity bytes. capacity is updated to the
+    // size of the returned buffer.
+    char *Acquire( std::size_t& capacity )
+    {
+        // usually the most recently released buffer is the right size
+        if( !free_.empty() && free_.back().capacity == capacity ){
+            char *result = free_.back().data.release();
+            free_.pop_back();
+            return result;
+        }
+
+        std::size_t best = free_.size();
+        for( std::size_t i=0; i < free_.size(); ++i ){
+            if( free_[i].capacity >= capacity
+                    && (best == free_.size() || free_[i].capacity < free_[best].capacity) )
+                best = i;
+        }
+
+        if( best == free_.size() )
+            return new char[ capacity ];
+
+        char *result = free_[best].data.release();
+        capacity = free_[best].capacity;
+        free_[best] = std::move( free_.back() );
+        free_.pop_back();
+        return result;
+    }
+
+    void Release( char *data, std::size_t capacity )
+    {
+        free_.push_back( Buffer{ std::unique_ptr<char[]>( data ), capacity } );
+    }
+
+    std::size_t FreeCount() const { return free_.size(); }
+};
+
+// holds the buffer of a PooledOutboundPacketStream. a base class so that
+// the buffer exists before the OutboundPacketStream is constructed.
+class PooledStreamBuffer{
+protected:
+    std::size_t bufferCapacity_;
+    char *buffer_;
+
+    explicit PooledStreamBuffer( std::size_t capacity )
+        : bufferCapacity_( capacity )
+        , buffer_( ThreadStreamBufferPool::Instance().Acquire( bufferCapacity_ ) ) {}
+
+    ~PooledStreamBuffer()
+    {
+        ThreadStreamBufferPool::Instance().Release( buffer_, bufferCapacity_ );
+    }
+
+    PooledStreamBuffer( const PooledStreamBuffer& ) = delete;
+    PooledStreamBuffer& operator=( const PooledStreamBuffer& ) = delete;
+};
+
+} // namespace detail
+
+
+// An OutboundPacketStream whose buffer is borrowed from a pool belonging
+// to the constructing thread, and returned to the pool of the destroying
+// thread. In steady state constructing one neither allocates nor takes a
+// lock, so it can be used as a local variable on each send, from several
+// threads at once:
+//
+//     void SendLevels( UdpTransmitSocket& socket, float left, float right )
+//     {
+//         PooledOutboundPacketStream ps;
+//         ps << BeginMessage( "/levels" ) << left << right << EndMessage();
+//         socket.Send( ps.Data(), ps.Size() );
+//     }
+//
+// The capacity is at least the requested capacity. Streams mustn't have
+// static or thread storage duration, since the pools are thread_local.
+class PooledOutboundPacketStream
+        : private detail::PooledStreamBuffer
+        , public OutboundPacketStream{
+public:
+    explicit PooledOutboundPacketStream( std::size_t capacity=DEFAULT_POOLED_STREAM_CAPACITY )
+        : detail::PooledStreamBuffer( capacity )
+        , OutboundPacketStream( buffer_, bufferCapacity_ ) {}
+
+    // allocates count buffers of capacity bytes in the calling thread's
+    // pool up front, e.g. when a sender thread starts
+    static void Preallocate( std::size_t count, std::size_t capacity=DEFAULT_POOLED_STREAM_CAPACITY )
+    {
+        detail::ThreadStreamBufferPool& pool = detail::ThreadStreamBufferPool::Instance();
+        for( std::size_t i=0; i < count; ++i )
+            pool.Release( new char[ capacity ], capacity );
+    }
+
+    // the number of unused buffers in the calling thread's pool
+    static std::size_t PooledBufferCount()
+    {
+        return detail::ThreadStreamBufferPool::Instance().FreeCount();
+    }
+};
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_OSCPOOLEDOUTBOUNDPACKETSTREAM_H */
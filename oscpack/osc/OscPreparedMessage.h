@@ -0,0 +1,210 @@
+/*
+  oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+  The text above constitutes the entire oscpack license; however,
+  the oscpack developer(s) also make the following non-binding requests:
+
+  Any person wishing to distribute modifications to the Software is
+  requested to send the modifications to the original developer so that
+  they can be incorporated into the canonical version. It is also
+  requested that these non-binding requests be included whenever the
+  above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCPREPAREDMESSAGE_H
+#define INCLUDED_OSCPACK_OSCPREPAREDMESSAGE_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "OscOutboundPacketStream.h"
+#include "OscReceivedElements.h"
+#include "OscTypesTraits.h"
+
+
+namespace oscpack{
+
+// A copy of a packet which is sent repeatedly with only some of its
+// argument values changing, e.g. the same controls every tick. The packet
+// is built once with an OutboundPacketStream; the offsets of its
+// arguments are recorded on construction, so Set() patches a value with
+// a single byte swapped store and the address pattern, type tags and
+// every other argument are never rewritten:
+//
+//     ps << BeginMessage( "/strip" ) << "vocals" << 0.f << 0.f << EndMessage();
+//     PreparedMessage strip( ps );
+//     ...
+//     strip.Set( 1, gain );
+//     strip.Set( 2, pan );
+//     socket.Send( strip.Data(), strip.Size() );
+//
+// The packet may be a bundle, in which case arguments are numbered in
+// order across all of its messages (array markers count as arguments,
+// as in ReceivedMessage::ArgumentCount()) and the time tags of its
+// bundles can be changed with SetTimeTag().
+//
+// Only fixed size arguments can be changed, and only to a value of the
+// same type: Set() throws TypeTagMismatchException otherwise, except
+// that true and false may replace each other.
+class PreparedMessage{
+    struct Argument{
+        std::size_t offset;        // of the argument's data
+        std::size_t typeTagOffset;
+    };
+
+    std::vector<char> data_;
+    std::vector<Argument> arguments_;
+    std::vector<std::size_t> bundleOffsets_;
+
+    static std::size_t ArgumentSize( char typeTag, const char *argument )
+    {
+        switch( typeTag ){
+            case INT32_TYPE_TAG:
+            case FLOAT_TYPE_TAG:
+            case CHAR_TYPE_TAG:
+            case RGBA_COLOR_TYPE_TAG:
+            case MIDI_MESSAGE_TYPE_TAG:
+                return 4;
+            case INT64_TYPE_TAG:
+            case TIME_TAG_TYPE_TAG:
+            case DOUBLE_TYPE_TAG:
+                return 8;
+            case STRING_TYPE_TAG:
+            case SYMBOL_TYPE_TAG:
+                return RoundUp4( (uint32_t)std::strlen( argument ) + 1 );
+            case BLOB_TYPE_TAG:
+                return 4 + RoundUp4( ToUInt32( argument ) );
+            default: // T, F, N, I, [ and ] have no data
+                return 0;
+        }
+    }
+
+    void AddMessage( const ReceivedMessage& m )
+    {
+        const char *typeTags = m.TypeTags();
+        std::size_t typeTagCount = m.ArgumentCount();
+
+        // the type tag string starts with ',' and is null terminated
+        const char *argument = typeTags - 1 + RoundUp4( (uint32_t)typeTagCount + 2 );
+        for( std::size_t i=0; i < typeTagCount; ++i ){
+            arguments_.push_back( Argument{
+                    (std::size_t)(argument - data_.data()), (std::size_t)(typeTags + i - data_.data()) } );
+            argument += ArgumentSize( typeTags[i], argument );
+        }
+    }
+
+    // contents is the start of the bundle, its time tag follows "#bundle"
+    void AddBundle( const ReceivedBundle& b, const char *contents )
+    {
+        bundleOffsets_.push_back( (std::size_t)(contents + 8 - data_.data()) );
+        for( ReceivedBundle::const_iterator i = b.ElementsBegin(); i != b.ElementsEnd(); ++i ){
+            if( i->IsBundle() )
+                AddBundle( ReceivedBundle( *i ), i->Contents() );
+            else
+                AddMessage( ReceivedMessage( *i ) );
+        }
+    }
+
+    void Init()
+    {
+        ReceivedPacket p( data_.data(), data_.size() );
+        if( p.IsBundle() )
+            AddBundle( ReceivedBundle( p ), p.Contents() );
+        else
+            AddMessage( ReceivedMessage( p ) );
+    }
+
+    char *ArgumentData( std::size_t index, char typeTag )
+    {
+        assert( index < arguments_.size() );
+        if( data_[ arguments_[index].typeTagOffset ] != typeTag )
+            throw TypeTagMismatchException( "PreparedMessage argument has a different type" );
+        return &data_[ arguments_[index].offset ];
+    }
+
+public:
+    // copies the packet in ps, which must be complete (ps.IsReady()).
+    // throws MalformedPacketException, MalformedMessageException or
+    // MalformedBundleException if it isn't a valid packet.
+    explicit PreparedMessage( const OutboundPacketStream& ps )
+        : data_( ps.Data(), ps.Data() + ps.Size() )
+    {
+        assert( ps.IsReady() );
+        Init();
+    }
+
+    PreparedMessage( const char *packet, std::size_t size )
+        : data_( packet, packet + size )
+    {
+        Init();
+    }
+
+    std::size_t ArgumentCount() const { return arguments_.size(); }
+    char TypeTag( std::size_t index ) const
+    {
+        assert( index < arguments_.size() );
+        return data_[ arguments_[index].typeTagOffset ];
+    }
+
+    // T is one of the fixed size argument types with an OscArgumentTraits
+    // specialization: int32_t, int64_t, float, double, char, RgbaColor,
+    // MidiMessage or TimeTag
+    template< class T >
+    void Set( std::size_t index, const T& value )
+    {
+        typedef OscArgumentTraits<T> traits_type;
+        static_assert( traits_type::is_fixed_size, "only fixed size arguments can be changed" );
+        traits_type::Write( ArgumentData( index, traits_type::type_tag ), value );
+    }
+
+    void Set( std::size_t index, bool value )
+    {
+        assert( index < arguments_.size() );
+        char& typeTag = data_[ arguments_[index].typeTagOffset ];
+        if( typeTag != TRUE_TYPE_TAG && typeTag != FALSE_TYPE_TAG )
+            throw TypeTagMismatchException( "PreparedMessage argument has a different type" );
+        typeTag = value ? TRUE_TYPE_TAG : FALSE_TYPE_TAG;
+    }
+
+    // the number of bundles in the packet, including nested bundles, in
+    // the order they begin. 0 if the packet is a message.
+    std::size_t BundleCount() const { return bundleOffsets_.size(); }
+
+    void SetTimeTag( uint64_t timeTag, std::size_t bundleIndex=0 )
+    {
+        assert( bundleIndex < bundleOffsets_.size() );
+        FromUInt64( &data_[ bundleOffsets_[bundleIndex] ], timeTag );
+    }
+
+    const char *Data() const { return data_.data(); }
+    std::size_t Size() const { return data_.size(); }
+};
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_OSCPREPAREDMESSAGE_H */
@@ -37,9 +37,12 @@
 #ifndef INCLUDED_OSCPACK_OSCRECEIVEDELEMENTS_H
 #define INCLUDED_OSCPACK_OSCRECEIVEDELEMENTS_H
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstring> // size_t
+#include <memory>
+#include <optional>
 #include <vector>
 #include "OscTypes.h"
 #include "OscException.h"
@@ -86,6 +89,111 @@ class ExcessArgumentException : public Exception{
 };
 
 
+// result of the non-throwing TryParse() functions below. they perform
+// the same validation as the corresponding constructors, which throw the
+// exception noted against each group of values instead.
+enum ParseStatus{
+    PARSE_OK = 0,
+
+    // MalformedPacketException
+    PARSE_INVALID_PACKET_SIZE,
+    PARSE_ZERO_LENGTH_PACKET,
+    PARSE_PACKET_SIZE_NOT_MULTIPLE_OF_4,
+
+    // MalformedMessageException
+    PARSE_INVALID_MESSAGE_SIZE,
+    PARSE_ZERO_LENGTH_MESSAGE,
+    PARSE_MESSAGE_SIZE_NOT_MULTIPLE_OF_4,
+    PARSE_UNTERMINATED_ADDRESS_PATTERN,
+    PARSE_TYPE_TAGS_NOT_PRESENT,
+    PARSE_UNTERMINATED_TYPE_TAGS,
+    PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE,
+    PARSE_UNTERMINATED_STRING_ARGUMENT,
+    PARSE_UNKNOWN_TYPE_TAG,
+    PARSE_UNTERMINATED_ARRAY,
+
+    // MalformedBundleException
+    PARSE_INVALID_BUNDLE_SIZE,
+    PARSE_BUNDLE_TOO_SHORT,
+    PARSE_BUNDLE_SIZE_NOT_MULTIPLE_OF_4,
+    PARSE_BAD_BUNDLE_ADDRESS_PATTERN,
+    PARSE_BUNDLE_ELEMENT_SIZE_TRUNCATED,
+    PARSE_BUNDLE_ELEMENT_SIZE_NOT_MULTIPLE_OF_4,
+    PARSE_BUNDLE_ELEMENT_TRUNCATED
+};
+
+// the what() string of the exception corresponding to status
+inline const char *ParseStatusString( ParseStatus status )
+{
+    switch( status ){
+        case PARSE_OK: return "ok";
+
+        case PARSE_INVALID_PACKET_SIZE: return "invalid packet size";
+        case PARSE_ZERO_LENGTH_PACKET: return "zero length elements not permitted";
+        case PARSE_PACKET_SIZE_NOT_MULTIPLE_OF_4: return "element size must be multiple of four";
+
+        case PARSE_INVALID_MESSAGE_SIZE: return "invalid message size";
+        case PARSE_ZERO_LENGTH_MESSAGE: return "zero length messages not permitted";
+        case PARSE_MESSAGE_SIZE_NOT_MULTIPLE_OF_4: return "message size must be multiple of four";
+        case PARSE_UNTERMINATED_ADDRESS_PATTERN: return "unterminated address pattern";
+        case PARSE_TYPE_TAGS_NOT_PRESENT: return "type tags not present";
+        case PARSE_UNTERMINATED_TYPE_TAGS: return "type tags were not terminated before end of message";
+        case PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE: return "arguments exceed message size";
+        case PARSE_UNTERMINATED_STRING_ARGUMENT: return "unterminated string argument";
+        case PARSE_UNKNOWN_TYPE_TAG: return "unknown type tag";
+        case PARSE_UNTERMINATED_ARRAY: return "array was not terminated before end of message (expected ']' end of array tag)";
+
+        case PARSE_INVALID_BUNDLE_SIZE: return "invalid bundle size";
+        case PARSE_BUNDLE_TOO_SHORT: return "packet too short for bundle";
+        case PARSE_BUNDLE_SIZE_NOT_MULTIPLE_OF_4: return "bundle size must be multiple of four";
+        case PARSE_BAD_BUNDLE_ADDRESS_PATTERN: return "bad bundle address pattern";
+        case PARSE_BUNDLE_ELEMENT_SIZE_TRUNCATED: return "packet too short for elementSize";
+        case PARSE_BUNDLE_ELEMENT_SIZE_NOT_MULTIPLE_OF_4: return "bundle element size must be multiple of four";
+        case PARSE_BUNDLE_ELEMENT_TRUNCATED: return "packet too short for bundle element";
+    }
+    return "unknown parse status";
+}
+
+namespace detail{
+
+// throws the exception corresponding to status, which must not be PARSE_OK
+[[noreturn]] inline void ThrowParseStatus( ParseStatus status )
+{
+    if( status < PARSE_INVALID_MESSAGE_SIZE )
+        OSCPACK_THROW( MalformedPacketException( ParseStatusString( status ) ) );
+    else if( status < PARSE_INVALID_BUNDLE_SIZE )
+        OSCPACK_THROW( MalformedMessageException( ParseStatusString( status ) ) );
+    else
+        OSCPACK_THROW( MalformedBundleException( ParseStatusString( status ) ) );
+}
+
+inline void ThrowIfFailed( ParseStatus status )
+{
+    if( status != PARSE_OK )
+        ThrowParseStatus( status );
+}
+
+// checks the bundle element whose size field is at p against end, the
+// end of the enclosing bundle.
+inline ParseStatus CheckBundleElement( const char *p, const char *end )
+{
+    if( end - p < oscpack::OSC_SIZEOF_INT32 )
+        return PARSE_BUNDLE_ELEMENT_SIZE_TRUNCATED;
+
+    // treat element size as an unsigned int for the purposes of this calculation
+    uint32_t elementSize = ToUInt32( p );
+    if( (elementSize & ((uint32_t)0x03)) != 0 )
+        return PARSE_BUNDLE_ELEMENT_SIZE_NOT_MULTIPLE_OF_4;
+
+    if( elementSize > (uint32_t)(end - p - oscpack::OSC_SIZEOF_INT32) )
+        return PARSE_BUNDLE_ELEMENT_TRUNCATED;
+
+    return PARSE_OK;
+}
+
+} // namespace detail
+
+
 class ReceivedPacket{
   public:
     // Although the OSC spec is not entirely clear on this, we only support
@@ -105,6 +213,19 @@ class ReceivedPacket{
         : contents_(contents)
         , size_(ValidateSize((osc_bundle_element_size_t)size)) {}
 
+    // non-throwing alternative to the constructors. on success, packet
+    // holds the packet and PARSE_OK is returned.
+    static ParseStatus TryParse( const char *contents, std::size_t size,
+        std::optional<ReceivedPacket>& packet )
+    {
+      ParseStatus status = PARSE_INVALID_PACKET_SIZE;
+      if( size <= (std::size_t)OSC_INT32_MAX )
+        status = CheckSize( (osc_bundle_element_size_t)size );
+      if( status == PARSE_OK )
+        packet.emplace( ReceivedPacket( contents, (osc_bundle_element_size_t)size, Unchecked() ) );
+      return status;
+    }
+
     bool IsMessage() const { return !IsBundle(); }
     bool IsBundle() const
     {
@@ -118,19 +239,31 @@ class ReceivedPacket{
     const char *contents_;
     osc_bundle_element_size_t size_;
 
-    static osc_bundle_element_size_t ValidateSize( osc_bundle_element_size_t size )
+    struct Unchecked{};
+
+    ReceivedPacket( const char *contents, osc_bundle_element_size_t size, Unchecked )
+      : contents_( contents )
+      , size_( size ) {}
+
+    static ParseStatus CheckSize( osc_bundle_element_size_t size )
     {
       // sanity check integer types declared in OscTypes.h
       // you'll need to fix OscTypes.h if any of these asserts fail
       if( !IsValidElementSizeValue(size) )
-        throw MalformedPacketException( "invalid packet size" );
+        return PARSE_INVALID_PACKET_SIZE;
 
       if( size == 0 )
-        throw MalformedPacketException( "zero length elements not permitted" );
+        return PARSE_ZERO_LENGTH_PACKET;
 
       if( !IsMultipleOf4(size) )
-        throw MalformedPacketException( "element size must be multiple of four" );
+        return PARSE_PACKET_SIZE_NOT_MULTIPLE_OF_4;
 
+      return PARSE_OK;
+    }
+
+    static osc_bundle_element_size_t ValidateSize( osc_bundle_element_size_t size )
+    {
+      detail::ThrowIfFailed( CheckSize( size ) );
       return size;
     }
 };
@@ -163,7 +296,16 @@ class ReceivedBundleElement{
 class ReceivedBundleElementIterator{
   public:
     ReceivedBundleElementIterator( const char *sizePtr )
-      : value_( sizePtr ) {}
+      : value_( sizePtr ), end_( nullptr ) {}
+
+    // a checked iterator validates the size of each element against end,
+    // the end of the enclosing bundle, as it is reached. used by bundles
+    // constructed with LazyBundleValidation.
+    ReceivedBundleElementIterator( const char *sizePtr, const char *end )
+      : value_( sizePtr ), end_( end )
+    {
+      Validate();
+    }
 
     ReceivedBundleElementIterator operator++()
     {
@@ -187,8 +329,22 @@ class ReceivedBundleElementIterator{
 
   private:
     ReceivedBundleElement value_;
+    const char *end_;
 
-    void Advance() { value_.sizePtr_ = value_.Contents() + value_.Size(); }
+    void Advance()
+    {
+      value_.sizePtr_ = value_.Contents() + value_.Size();
+      if( end_ )
+        Validate();
+    }
+
+    void Validate() const
+    {
+      if( value_.sizePtr_ == end_ )
+        return;
+
+      detail::ThrowIfFailed( detail::CheckBundleElement( value_.sizePtr_, end_ ) );
+    }
 
     bool IsEqualTo( const ReceivedBundleElementIterator& rhs ) const
     {
@@ -217,35 +373,45 @@ class ReceivedMessageArgument{
       , argumentPtr_( argumentPtr ) {}
 
     friend class ReceivedMessageArgumentIterator;
+    friend class ReceivedMessageArgumentStream;
 
     char TypeTag() const { return *typeTagPtr_; }
 
     // the unchecked methods below don't check whether the argument actually
     // is of the specified type. they should only be used if you've already
     // checked the type tag or the associated IsType() method.
+    //
+    // the TryAs methods return std::nullopt instead of throwing when the
+    // argument is missing or is of another type.
 
     bool IsBool() const
     { return *typeTagPtr_ == TRUE_TYPE_TAG || *typeTagPtr_ == FALSE_TYPE_TAG; }
     bool AsBool() const
     {
       if( !typeTagPtr_ )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
       else if( *typeTagPtr_ == TRUE_TYPE_TAG )
         return true;
       else if( *typeTagPtr_ == FALSE_TYPE_TAG )
         return false;
       else
-        throw WrongArgumentTypeException();
+        OSCPACK_THROW( WrongArgumentTypeException() );
     }
     bool AsBoolUnchecked() const
     {
       if( !typeTagPtr_ )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
       else if( *typeTagPtr_ == TRUE_TYPE_TAG )
         return true;
       else
         return false;
     }
+    std::optional<bool> TryAsBool() const
+    {
+      if( typeTagPtr_ && IsBool() )
+        return *typeTagPtr_ == TRUE_TYPE_TAG;
+      return std::nullopt;
+    }
 
     bool IsNil() const { return *typeTagPtr_ == NIL_TYPE_TAG; }
     bool IsInfinitum() const { return *typeTagPtr_ == INFINITUM_TYPE_TAG; }
@@ -254,11 +420,11 @@ class ReceivedMessageArgument{
     int32_t AsInt32() const
     {
       if( !typeTagPtr_ )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
       else if( *typeTagPtr_ == INT32_TYPE_TAG )
         return AsInt32Unchecked();
       else
-        throw WrongArgumentTypeException();
+        OSCPACK_THROW( WrongArgumentTypeException() );
     }
     int32_t AsInt32Unchecked() const
     {
@@ -278,16 +444,22 @@ class ReceivedMessageArgument{
       return *(int32_t*)argumentPtr_;
 #endif
     }
+    std::optional<int32_t> TryAsInt32() const
+    {
+      if( typeTagPtr_ && *typeTagPtr_ == INT32_TYPE_TAG )
+        return AsInt32Unchecked();
+      return std::nullopt;
+    }
 
     bool IsFloat() const { return *typeTagPtr_ == FLOAT_TYPE_TAG; }
     float AsFloat() const
     {
       if( !typeTagPtr_ )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
       else if( *typeTagPtr_ == FLOAT_TYPE_TAG )
         return AsFloatUnchecked();
       else
-        throw WrongArgumentTypeException();
+        OSCPACK_THROW( WrongArgumentTypeException() );
     }
     float AsFloatUnchecked() const
     {
@@ -307,91 +479,127 @@ class ReceivedMessageArgument{
       return *(float*)argumentPtr_;
 #endif
     }
+    std::optional<float> TryAsFloat() const
+    {
+      if( typeTagPtr_ && *typeTagPtr_ == FLOAT_TYPE_TAG )
+        return AsFloatUnchecked();
+      return std::nullopt;
+    }
 
     bool IsChar() const { return *typeTagPtr_ == CHAR_TYPE_TAG; }
     char AsChar() const
     {
       if( !typeTagPtr_ )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
       else if( *typeTagPtr_ == CHAR_TYPE_TAG )
         return AsCharUnchecked();
       else
-        throw WrongArgumentTypeException();
+        OSCPACK_THROW( WrongArgumentTypeException() );
     }
     char AsCharUnchecked() const
     {
       return (char)ToInt32( argumentPtr_ );
     }
+    std::optional<char> TryAsChar() const
+    {
+      if( typeTagPtr_ && *typeTagPtr_ == CHAR_TYPE_TAG )
+        return AsCharUnchecked();
+      return std::nullopt;
+    }
 
     bool IsRgbaColor() const { return *typeTagPtr_ == RGBA_COLOR_TYPE_TAG; }
     uint32_t AsRgbaColor() const
     {
       if( !typeTagPtr_ )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
       else if( *typeTagPtr_ == RGBA_COLOR_TYPE_TAG )
         return AsRgbaColorUnchecked();
       else
-        throw WrongArgumentTypeException();
+        OSCPACK_THROW( WrongArgumentTypeException() );
     }
     uint32_t AsRgbaColorUnchecked() const
     {
       return ToUInt32( argumentPtr_ );
     }
+    std::optional<uint32_t> TryAsRgbaColor() const
+    {
+      if( typeTagPtr_ && *typeTagPtr_ == RGBA_COLOR_TYPE_TAG )
+        return AsRgbaColorUnchecked();
+      return std::nullopt;
+    }
 
     bool IsMidiMessage() const { return *typeTagPtr_ == MIDI_MESSAGE_TYPE_TAG; }
     uint32_t AsMidiMessage() const
     {
       if( !typeTagPtr_ )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
       else if( *typeTagPtr_ == MIDI_MESSAGE_TYPE_TAG )
         return AsMidiMessageUnchecked();
       else
-        throw WrongArgumentTypeException();
+        OSCPACK_THROW( WrongArgumentTypeException() );
     }
     uint32_t AsMidiMessageUnchecked() const
     {
       return ToUInt32( argumentPtr_ );
     }
+    std::optional<uint32_t> TryAsMidiMessage() const
+    {
+      if( typeTagPtr_ && *typeTagPtr_ == MIDI_MESSAGE_TYPE_TAG )
+        return AsMidiMessageUnchecked();
+      return std::nullopt;
+    }
 
     bool IsInt64() const { return *typeTagPtr_ == INT64_TYPE_TAG; }
     int64_t AsInt64() const
     {
       if( !typeTagPtr_ )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
       else if( *typeTagPtr_ == INT64_TYPE_TAG )
         return AsInt64Unchecked();
       else
-        throw WrongArgumentTypeException();
+        OSCPACK_THROW( WrongArgumentTypeException() );
     }
     int64_t AsInt64Unchecked() const
     {
       return ToInt64( argumentPtr_ );
     }
+    std::optional<int64_t> TryAsInt64() const
+    {
+      if( typeTagPtr_ && *typeTagPtr_ == INT64_TYPE_TAG )
+        return AsInt64Unchecked();
+      return std::nullopt;
+    }
 
     bool IsTimeTag() const { return *typeTagPtr_ == TIME_TAG_TYPE_TAG; }
     uint64_t AsTimeTag() const
     {
       if( !typeTagPtr_ )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
       else if( *typeTagPtr_ == TIME_TAG_TYPE_TAG )
         return AsTimeTagUnchecked();
       else
-        throw WrongArgumentTypeException();
+        OSCPACK_THROW( WrongArgumentTypeException() );
     }
     uint64_t AsTimeTagUnchecked() const
     {
       return ToUInt64( argumentPtr_ );
     }
+    std::optional<uint64_t> TryAsTimeTag() const
+    {
+      if( typeTagPtr_ && *typeTagPtr_ == TIME_TAG_TYPE_TAG )
+        return AsTimeTagUnchecked();
+      return std::nullopt;
+    }
 
     bool IsDouble() const { return *typeTagPtr_ == DOUBLE_TYPE_TAG; }
     double AsDouble() const
     {
       if( !typeTagPtr_ )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
       else if( *typeTagPtr_ == DOUBLE_TYPE_TAG )
         return AsDoubleUnchecked();
       else
-        throw WrongArgumentTypeException();
+        OSCPACK_THROW( WrongArgumentTypeException() );
     }
     double AsDoubleUnchecked() const
     {
@@ -415,51 +623,80 @@ class ReceivedMessageArgument{
       return *(double*)argumentPtr_;
 #endif
     }
+    std::optional<double> TryAsDouble() const
+    {
+      if( typeTagPtr_ && *typeTagPtr_ == DOUBLE_TYPE_TAG )
+        return AsDoubleUnchecked();
+      return std::nullopt;
+    }
 
     bool IsString() const { return *typeTagPtr_ == STRING_TYPE_TAG; }
     const char* AsString() const
     {
       if( !typeTagPtr_ )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
       else if( *typeTagPtr_ == STRING_TYPE_TAG )
         return argumentPtr_;
       else
-        throw WrongArgumentTypeException();
+        OSCPACK_THROW( WrongArgumentTypeException() );
     }
     const char* AsStringUnchecked() const { return argumentPtr_; }
+    std::optional<const char*> TryAsString() const
+    {
+      if( typeTagPtr_ && *typeTagPtr_ == STRING_TYPE_TAG )
+        return argumentPtr_;
+      return std::nullopt;
+    }
 
     bool IsSymbol() const { return *typeTagPtr_ == SYMBOL_TYPE_TAG; }
     const char* AsSymbol() const
     {
       if( !typeTagPtr_ )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
       else if( *typeTagPtr_ == SYMBOL_TYPE_TAG )
         return argumentPtr_;
       else
-        throw WrongArgumentTypeException();
+        OSCPACK_THROW( WrongArgumentTypeException() );
     }
     const char* AsSymbolUnchecked() const { return argumentPtr_; }
+    std::optional<const char*> TryAsSymbol() const
+    {
+      if( typeTagPtr_ && *typeTagPtr_ == SYMBOL_TYPE_TAG )
+        return argumentPtr_;
+      return std::nullopt;
+    }
 
     bool IsBlob() const { return *typeTagPtr_ == BLOB_TYPE_TAG; }
     void AsBlob( const void*& data, osc_bundle_element_size_t& size ) const
     {
       if( !typeTagPtr_ )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
       else if( *typeTagPtr_ == BLOB_TYPE_TAG )
         AsBlobUnchecked( data, size );
       else
-        throw WrongArgumentTypeException();
+        OSCPACK_THROW( WrongArgumentTypeException() );
     }
     void AsBlobUnchecked( const void*& data, osc_bundle_element_size_t& size ) const
     {
       // read blob size as an unsigned int then validate
       osc_bundle_element_size_t sizeResult = (osc_bundle_element_size_t)ToUInt32( argumentPtr_ );
       if( !IsValidElementSizeValue(sizeResult) )
-        throw MalformedMessageException("invalid blob size");
+        OSCPACK_THROW( MalformedMessageException("invalid blob size") );
 
       size = sizeResult;
       data = (void*)(argumentPtr_+ oscpack::OSC_SIZEOF_INT32);
     }
+    std::optional<Blob> TryAsBlob() const
+    {
+      if( !typeTagPtr_ || *typeTagPtr_ != BLOB_TYPE_TAG )
+        return std::nullopt;
+
+      osc_bundle_element_size_t size = (osc_bundle_element_size_t)ToUInt32( argumentPtr_ );
+      if( !IsValidElementSizeValue(size) )
+        return std::nullopt;
+
+      return Blob( argumentPtr_ + oscpack::OSC_SIZEOF_INT32, size );
+    }
 
     bool IsArrayBegin() const { return *typeTagPtr_ == ARRAY_BEGIN_TYPE_TAG; }
     bool IsArrayEnd() const { return *typeTagPtr_ == ARRAY_END_TYPE_TAG; }
@@ -469,7 +706,7 @@ class ReceivedMessageArgument{
     {
       // it is only valid to call ComputeArrayItemCount when the argument is the array start marker
       if( !IsArrayBegin() )
-        throw WrongArgumentTypeException();
+        OSCPACK_THROW( WrongArgumentTypeException() );
 
       std::size_t result = 0;
       unsigned int level = 0;
@@ -529,6 +766,8 @@ class ReceivedMessageArgumentIterator{
     friend bool operator==(const ReceivedMessageArgumentIterator& lhs,
                            const ReceivedMessageArgumentIterator& rhs );
 
+    friend class ReceivedMessageArgumentStream;
+
   private:
     ReceivedMessageArgument value_;
 
@@ -630,6 +869,31 @@ class ReceivedMessageArgumentStream{
 
     ReceivedMessageArgumentIterator p_, end_;
 
+    // read count consecutive 32 bit arguments with the given type tag
+    void ReadValues32( char typeTag, void *values, std::size_t count )
+    {
+      if( count == 0 )
+        return;
+
+      if( Eos() )
+        OSCPACK_THROW( MissingArgumentException() );
+
+      ReceivedMessageArgument& argument = p_.value_;
+      std::size_t available = end_.value_.typeTagPtr_ - argument.typeTagPtr_;
+      std::size_t matching = detail::CountLeadingBytes( argument.typeTagPtr_, std::min( count, available ), typeTag );
+      if( matching != count ){
+        if( matching == available )
+          OSCPACK_THROW( MissingArgumentException() );
+        else
+          OSCPACK_THROW( WrongArgumentTypeException() );
+      }
+
+      ToUInt32s( values, argument.argumentPtr_, count );
+
+      argument.typeTagPtr_ += count;
+      argument.argumentPtr_ += count * 4;
+    }
+
   public:
 
     // end of stream
@@ -638,7 +902,7 @@ class ReceivedMessageArgumentStream{
     ReceivedMessageArgumentStream& operator>>( bool& rhs )
     {
       if( Eos() )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
 
       rhs = (*p_++).AsBool();
       return *this;
@@ -646,12 +910,53 @@ class ReceivedMessageArgumentStream{
 
     // not sure if it would be useful to stream Nil and Infinitum
     // for now it's not possible
-    // same goes for array boundaries
+
+    // array boundaries, e.g. args >> BeginArray() >> ... >> EndArray()
+    ReceivedMessageArgumentStream& operator>>( const ArrayInitiator& rhs )
+    {
+      (void) rhs; // suppress unused parameter warning
+
+      if( Eos() )
+        OSCPACK_THROW( MissingArgumentException() );
+      if( p_->TypeTag() != ARRAY_BEGIN_TYPE_TAG )
+        OSCPACK_THROW( WrongArgumentTypeException() );
+
+      ++p_;
+      return *this;
+    }
+
+    ReceivedMessageArgumentStream& operator>>( const ArrayTerminator& rhs )
+    {
+      (void) rhs; // suppress unused parameter warning
+
+      if( Eos() )
+        OSCPACK_THROW( MissingArgumentException() );
+      if( p_->TypeTag() != ARRAY_END_TYPE_TAG )
+        OSCPACK_THROW( WrongArgumentTypeException() );
+
+      ++p_;
+      return *this;
+    }
+
+    // Read count float or int32 arguments at once, converting them from
+    // network byte order as a block. Throws WrongArgumentTypeException if
+    // any of them has a different type (nothing is read in that case).
+    ReceivedMessageArgumentStream& ReadFloats( float *values, std::size_t count )
+    {
+      ReadValues32( FLOAT_TYPE_TAG, values, count );
+      return *this;
+    }
+
+    ReceivedMessageArgumentStream& ReadInt32s( int32_t *values, std::size_t count )
+    {
+      ReadValues32( INT32_TYPE_TAG, values, count );
+      return *this;
+    }
 
     ReceivedMessageArgumentStream& operator>>( int32_t& rhs )
     {
       if( Eos() )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
 
       rhs = (*p_++).AsInt32();
       return *this;
@@ -660,7 +965,7 @@ class ReceivedMessageArgumentStream{
     ReceivedMessageArgumentStream& operator>>( float& rhs )
     {
       if( Eos() )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
 
       rhs = (*p_++).AsFloat();
       return *this;
@@ -669,7 +974,7 @@ class ReceivedMessageArgumentStream{
     ReceivedMessageArgumentStream& operator>>( char& rhs )
     {
       if( Eos() )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
 
       rhs = (*p_++).AsChar();
       return *this;
@@ -678,7 +983,7 @@ class ReceivedMessageArgumentStream{
     ReceivedMessageArgumentStream& operator>>( RgbaColor& rhs )
     {
       if( Eos() )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
 
       rhs.value = (*p_++).AsRgbaColor();
       return *this;
@@ -687,7 +992,7 @@ class ReceivedMessageArgumentStream{
     ReceivedMessageArgumentStream& operator>>( MidiMessage& rhs )
     {
       if( Eos() )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
 
       rhs.value = (*p_++).AsMidiMessage();
       return *this;
@@ -696,7 +1001,7 @@ class ReceivedMessageArgumentStream{
     ReceivedMessageArgumentStream& operator>>( int64_t& rhs )
     {
       if( Eos() )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
 
       rhs = (*p_++).AsInt64();
       return *this;
@@ -705,7 +1010,7 @@ class ReceivedMessageArgumentStream{
     ReceivedMessageArgumentStream& operator>>( TimeTag& rhs )
     {
       if( Eos() )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
 
       rhs.value = (*p_++).AsTimeTag();
       return *this;
@@ -714,7 +1019,7 @@ class ReceivedMessageArgumentStream{
     ReceivedMessageArgumentStream& operator>>( double& rhs )
     {
       if( Eos() )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
 
       rhs = (*p_++).AsDouble();
       return *this;
@@ -723,7 +1028,7 @@ class ReceivedMessageArgumentStream{
     ReceivedMessageArgumentStream& operator>>( Blob& rhs )
     {
       if( Eos() )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
 
       (*p_++).AsBlob( rhs.data, rhs.size );
       return *this;
@@ -732,7 +1037,7 @@ class ReceivedMessageArgumentStream{
     ReceivedMessageArgumentStream& operator>>( const char*& rhs )
     {
       if( Eos() )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
 
       rhs = (*p_++).AsString();
       return *this;
@@ -741,7 +1046,7 @@ class ReceivedMessageArgumentStream{
     ReceivedMessageArgumentStream& operator>>( Symbol& rhs )
     {
       if( Eos() )
-        throw MissingArgumentException();
+        OSCPACK_THROW( MissingArgumentException() );
 
       rhs.value = (*p_++).AsSymbol();
       return *this;
@@ -752,7 +1057,7 @@ class ReceivedMessageArgumentStream{
       (void) rhs; // suppress unused parameter warning
 
       if( !Eos() )
-        throw ExcessArgumentException();
+        OSCPACK_THROW( ExcessArgumentException() );
 
       return *this;
     }
@@ -760,23 +1065,23 @@ class ReceivedMessageArgumentStream{
 
 
 class ReceivedMessage{
-    void Init( const char *message, osc_bundle_element_size_t size )
+    ParseStatus Init( const char *message, osc_bundle_element_size_t size )
     {
       if( !IsValidElementSizeValue(size) )
-        throw MalformedMessageException( "invalid message size" );
+        return PARSE_INVALID_MESSAGE_SIZE;
 
       if( size == 0 )
-        throw MalformedMessageException( "zero length messages not permitted" );
+        return PARSE_ZERO_LENGTH_MESSAGE;
 
       if( !IsMultipleOf4(size) )
-        throw MalformedMessageException( "message size must be multiple of four" );
+        return PARSE_MESSAGE_SIZE_NOT_MULTIPLE_OF_4;
 
       const char *end = message + size;
 
       typeTagsBegin_ = FindStr4End( addressPattern_, end );
       if( typeTagsBegin_ == 0 ){
         // address pattern was not terminated before end
-        throw MalformedMessageException( "unterminated address pattern" );
+        return PARSE_UNTERMINATED_ADDRESS_PATTERN;
       }
 
       if( typeTagsBegin_ == end ){
@@ -787,7 +1092,7 @@ class ReceivedMessage{
 
       }else{
         if( *typeTagsBegin_ != ',' )
-          throw MalformedMessageException( "type tags not present" );
+          return PARSE_TYPE_TAGS_NOT_PRESENT;
 
         if( *(typeTagsBegin_ + 1) == '\0' ){
           // zero length type tags
@@ -800,7 +1105,7 @@ class ReceivedMessage{
 
           arguments_ = FindStr4End( typeTagsBegin_, end );
           if( arguments_ == 0 ){
-            throw MalformedMessageException( "type tags were not terminated before end of message" );
+            return PARSE_UNTERMINATED_TYPE_TAGS;
           }
 
           ++typeTagsBegin_; // advance past initial ','
@@ -809,7 +1114,21 @@ class ReceivedMessage{
           const char *argument = arguments_;
           unsigned int arrayLevel = 0;
 
-          do{
+          while( *typeTag != '\0' ){
+#if defined(OSCPACK_SIMD)
+            // skip runs of fixed size arguments with a single bounds check.
+            // the type tags are followed by at least arguments_ - typeTag bytes
+            std::size_t fixedArgumentsSize = 0;
+            const char *fixedTypeTagsEnd = detail::SkipFixedSizeTypeTags( typeTag, arguments_, fixedArgumentsSize );
+            if( fixedTypeTagsEnd != typeTag ){
+              if( fixedArgumentsSize > (std::size_t)(end - argument) )
+                return PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE;
+              argument += fixedArgumentsSize;
+              typeTag = fixedTypeTagsEnd;
+              continue;
+            }
+#endif
+
             switch( *typeTag ){
               case TRUE_TYPE_TAG:
               case FALSE_TYPE_TAG:
@@ -838,10 +1157,10 @@ class ReceivedMessage{
               case MIDI_MESSAGE_TYPE_TAG:
 
                 if( argument == end )
-                  throw MalformedMessageException( "arguments exceed message size" );
+                  return PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE;
                 argument += 4;
                 if( argument > end )
-                  throw MalformedMessageException( "arguments exceed message size" );
+                  return PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE;
                 break;
 
               case INT64_TYPE_TAG:
@@ -849,44 +1168,50 @@ class ReceivedMessage{
               case DOUBLE_TYPE_TAG:
 
                 if( argument == end )
-                  throw MalformedMessageException( "arguments exceed message size" );
+                  return PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE;
                 argument += 8;
                 if( argument > end )
-                  throw MalformedMessageException( "arguments exceed message size" );
+                  return PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE;
                 break;
 
               case STRING_TYPE_TAG:
               case SYMBOL_TYPE_TAG:
 
                 if( argument == end )
-                  throw MalformedMessageException( "arguments exceed message size" );
+                  return PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE;
                 argument = FindStr4End( argument, end );
                 if( argument == 0 )
-                  throw MalformedMessageException( "unterminated string argument" );
+                  return PARSE_UNTERMINATED_STRING_ARGUMENT;
                 break;
 
               case BLOB_TYPE_TAG:
               {
-                if( argument + oscpack::OSC_SIZEOF_INT32 > end )
-                  MalformedMessageException( "arguments exceed message size" );
+                if( end - argument < oscpack::OSC_SIZEOF_INT32 )
+                  return PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE;
 
-                // treat blob size as an unsigned int for the purposes of this calculation
+                // treat blob size as an unsigned int for the purposes of this calculation.
+                // compare before advancing so that a huge size can't wrap
+                // the argument pointer (or RoundUp4()).
                 uint32_t blobSize = ToUInt32( argument );
+                if( blobSize > (uint32_t)(end - argument - oscpack::OSC_SIZEOF_INT32) )
+                  return PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE;
+
                 argument = argument + oscpack::OSC_SIZEOF_INT32 + RoundUp4( blobSize );
                 if( argument > end )
-                  MalformedMessageException( "arguments exceed message size" );
+                  return PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE;
               }
                 break;
 
               default:
-                throw MalformedMessageException( "unknown type tag" );
+                return PARSE_UNKNOWN_TYPE_TAG;
             }
 
-          }while( *++typeTag != '\0' );
+            ++typeTag;
+          }
           typeTagsEnd_ = typeTag;
 
           if( arrayLevel !=  0 )
-            throw MalformedMessageException( "array was not terminated before end of message (expected ']' end of array tag)" );
+            return PARSE_UNTERMINATED_ARRAY;
         }
 
         // These invariants should be guaranteed by the above code.
@@ -897,17 +1222,48 @@ class ReceivedMessage{
         assert( argumentCount <= OSC_INT32_MAX );
 #endif
       }
+
+      return PARSE_OK;
+    }
+
+    struct Unchecked{};
+
+    // used by TryParse(), Init() sets the remaining members
+    ReceivedMessage( const char *message, osc_bundle_element_size_t size, Unchecked )
+      : addressPattern_( message ), size_{size} {}
+
+    static ParseStatus TryParse( const char *message, osc_bundle_element_size_t size,
+        std::optional<ReceivedMessage>& result )
+    {
+      ReceivedMessage m( message, size, Unchecked() );
+      ParseStatus status = m.Init( message, size );
+      if( status == PARSE_OK )
+        result.emplace( m );
+      return status;
     }
   public:
     explicit ReceivedMessage( const ReceivedPacket& packet )
       : addressPattern_( packet.Contents() ), size_{packet.Size()}
     {
-      Init( packet.Contents(), packet.Size() );
+      detail::ThrowIfFailed( Init( packet.Contents(), packet.Size() ) );
     }
     explicit ReceivedMessage( const ReceivedBundleElement& bundleElement )
       : addressPattern_( bundleElement.Contents() ), size_{bundleElement.Size()}
     {
-      Init( bundleElement.Contents(), bundleElement.Size() );
+      detail::ThrowIfFailed( Init( bundleElement.Contents(), bundleElement.Size() ) );
+    }
+
+    // non-throwing alternatives to the constructors. on success, result
+    // holds the message and PARSE_OK is returned.
+    static ParseStatus TryParse( const ReceivedPacket& packet,
+        std::optional<ReceivedMessage>& result )
+    {
+      return TryParse( packet.Contents(), packet.Size(), result );
+    }
+    static ParseStatus TryParse( const ReceivedBundleElement& bundleElement,
+        std::optional<ReceivedMessage>& result )
+    {
+      return TryParse( bundleElement.Contents(), bundleElement.Size(), result );
     }
     const char *AddressPattern() const { return addressPattern_; }
 
@@ -947,7 +1303,7 @@ class ReceivedMessage{
     const char* data() const { return addressPattern_; }
 
   private:
-    friend class OwnedMessage;
+    template< class Allocator > friend class BasicOwnedMessage;
 
     explicit ReceivedMessage(
             const char *addressPattern,
@@ -971,37 +1327,88 @@ class ReceivedMessage{
     const osc_bundle_element_size_t size_;
 };
 
-class OwnedMessage
+// A copy of a received message which remains valid after the packet
+// buffer it was received into has been reused. The copy is allocated
+// with Allocator, see OscAllocators.h for pool and arena allocators.
+template< class Allocator = std::allocator<char> >
+class BasicOwnedMessage
 {
-    explicit OwnedMessage(const ReceivedMessage& other):
-        buffer_(other.AddressPattern(), other.AddressPattern() + other.size()),
-        message_(buffer_.data(),
-                (other.typeTagsBegin_ ? buffer_.data() + (other.typeTagsBegin_ - other.addressPattern_) : (const char*)nullptr),
-                (other.typeTagsEnd_   ? buffer_.data() + (other.typeTagsEnd_   - other.addressPattern_) : (const char*)nullptr),
-                (other.arguments_     ? buffer_.data() + (other.arguments_     - other.addressPattern_) : (const char*)nullptr),
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<char> allocator_type;
+    typedef std::allocator_traits<allocator_type> traits;
+
+    static char* Copy( allocator_type& allocator, const ReceivedMessage& other )
+    {
+        char *buffer = traits::allocate( allocator, other.size() );
+        std::memcpy( buffer, other.AddressPattern(), other.size() );
+        return buffer;
+    }
+
+    static const char* Rebase( const char *buffer, const char *p, const ReceivedMessage& other )
+    {
+        return p ? buffer + (p - other.addressPattern_) : (const char*)nullptr;
+    }
+
+  public:
+    explicit BasicOwnedMessage(const ReceivedMessage& other, const Allocator& allocator = Allocator()):
+        allocator_(allocator),
+        buffer_(Copy(allocator_, other)),
+        message_(buffer_,
+                Rebase(buffer_, other.typeTagsBegin_, other),
+                Rebase(buffer_, other.typeTagsEnd_, other),
+                Rebase(buffer_, other.arguments_, other),
                 other.size())
     {
 
     }
 
-    operator const ReceivedMessage&() { return message_; }
+    // moving transfers the buffer, so message_ remains valid
+    BasicOwnedMessage(BasicOwnedMessage&& other):
+        allocator_(std::move(other.allocator_)),
+        buffer_(other.buffer_),
+        message_(other.message_)
+    {
+        other.buffer_ = nullptr;
+    }
+
+    BasicOwnedMessage(const BasicOwnedMessage&) = delete;
+    BasicOwnedMessage& operator=(const BasicOwnedMessage&) = delete;
+
+    ~BasicOwnedMessage()
+    {
+        if( buffer_ )
+            traits::deallocate( allocator_, buffer_, message_.size() );
+    }
+
+    const ReceivedMessage& Message() const { return message_; }
+    operator const ReceivedMessage&() const { return message_; }
+
   private:
-    std::vector<char> buffer_;
+    allocator_type allocator_;
+    char *buffer_;
     ReceivedMessage message_;
 };
 
+typedef BasicOwnedMessage<> OwnedMessage;
+
+// tag for constructing a ReceivedBundle that only validates its header
+// up front. each element is validated when an iterator reaches it, so
+// elements that are never visited cost nothing, but a malformed element
+// is only reported (by MalformedBundleException from the iterator) after
+// the elements preceding it have been visited.
+struct LazyBundleValidation{};
+
 class ReceivedBundle{
-    void Init( const char *bundle, osc_bundle_element_size_t size )
+    ParseStatus InitHeader( const char *bundle, osc_bundle_element_size_t size )
     {
 
       if( !IsValidElementSizeValue(size) )
-        throw MalformedBundleException( "invalid bundle size" );
+        return PARSE_INVALID_BUNDLE_SIZE;
 
       if( size < 16 )
-        throw MalformedBundleException( "packet too short for bundle" );
+        return PARSE_BUNDLE_TOO_SHORT;
 
       if( !IsMultipleOf4(size) )
-        throw MalformedBundleException( "bundle size must be multiple of four" );
+        return PARSE_BUNDLE_SIZE_NOT_MULTIPLE_OF_4;
 
       if( bundle[0] != '#'
           || bundle[1] != 'b'
@@ -1011,43 +1418,84 @@ class ReceivedBundle{
           || bundle[5] != 'l'
           || bundle[6] != 'e'
           || bundle[7] != '\0' )
-        throw MalformedBundleException( "bad bundle address pattern" );
+        return PARSE_BAD_BUNDLE_ADDRESS_PATTERN;
 
       end_ = bundle + size;
 
       timeTag_ = bundle + 8;
 
+      return PARSE_OK;
+    }
+
+    ParseStatus Init( const char *bundle, osc_bundle_element_size_t size )
+    {
+      ParseStatus status = InitHeader( bundle, size );
+      if( status != PARSE_OK )
+        return status;
+
       const char *p = timeTag_ + 8;
 
       while( p < end_ ){
-        if( p + oscpack::OSC_SIZEOF_INT32 > end_ )
-          throw MalformedBundleException( "packet too short for elementSize" );
+        status = detail::CheckBundleElement( p, end_ );
+        if( status != PARSE_OK )
+          return status;
 
-        // treat element size as an unsigned int for the purposes of this calculation
-        uint32_t elementSize = ToUInt32( p );
-        if( (elementSize & ((uint32_t)0x03)) != 0 )
-          throw MalformedBundleException( "bundle element size must be multiple of four" );
-
-        p += oscpack::OSC_SIZEOF_INT32 + elementSize;
-        if( p > end_ )
-          throw MalformedBundleException( "packet too short for bundle element" );
+        p += oscpack::OSC_SIZEOF_INT32 + ToUInt32( p );
 
         ++elementCount_;
       }
 
-      if( p != end_ )
-        throw MalformedBundleException( "bundle contents " );
+      return PARSE_OK;
+    }
+
+    struct Unchecked{};
+
+    explicit ReceivedBundle( Unchecked )
+      : elementCount_( 0 ), lazy_( false ) {}
+
+    static ParseStatus TryParse( const char *bundle, osc_bundle_element_size_t size,
+        std::optional<ReceivedBundle>& result )
+    {
+      ReceivedBundle b{ Unchecked() };
+      ParseStatus status = b.Init( bundle, size );
+      if( status == PARSE_OK )
+        result.emplace( b );
+      return status;
     }
   public:
     explicit ReceivedBundle( const ReceivedPacket& packet )
-      : elementCount_( 0 )
+      : elementCount_( 0 ), lazy_( false )
     {
-      Init( packet.Contents(), packet.Size() );
+      detail::ThrowIfFailed( Init( packet.Contents(), packet.Size() ) );
     }
     explicit ReceivedBundle( const ReceivedBundleElement& bundleElement )
-      : elementCount_( 0 )
+      : elementCount_( 0 ), lazy_( false )
+    {
+      detail::ThrowIfFailed( Init( bundleElement.Contents(), bundleElement.Size() ) );
+    }
+
+    ReceivedBundle( const ReceivedPacket& packet, LazyBundleValidation )
+      : elementCount_( 0 ), lazy_( true )
+    {
+      detail::ThrowIfFailed( InitHeader( packet.Contents(), packet.Size() ) );
+    }
+    ReceivedBundle( const ReceivedBundleElement& bundleElement, LazyBundleValidation )
+      : elementCount_( 0 ), lazy_( true )
     {
-      Init( bundleElement.Contents(), bundleElement.Size() );
+      detail::ThrowIfFailed( InitHeader( bundleElement.Contents(), bundleElement.Size() ) );
+    }
+
+    // non-throwing alternatives to the (eagerly validating) constructors.
+    // on success, result holds the bundle and PARSE_OK is returned.
+    static ParseStatus TryParse( const ReceivedPacket& packet,
+        std::optional<ReceivedBundle>& result )
+    {
+      return TryParse( packet.Contents(), packet.Size(), result );
+    }
+    static ParseStatus TryParse( const ReceivedBundleElement& bundleElement,
+        std::optional<ReceivedBundle>& result )
+    {
+      return TryParse( bundleElement.Contents(), bundleElement.Size(), result );
     }
 
     uint64_t TimeTag() const
@@ -1055,12 +1503,27 @@ class ReceivedBundle{
       return ToUInt64( timeTag_ );
     }
 
-    uint32_t ElementCount() const { return elementCount_; }
+    bool IsLazilyValidated() const { return lazy_; }
+
+    // a lazily validated bundle counts (and validates) its elements on
+    // each call.
+    uint32_t ElementCount() const
+    {
+      if( !lazy_ )
+        return elementCount_;
+
+      uint32_t result = 0;
+      for( const_iterator i = ElementsBegin(); i != ElementsEnd(); ++i )
+        ++result;
+      return result;
+    }
 
     typedef ReceivedBundleElementIterator const_iterator;
 
     ReceivedBundleElementIterator ElementsBegin() const
     {
+      if( lazy_ )
+        return ReceivedBundleElementIterator( timeTag_ + 8, end_ );
       return ReceivedBundleElementIterator( timeTag_ + 8 );
     }
 
@@ -1073,6 +1536,7 @@ class ReceivedBundle{
     const char *timeTag_;
     const char *end_;
     uint32_t elementCount_;
+    bool lazy_;
 };
 
 
@@ -0,0 +1,383 @@
+/*
+  oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+  The text above constitutes the entire oscpack license; however,
+  the oscpack developer(s) also make the following non-binding requests:
+
+  Any person wishing to distribute modifications to the Software is
+  requested to send the modifications to the original developer so that
+  they can be incorporated into the canonical version. It is also
+  requested that these non-binding requests be included whenever the
+  above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCSIMD_H
+#define INCLUDED_OSCPACK_OSCSIMD_H
+
+/*
+    Vectorised helpers for the parsing hot paths (see FindStr4End() and
+    ReceivedMessage::Init()) and for converting arrays of 32 bit values
+    and their type tags (see FromUInt32s()). One of OSCPACK_SIMD_SSE2 or OSCPACK_SIMD_NEON
+    is defined when the target supports it; otherwise the callers use
+    their scalar loops.
+
+    To always use the scalar code define OSCPACK_DISABLE_SIMD, e.g.:
+
+    $ g++ -DOSCPACK_DISABLE_SIMD ...
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+#include "OscHostEndianness.h"
+#include "OscTypes.h"
+
+#if defined(OSCPACK_DISABLE_SIMD)
+
+// scalar code only
+
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+#define OSCPACK_SIMD_SSE2 1
+#include <emmintrin.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(OSC_HOST_LITTLE_ENDIAN)
+
+#define OSCPACK_SIMD_NEON 1
+#include <arm_neon.h>
+
+#endif
+
+#if defined(OSCPACK_SIMD_SSE2) || defined(OSCPACK_SIMD_NEON)
+#define OSCPACK_SIMD 1
+#endif
+
+#if defined(OSCPACK_SIMD) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace oscpack{
+namespace detail{
+
+#if defined(OSCPACK_SIMD)
+
+inline unsigned int CountTrailingZeros( uint64_t x ) // x != 0
+{
+#if defined(_MSC_VER)
+    unsigned long result;
+#if defined(_M_X64) || defined(_M_ARM64)
+    _BitScanForward64( &result, x );
+#else
+    if( (uint32_t)x != 0 )
+        _BitScanForward( &result, (uint32_t)x );
+    else{
+        _BitScanForward( &result, (uint32_t)(x >> 32) );
+        result += 32;
+    }
+#endif
+    return (unsigned int)result;
+#else
+    return (unsigned int)__builtin_ctzll( x );
+#endif
+}
+
+
+// Masks of the 16 bytes at p. With SSE2 each byte is represented by one
+// bit, with NEON by four; BITS_PER_BYTE abstracts over this.
+
+#if defined(OSCPACK_SIMD_SSE2)
+
+typedef __m128i ByteVector;
+static const constexpr unsigned int BITS_PER_BYTE = 1;
+
+inline ByteVector LoadBytes( const char *p )
+{
+    return _mm_loadu_si128( reinterpret_cast<const __m128i*>(p) );
+}
+
+inline void StoreBytes( char *p, ByteVector v )
+{
+    _mm_storeu_si128( reinterpret_cast<__m128i*>(p), v );
+}
+
+// reverse the byte order of each 4-byte word
+inline ByteVector ByteSwap32( ByteVector v )
+{
+#if defined(__SSSE3__)
+    return _mm_shuffle_epi8( v, _mm_setr_epi8( 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 ) );
+#else
+    v = _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+    v = _mm_shufflelo_epi16( v, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+    return _mm_shufflehi_epi16( v, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+#endif
+}
+
+// reverse the order of the 16 bytes
+inline ByteVector ReverseBytes( ByteVector v )
+{
+#if defined(__SSSE3__)
+    return _mm_shuffle_epi8( v, _mm_setr_epi8( 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 ) );
+#else
+    return ByteSwap32( _mm_shuffle_epi32( v, _MM_SHUFFLE( 0, 1, 2, 3 ) ) );
+#endif
+}
+
+inline ByteVector EqualBytes( ByteVector a, ByteVector b )
+{
+    return _mm_cmpeq_epi8( a, b );
+}
+
+inline ByteVector EqualBytes( ByteVector v, char c )
+{
+    return _mm_cmpeq_epi8( v, _mm_set1_epi8( c ) );
+}
+
+inline ByteVector OrBytes( ByteVector a, ByteVector b )
+{
+    return _mm_or_si128( a, b );
+}
+
+inline ByteVector AndBytes( ByteVector a, ByteVector b )
+{
+    return _mm_and_si128( a, b );
+}
+
+inline ByteVector SplatBytes( char c )
+{
+    return _mm_set1_epi8( c );
+}
+
+// 0xFF for the first count bytes, 0 for the others
+inline ByteVector PrefixBytes( unsigned int count )
+{
+    return _mm_cmplt_epi8( _mm_setr_epi8( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 ),
+            _mm_set1_epi8( (char)count ) );
+}
+
+inline std::size_t SumBytes( ByteVector v )
+{
+    __m128i sums = _mm_sad_epu8( v, _mm_setzero_si128() );
+    return (std::size_t)_mm_cvtsi128_si32( sums ) + (std::size_t)_mm_cvtsi128_si32( _mm_srli_si128( sums, 8 ) );
+}
+
+inline uint64_t ByteMask( ByteVector v )
+{
+    return (uint32_t)_mm_movemask_epi8( v );
+}
+
+#else // OSCPACK_SIMD_NEON
+
+typedef uint8x16_t ByteVector;
+static const constexpr unsigned int BITS_PER_BYTE = 4;
+
+inline ByteVector LoadBytes( const char *p )
+{
+    return vld1q_u8( reinterpret_cast<const uint8_t*>(p) );
+}
+
+inline void StoreBytes( char *p, ByteVector v )
+{
+    vst1q_u8( reinterpret_cast<uint8_t*>(p), v );
+}
+
+// reverse the byte order of each 4-byte word
+inline ByteVector ByteSwap32( ByteVector v )
+{
+    return vrev32q_u8( v );
+}
+
+// reverse the order of the 16 bytes
+inline ByteVector ReverseBytes( ByteVector v )
+{
+    v = vrev64q_u8( v );
+    return vextq_u8( v, v, 8 );
+}
+
+inline ByteVector EqualBytes( ByteVector a, ByteVector b )
+{
+    return vceqq_u8( a, b );
+}
+
+inline ByteVector EqualBytes( ByteVector v, char c )
+{
+    return vceqq_u8( v, vdupq_n_u8( (uint8_t)c ) );
+}
+
+inline ByteVector OrBytes( ByteVector a, ByteVector b )
+{
+    return vorrq_u8( a, b );
+}
+
+inline ByteVector AndBytes( ByteVector a, ByteVector b )
+{
+    return vandq_u8( a, b );
+}
+
+inline ByteVector SplatBytes( char c )
+{
+    return vdupq_n_u8( (uint8_t)c );
+}
+
+// 0xFF for the first count bytes, 0 for the others
+inline ByteVector PrefixBytes( unsigned int count )
+{
+    static const uint8_t indices[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+    return vcltq_u8( vld1q_u8( indices ), vdupq_n_u8( (uint8_t)count ) );
+}
+
+inline std::size_t SumBytes( ByteVector v )
+{
+#if defined(__aarch64__) || defined(_M_ARM64)
+    return vaddlvq_u8( v );
+#else
+    uint64x2_t sums = vpaddlq_u32( vpaddlq_u16( vpaddlq_u8( v ) ) );
+    return (std::size_t)(vgetq_lane_u64( sums, 0 ) + vgetq_lane_u64( sums, 1 ));
+#endif
+}
+
+inline uint64_t ByteMask( ByteVector v )
+{
+    // narrow each 0x00/0xFF byte to a nibble
+    uint8x8_t narrowed = vshrn_n_u16( vreinterpretq_u16_u8( v ), 4 );
+    return vget_lane_u64( vreinterpret_u64_u8( narrowed ), 0 );
+}
+
+#endif
+
+// mask of the last byte of each of the four 4-byte words
+static const constexpr uint64_t WORD_LAST_BYTES_MASK =
+        BITS_PER_BYTE == 1 ? 0x8888ULL : 0xF000F000F000F000ULL;
+
+
+// Returns the offset just past the first of the 16 bytes at p that ends
+// a 4-byte word and is zero, or 0 if there is none. This is the test
+// FindStr4End() applies to each word.
+inline std::size_t FindStr4Terminator16( const char *p )
+{
+    uint64_t mask = ByteMask( EqualBytes( LoadBytes( p ), '\0' ) ) & WORD_LAST_BYTES_MASK;
+    if( mask == 0 )
+        return 0;
+    return CountTrailingZeros( mask ) / BITS_PER_BYTE + 1;
+}
+
+
+// true if any of the 64 bytes at p ends a 4-byte word and is zero
+inline bool HasStr4Terminator64( const char *p )
+{
+    ByteVector zero = OrBytes(
+            OrBytes( EqualBytes( LoadBytes( p ), '\0' ), EqualBytes( LoadBytes( p + 16 ), '\0' ) ),
+            OrBytes( EqualBytes( LoadBytes( p + 32 ), '\0' ), EqualBytes( LoadBytes( p + 48 ), '\0' ) ) );
+    return (ByteMask( zero ) & WORD_LAST_BYTES_MASK) != 0;
+}
+
+
+// the argument size of a fixed-size type tag, or -1 for other tags
+inline int FixedSizeTypeTagSize( char typeTag )
+{
+    switch( typeTag ){
+        case TRUE_TYPE_TAG:
+        case FALSE_TYPE_TAG:
+        case NIL_TYPE_TAG:
+        case INFINITUM_TYPE_TAG:
+            return 0;
+        case INT32_TYPE_TAG:
+        case FLOAT_TYPE_TAG:
+        case CHAR_TYPE_TAG:
+        case RGBA_COLOR_TYPE_TAG:
+        case MIDI_MESSAGE_TYPE_TAG:
+            return 4;
+        case INT64_TYPE_TAG:
+        case TIME_TAG_TYPE_TAG:
+        case DOUBLE_TYPE_TAG:
+            return 8;
+        default:
+            return -1;
+    }
+}
+
+
+// Skips the run of fixed-size type tags (4 byte, 8 byte and zero length
+// arguments, but not array brackets) at the start of typeTag, 16 tags at
+// a time while typeTag + 16 <= limit. Returns the first tag not consumed
+// and adds the size of the skipped arguments to argumentsSize.
+inline const char *SkipFixedSizeTypeTags( const char *typeTag, const char *limit, std::size_t& argumentsSize )
+{
+    static const constexpr uint64_t ALL_BYTES_MASK = BITS_PER_BYTE == 1 ? 0xFFFFULL : ~0ULL;
+
+    // runs of a single tag (e.g. ,ffff...) only need one comparison
+    int uniformSize = FixedSizeTypeTagSize( *typeTag );
+    if( uniformSize >= 0 ){
+        ByteVector uniform = SplatBytes( *typeTag );
+        while( limit - typeTag >= 16
+                && ByteMask( EqualBytes( LoadBytes( typeTag ), uniform ) ) == ALL_BYTES_MASK ){
+            argumentsSize += 16 * uniformSize;
+            typeTag += 16;
+        }
+    }
+
+    while( limit - typeTag >= 16 ){
+        ByteVector tags = LoadBytes( typeTag );
+
+        ByteVector size4 = OrBytes(
+                OrBytes( EqualBytes( tags, INT32_TYPE_TAG ), EqualBytes( tags, FLOAT_TYPE_TAG ) ),
+                OrBytes( OrBytes( EqualBytes( tags, CHAR_TYPE_TAG ), EqualBytes( tags, RGBA_COLOR_TYPE_TAG ) ),
+                        EqualBytes( tags, MIDI_MESSAGE_TYPE_TAG ) ) );
+        ByteVector size8 = OrBytes(
+                OrBytes( EqualBytes( tags, INT64_TYPE_TAG ), EqualBytes( tags, TIME_TAG_TYPE_TAG ) ),
+                EqualBytes( tags, DOUBLE_TYPE_TAG ) );
+        ByteVector size0 = OrBytes(
+                OrBytes( EqualBytes( tags, TRUE_TYPE_TAG ), EqualBytes( tags, FALSE_TYPE_TAG ) ),
+                OrBytes( EqualBytes( tags, NIL_TYPE_TAG ), EqualBytes( tags, INFINITUM_TYPE_TAG ) ) );
+
+        // the argument size of each tag
+        ByteVector sizes = OrBytes( AndBytes( size4, SplatBytes( 4 ) ), AndBytes( size8, SplatBytes( 8 ) ) );
+
+        uint64_t other = ~ByteMask( OrBytes( OrBytes( size4, size8 ), size0 ) ) & ALL_BYTES_MASK;
+
+        if( other == 0 ){
+            argumentsSize += SumBytes( sizes );
+            typeTag += 16;
+        }else{
+            unsigned int count = CountTrailingZeros( other ) / BITS_PER_BYTE;
+            argumentsSize += SumBytes( AndBytes( sizes, PrefixBytes( count ) ) );
+            typeTag += count;
+            break;
+        }
+    }
+
+    return typeTag;
+}
+
+#endif /* OSCPACK_SIMD */
+
+} // namespace detail
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_OSCSIMD_H */
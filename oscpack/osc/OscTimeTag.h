@@ -0,0 +1,108 @@
+/*
+  oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+  The text above constitutes the entire oscpack license; however,
+  the oscpack developer(s) also make the following non-binding requests:
+
+  Any person wishing to distribute modifications to the Software is
+  requested to send the modifications to the original developer so that
+  they can be incorporated into the canonical version. It is also
+  requested that these non-binding requests be included whenever the
+  above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCTIMETAG_H
+#define INCLUDED_OSCPACK_OSCTIMETAG_H
+
+#include <chrono>
+#include <cstdint>
+
+
+namespace oscpack{
+
+// OSC time tags are 64-bit NTP timestamps: seconds since 1 January 1900
+// in the upper 32 bits and fractional seconds in the lower 32 bits.
+
+// the time tag value meaning "immediately"
+const uint64_t IMMEDIATE_TIME_TAG = 1;
+
+// seconds between the NTP epoch (1900) and the unix epoch (1970)
+const uint64_t NTP_UNIX_EPOCH_OFFSET_SECONDS = 2208988800u;
+
+// convert a time in nanoseconds since the unix epoch, such as
+// ReceivedDatagram::receiveTimeNs, to a time tag
+inline uint64_t TimeTagFromUnixTimeNs( int64_t ns )
+{
+    int64_t seconds = ns / 1000000000;
+    int64_t remainder = ns % 1000000000;
+    if( remainder < 0 ){
+        remainder += 1000000000;
+        --seconds;
+    }
+
+    uint64_t fraction = ((uint64_t)remainder << 32) / 1000000000u;
+    return ((uint64_t)(seconds + NTP_UNIX_EPOCH_OFFSET_SECONDS) << 32) | fraction;
+}
+
+// the inverse of TimeTagFromUnixTimeNs(), exact for the time tags it
+// returns since the fraction is rounded up
+inline int64_t UnixTimeNsFromTimeTag( uint64_t timeTag )
+{
+    int64_t seconds = (int64_t)(timeTag >> 32) - (int64_t)NTP_UNIX_EPOCH_OFFSET_SECONDS;
+    int64_t ns = (int64_t)(((timeTag & 0xFFFFFFFFu) * 1000000000u + 0xFFFFFFFFu) >> 32);
+    return seconds * 1000000000 + ns;
+}
+
+inline uint64_t TimeTagFromSystemTime( std::chrono::system_clock::time_point t )
+{
+    using namespace std::chrono;
+    return TimeTagFromUnixTimeNs( duration_cast<nanoseconds>( t.time_since_epoch() ).count() );
+}
+
+inline std::chrono::system_clock::time_point SystemTimeFromTimeTag( uint64_t timeTag )
+{
+    using namespace std::chrono;
+    int64_t seconds = (int64_t)(timeTag >> 32) - (int64_t)NTP_UNIX_EPOCH_OFFSET_SECONDS;
+    int64_t ns = (int64_t)(((timeTag & 0xFFFFFFFFu) * 1000000000u) >> 32);
+    return system_clock::time_point(
+            duration_cast<system_clock::duration>( nanoseconds( seconds * 1000000000 + ns ) ) );
+}
+
+inline uint64_t TimeTagNow()
+{
+    return TimeTagFromSystemTime( std::chrono::system_clock::now() );
+}
+
+// the signed difference later - earlier in seconds. Correct across the
+// NTP era rollover for time tags less than 68 years apart.
+inline double TimeTagDifferenceSeconds( uint64_t later, uint64_t earlier )
+{
+    return (double)(int64_t)(later - earlier) * (1.0 / 4294967296.0);
+}
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_OSCTIMETAG_H */
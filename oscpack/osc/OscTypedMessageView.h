@@ -0,0 +1,163 @@
+/*
+  oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+  The text above constitutes the entire oscpack license; however,
+  the oscpack developer(s) also make the following non-binding requests:
+
+  Any person wishing to distribute modifications to the Software is
+  requested to send the modifications to the original developer so that
+  they can be incorporated into the canonical version. It is also
+  requested that these non-binding requests be included whenever the
+  above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_OSCTYPEDMESSAGEVIEW_H
+#define INCLUDED_OSCPACK_OSCTYPEDMESSAGEVIEW_H
+
+#include <array>
+#include <cstring>
+#include <tuple>
+#include <utility>
+
+#include "OscReceivedElements.h"
+#include "OscTypesTraits.h"
+
+
+namespace oscpack{
+
+// A view of a message with a known shape: arguments of the fixed-size
+// types Ts (e.g. int32_t, float, double). The message is validated by
+// comparing its padded type tag string against the expected one with a
+// single memcmp and checking the total size, after which every argument
+// is at a compile-time offset.
+//
+// The view can be constructed directly from packet data, without
+// constructing a ReceivedMessage:
+//
+//     TypedMessageView<int32_t, float, float> fader( data, size );
+//     if( fader ){
+//         std::tuple<int32_t, float, float> v = fader.Values();
+//         ...
+//     }
+//
+// Messages without a type tag string (allowed by older OSC versions) never
+// match. The view refers to the packet data, which must outlive it.
+template< class... Ts >
+class TypedMessageView{
+    static_assert( (true && ... && OscArgumentTraits<Ts>::is_fixed_size),
+            "TypedMessageView only supports fixed-size argument types" );
+
+    // slot size includes comma and null terminator
+    static constexpr std::size_t typeTagSlotSize_ = (sizeof...(Ts) + 2 + 3) & ~(std::size_t)3;
+    static constexpr std::size_t argumentsSize_ = (std::size_t(0) + ... + OscArgumentTraits<Ts>::fixed_size);
+
+    static constexpr std::array<char, typeTagSlotSize_> MakeTypeTags()
+    {
+        std::array<char, typeTagSlotSize_> result{};
+        const char typeTags[] = { ',', OscArgumentTraits<Ts>::type_tag... };
+        for( std::size_t i=0; i < sizeof(typeTags); ++i )
+            result[i] = typeTags[i];
+        return result;
+    }
+
+    static constexpr std::array<std::size_t, sizeof...(Ts) + 1> MakeOffsets()
+    {
+        std::array<std::size_t, sizeof...(Ts) + 1> result{};
+        const std::size_t sizes[] = { OscArgumentTraits<Ts>::fixed_size..., 0 };
+        for( std::size_t i=0; i < sizeof...(Ts); ++i )
+            result[i + 1] = result[i] + sizes[i];
+        return result;
+    }
+
+    static constexpr std::array<char, typeTagSlotSize_> typeTags_ = MakeTypeTags();
+    static constexpr std::array<std::size_t, sizeof...(Ts) + 1> offsets_ = MakeOffsets();
+
+    const char *addressPattern_;
+    const char *arguments_; // 0 if the message doesn't match
+
+    void Init( const char *message, std::size_t size )
+    {
+        // FindStr4End() reads whole 4 byte words
+        if( size == 0 || !IsMultipleOf4( size ) )
+            return;
+
+        const char *end = message + size;
+        const char *typeTags = FindStr4End( message, end );
+
+        if( typeTags != 0
+                && (std::size_t)(end - typeTags) == typeTagSlotSize_ + argumentsSize_
+                && std::memcmp( typeTags, typeTags_.data(), typeTagSlotSize_ ) == 0 ){
+            addressPattern_ = message;
+            arguments_ = typeTags + typeTagSlotSize_;
+        }
+    }
+
+    template< std::size_t... Is >
+    std::tuple<Ts...> Values( std::index_sequence<Is...> ) const
+    {
+        return std::tuple<Ts...>( OscArgumentTraits<Ts>::Read( arguments_ + offsets_[Is] )... );
+    }
+
+public:
+    // message and size are the contents of a packet or bundle element
+    TypedMessageView( const char *message, std::size_t size )
+        : addressPattern_( 0 )
+        , arguments_( 0 )
+    {
+        Init( message, size );
+    }
+
+    explicit TypedMessageView( const ReceivedMessage& m )
+        : addressPattern_( 0 )
+        , arguments_( 0 )
+    {
+        Init( m.data(), m.size() );
+    }
+
+    // true if the message has exactly the argument types Ts
+    bool IsValid() const { return arguments_ != 0; }
+    explicit operator bool() const { return IsValid(); }
+
+    // the accessors below may only be called if IsValid()
+
+    const char *AddressPattern() const { return addressPattern_; }
+
+    template< std::size_t I >
+    typename std::tuple_element< I, std::tuple<Ts...> >::type Get() const
+    {
+        typedef typename std::tuple_element< I, std::tuple<Ts...> >::type value_type;
+        return OscArgumentTraits<value_type>::Read( arguments_ + offsets_[I] );
+    }
+
+    std::tuple<Ts...> Values() const
+    {
+        return Values( std::index_sequence_for<Ts...>() );
+    }
+};
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_OSCTYPEDMESSAGEVIEW_H */
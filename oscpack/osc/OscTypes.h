@@ -121,6 +121,19 @@ struct BeginMessage{
     const char *addressPattern{};
 };
 
+// Begins a message whose type tag string is known up front, for example
+// BeginTypedMessage( "/xy", "ff" ). The type tags are written ahead of the
+// arguments, which then land in their final position, so EndMessage()
+// only has to fill in the message size. Each argument must match its type
+// tag, otherwise TypeTagMismatchException is thrown. A leading ',' in
+// typeTags is optional.
+struct BeginTypedMessage{
+    constexpr BeginTypedMessage( const char *addressPattern_, const char *typeTags_ )
+        : addressPattern( addressPattern_ ), typeTags( typeTags_ ) {}
+    const char *addressPattern{};
+    const char *typeTags{};
+};
+
 struct MessageTerminator{ };
 constexpr MessageTerminator EndMessage()
 { return {}; }
@@ -1,6 +1,9 @@
 #pragma once
 #include "OscReceivedElements.h"
 
+#include <cstring>
+#include <string>
+#include <string_view>
 #include <type_traits>
 namespace oscpack
 {
@@ -138,4 +141,176 @@ auto convert(oscpack::ReceivedMessageArgument,
   return (*OscpackFunction<val>::convert)();
 }
 
+
+// The mirror of OscpackFunction for sending: maps an argument type to its
+// type tag and encoded size, and encodes values. Used by MessageWriter.
+//
+// fixed_size is the encoded size in bytes of types with a fixed size,
+// VariableSize() the remaining size of types such as strings. Fixed-size
+// types can also be decoded with Read(), see TypedMessageView.
+template<typename T>
+struct OscArgumentTraits;
+
+namespace detail
+{
+template<char Tag, std::size_t Size>
+struct FixedSizeArgumentTraits
+{
+    static const constexpr bool is_fixed_size = true;
+    static const constexpr char type_tag = Tag;
+    static const constexpr std::size_t fixed_size = Size;
+
+    template<typename T>
+    static std::size_t VariableSize(const T&) { return 0; }
+};
+
+inline char* WriteString( char *p, const char *s, std::size_t length )
+{
+    std::size_t size = RoundUp4( (uint32_t)length + 1 );
+    std::memset( p + size - 4, 0, 4 ); // zero padding and terminator
+    std::memcpy( p, s, length );
+    return p + size;
+}
+}
+
+template<>
+struct OscArgumentTraits<int32_t> : detail::FixedSizeArgumentTraits<INT32_TYPE_TAG, 4>
+{
+    static char* Write(char *p, int32_t x) { FromInt32( p, x ); return p + 4; }
+    static int32_t Read(const char *p) { return ToInt32( p ); }
+};
+
+template<>
+struct OscArgumentTraits<int64_t> : detail::FixedSizeArgumentTraits<INT64_TYPE_TAG, 8>
+{
+    static char* Write(char *p, int64_t x) { FromInt64( p, x ); return p + 8; }
+    static int64_t Read(const char *p) { return ToInt64( p ); }
+};
+
+template<>
+struct OscArgumentTraits<float> : detail::FixedSizeArgumentTraits<FLOAT_TYPE_TAG, 4>
+{
+    static char* Write(char *p, float x)
+    {
+        uint32_t u;
+        std::memcpy( &u, &x, 4 );
+        FromUInt32( p, u );
+        return p + 4;
+    }
+    static float Read(const char *p)
+    {
+        uint32_t u = ToUInt32( p );
+        float x;
+        std::memcpy( &x, &u, 4 );
+        return x;
+    }
+};
+
+template<>
+struct OscArgumentTraits<double> : detail::FixedSizeArgumentTraits<DOUBLE_TYPE_TAG, 8>
+{
+    static char* Write(char *p, double x)
+    {
+        uint64_t u;
+        std::memcpy( &u, &x, 8 );
+        FromUInt64( p, u );
+        return p + 8;
+    }
+    static double Read(const char *p)
+    {
+        uint64_t u = ToUInt64( p );
+        double x;
+        std::memcpy( &x, &u, 8 );
+        return x;
+    }
+};
+
+template<>
+struct OscArgumentTraits<char> : detail::FixedSizeArgumentTraits<CHAR_TYPE_TAG, 4>
+{
+    static char* Write(char *p, char x) { FromInt32( p, x ); return p + 4; }
+    static char Read(const char *p) { return (char)ToInt32( p ); }
+};
+
+template<>
+struct OscArgumentTraits<RgbaColor> : detail::FixedSizeArgumentTraits<RGBA_COLOR_TYPE_TAG, 4>
+{
+    static char* Write(char *p, RgbaColor x) { FromUInt32( p, x ); return p + 4; }
+    static RgbaColor Read(const char *p) { return RgbaColor( ToUInt32( p ) ); }
+};
+
+template<>
+struct OscArgumentTraits<MidiMessage> : detail::FixedSizeArgumentTraits<MIDI_MESSAGE_TYPE_TAG, 4>
+{
+    static char* Write(char *p, MidiMessage x) { FromUInt32( p, x ); return p + 4; }
+    static MidiMessage Read(const char *p) { return MidiMessage( ToUInt32( p ) ); }
+};
+
+template<>
+struct OscArgumentTraits<TimeTag> : detail::FixedSizeArgumentTraits<TIME_TAG_TYPE_TAG, 8>
+{
+    static char* Write(char *p, TimeTag x) { FromUInt64( p, x ); return p + 8; }
+    static TimeTag Read(const char *p) { return TimeTag( ToUInt64( p ) ); }
+};
+
+template<>
+struct OscArgumentTraits<NilType> : detail::FixedSizeArgumentTraits<NIL_TYPE_TAG, 0>
+{
+    static char* Write(char *p, NilType) { return p; }
+    static NilType Read(const char *) { return {}; }
+};
+
+template<>
+struct OscArgumentTraits<InfinitumType> : detail::FixedSizeArgumentTraits<INFINITUM_TYPE_TAG, 0>
+{
+    static char* Write(char *p, InfinitumType) { return p; }
+    static InfinitumType Read(const char *) { return {}; }
+};
+
+template<>
+struct OscArgumentTraits<std::string_view>
+{
+    static const constexpr bool is_fixed_size = false;
+    static const constexpr char type_tag = STRING_TYPE_TAG;
+    static const constexpr std::size_t fixed_size = 0;
+    static std::size_t VariableSize(std::string_view s) { return RoundUp4( (uint32_t)s.size() + 1 ); }
+    static char* Write(char *p, std::string_view s) { return detail::WriteString( p, s.data(), s.size() ); }
+};
+
+template<>
+struct OscArgumentTraits<const char*> : OscArgumentTraits<std::string_view> {};
+
+template<>
+struct OscArgumentTraits<std::string> : OscArgumentTraits<std::string_view> {};
+
+template<>
+struct OscArgumentTraits<Symbol>
+{
+    static const constexpr bool is_fixed_size = false;
+    static const constexpr char type_tag = SYMBOL_TYPE_TAG;
+    static const constexpr std::size_t fixed_size = 0;
+    static std::size_t VariableSize(Symbol s) { return RoundUp4( (uint32_t)std::strlen( s ) + 1 ); }
+    static char* Write(char *p, Symbol s) { return detail::WriteString( p, s, std::strlen( s ) ); }
+};
+
+template<>
+struct OscArgumentTraits<Blob>
+{
+    static const constexpr bool is_fixed_size = false;
+    static const constexpr char type_tag = BLOB_TYPE_TAG;
+    static const constexpr std::size_t fixed_size = 4;
+    static std::size_t VariableSize(const Blob& b) { return RoundUp4( b.size ); }
+    static char* Write(char *p, const Blob& b)
+    {
+        FromUInt32( p, b.size );
+        p += 4;
+        std::size_t size = RoundUp4( b.size );
+        if( size ){
+            std::memset( p + size - 4, 0, 4 );
+            std::memcpy( p, b.data, b.size );
+        }
+        return p + size;
+    }
+};
+
 }
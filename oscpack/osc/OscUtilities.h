@@ -1,6 +1,9 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include "OscHostEndianness.h"
+#include "OscSimd.h"
 
 namespace oscpack
 {
@@ -98,6 +101,88 @@ inline void FromUInt64( char *p, uint64_t x )
 #endif
 }
 
+namespace detail{
+
+// copy count 4-byte words from src to dst, reversing the byte order of each
+inline void CopyByteSwapped32( char *dst, const char *src, std::size_t count )
+{
+  const char *srcEnd = src + count * 4;
+
+#if defined(OSCPACK_SIMD)
+  for( ; srcEnd - src >= 32; src += 32, dst += 32 ){
+    StoreBytes( dst, ByteSwap32( LoadBytes( src ) ) );
+    StoreBytes( dst + 16, ByteSwap32( LoadBytes( src + 16 ) ) );
+  }
+#endif
+
+  for( ; src != srcEnd; src += 4, dst += 4 ){
+    dst[0] = src[3];
+    dst[1] = src[2];
+    dst[2] = src[1];
+    dst[3] = src[0];
+  }
+}
+
+// copy size bytes from src to dst in reverse order
+inline void CopyReversed( char *dst, const char *src, std::size_t size )
+{
+  const char *srcEnd = src + size;
+
+#if defined(OSCPACK_SIMD)
+  for( ; srcEnd - src >= 16; dst += 16 ){
+    srcEnd -= 16;
+    StoreBytes( dst, ReverseBytes( LoadBytes( srcEnd ) ) );
+  }
+#endif
+
+  while( srcEnd != src )
+    *dst++ = *--srcEnd;
+}
+
+// the number of leading bytes of p[0..size) that are equal to c
+inline std::size_t CountLeadingBytes( const char *p, std::size_t size, char c )
+{
+  std::size_t i = 0;
+
+#if defined(OSCPACK_SIMD)
+  static const constexpr uint64_t ALL_BYTES_MASK = BITS_PER_BYTE == 1 ? 0xFFFFULL : ~0ULL;
+  ByteVector bytes = SplatBytes( c );
+  for( ; size - i >= 16; i += 16 ){
+    uint64_t different = ~ByteMask( EqualBytes( LoadBytes( p + i ), bytes ) ) & ALL_BYTES_MASK;
+    if( different != 0 )
+      return i + CountTrailingZeros( different ) / BITS_PER_BYTE;
+  }
+#endif
+
+  while( i < size && p[i] == c )
+    ++i;
+
+  return i;
+}
+
+} // namespace detail
+
+// the array versions of FromUInt32() and ToUInt32(), for count 4-byte values
+// such as uint32_t, int32_t or float. p and values may be unaligned but must
+// not overlap.
+inline void FromUInt32s( char *p, const void *values, std::size_t count )
+{
+#ifdef OSC_HOST_LITTLE_ENDIAN
+    detail::CopyByteSwapped32( p, static_cast<const char*>(values), count );
+#else
+    std::memcpy( p, values, count * 4 );
+#endif
+}
+
+inline void ToUInt32s( void *values, const char *p, std::size_t count )
+{
+#ifdef OSC_HOST_LITTLE_ENDIAN
+    detail::CopyByteSwapped32( static_cast<char*>(values), p, count );
+#else
+    std::memcpy( values, p, count * 4 );
+#endif
+}
+
 // return the first 4 byte boundary after the end of a str4
 // be careful about calling this version if you don't know whether
 // the string is terminated correctly.
@@ -125,6 +210,22 @@ inline const char* FindStr4End( const char *p, const char *end )
   if( p[0] == '\0' )    // special case for SuperCollider integer address pattern
     return p + 4;
 
+#if defined(OSCPACK_SIMD)
+  // test sixteen, then four words at a time, then finish the remainder below
+  while( end - p >= 64 && !detail::HasStr4Terminator64( p ) )
+    p += 64;
+
+  while( end - p >= 16 ){
+    std::size_t terminatorEnd = detail::FindStr4Terminator16( p );
+    if( terminatorEnd != 0 )
+      return p + terminatorEnd;
+    p += 16;
+  }
+
+  if( p == end )
+    return 0;
+#endif
+
   p += 3;
   end -= 1;
 
@@ -0,0 +1,264 @@
+/*
+  oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files
+  (the "Software"), to deal in the Software without restriction,
+  including without limitation the rights to use, copy, modify, merge,
+  publish, distribute, sublicense, and/or sell copies of the Software,
+  and to permit persons to whom the Software is furnished to do so,
+  subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+  ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+  The text above constitutes the entire oscpack license; however,
+  the oscpack developer(s) also make the following non-binding requests:
+
+  Any person wishing to distribute modifications to the Software is
+  requested to send the modifications to the original developer so that
+  they can be incorporated into the canonical version. It is also
+  requested that these non-binding requests be included whenever the
+  above license is reproduced.
+*/
+#ifndef INCLUDED_OSCPACK_SCHEDULEDOSCPACKETLISTENER_H
+#define INCLUDED_OSCPACK_SCHEDULEDOSCPACKETLISTENER_H
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+#include "OscAllocators.h"
+#include "OscPacketListener.h"
+#include "OscTimeTag.h"
+#include "../ip/TimerListener.h"
+#include "../ip/TimerQueue.h"
+
+
+namespace oscpack{
+
+// An OscPacketListener which holds the messages of bundles with a future
+// time tag until the time tag is due, instead of dispatching them on
+// arrival. Bundles that are immediate or already due are dispatched as
+// usual.
+//
+// The listener must be attached to the multiplexer both as a socket
+// listener and as a scheduled timer listener:
+//
+//     mux.AttachSocketListener( &socket, &listener );
+//     mux.AttachScheduledTimerListener( &listener );
+//
+// Time tags are converted from the system clock to the multiplexer's
+// steady clock when a bundle is received. Nested bundles are due at the
+// later of their own time tag and that of the enclosing bundle.
+//
+// Pending messages are copied into a pool allocated up front, so
+// scheduling doesn't allocate as long as messages fit in the pool's
+// blocks (larger messages are copied to the heap).
+class ScheduledOscPacketListener : public OscPacketListener, public ScheduledTimerListener{
+    struct ScheduledMessage{
+        ScheduledMessage( const ReceivedMessage& m, FixedBlockPool *pool,
+                const IpEndpointName& e, uint64_t t )
+            : message( m, PoolAllocator<char>( pool ) ), remoteEndpoint( e ), timeTag( t ) {}
+
+        BasicOwnedMessage< PoolAllocator<char> > message;
+        IpEndpointName remoteEndpoint;
+        uint64_t timeTag;
+    };
+
+    struct Pending{
+        double dueMs;
+        uint64_t sequence; // preserves arrival order for equal due times
+        std::size_t slot;
+    };
+
+    // std heap functions build a max-heap, so order by later due time
+    static bool Later( const Pending& lhs, const Pending& rhs )
+    {
+        return lhs.dueMs > rhs.dueMs
+                || (lhs.dueMs == rhs.dueMs && lhs.sequence > rhs.sequence);
+    }
+
+    FixedBlockPool pool_;
+    std::vector< std::optional<ScheduledMessage> > slots_;
+    std::vector<std::size_t> freeSlots_;
+    std::vector<Pending> heap_;
+    uint64_t sequence_;
+    std::size_t maximumPendingCount_;
+    std::size_t droppedCount_;
+
+    void ScheduleMessage( const ReceivedMessage& m, uint64_t timeTag, double dueMs,
+            const IpEndpointName& remoteEndpoint )
+    {
+        if( heap_.size() >= maximumPendingCount_ ){
+            ++droppedCount_;
+            return;
+        }
+
+        std::size_t slot;
+        if( freeSlots_.empty() ){
+            slot = slots_.size();
+            slots_.emplace_back();
+        }else{
+            slot = freeSlots_.back();
+            freeSlots_.pop_back();
+        }
+        slots_[slot].emplace( m, &pool_, remoteEndpoint, timeTag );
+
+        heap_.push_back( Pending{ dueMs, sequence_++, slot } );
+        std::push_heap( heap_.begin(), heap_.end(), Later );
+    }
+
+    // schedules the messages of b, which is nested at depth within the
+    // packet. nested bundles are walked iteratively, as in
+    // OscPacketListener::ProcessBundle().
+    void ScheduleBundle( const ReceivedBundle& b, uint64_t timeTag, double dueMs,
+            const IpEndpointName& remoteEndpoint, std::size_t depth )
+    {
+        struct Level{
+            ReceivedBundle::const_iterator i, end;
+            uint64_t timeTag;
+            double dueMs;
+        };
+        std::vector<Level> enclosing;
+
+        Level level = { b.ElementsBegin(), b.ElementsEnd(), timeTag, dueMs };
+        for(;;){
+            if( level.i == level.end ){
+                if( enclosing.empty() )
+                    break;
+                level = enclosing.back();
+                enclosing.pop_back();
+                continue;
+            }
+
+            ReceivedBundleElement e = *level.i;
+            ++level.i;
+            if( e.IsBundle() ){
+                ReceivedBundle nested = MakeBundle( e );
+                if( depth + enclosing.size() + 1 > MaximumBundleDepth() )
+                    throw MalformedBundleException( "bundles nested too deeply" );
+
+                uint64_t nestedTimeTag = level.timeTag;
+                double nestedDueMs = level.dueMs;
+
+                double laterSeconds = TimeTagDifferenceSeconds( nested.TimeTag(), level.timeTag );
+                if( nested.TimeTag() != IMMEDIATE_TIME_TAG && laterSeconds > 0 ){
+                    nestedTimeTag = nested.TimeTag();
+                    nestedDueMs += laterSeconds * 1000.;
+                }
+
+                enclosing.push_back( level );
+                level = Level{ nested.ElementsBegin(), nested.ElementsEnd(),
+                        nestedTimeTag, nestedDueMs };
+            }else{
+                ScheduleMessage( ReceivedMessage(e), level.timeTag, level.dueMs, remoteEndpoint );
+            }
+        }
+    }
+
+    // schedules b and returns true if its time tag is in the future
+    bool ScheduleIfLater( const ReceivedBundle& b,
+            const IpEndpointName& remoteEndpoint, std::size_t depth )
+    {
+        uint64_t timeTag = b.TimeTag();
+        if( timeTag != IMMEDIATE_TIME_TAG ){
+            double delaySeconds = TimeTagDifferenceSeconds( timeTag, TimeTagNow() );
+            if( delaySeconds > 0 ){
+                ScheduleBundle( b, timeTag,
+                        detail::SteadyTimeMs() + delaySeconds * 1000., remoteEndpoint, depth );
+                return true;
+            }
+        }
+        return false;
+    }
+
+protected:
+    void ProcessBundle( const oscpack::ReceivedBundle& b,
+        const IpEndpointName& remoteEndpoint ) override
+    {
+        if( !ScheduleIfLater( b, remoteEndpoint, 1 ) )
+            OscPacketListener::ProcessBundle( b, remoteEndpoint );
+    }
+
+    bool ProcessNestedBundle( const oscpack::ReceivedBundle& b,
+        const IpEndpointName& remoteEndpoint, std::size_t depth ) override
+    {
+        return !ScheduleIfLater( b, remoteEndpoint, depth );
+    }
+
+    // called for each message of a scheduled bundle once it is due, with
+    // the time tag of its innermost bundle. calls ProcessMessage() by default,
+    // through DispatchMessage().
+    virtual void ProcessScheduledMessage( const oscpack::ReceivedMessage& m,
+        const IpEndpointName& remoteEndpoint, uint64_t timeTag )
+    {
+        (void) timeTag; // suppress unused parameter warning
+        DispatchMessage( m, remoteEndpoint );
+    }
+
+public:
+    // messages beyond maximumPendingCount are discarded, see DroppedCount().
+    // pooledMessageSize is the size in bytes of each pool block.
+    explicit ScheduledOscPacketListener( std::size_t maximumPendingCount=1024,
+            std::size_t pooledMessageSize=256 )
+        : pool_( pooledMessageSize, maximumPendingCount )
+        , sequence_( 0 )
+        , maximumPendingCount_( maximumPendingCount )
+        , droppedCount_( 0 )
+    {
+        slots_.reserve( maximumPendingCount );
+        freeSlots_.reserve( maximumPendingCount );
+        heap_.reserve( maximumPendingCount );
+    }
+
+    bool NextExpiryMs( double& expiryMs ) override
+    {
+        if( heap_.empty() )
+            return false;
+
+        expiryMs = heap_.front().dueMs;
+        return true;
+    }
+
+    void TimerExpired() override
+    {
+        double currentTimeMs = detail::SteadyTimeMs();
+        while( !heap_.empty() && heap_.front().dueMs <= currentTimeMs ){
+            std::pop_heap( heap_.begin(), heap_.end(), Later );
+            std::size_t slot = heap_.back().slot;
+            heap_.pop_back();
+
+            // release the slot before dispatching, the handler may
+            // receive and schedule further messages
+            ScheduledMessage scheduled( std::move( *slots_[slot] ) );
+            slots_[slot].reset();
+            freeSlots_.push_back( slot );
+
+            ProcessScheduledMessage( scheduled.message, scheduled.remoteEndpoint, scheduled.timeTag );
+        }
+    }
+
+    // the number of messages waiting for their time tag
+    std::size_t PendingCount() const { return heap_.size(); }
+
+    // the number of messages discarded because too many were pending
+    std::size_t DroppedCount() const { return droppedCount_; }
+};
+
+} // namespace oscpack
+
+#endif /* INCLUDED_OSCPACK_SCHEDULEDOSCPACKETLISTENER_H */
@@ -0,0 +1,651 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+
+/*
+    Timing loops for the hot paths of the library. Each benchmark reports
+    the mean time per iteration. Build with optimisation enabled.
+
+    usage: OscBenchmarks [--format=console|csv|json] [--filter=substring]
+
+    --format=json writes the results in the layout of Google Benchmark's
+    JSON reporter ("benchmarks": [ { "name", "iterations", "real_time",
+    "time_unit" } ]) so that the output can be compared between builds
+    with the usual tools. --filter runs only benchmarks whose name
+    contains substring.
+
+    the loopback benchmarks use UDP ports 7100 to 7103 on 127.0.0.1, and
+    the shared memory transport benchmark the rings of ports 7102 and 7103.
+*/
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "osc/OscOutboundPacketStream.h"
+#include "osc/OscMessageWriter.h"
+#include "osc/OscPooledOutboundPacketStream.h"
+#include "osc/OscPreparedMessage.h"
+#include "osc/OscReceivedElements.h"
+#include "osc/OscTypedMessageView.h"
+#include "osc/MessageMappingOscPacketListener.h"
+#include "osc/CoalescingOscPacketListener.h"
+#include "ip/UdpSocket.h"
+#if !defined(_WIN32)
+#include "ip/posix/EventSocketReceiveMultiplexer.h"
+#endif
+#if defined(__linux__)
+#include "ip/posix/UringSocketReceiveMultiplexer.h"
+#include "ip/posix/SharedMemorySocketReceiveMultiplexer.h"
+#endif
+
+#include "OscGarbagePackets.h"
+
+namespace osc{
+
+  using namespace oscpack;
+
+// prevent the compiler from discarding the result of a benchmark
+static volatile std::size_t sink_;
+
+enum OutputFormat{ CONSOLE_OUTPUT, CSV_OUTPUT, JSON_OUTPUT };
+
+static OutputFormat format_ = CONSOLE_OUTPUT;
+static std::string filter_;
+static int resultCount_ = 0;
+
+// names are quoted but not escaped in csv and json output, so they must
+// not contain quotes or backslashes
+void ReportResult( const std::string& name, int iterations, double nsPerIteration )
+{
+    switch( format_ ){
+        case CONSOLE_OUTPUT:
+            std::cout << std::left << std::setw( 48 ) << name
+                << std::right << std::setw( 12 ) << std::fixed << std::setprecision( 1 )
+                << nsPerIteration << " ns\n";
+            break;
+
+        case CSV_OUTPUT:
+            if( resultCount_ == 0 )
+                std::cout << "name,iterations,real_time,time_unit\n";
+            std::cout << "\"" << name << "\"," << iterations << ","
+                << std::fixed << std::setprecision( 3 ) << nsPerIteration << ",ns\n";
+            break;
+
+        case JSON_OUTPUT:
+            std::cout << (resultCount_ == 0 ? "{\n  \"benchmarks\": [\n" : ",\n")
+                << "    {\n"
+                << "      \"name\": \"" << name << "\",\n"
+                << "      \"iterations\": " << iterations << ",\n"
+                << "      \"real_time\": " << std::fixed << std::setprecision( 3 ) << nsPerIteration << ",\n"
+                << "      \"time_unit\": \"ns\"\n"
+                << "    }";
+            break;
+    }
+    ++resultCount_;
+}
+
+void FinishReport()
+{
+    if( format_ == JSON_OUTPUT )
+        std::cout << (resultCount_ == 0 ? "{\n  \"benchmarks\": [" : "\n  ") << "]\n}\n";
+}
+
+bool IsSelected( const std::string& name )
+{
+    return filter_.empty() || name.find( filter_ ) != std::string::npos;
+}
+
+template< class F >
+void RunBenchmark( const std::string& name, int iterations, F f )
+{
+    using namespace std::chrono;
+
+    if( !IsSelected( name ) )
+        return;
+
+    for( int i=0; i < iterations / 10; ++i ) // warm up
+        f();
+
+    steady_clock::time_point start = steady_clock::now();
+    for( int i=0; i < iterations; ++i )
+        f();
+    double ns = duration<double, std::nano>( steady_clock::now() - start ).count();
+
+    ReportResult( name, iterations, ns / iterations );
+}
+
+
+// a sensor array message of floatCount floats, built with and without
+// declaring the type tags up front
+void BenchmarkMessageBuilding( int floatCount )
+{
+    std::vector<char> buffer( 16 + floatCount * 5 + 64 );
+    std::string typeTags( floatCount, 'f' );
+    int iterations = 20000000 / floatCount;
+
+    std::string name = "BeginMessage, " + std::to_string( floatCount ) + " floats";
+    RunBenchmark( name, iterations, [&](){
+        OutboundPacketStream ps( &buffer[0], buffer.size() );
+        ps << BeginMessage( "/sensor/array" );
+        for( int i=0; i < floatCount; ++i )
+            ps << (float)i;
+        ps << oscpack::EndMessage();
+        sink_ = ps.Size();
+    } );
+
+    name = "BeginTypedMessage, " + std::to_string( floatCount ) + " floats";
+    RunBenchmark( name, iterations, [&](){
+        OutboundPacketStream ps( &buffer[0], buffer.size() );
+        ps << BeginTypedMessage( "/sensor/array", typeTags.c_str() );
+        for( int i=0; i < floatCount; ++i )
+            ps << (float)i;
+        ps << oscpack::EndMessage();
+        sink_ = ps.Size();
+    } );
+}
+
+
+// a small fixed-shape control message sent through the streaming
+// interface and through MessageWriter
+void BenchmarkFixedShapeMessage()
+{
+    char buffer[64];
+    int iterations = 5000000;
+
+    RunBenchmark( "stream /fader ,iff", iterations, [&](){
+        OutboundPacketStream ps( buffer, sizeof(buffer) );
+        ps << BeginMessage( "/fader" ) << 3 << 0.5f << 0.25f << oscpack::EndMessage();
+        sink_ = ps.Size();
+    } );
+
+    MessageWriter<int32_t, float, float> fader( "/fader" );
+    RunBenchmark( "MessageWriter /fader ,iff", iterations, [&](){
+        OutboundPacketStream ps( buffer, sizeof(buffer) );
+        fader.Write( ps, 3, 0.5f, 0.25f );
+        sink_ = ps.Size();
+    } );
+
+    OutboundPacketStream ps( buffer, sizeof(buffer) );
+    ps << BeginMessage( "/fader" ) << 3 << 0.5f << 0.25f << oscpack::EndMessage();
+    PreparedMessage prepared( ps );
+    RunBenchmark( "PreparedMessage /fader ,iff, 2 floats set", iterations, [&](){
+        prepared.Set( 1, 0.5f );
+        prepared.Set( 2, 0.25f );
+        sink_ = prepared.Size();
+    } );
+
+    RunBenchmark( "PooledOutboundPacketStream /fader ,iff", iterations, [&](){
+        PooledOutboundPacketStream pooled;
+        pooled << BeginMessage( "/fader" ) << 3 << 0.5f << 0.25f << oscpack::EndMessage();
+        sink_ = pooled.Size();
+    } );
+}
+
+
+// decoding the same message through ReceivedMessage and TypedMessageView
+void BenchmarkFixedShapeDecoding()
+{
+    char buffer[64];
+    OutboundPacketStream ps( buffer, sizeof(buffer) );
+    ps << BeginMessage( "/fader" ) << 3 << 0.5f << 0.25f << oscpack::EndMessage();
+    int iterations = 5000000;
+
+    RunBenchmark( "ReceivedMessage /fader ,iff", iterations, [&](){
+        ReceivedMessage m( ReceivedPacket( ps.Data(), ps.Size() ) );
+        ReceivedMessageArgumentStream args = m.ArgumentStream();
+        int32_t channel;
+        float x, y;
+        args >> channel >> x >> y;
+        sink_ = channel + (std::size_t)(x + y);
+    } );
+
+    RunBenchmark( "TypedMessageView /fader ,iff", iterations, [&](){
+        TypedMessageView<int32_t, float, float> m( ps.Data(), ps.Size() );
+        if( m )
+            sink_ = m.Get<0>() + (std::size_t)(m.Get<1>() + m.Get<2>());
+    } );
+}
+
+
+// validating a spectrum frame of 512 floats and a message with a long
+// string argument (define OSCPACK_DISABLE_SIMD to compare with the
+// scalar code)
+void BenchmarkParsing()
+{
+    std::vector<char> buffer( 4096 );
+    OutboundPacketStream ps( &buffer[0], buffer.size() );
+    ps << BeginMessage( "/spectrum" );
+    for( int i=0; i < 512; ++i )
+        ps << (float)i;
+    ps << oscpack::EndMessage();
+
+    RunBenchmark( "ReceivedMessage, 512 floats", 500000, [&](){
+        ReceivedMessage m( ReceivedPacket( ps.Data(), ps.Size() ) );
+        sink_ = m.ArgumentCount();
+    } );
+
+    std::string text( 1000, 'x' );
+    OutboundPacketStream ts( &buffer[0], buffer.size() );
+    ts << BeginMessage( "/text" ) << oscpack::string_view( text ) << oscpack::EndMessage();
+
+    RunBenchmark( "ReceivedMessage, 1000 character string", 2000000, [&](){
+        ReceivedMessage m( ReceivedPacket( ts.Data(), ts.Size() ) );
+        sink_ = m.ArgumentCount();
+    } );
+}
+
+
+// validation of a mix of well formed and corrupted packets from
+// GarbagePacketGenerator, to check that parser hardening doesn't cost
+// throughput. the packets are stored 4 byte aligned and back to back.
+void BenchmarkGarbageParsing()
+{
+    const int packetCount = 1024;
+    GarbagePacketGenerator generator( 1 );
+    std::vector<char> buffer( GarbagePacketGenerator::MINIMUM_CAPACITY );
+    std::vector<uint32_t> storage;
+    std::vector<std::pair<std::size_t, std::size_t> > packets; // word offset, size
+    for( int i=0; i < packetCount; ++i ){
+        std::size_t size = generator.MakePacket( &buffer[0], buffer.size(), 0.5 );
+        packets.push_back( std::make_pair( storage.size(), size ) );
+        storage.resize( storage.size() + (size + 3) / 4 );
+        std::memcpy( &storage[ packets.back().first ], &buffer[0], size );
+    }
+
+    int i = 0;
+    RunBenchmark( "TryParse, garbage packets (50% corrupt)", 2000000, [&](){
+        const std::pair<std::size_t, std::size_t>& packet = packets[ i++ & (packetCount - 1) ];
+        std::optional<ReceivedPacket> p;
+        std::optional<ReceivedMessage> m;
+        std::optional<ReceivedBundle> b;
+        std::size_t result = 0;
+        if( ReceivedPacket::TryParse( (const char*)&storage[ packet.first ], packet.second, p ) == PARSE_OK ){
+            if( p->IsBundle() )
+                result = ReceivedBundle::TryParse( *p, b );
+            else
+                result = ReceivedMessage::TryParse( *p, m );
+        }
+        sink_ = result;
+    } );
+}
+
+
+// a visualiser frame of 1024 floats, streamed one at a time and written
+// and read as a block
+void BenchmarkFloatArrays()
+{
+    const int floatCount = 1024;
+    std::vector<float> values( floatCount, 0.25f ), readValues( floatCount );
+    std::vector<char> buffer( floatCount * 5 + 64 );
+    int iterations = 200000;
+
+    RunBenchmark( "operator<<(float), 1024 floats", iterations, [&](){
+        OutboundPacketStream ps( &buffer[0], buffer.size() );
+        ps << BeginMessage( "/frame" );
+        for( int i=0; i < floatCount; ++i )
+            ps << values[i];
+        ps << oscpack::EndMessage();
+        sink_ = ps.Size();
+    } );
+
+    RunBenchmark( "WriteFloats, 1024 floats", iterations, [&](){
+        OutboundPacketStream ps( &buffer[0], buffer.size() );
+        ps << BeginMessage( "/frame" );
+        ps.WriteFloats( values.data(), floatCount );
+        ps << oscpack::EndMessage();
+        sink_ = ps.Size();
+    } );
+
+    OutboundPacketStream ps( &buffer[0], buffer.size() );
+    ps << BeginMessage( "/frame" );
+    ps.WriteFloats( values.data(), floatCount );
+    ps << oscpack::EndMessage();
+    ReceivedMessage m( ReceivedPacket( ps.Data(), ps.Size() ) );
+
+    RunBenchmark( "operator>>(float&), 1024 floats", iterations, [&](){
+        ReceivedMessageArgumentStream args = m.ArgumentStream();
+        for( int i=0; i < floatCount; ++i )
+            args >> readValues[i];
+        sink_ = (std::size_t)readValues[floatCount - 1];
+    } );
+
+    RunBenchmark( "ReadFloats, 1024 floats", iterations, [&](){
+        ReceivedMessageArgumentStream args = m.ArgumentStream();
+        args.ReadFloats( readValues.data(), floatCount );
+        sink_ = (std::size_t)readValues[floatCount - 1];
+    } );
+}
+
+
+// bundles of messageCount small messages, and a message with one
+// argument of each of the common types
+void BenchmarkBundleBuilding( int messageCount )
+{
+    std::vector<char> buffer( 16 + messageCount * 32 );
+    int iterations = 10000000 / messageCount;
+
+    RunBenchmark( "BeginBundle, " + std::to_string( messageCount ) + " messages", iterations, [&](){
+        OutboundPacketStream ps( &buffer[0], buffer.size() );
+        ps << BeginBundleImmediate();
+        for( int i=0; i < messageCount; ++i )
+            ps << BeginMessage( "/mixer/fader" ) << i << 0.5f << oscpack::EndMessage();
+        ps << EndBundle();
+        sink_ = ps.Size();
+    } );
+}
+
+static void WriteMixedMessage( OutboundPacketStream& ps )
+{
+    static const char blobData[16] = { 0 };
+    ps << BeginMessage( "/mixed" ) << 1 << 2.5f << "a string" << Blob( blobData, sizeof(blobData) )
+            << (int64_t)3 << 4.5 << true << TimeTag( 5 ) << Symbol( "sym" ) << oscpack::EndMessage();
+}
+
+void BenchmarkMixedTypes()
+{
+    char buffer[256];
+    int iterations = 5000000;
+
+    RunBenchmark( "stream mixed types, 9 arguments", iterations, [&](){
+        OutboundPacketStream ps( buffer, sizeof(buffer) );
+        WriteMixedMessage( ps );
+        sink_ = ps.Size();
+    } );
+
+    OutboundPacketStream ps( buffer, sizeof(buffer) );
+    WriteMixedMessage( ps );
+
+    // ReceivedMessage construction (Init) and visiting every argument
+    RunBenchmark( "ReceivedMessage mixed types, iterate", iterations, [&](){
+        ReceivedMessage m( ReceivedPacket( ps.Data(), ps.Size() ) );
+        std::size_t result = 0;
+        for( ReceivedMessage::const_iterator i = m.ArgumentsBegin(); i != m.ArgumentsEnd(); ++i )
+            result += (std::size_t)i->TypeTag();
+        sink_ = result;
+    } );
+}
+
+
+// dispatch of a bundle of 100 messages to a MessageMappingOscPacketListener
+// with addressCount registered addresses
+class BenchmarkDispatcher : public MessageMappingOscPacketListener<BenchmarkDispatcher>{
+public:
+    std::size_t count = 0;
+
+    explicit BenchmarkDispatcher( const std::vector<std::string>& addresses )
+    {
+        for( std::size_t i=0; i < addresses.size(); ++i )
+            RegisterMessageFunction( addresses[i].c_str(), &BenchmarkDispatcher::Count );
+    }
+
+    void Count( const ReceivedMessage&, const IpEndpointName& ) { ++count; }
+};
+
+void BenchmarkDispatch( int addressCount )
+{
+    std::vector<std::string> addresses;
+    for( int i=0; i < addressCount; ++i )
+        addresses.push_back( "/mixer/channel/" + std::to_string( i ) + "/fader" );
+    BenchmarkDispatcher dispatcher( addresses );
+
+    const int messageCount = 100;
+    std::vector<char> buffer( 16 + messageCount * 48 );
+    OutboundPacketStream ps( &buffer[0], buffer.size() );
+    ps << BeginBundleImmediate();
+    for( int i=0; i < messageCount; ++i )
+        ps << BeginMessage( addresses[ (i * 7) % addressCount ].c_str() ) << 0.5f << oscpack::EndMessage();
+    ps << EndBundle();
+
+    IpEndpointName endpoint;
+    RunBenchmark( "dispatch 100 messages, " + std::to_string( addressCount ) + " addresses", 100000, [&](){
+        dispatcher.ProcessPacket( ps.Data(), (int)ps.Size(), endpoint );
+        sink_ = dispatcher.count;
+    } );
+}
+
+
+// the same bundle received frameCount times per drain of a
+// CoalescingOscPacketListener, so each handler runs once per drain
+void BenchmarkCoalescedDispatch( int addressCount, int frameCount )
+{
+    std::vector<std::string> addresses;
+    for( int i=0; i < addressCount; ++i )
+        addresses.push_back( "/mixer/channel/" + std::to_string( i ) + "/fader" );
+    BenchmarkDispatcher dispatcher( addresses );
+    CoalescingOscPacketListener coalescer( &dispatcher );
+
+    const int messageCount = 100;
+    std::vector<char> buffer( 16 + messageCount * 48 );
+    OutboundPacketStream ps( &buffer[0], buffer.size() );
+    ps << BeginBundleImmediate();
+    for( int i=0; i < messageCount; ++i )
+        ps << BeginMessage( addresses[ (i * 7) % addressCount ].c_str() ) << 0.5f << oscpack::EndMessage();
+    ps << EndBundle();
+
+    IpEndpointName endpoint;
+    RunBenchmark( "coalesced dispatch 100 messages x " + std::to_string( frameCount ) + ", "
+            + std::to_string( addressCount ) + " addresses", 100000 / frameCount, [&](){
+        for( int i=0; i < frameCount; ++i )
+            coalescer.ProcessPacket( ps.Data(), (int)ps.Size(), endpoint );
+        coalescer.Drain();
+        sink_ = dispatcher.count;
+    } );
+}
+
+
+// round trips through an echo thread, and bursts of burstSize datagrams
+// sent and received by the same thread, over the loopback interface
+void BenchmarkLoopback()
+{
+    const int burstSize = 32;
+    const std::string burstName = "udp loopback, bursts of " + std::to_string( burstSize ) + " messages";
+    bool latencySelected = IsSelected( "udp loopback round trip" );
+    bool throughputSelected = IsSelected( burstName );
+    if( !latencySelected && !throughputSelected )
+        return;
+
+    IpEndpointName clientEndpoint( "127.0.0.1", 7100 );
+    IpEndpointName serverEndpoint( "127.0.0.1", 7101 );
+
+    UdpReceiveSocket client( clientEndpoint ), server( serverEndpoint );
+    server.SetReceiveBufferSize( 1 << 20 );
+
+    char buffer[64];
+    OutboundPacketStream ps( buffer, sizeof(buffer) );
+    ps << BeginMessage( "/ping" ) << 1 << 0.5f << oscpack::EndMessage();
+
+    if( latencySelected ){
+        // the echo thread returns each datagram to its sender until it
+        // receives an empty message
+        std::thread echo( [&](){
+            char data[64];
+            IpEndpointName from;
+            for(;;){
+                std::size_t size = server.ReceiveFrom( from, data, sizeof(data) );
+                server.SendTo( from, data, size );
+                if( size == 8 )
+                    break;
+            }
+        } );
+
+        char reply[64];
+        IpEndpointName from;
+        RunBenchmark( "udp loopback round trip", 20000, [&](){
+            client.SendTo( serverEndpoint, ps.Data(), ps.Size() );
+            sink_ = client.ReceiveFrom( from, reply, sizeof(reply) );
+        } );
+
+        OutboundPacketStream quit( buffer, sizeof(buffer) );
+        quit << BeginMessage( "/q" ) << oscpack::EndMessage();
+        client.SendTo( serverEndpoint, quit.Data(), quit.Size() );
+        client.ReceiveFrom( from, reply, sizeof(reply) );
+        echo.join();
+
+        ps.Clear();
+        ps << BeginMessage( "/ping" ) << 1 << 0.5f << oscpack::EndMessage();
+    }
+
+    if( throughputSelected ){
+        char data[64];
+        IpEndpointName from;
+        int bursts = 20000;
+        RunBenchmark( burstName, bursts, [&](){
+            for( int i=0; i < burstSize; ++i )
+                client.SendTo( serverEndpoint, ps.Data(), ps.Size() );
+            std::size_t received = 0;
+            for( int i=0; i < burstSize; ++i )
+                received += server.ReceiveFrom( from, data, sizeof(data) );
+            sink_ = received;
+        } );
+    }
+}
+
+
+// round trips to an echo listener which replies from the thread running
+// the multiplexer, to compare the multiplexer implementations
+template< class Impl_T >
+void BenchmarkMultiplexerRoundTrip( const std::string& implementationName )
+{
+    const std::string name = "udp loopback round trip, " + implementationName;
+    if( !IsSelected( name ) )
+        return;
+
+    using ServerSocket = detail::UdpListeningReceiveSocket<Impl_T>;
+
+    class EchoListener : public PacketListener{
+    public:
+        ServerSocket *socket = nullptr;
+        void ProcessPacket( const char *data, int size, const IpEndpointName& remoteEndpoint ) override
+        {
+            socket->SendTo( remoteEndpoint, data, (std::size_t)size );
+        }
+    };
+
+    IpEndpointName clientEndpoint( "127.0.0.1", 7102 );
+    IpEndpointName serverEndpoint( "127.0.0.1", 7103 );
+
+    EchoListener listener;
+    std::unique_ptr<ServerSocket> server;
+    try{
+        server.reset( new ServerSocket( serverEndpoint, &listener ) );
+    }catch( std::runtime_error& e ){
+        // e.g. io_uring is disabled
+        std::cerr << "skipping " << name << ": " << e.what();
+        return;
+    }
+    listener.socket = server.get();
+
+    std::thread thread( [&](){ server->Run(); } );
+
+    detail::UdpReceiveSocket<Impl_T> client( clientEndpoint );
+    char buffer[64];
+    OutboundPacketStream ps( buffer, sizeof(buffer) );
+    ps << BeginMessage( "/ping" ) << 1 << 0.5f << oscpack::EndMessage();
+
+    char reply[64];
+    IpEndpointName from;
+    RunBenchmark( name, 20000, [&](){
+        client.SendTo( serverEndpoint, ps.Data(), ps.Size() );
+        sink_ = client.ReceiveFrom( from, reply, sizeof(reply) );
+    } );
+
+    server->AsynchronousBreak();
+    thread.join();
+}
+
+
+void RunBenchmarks()
+{
+    BenchmarkMessageBuilding( 4 );
+    BenchmarkMessageBuilding( 256 );  // ~1 KB
+    BenchmarkMessageBuilding( 2048 ); // ~8 KB
+    BenchmarkFixedShapeMessage();
+    BenchmarkFixedShapeDecoding();
+    BenchmarkParsing();
+    BenchmarkGarbageParsing();
+    BenchmarkFloatArrays();
+    BenchmarkBundleBuilding( 1 );
+    BenchmarkBundleBuilding( 8 );
+    BenchmarkBundleBuilding( 64 );
+    BenchmarkMixedTypes();
+    BenchmarkDispatch( 10 );
+    BenchmarkDispatch( 100 );
+    BenchmarkDispatch( 1000 );
+    BenchmarkCoalescedDispatch( 10, 1 );
+    BenchmarkCoalescedDispatch( 10, 10 );
+    BenchmarkLoopback();
+    BenchmarkMultiplexerRoundTrip<detail::Implementation>( "default multiplexer" );
+#if !defined(_WIN32)
+    BenchmarkMultiplexerRoundTrip<posix::EventImplementation>( "epoll/kqueue multiplexer" );
+#endif
+#if defined(__linux__)
+    BenchmarkMultiplexerRoundTrip<posix::UringImplementation>( "io_uring multiplexer" );
+    BenchmarkMultiplexerRoundTrip<posix::SharedMemoryImplementation>( "shared memory transport" );
+#endif
+}
+
+} // namespace osc
+
+
+int main(int argc, char* argv[])
+{
+    for( int i=1; i < argc; ++i ){
+        std::string arg = argv[i];
+        if( arg == "--format=console" )
+            osc::format_ = osc::CONSOLE_OUTPUT;
+        else if( arg == "--format=csv" )
+            osc::format_ = osc::CSV_OUTPUT;
+        else if( arg == "--format=json" )
+            osc::format_ = osc::JSON_OUTPUT;
+        else if( arg.compare( 0, 9, "--filter=" ) == 0 )
+            osc::filter_ = arg.substr( 9 );
+        else{
+            std::cerr << "usage: OscBenchmarks [--format=console|csv|json] [--filter=substring]\n";
+            return 1;
+        }
+    }
+
+    osc::RunBenchmarks();
+    osc::FinishReport();
+    return 0;
+}
@@ -0,0 +1,216 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+
+/*
+    Records OSC traffic to a capture file and replays it, see
+    osc/OscPacketCapture.h. Captures of production traffic make realistic
+    inputs for performance tests and make timing problems reproducible.
+
+    usage: OscCapture record FILE [--port=P] [--seconds=S]
+           OscCapture replay FILE [--host=A] [--port=P] [--speed=X]
+           OscCapture dispatch FILE [--speed=X]
+
+    record      receives on --port (default 7110) into FILE for --seconds
+                (default 10), with kernel receive timestamps
+    replay      sends the datagrams in FILE to --host:--port (default
+                127.0.0.1:7110) with the recorded timing divided by
+                --speed (default 1; 0 sends as fast as possible)
+    dispatch    parses and dispatches the datagrams in FILE through an
+                OscPacketListener in process, by default as fast as
+                possible, and reports the rate
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "osc/OscPacketCapture.h"
+#include "osc/OscPacketListener.h"
+#include "ip/UdpSocket.h"
+
+namespace osc{
+
+  using namespace oscpack;
+
+struct CaptureOptions{
+    std::string mode;
+    std::string path;
+    std::string host = "127.0.0.1";
+    int port = 7110;
+    double seconds = 10;
+    double speed = -1; // the mode's default
+};
+
+
+class CountingListener : public OscPacketListener{
+public:
+    uint64_t packetCount = 0;
+    uint64_t messageCount = 0;
+    uint64_t malformedCount = 0;
+
+    void ProcessPacket( const char *data, int size,
+        const IpEndpointName& remoteEndpoint ) override
+    {
+        ++packetCount;
+        try{
+            OscPacketListener::ProcessPacket( data, size, remoteEndpoint );
+        }catch( Exception& ){
+            ++malformedCount;
+        }
+    }
+
+protected:
+    void ProcessMessage( const ReceivedMessage& m, const IpEndpointName& ) override
+    {
+        for( ReceivedMessage::const_iterator i = m.ArgumentsBegin(); i != m.ArgumentsEnd(); ++i )
+            (void) i->TypeTag();
+        ++messageCount;
+    }
+};
+
+
+double SecondsSince( std::chrono::steady_clock::time_point start )
+{
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+
+int Record( const CaptureOptions& options )
+{
+    PacketCaptureWriter writer( options.path.c_str() );
+    PacketCaptureListener recorder( writer );
+    UdpListeningReceiveSocket socket( IpEndpointName( IpEndpointName::ANY_ADDRESS, options.port ), &recorder );
+    socket.SetEnableReceiveTimestamps( true );
+    socket.SetEnableReceiveLocalEndpoint( true );
+
+    std::thread receiver( [&](){ socket.Run(); } );
+    std::this_thread::sleep_for( std::chrono::duration<double>( options.seconds ) );
+    socket.AsynchronousBreak();
+    receiver.join();
+
+    writer.Close();
+    std::cout << writer.RecordCount() << " datagrams recorded\n";
+    return 0;
+}
+
+
+int Replay( const CaptureOptions& options )
+{
+    PacketCaptureReader reader( options.path.c_str() );
+    PacketCaptureReplayer replayer( reader );
+    replayer.SetSpeed( options.speed < 0 ? 1 : options.speed );
+
+    UdpTransmitSocket socket( IpEndpointName( options.host.c_str(), options.port ) );
+    auto start = std::chrono::steady_clock::now();
+    std::size_t count = replayer.Transmit( socket );
+    double seconds = SecondsSince( start );
+
+    std::cout << count << " datagrams sent in " << seconds << " s ("
+        << (uint64_t)((double)count / seconds) << " /s)\n";
+    return 0;
+}
+
+
+int Dispatch( const CaptureOptions& options )
+{
+    PacketCaptureReader reader( options.path.c_str() );
+    PacketCaptureReplayer replayer( reader );
+    replayer.SetSpeed( options.speed < 0 ? 0 : options.speed );
+
+    CountingListener listener;
+    auto start = std::chrono::steady_clock::now();
+    std::size_t count = replayer.Deliver( listener );
+    double seconds = SecondsSince( start );
+
+    std::cout << count << " datagrams dispatched in " << seconds << " s ("
+        << (uint64_t)((double)count / seconds) << " /s), "
+        << listener.messageCount << " messages, " << listener.malformedCount << " malformed\n";
+    return 0;
+}
+
+} // namespace osc
+
+
+int main(int argc, char* argv[])
+{
+    osc::CaptureOptions options;
+    bool valid = argc >= 3;
+    if( valid ){
+        options.mode = argv[1];
+        options.path = argv[2];
+        valid = options.mode == "record" || options.mode == "replay" || options.mode == "dispatch";
+    }
+    for( int i=3; valid && i < argc; ++i ){
+        std::string arg = argv[i];
+        std::string::size_type equals = arg.find( '=' );
+        std::string name = arg.substr( 0, equals );
+        std::string value = equals == std::string::npos ? std::string() : arg.substr( equals + 1 );
+
+        if( name == "--host" )
+            options.host = value;
+        else if( name == "--port" )
+            options.port = std::atoi( value.c_str() );
+        else if( name == "--seconds" )
+            options.seconds = std::atof( value.c_str() );
+        else if( name == "--speed" )
+            options.speed = std::atof( value.c_str() );
+        else
+            valid = false;
+    }
+
+    if( !valid ){
+        std::cerr << "usage: OscCapture record FILE [--port=P] [--seconds=S]\n"
+            "       OscCapture replay FILE [--host=A] [--port=P] [--speed=X]\n"
+            "       OscCapture dispatch FILE [--speed=X]\n";
+        return 1;
+    }
+
+    try{
+        if( options.mode == "record" )
+            return osc::Record( options );
+        else if( options.mode == "replay" )
+            return osc::Replay( options );
+        else
+            return osc::Dispatch( options );
+    }catch( std::exception& e ){
+        std::cerr << "OscCapture: " << e.what();
+        return 1;
+    }
+}
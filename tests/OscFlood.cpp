@@ -0,0 +1,280 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+
+/*
+    UDP flood generator and receiver for stress testing and capacity
+    planning. Sender threads transmit a mix of well formed and corrupted
+    packets from GarbagePacketGenerator; the receiver parses and dispatches
+    each packet through an OscPacketListener and counts malformed packets.
+    Once a second, and at the end, the sustained receive rate and the drop
+    rate (packets sent but never received) are reported.
+
+    usage: OscFlood [--threads=N] [--seconds=S] [--rate=P] [--corrupt=F]
+                    [--host=A] [--port=P] [--receive-buffer=B]
+                    [--send-only | --receive-only]
+
+    --threads   number of sender threads (default 2)
+    --seconds   duration of the run (default 5)
+    --rate      total packets per second over all threads, 0 for as fast
+                as possible (default 0)
+    --corrupt   fraction of packets which are corrupted (default 0.1)
+    --host      the receiver's address for --send-only (default 127.0.0.1)
+    --port      the receiver's port (default 7110)
+    --receive-buffer
+                the receiver's SO_RCVBUF in bytes (default: system default)
+
+    by default the senders and the receiver run in the same process on the
+    loopback interface. with --send-only and --receive-only they may be
+    run on different hosts; the drop rate is then the difference between
+    the two reports. senders and receiver compete for cores, so on small
+    machines split runs give more representative rates.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "osc/OscPacketListener.h"
+#include "ip/UdpSocket.h"
+
+#include "OscGarbagePackets.h"
+
+namespace osc{
+
+  using namespace oscpack;
+
+struct FloodOptions{
+    int threads = 2;
+    double seconds = 5;
+    double rate = 0;
+    double corruptFraction = 0.1;
+    std::string host = "127.0.0.1";
+    int port = 7110;
+    int receiveBufferSize = 0;
+    bool send = true;
+    bool receive = true;
+};
+
+
+class FloodListener : public OscPacketListener{
+public:
+    std::atomic<uint64_t> packetCount{ 0 };
+    std::atomic<uint64_t> messageCount{ 0 };
+    std::atomic<uint64_t> malformedCount{ 0 };
+
+    void ProcessPacket( const char *data, int size,
+        const IpEndpointName& remoteEndpoint ) override
+    {
+        packetCount.fetch_add( 1, std::memory_order_relaxed );
+        try{
+            OscPacketListener::ProcessPacket( data, size, remoteEndpoint );
+        }catch( Exception& ){
+            malformedCount.fetch_add( 1, std::memory_order_relaxed );
+        }
+    }
+
+protected:
+    void ProcessMessage( const ReceivedMessage& m, const IpEndpointName& ) override
+    {
+        // touch the arguments as a typical handler would
+        for( ReceivedMessage::const_iterator i = m.ArgumentsBegin(); i != m.ArgumentsEnd(); ++i )
+            (void) i->TypeTag();
+        messageCount.fetch_add( 1, std::memory_order_relaxed );
+    }
+};
+
+
+// sends packets until stop is set, pacing to packetsPerSecond if it is
+// greater than zero
+void RunSender( const FloodOptions& options, int index, double packetsPerSecond,
+        std::atomic<bool>& stop, std::atomic<uint64_t>& sentCount )
+{
+    UdpTransmitSocket socket( IpEndpointName( options.host.c_str(), options.port ) );
+    GarbagePacketGenerator generator( 1 + (uint64_t)index );
+    std::vector<char> buffer( GarbagePacketGenerator::MINIMUM_CAPACITY );
+
+    const int batchSize = 64;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t sent = 0;
+    while( !stop.load( std::memory_order_relaxed ) ){
+        for( int i=0; i < batchSize; ++i ){
+            // empty datagrams are never passed to listeners, so they
+            // would be reported as dropped
+            std::size_t size;
+            do{
+                size = generator.MakePacket( buffer.data(), buffer.size(), options.corruptFraction );
+            }while( size == 0 );
+            socket.Send( buffer.data(), size );
+        }
+        sent += batchSize;
+        sentCount.fetch_add( batchSize, std::memory_order_relaxed );
+
+        if( packetsPerSecond > 0 ){
+            auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>( (double)sent / packetsPerSecond ) );
+            std::this_thread::sleep_until( due );
+        }
+    }
+}
+
+
+void Report( const char *label, double seconds, uint64_t sent, const FloodListener *listener,
+        const UdpListeningReceiveSocket *socket )
+{
+    std::cout << std::left << std::setw( 8 ) << label << std::right << std::fixed
+        << std::setprecision( 1 ) << std::setw( 6 ) << seconds << " s";
+    if( sent > 0 )
+        std::cout << std::setw( 12 ) << (uint64_t)((double)sent / seconds) << " sent/s";
+
+    if( listener ){
+        uint64_t received = listener->packetCount.load();
+        std::cout << std::setw( 12 ) << (uint64_t)((double)received / seconds) << " received/s"
+            << std::setw( 12 ) << listener->messageCount.load() << " messages"
+            << std::setw( 10 ) << listener->malformedCount.load() << " malformed";
+        if( sent > 0 ){
+            double dropRate = sent > received ? (double)(sent - received) / (double)sent : 0.;
+            std::cout << std::setw( 9 ) << std::setprecision( 2 ) << dropRate * 100. << "% dropped";
+        }
+        if( METRICS_ENABLED )
+            std::cout << "  (kernel drops " << socket->Metrics().kernelDropCount << ")";
+        std::cout << "  truncated " << socket->TruncatedDatagramCount();
+    }
+    std::cout << "\n" << std::flush;
+}
+
+
+int RunFlood( const FloodOptions& options )
+{
+    FloodListener listener;
+    std::unique_ptr<UdpListeningReceiveSocket> receiveSocket;
+    std::thread receiver;
+    if( options.receive ){
+        receiveSocket.reset( new UdpListeningReceiveSocket(
+                IpEndpointName( IpEndpointName::ANY_ADDRESS, options.port ), &listener ) );
+        if( options.receiveBufferSize > 0 )
+            receiveSocket->SetReceiveBufferSize( options.receiveBufferSize );
+        receiver = std::thread( [&](){ receiveSocket->Run(); } );
+    }
+
+    std::atomic<bool> stop{ false };
+    std::atomic<uint64_t> sentCount{ 0 };
+    std::vector<std::thread> senders;
+    if( options.send ){
+        for( int i=0; i < options.threads; ++i )
+            senders.emplace_back( RunSender, std::cref( options ), i,
+                    options.rate / options.threads, std::ref( stop ), std::ref( sentCount ) );
+    }
+
+    const FloodListener *reportedListener = options.receive ? &listener : nullptr;
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&](){
+        return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    };
+    for( int second = 1; second < options.seconds; ++second ){
+        std::this_thread::sleep_until( start + std::chrono::seconds( second ) );
+        Report( "", elapsed(), sentCount.load(), reportedListener, receiveSocket.get() );
+    }
+    std::this_thread::sleep_until( start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>( options.seconds ) ) );
+
+    stop = true;
+    for( std::thread& sender : senders )
+        sender.join();
+    double seconds = elapsed();
+
+    if( options.receive ){
+        // let the receiver drain its socket buffer
+        std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+        receiveSocket->AsynchronousBreak();
+        receiver.join();
+    }
+
+    Report( "total", seconds, sentCount.load(), reportedListener, receiveSocket.get() );
+    return 0;
+}
+
+} // namespace osc
+
+
+int main(int argc, char* argv[])
+{
+    osc::FloodOptions options;
+    for( int i=1; i < argc; ++i ){
+        std::string arg = argv[i];
+        std::string::size_type equals = arg.find( '=' );
+        std::string name = arg.substr( 0, equals );
+        std::string value = equals == std::string::npos ? std::string() : arg.substr( equals + 1 );
+
+        if( name == "--threads" )
+            options.threads = std::atoi( value.c_str() );
+        else if( name == "--seconds" )
+            options.seconds = std::atof( value.c_str() );
+        else if( name == "--rate" )
+            options.rate = std::atof( value.c_str() );
+        else if( name == "--corrupt" )
+            options.corruptFraction = std::atof( value.c_str() );
+        else if( name == "--host" )
+            options.host = value;
+        else if( name == "--port" )
+            options.port = std::atoi( value.c_str() );
+        else if( name == "--receive-buffer" )
+            options.receiveBufferSize = std::atoi( value.c_str() );
+        else if( arg == "--send-only" )
+            options.receive = false;
+        else if( arg == "--receive-only" )
+            options.send = false;
+        else{
+            std::cerr << "usage: OscFlood [--threads=N] [--seconds=S] [--rate=P] [--corrupt=F]\n"
+                "                [--host=A] [--port=P] [--receive-buffer=B]\n"
+                "                [--send-only | --receive-only]\n";
+            return 1;
+        }
+    }
+
+    if( options.threads < 1 || options.seconds <= 0 || !(options.send || options.receive) ){
+        std::cerr << "OscFlood: invalid options\n";
+        return 1;
+    }
+
+    return osc::RunFlood( options );
+}
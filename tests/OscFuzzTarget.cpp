@@ -0,0 +1,262 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+
+/*
+    libFuzzer target for the receive side: ReceivedPacket, ReceivedMessage
+    and ReceivedBundle through both the throwing and the TryParse() API,
+    every TryAs*() accessor, the printing operators, address pattern
+    matching and OscPacketListener dispatch with eager and lazy bundle
+    validation. Any crash, sanitizer report or exception other than
+    oscpack::Exception is a bug.
+
+    with clang:
+
+        clang++ -std=c++17 -g -O1 -fsanitize=fuzzer,address,undefined \
+            -I. -Ioscpack tests/OscFuzzTarget.cpp -o OscFuzzer
+        ./OscFuzzer corpus/
+
+    or configure cmake with -DOSCPACK_BUILD_FUZZER=ON.
+
+    when compiled with OSCPACK_FUZZ_STANDALONE defined there is no libFuzzer
+    dependency, and main() runs the target over each file named on the
+    command line, or over packets from GarbagePacketGenerator:
+
+        usage: OscFuzz [--iterations=N] [--seed=S] [file...]
+
+    the cmake build runs the standalone version as the OscFuzzSmoke test.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <sstream>
+
+#include "osc/OscReceivedElements.h"
+#include "osc/OscPrintReceivedElements.h"
+#include "osc/OscAddressPattern.h"
+#include "osc/MessageMappingOscPacketListener.h"
+
+namespace osc{
+
+  using namespace oscpack;
+
+// prevent the compiler from discarding the values that are read
+static volatile std::size_t sink_;
+
+static const char *addresses_[] = { "/a", "/synth/1/freq", "/synth/2/freq", "/x/y/z" };
+
+class FuzzListener : public MessageMappingOscPacketListener<FuzzListener>{
+public:
+    FuzzListener()
+    {
+        RegisterMessageFunction( "/a", &FuzzListener::Count );
+        RegisterMessageFunction( "/synth/1/freq", &FuzzListener::Count );
+        RegisterMessageFunction( "/synth/2/freq", &FuzzListener::Count );
+        RegisterMessageFunction( "/x/y/z", &FuzzListener::Count );
+    }
+
+    void Count( const ReceivedMessage& m, const IpEndpointName& )
+    {
+        sink_ += m.ArgumentCount();
+    }
+};
+
+
+void ReadArgument( const ReceivedMessageArgument& arg )
+{
+    std::size_t n = 0;
+    n += arg.TryAsBool().has_value();
+    n += arg.TryAsInt32().has_value();
+    n += arg.TryAsFloat().has_value();
+    n += arg.TryAsChar().has_value();
+    n += arg.TryAsRgbaColor().has_value();
+    n += arg.TryAsMidiMessage().has_value();
+    n += arg.TryAsInt64().has_value();
+    n += arg.TryAsTimeTag().has_value();
+    n += arg.TryAsDouble().has_value();
+    if( std::optional<const char*> s = arg.TryAsString() )
+        n += std::strlen( *s );
+    if( std::optional<const char*> s = arg.TryAsSymbol() )
+        n += std::strlen( *s );
+    if( std::optional<Blob> b = arg.TryAsBlob() ){
+        const char *data = (const char*)b->data;
+        for( osc_bundle_element_size_t i=0; i < b->size; ++i )
+            n += (unsigned char)data[i];
+    }
+    if( arg.IsArrayBegin() )
+        n += arg.ComputeArrayItemCount();
+    sink_ += n;
+}
+
+
+void ReadMessage( const ReceivedMessage& m )
+{
+    const char *address = m.AddressPattern();
+    for( const char *a : addresses_ ){
+        sink_ += MatchAddressPattern( address, a );
+        sink_ += MatchAddressPattern( "/*/?/{freq,gain}", address );
+    }
+    if( IsAddressPattern( address ) )
+        sink_ += CompiledAddressPattern( address ).Matches( "/synth/1/freq" );
+
+    for( ReceivedMessage::const_iterator i = m.ArgumentsBegin(); i != m.ArgumentsEnd(); ++i )
+        ReadArgument( *i );
+}
+
+
+void ReadBundle( const ReceivedBundle& b, int depth )
+{
+    sink_ += (std::size_t)b.TimeTag();
+    for( ReceivedBundle::const_iterator i = b.ElementsBegin(); i != b.ElementsEnd(); ++i ){
+        if( i->IsBundle() ){
+            std::optional<ReceivedBundle> nested;
+            if( depth < 64 && ReceivedBundle::TryParse( *i, nested ) == PARSE_OK )
+                ReadBundle( *nested, depth + 1 );
+        }else{
+            std::optional<ReceivedMessage> m;
+            if( ReceivedMessage::TryParse( *i, m ) == PARSE_OK )
+                ReadMessage( *m );
+        }
+    }
+}
+
+
+void FuzzOnePacket( const uint8_t *data, std::size_t size )
+{
+    // a copy of exactly size bytes, so that the sanitizers catch reads
+    // past the end. allocations are suitably aligned, as receive buffers are.
+    std::unique_ptr<char[]> copy( new char[ size ? size : 1 ] );
+    if( size > 0 )
+        std::memcpy( copy.get(), data, size );
+    const char *packetData = copy.get();
+
+    std::optional<ReceivedPacket> p;
+    if( ReceivedPacket::TryParse( packetData, size, p ) != PARSE_OK )
+        return;
+
+    if( p->IsBundle() ){
+        std::optional<ReceivedBundle> b;
+        if( ReceivedBundle::TryParse( *p, b ) == PARSE_OK )
+            ReadBundle( *b, 1 );
+    }else{
+        std::optional<ReceivedMessage> m;
+        if( ReceivedMessage::TryParse( *p, m ) == PARSE_OK )
+            ReadMessage( *m );
+    }
+
+    try{
+        std::ostringstream os;
+        os << *p;
+        sink_ += os.str().size();
+    }catch( Exception& ){
+    }
+
+    for( int lazy = 0; lazy < 2; ++lazy ){
+        FuzzListener listener;
+        listener.SetLazyBundleValidation( lazy != 0 );
+        try{
+            listener.ProcessPacket( packetData, (int)size, IpEndpointName() );
+        }catch( Exception& ){
+        }
+    }
+}
+
+} // namespace osc
+
+
+extern "C" int LLVMFuzzerTestOneInput( const uint8_t *data, std::size_t size )
+{
+    osc::FuzzOnePacket( data, size );
+    return 0;
+}
+
+
+#if defined(OSCPACK_FUZZ_STANDALONE)
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "OscGarbagePackets.h"
+
+int main(int argc, char* argv[])
+{
+    long iterations = 100000;
+    uint64_t seed = 1;
+    std::vector<std::string> files;
+    for( int i=1; i < argc; ++i ){
+        std::string arg = argv[i];
+        if( arg.compare( 0, 13, "--iterations=" ) == 0 )
+            iterations = std::stol( arg.substr( 13 ) );
+        else if( arg.compare( 0, 7, "--seed=" ) == 0 )
+            seed = std::stoull( arg.substr( 7 ) );
+        else if( arg.compare( 0, 2, "--" ) == 0 ){
+            std::cerr << "usage: OscFuzz [--iterations=N] [--seed=S] [file...]\n";
+            return 1;
+        }else
+            files.push_back( arg );
+    }
+
+    if( !files.empty() ){
+        for( const std::string& file : files ){
+            std::ifstream in( file.c_str(), std::ios::binary );
+            if( !in ){
+                std::cerr << "OscFuzz: can't open " << file << "\n";
+                return 1;
+            }
+            std::vector<char> contents( (std::istreambuf_iterator<char>( in )), std::istreambuf_iterator<char>() );
+            LLVMFuzzerTestOneInput( (const uint8_t*)contents.data(), contents.size() );
+        }
+        std::cout << files.size() << " files run\n";
+        return 0;
+    }
+
+    osc::GarbagePacketGenerator generator( seed );
+    std::vector<char> buffer( osc::GarbagePacketGenerator::MINIMUM_CAPACITY );
+    for( long i=0; i < iterations; ++i ){
+        std::size_t size = generator.MakePacket( buffer.data(), buffer.size(), 0.9 );
+        LLVMFuzzerTestOneInput( (const uint8_t*)buffer.data(), size );
+    }
+    std::cout << iterations << " packets run, seed " << seed << "\n";
+    return 0;
+}
+
+#endif /* OSCPACK_FUZZ_STANDALONE */
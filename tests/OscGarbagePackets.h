@@ -0,0 +1,247 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+#ifndef INCLUDED_OSCGARBAGEPACKETS_H
+#define INCLUDED_OSCGARBAGEPACKETS_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "osc/OscOutboundPacketStream.h"
+
+/*
+    Pseudo-random OSC packets for the fuzzing and stress tools: well formed
+    messages and (possibly nested) bundles of all argument types, and
+    corrupted copies of them. Corruption flips bits, overwrites bytes and
+    size fields with boundary values, truncates, extends, or replaces the
+    packet with noise, so that a mutated packet exercises the parser's
+    bounds checks rather than just failing its first test.
+
+    packets are deterministic for a given seed.
+*/
+
+namespace osc{
+
+class GarbagePacketGenerator{
+    uint64_t state_;
+
+    static const char *AddressPattern( std::size_t i )
+    {
+        static const char *patterns[] = {
+            "/a", "/synth/1/freq", "/synth/2/freq", "/synth/*/freq", "/synth/?/gain",
+            "/[a-c]/{x,y,zz}", "/*", "/{}", "/[!a-z]", "//", "/a/b/c/d/e/f/g/h",
+            "/long/address/pattern/with/many/parts/0123456789"
+        };
+        return patterns[ i % (sizeof(patterns) / sizeof(patterns[0])) ];
+    }
+
+    void WriteArgument( oscpack::OutboundPacketStream& ps, int depth )
+    {
+        static const char text[] = "abcdefghijklmnopqrstuvwxyz012345";
+        switch( Uniform( depth < 2 ? 17 : 16 ) ){
+            case 0: ps << ((Next() & 1) != 0); break;
+            case 1: ps << oscpack::OscNil(); break;
+            case 2: ps << oscpack::Infinitum(); break;
+            case 3: ps << (int32_t)Next(); break;
+            case 4: ps << (float)(int32_t)Next() / 1024.f; break;
+            case 5: ps << (char)('a' + Uniform( 26 )); break;
+            case 6: ps << oscpack::RgbaColor( Next() ); break;
+            case 7: ps << oscpack::MidiMessage( Next() ); break;
+            case 8: ps << (int64_t)(((uint64_t)Next() << 32) | Next()); break;
+            case 9: ps << oscpack::TimeTag( ((uint64_t)Next() << 32) | Next() ); break;
+            case 10: ps << (double)(int32_t)Next() / 3.; break;
+            case 11: ps << oscpack::string_view( text, Uniform( 17 ) ); break;
+            case 12:{
+                char symbol[17];
+                std::size_t length = Uniform( 17 );
+                std::memcpy( symbol, text, length );
+                symbol[length] = '\0';
+                ps << oscpack::Symbol( symbol );
+                break;
+            }
+            case 13: ps << oscpack::Blob( text, (oscpack::osc_bundle_element_size_t)Uniform( 33 ) ); break;
+            case 14: ps << oscpack::string_view( "" ); break;
+            case 15: ps << oscpack::Blob( text, 0 ); break;
+            case 16:{
+                ps << oscpack::BeginArray();
+                for( std::size_t i = Uniform( 4 ); i > 0; --i )
+                    WriteArgument( ps, depth + 1 );
+                ps << oscpack::EndArray();
+                break;
+            }
+        }
+    }
+
+    void WriteMessage( oscpack::OutboundPacketStream& ps )
+    {
+        ps << oscpack::BeginMessage( AddressPattern( Next() ) );
+        for( std::size_t i = Uniform( 7 ); i > 0; --i )
+            WriteArgument( ps, 0 );
+        ps << oscpack::EndMessage();
+    }
+
+    void WriteBundle( oscpack::OutboundPacketStream& ps, int depth )
+    {
+        ps << oscpack::BeginBundle( (Next() & 1) ? 1 : ((uint64_t)Next() << 32) );
+        for( std::size_t i = Uniform( 4 ); i > 0; --i ){
+            if( depth < 2 && Uniform( 4 ) == 0 )
+                WriteBundle( ps, depth + 1 );
+            else
+                WriteMessage( ps );
+        }
+        ps << oscpack::EndBundle();
+    }
+
+    uint32_t InterestingInt32( std::size_t packetSize )
+    {
+        static const uint32_t values[] = {
+            0, 1, 3, 4, 8, 16, 0x7F, 0x80, 0xFF, 0x7FFFFFFF, 0x80000000,
+            0xFFFFFFFC, 0xFFFFFFFF
+        };
+        std::size_t i = Uniform( sizeof(values) / sizeof(values[0]) + 3 );
+        if( i < sizeof(values) / sizeof(values[0]) )
+            return values[i];
+        // sizes close to the actual packet size are the most likely to
+        // get past the first checks
+        return (uint32_t)packetSize + 4 * (uint32_t)(i - sizeof(values) / sizeof(values[0])) - 4;
+    }
+
+public:
+    // buffers passed to the generator must be at least this large
+    static constexpr std::size_t MINIMUM_CAPACITY = 8192;
+
+    explicit GarbagePacketGenerator( uint64_t seed=1 )
+        : state_( seed ? seed : 1 ) {}
+
+    // xorshift64*
+    uint32_t Next()
+    {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return (uint32_t)((state_ * 0x2545F4914F6CDD1DULL) >> 32);
+    }
+
+    // a value in [0, n)
+    std::size_t Uniform( std::size_t n ) { return (std::size_t)(Next() % n); }
+
+    // writes a well formed message or bundle to buffer and returns its size
+    std::size_t MakeValidPacket( char *buffer, std::size_t capacity )
+    {
+        assert( capacity >= MINIMUM_CAPACITY );
+        oscpack::OutboundPacketStream ps( buffer, capacity );
+        if( Uniform( 3 ) == 0 ){
+            try{
+                WriteBundle( ps, 0 );
+                return ps.Size();
+            }catch( oscpack::OutOfBufferMemoryException& ){
+                // a large nested bundle, a single message always fits
+                ps.Clear();
+            }
+        }
+        WriteMessage( ps );
+        return ps.Size();
+    }
+
+    // damages the packet of size bytes in buffer in place and returns its
+    // new size, which may be anything from 0 to capacity
+    std::size_t Corrupt( char *buffer, std::size_t size, std::size_t capacity )
+    {
+        static const char interestingChars[] = { 0, 1, '#', ',', '[', ']', '/', '*', '{', '}', 'b', 's' };
+
+        for( std::size_t mutations = 1 + Uniform( 4 ); mutations > 0; --mutations ){
+            switch( Uniform( size > 0 ? 7 : 1 ) ){
+                case 0: // noise, usually a multiple of 4 bytes
+                    size = Uniform( 512 );
+                    if( Uniform( 4 ) != 0 )
+                        size &= ~(std::size_t)3;
+                    for( std::size_t i=0; i < size; ++i )
+                        buffer[i] = (char)Next();
+                    break;
+                case 1: // bit flips
+                    for( std::size_t i = 1 + Uniform( 8 ); i > 0; --i )
+                        buffer[ Uniform( size ) ] ^= (char)(1 << Uniform( 8 ));
+                    break;
+                case 2: // byte overwrites
+                    for( std::size_t i = 1 + Uniform( 4 ); i > 0; --i )
+                        buffer[ Uniform( size ) ] = interestingChars[ Uniform( sizeof(interestingChars) ) ];
+                    break;
+                case 3: // size fields and other int32s
+                    if( size >= 4 ){
+                        uint32_t value = InterestingInt32( size );
+                        char *p = buffer + (Uniform( size / 4 ) * 4);
+                        p[0] = (char)(value >> 24);
+                        p[1] = (char)(value >> 16);
+                        p[2] = (char)(value >> 8);
+                        p[3] = (char)value;
+                    }
+                    break;
+                case 4: // truncation, usually to a multiple of 4
+                    size = Uniform( size );
+                    if( Uniform( 4 ) != 0 )
+                        size &= ~(std::size_t)3;
+                    break;
+                case 5: // extension, usually by a multiple of 4 bytes
+                    for( std::size_t i = Uniform( 4 ) ? 4 * Uniform( 5 ) : Uniform( 16 );
+                            i > 0 && size < capacity; --i )
+                        buffer[ size++ ] = (char)Next();
+                    break;
+                case 6: // terminators removed from strings and type tags
+                    for( std::size_t i=0; i < size; ++i )
+                        if( buffer[i] == '\0' && Uniform( 4 ) == 0 )
+                            buffer[i] = 'x';
+                    break;
+            }
+        }
+        return size;
+    }
+
+    // writes a packet to buffer and returns its size. the packet is
+    // corrupted with probability corruptFraction (0..1)
+    std::size_t MakePacket( char *buffer, std::size_t capacity, double corruptFraction )
+    {
+        std::size_t size = MakeValidPacket( buffer, capacity );
+        if( (double)Next() < corruptFraction * 4294967296. )
+            size = Corrupt( buffer, size, capacity );
+        return size;
+    }
+};
+
+} // namespace osc
+
+#endif /* INCLUDED_OSCGARBAGEPACKETS_H */
@@ -0,0 +1,126 @@
+/*
+	oscpack -- Open Sound Control (OSC) packet manipulation library
+    http://www.rossbencina.com/code/oscpack
+
+    Copyright (c) 2004-2013 Ross Bencina <rossb@audiomulch.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be
+	included in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+	ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+	CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+	WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+	The text above constitutes the entire oscpack license; however, 
+	the oscpack developer(s) also make the following non-binding requests:
+
+	Any person wishing to distribute modifications to the Software is
+	requested to send the modifications to the original developer so that
+	they can be incorporated into the canonical version. It is also 
+	requested that these non-binding requests be included whenever the
+	above license is reproduced.
+*/
+
+/*
+    Checks that the receive side headers compile and work with exceptions
+    disabled. The cmake build compiles this file with -fno-exceptions (or
+    /EHs-c- with MSVC) and runs it as the OscNoExceptions test.
+*/
+#include <cstring>
+#include <iostream>
+#include <optional>
+
+#include "osc/OscReceivedElements.h"
+#include "osc/OscPrintReceivedElements.h"
+#include "osc/OscPacketListener.h"
+#include "osc/MessageMappingOscPacketListener.h"
+#include "osc/CoalescingOscPacketListener.h"
+#include "osc/OscAddressPattern.h"
+#include "osc/OscAddressMatchCache.h"
+#include "osc/OscAddressTable.h"
+#include "osc/OscTypedMessageView.h"
+#include "osc/OscTimeTag.h"
+
+#if defined(OSCPACK_HAS_EXCEPTIONS)
+#error "OscNoExceptionsTest must be compiled with exceptions disabled"
+#endif
+
+using namespace oscpack;
+
+namespace {
+
+int failCount_ = 0;
+
+void check( bool condition, const char *text )
+{
+    if( !condition ){
+        ++failCount_;
+        std::cout << "FAILED: " << text << "\n";
+    }
+}
+
+#define CHECK( condition ) check( (condition), #condition )
+
+class CountingOscPacketListener : public OscPacketListener{
+public:
+    int messageCount = 0;
+    int32_t lastValue = 0;
+
+protected:
+    void ProcessMessage( const ReceivedMessage& m, const IpEndpointName& ) override
+    {
+        std::optional<int32_t> value = m.ArgumentsBegin()->TryAsInt32();
+        if( value )
+            lastValue = *value;
+        ++messageCount;
+    }
+};
+
+} // namespace
+
+
+int main()
+{
+    // "/a" ,i 42
+    const char message[] = { '/', 'a', 0, 0, ',', 'i', 0, 0, 0, 0, 0, 42 };
+
+    std::optional<ReceivedPacket> packet;
+    CHECK( ReceivedPacket::TryParse( message, sizeof(message), packet ) == PARSE_OK );
+    std::optional<ReceivedPacket> unaligned;
+    CHECK( ReceivedPacket::TryParse( message, 3, unaligned ) != PARSE_OK );
+
+    std::optional<ReceivedMessage> m;
+    CHECK( packet && ReceivedMessage::TryParse( *packet, m ) == PARSE_OK );
+    CHECK( m && std::strcmp( m->AddressPattern(), "/a" ) == 0 );
+    CHECK( m && m->ArgumentsBegin()->TryAsInt32() == 42 );
+    CHECK( m && !m->ArgumentsBegin()->TryAsFloat() );
+
+    std::optional<ReceivedPacket> shortPacket;
+    std::optional<ReceivedMessage> truncated;
+    CHECK( ReceivedPacket::TryParse( message, 8, shortPacket ) == PARSE_OK );
+    CHECK( shortPacket && ReceivedMessage::TryParse( *shortPacket, truncated ) == PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE );
+
+    CHECK( MatchAddressPattern( "/a", "/a" ) );
+    CHECK( !MatchAddressPattern( "/[b-z]", "/a" ) );
+
+    CountingOscPacketListener listener;
+    listener.ProcessPacket( message, (int)sizeof(message), IpEndpointName() );
+    CHECK( listener.messageCount == 1 && listener.lastValue == 42 );
+
+    std::cout << ( failCount_ == 0 ? "OscNoExceptions: all checks passed\n" : "OscNoExceptions: FAILED\n" );
+    return failCount_ == 0 ? 0 : 1;
+}
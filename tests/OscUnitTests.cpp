@@ -36,13 +36,56 @@
 */
 #include "OscUnitTests.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "osc/OscReceivedElements.h"
 #include "osc/OscPrintReceivedElements.h"
 #include "osc/OscOutboundPacketStream.h"
+#include "osc/OscAddressPattern.h"
+#include "osc/OscAddressMatchCache.h"
+#include "osc/MessageMappingOscPacketListener.h"
+#include "osc/OscTimeTag.h"
+#include "osc/OscAllocators.h"
+#include "osc/OscMessageWriter.h"
+#include "osc/OscTypedMessageView.h"
+#include "osc/CoalescingTransmitter.h"
+#include "osc/CoalescingOscPacketListener.h"
+#include "osc/OscGrowableOutboundPacketStream.h"
+#include "osc/OscPacketListener.h"
+#include "osc/OscPreparedMessage.h"
+#include "osc/OscPooledOutboundPacketStream.h"
+#include "osc/OscPacketCapture.h"
+#include "ip/EndpointResolver.h"
+#include "ip/QueuedPacketListener.h"
+#include "ip/UdpSocket.h"
+#include "ip/UdpReceiveGroup.h"
+#if defined(_WIN32)
+#include "ip/win32/CompletionPortSocketReceiveMultiplexer.h"
+#else
+#include "ip/posix/EventSocketReceiveMultiplexer.h"
+#endif
+#if defined(__linux__)
+#include "ip/posix/SharedMemorySocketReceiveMultiplexer.h"
+#include "ip/posix/UringSocketReceiveMultiplexer.h"
+#include <csignal>
+#include <sys/resource.h>
+#endif
 
 #if defined(__BORLANDC__) // workaround for BCB4 release build intrinsics bug
 namespace std {
@@ -435,11 +478,3020 @@ void test3()
 }
 
 
-void RunUnitTests()
+class MappingTestListener : public MessageMappingOscPacketListener<MappingTestListener>{
+public:
+    int aCount, bCount, cCount;
+
+    MappingTestListener()
+        : aCount( 0 ), bCount( 0 ), cCount( 0 )
+    {
+        RegisterMessageFunction( "/synth/1/freq", &MappingTestListener::A );
+        RegisterMessageFunction( "/synth/2/freq", &MappingTestListener::B );
+        RegisterMessageFunction( "/synth/1/gain", &MappingTestListener::C );
+    }
+
+    void A( const ReceivedMessage&, const IpEndpointName& ) { ++aCount; }
+    void B( const ReceivedMessage&, const IpEndpointName& ) { ++bCount; }
+    void C( const ReceivedMessage&, const IpEndpointName& ) { ++cCount; }
+};
+
+
+void test4()
 {
-    test1();
-    test2();
-    test3();
+    assertEqual( MatchAddressPattern( "/a/b", "/a/b" ), true );
+    assertEqual( MatchAddressPattern( "/a/b", "/a/bc" ), false );
+    assertEqual( MatchAddressPattern( "/a/?", "/a/b" ), true );
+    assertEqual( MatchAddressPattern( "/a?b", "/a/b" ), false );
+    assertEqual( MatchAddressPattern( "/a/*", "/a/bcd" ), true );
+    assertEqual( MatchAddressPattern( "/a/*", "/a/" ), true );
+    assertEqual( MatchAddressPattern( "/*", "/a/b" ), false );
+    assertEqual( MatchAddressPattern( "/*/b", "/a/b" ), true );
+    assertEqual( MatchAddressPattern( "/a*d", "/abcd" ), true );
+    assertEqual( MatchAddressPattern( "/[abc]", "/b" ), true );
+    assertEqual( MatchAddressPattern( "/[a-c]x", "/cx" ), true );
+    assertEqual( MatchAddressPattern( "/[!a-c]", "/d" ), true );
+    assertEqual( MatchAddressPattern( "/[!a-c]", "/b" ), false );
+    assertEqual( MatchAddressPattern( "/[a-", "/a" ), false );
+    assertEqual( MatchAddressPattern( "/{foo,bar}/x", "/bar/x" ), true );
+    assertEqual( MatchAddressPattern( "/{foo,bar}/x", "/baz/x" ), false );
+    assertEqual( MatchAddressPattern( "/{,a}b", "/b" ), true );
+    assertEqual( IsAddressPattern( "/a/b" ), false );
+    assertEqual( IsAddressPattern( "/a/{b,c}" ), true );
+
+    // dispatch of exact addresses and patterns
+
+    const int bufferSize = 256;
+    char buffer[bufferSize];
+    IpEndpointName endpoint;
+    MappingTestListener listener;
+
+    const char *addresses[] = { "/synth/1/freq", "/synth/*/freq", "/synth/1/*", "/synth/[12]/gain", "/synth/3/freq" };
+    for( const char *address : addresses ){
+        OutboundPacketStream ps( buffer, bufferSize );
+        ps << BeginMessage( address ) << 1.f << oscpack::EndMessage();
+        listener.ProcessPacket( ps.Data(), (int)ps.Size(), endpoint );
+    }
+
+    assertEqual( listener.aCount, 3 );
+    assertEqual( listener.bCount, 1 );
+    assertEqual( listener.cCount, 2 );
+}
+
+
+// the backtracking matcher which MatchAddressPattern() replaced, which the
+// state machine must agree with. exponential for patterns such as /*a*a*b
+bool ReferenceMatchAddressPattern( const char *pattern, const char *address )
+{
+    while( *pattern ){
+        switch( *pattern ){
+            case '?':
+                if( *address == '\0' || *address == '/' )
+                    return false;
+                ++pattern;
+                ++address;
+                break;
+
+            case '*':
+                while( *pattern == '*' )
+                    ++pattern;
+
+                // try each possible length of the star match, stopping at
+                // the end of the current address part
+                for(;;){
+                    if( ReferenceMatchAddressPattern( pattern, address ) )
+                        return true;
+                    if( *address == '\0' || *address == '/' )
+                        return false;
+                    ++address;
+                }
+
+            case '[':
+                {
+                    if( *address == '\0' || *address == '/' )
+                        return false;
+
+                    bool matched;
+                    pattern = oscpack::detail::MatchAddressPatternSet( pattern + 1, *address, matched );
+                    if( !pattern || !matched )
+                        return false;
+                    ++address;
+                }
+                break;
+
+            case '{':
+                {
+                    const char *close = std::strchr( pattern, '}' );
+                    if( !close )
+                        return false;
+
+                    const char *alternative = pattern + 1;
+                    for(;;){
+                        const char *alternativeEnd = alternative;
+                        while( alternativeEnd != close && *alternativeEnd != ',' )
+                            ++alternativeEnd;
+
+                        std::size_t length = alternativeEnd - alternative;
+                        if( std::strncmp( alternative, address, length ) == 0
+                                && ReferenceMatchAddressPattern( close + 1, address + length ) )
+                            return true;
+
+                        if( alternativeEnd == close )
+                            return false;
+                        alternative = alternativeEnd + 1;
+                    }
+                }
+
+            default:
+                if( *pattern != *address )
+                    return false;
+                ++pattern;
+                ++address;
+                break;
+        }
+    }
+
+    return *address == '\0';
+}
+
+
+void test5()
+{
+    // patterns agree with the backtracking matcher
+
+    const char *patterns[] = { "/a/b", "/a/?", "/a/*", "/*", "/*/b", "/a*d", "/a*b*c", "/[abc]",
+            "/[a-c]x", "/[!a-c]", "/[a-", "/{foo,bar}/x", "/{,a}b", "/{a,ab}c*", "/a/{b" };
+    const char *addresses[] = { "/a/b", "/a/bc", "/a/", "/abcd", "/abc", "/abxbxc", "/b", "/cx",
+            "/d", "/bar/x", "/baz/x", "/abcd/e", "/abc", "/" };
+
+    int disagreements = 0;
+    for( const char *pattern : patterns ){
+        CompiledAddressPattern compiled( pattern );
+        for( const char *address : addresses ){
+            if( compiled.Matches( address ) != ReferenceMatchAddressPattern( pattern, address ) ){
+                std::cout << "compiled pattern " << pattern << " disagrees on " << address << "\n";
+                ++disagreements;
+            }
+        }
+    }
+    assertEqual( disagreements, 0 );
+
+    // and on random patterns and addresses
+    uint32_t seed = 1;
+    auto random = [&seed]( uint32_t n ) {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) % n;
+    };
+    const char patternCharacters[] = "ab/*?{,}[]!-";
+    const char addressCharacters[] = "ab/";
+    disagreements = 0;
+    for( int i=0; i < 20000; ++i ){
+        std::string pattern( "/" ), address( "/" );
+        for( uint32_t j = random( 8 ); j > 0; --j )
+            pattern += patternCharacters[ random( sizeof(patternCharacters) - 1 ) ];
+        for( uint32_t j = random( 8 ); j > 0; --j )
+            address += addressCharacters[ random( sizeof(addressCharacters) - 1 ) ];
+        if( MatchAddressPattern( pattern.c_str(), address.c_str() )
+                != ReferenceMatchAddressPattern( pattern.c_str(), address.c_str() ) ){
+            if( disagreements++ < 10 )
+                std::cout << "pattern " << pattern << " disagrees on " << address << "\n";
+        }
+    }
+    assertEqual( disagreements, 0 );
+
+    // patterns which make a backtracking matcher take exponential time
+    std::string stars( "/" );
+    for( int i=0; i < 20; ++i )
+        stars += "*a";
+    stars += "*b";
+    const std::string as = "/" + std::string( 40, 'a' );
+    std::string longAddress = "/" + std::string( 2000, 'a' ) + "b";
+    auto start = std::chrono::steady_clock::now();
+    CompiledAddressPattern pathological( stars.c_str() );
+    assertEqual( pathological.Matches( as.c_str() ), false );
+    assertEqual( pathological.Matches( longAddress.c_str() ), true );
+    assertEqual( MatchAddressPattern( stars.c_str(), as.c_str() ), false );
+    assertEqual( MatchAddressPattern( "/{a,a}{a,a}{a,a}{a,a}{a,a}{a,a}{a,a}{a,a}{a,a}{a,a}{a,a}{a,a}b", as.c_str() ), false );
+    double elapsedMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+    assertEqual( elapsedMs < 1000., true );
+
+    // the number of alternatives is limited
+    std::string alternatives( "/{" );
+    for( std::size_t i=1; i < MAX_ADDRESS_PATTERN_ALTERNATIVES; ++i )
+        alternatives += "a,";
+    alternatives += "b}";
+    assertEqual( MatchAddressPattern( alternatives.c_str(), "/b" ), true );
+    alternatives.insert( 2, "a," );
+    assertEqual( CompiledAddressPattern( alternatives.c_str() ).IsValid(), false );
+    assertEqual( MatchAddressPattern( alternatives.c_str(), "/b" ), false );
+
+    assertEqual( CompiledAddressPattern( "/a/b" ).IsLiteral(), true );
+    assertEqual( CompiledAddressPattern( "/a/*" ).IsLiteral(), false );
+    assertEqual( CompiledAddressPattern( "/[a-" ).IsValid(), false );
+
+    // least recently used eviction
+
+    AddressMatchCache<int> cache( 2 );
+    cache.Insert( "/a" ).push_back( 1 );
+    cache.Insert( "/b" ).push_back( 2 );
+    assertEqual( cache.Find( "/a" ) != 0, true ); // /b is now least recently used
+    cache.Insert( "/c" ).push_back( 3 );
+    assertEqual( cache.Size(), (std::size_t)2 );
+    assertEqual( cache.Find( "/b" ) == 0, true );
+    assertEqual( (*cache.Find( "/a" ))[0], 1 );
+    assertEqual( (*cache.Find( "/c" ))[0], 3 );
+}
+
+
+void test6()
+{
+    using namespace std::chrono;
+
+    // time tag conversion
+
+    system_clock::time_point unixEpoch;
+    assertEqual( TimeTagFromSystemTime( unixEpoch ), (uint64_t)NTP_UNIX_EPOCH_OFFSET_SECONDS << 32 );
+    assertEqual( TimeTagFromSystemTime( unixEpoch + milliseconds( 500 ) ),
+            ((uint64_t)NTP_UNIX_EPOCH_OFFSET_SECONDS << 32) | 0x80000000u );
+
+    system_clock::time_point t = unixEpoch + seconds( 1700000000 ) + microseconds( 123456 );
+    int64_t errorUs = duration_cast<microseconds>( SystemTimeFromTimeTag( TimeTagFromSystemTime( t ) ) - t ).count();
+    assertEqual( errorUs >= -1 && errorUs <= 1, true );
+
+    uint64_t a = TimeTagFromSystemTime( t );
+    uint64_t b = TimeTagFromSystemTime( t + milliseconds( 250 ) );
+    assertEqual( std::fabs( TimeTagDifferenceSeconds( b, a ) - 0.25 ) < 1e-6, true );
+    assertEqual( std::fabs( TimeTagDifferenceSeconds( a, b ) + 0.25 ) < 1e-6, true );
+
+    // kernel receive timestamps are nanoseconds since the unix epoch
+    assertEqual( TimeTagFromUnixTimeNs( 0 ), (uint64_t)NTP_UNIX_EPOCH_OFFSET_SECONDS << 32 );
+    assertEqual( TimeTagFromUnixTimeNs( 1700000000123456000ll ), a );
+    assertEqual( TimeTagFromUnixTimeNs( -500000000 ),
+            ((uint64_t)(NTP_UNIX_EPOCH_OFFSET_SECONDS - 1) << 32) | 0x80000000u );
+
+    // owned messages outlive the packet buffer
+
+    const int bufferSize = 64;
+    char buffer[bufferSize];
+    OutboundPacketStream ps( buffer, bufferSize );
+    ps << BeginMessage( "/owned" ) << 42 << oscpack::EndMessage();
+
+    OwnedMessage owned( ReceivedMessage( ReceivedPacket( ps.Data(), ps.Size() ) ) );
+    std::memset( buffer, 0, bufferSize );
+    OwnedMessage moved( std::move( owned ) );
+    assertEqual( std::strcmp( moved.Message().AddressPattern(), "/owned" ), 0 );
+    assertEqual( moved.Message().ArgumentsBegin()->AsInt32(), 42 );
+}
+
+
+void test7()
+{
+    const int bufferSize = 64;
+    char buffer[bufferSize];
+    OutboundPacketStream ps( buffer, bufferSize );
+    ps << BeginMessage( "/pooled" ) << 7 << oscpack::EndMessage();
+    ReceivedMessage m( ReceivedPacket( ps.Data(), ps.Size() ) );
+
+    // pool blocks are reused and the heap is used once the pool is exhausted
+
+    FixedBlockPool pool( 64, 2 );
+    typedef BasicOwnedMessage< PoolAllocator<char> > PooledMessage;
+    {
+        PooledMessage a( m, PoolAllocator<char>( &pool ) );
+        PooledMessage b( m, PoolAllocator<char>( &pool ) );
+        PooledMessage c( m, PoolAllocator<char>( &pool ) );
+        assertEqual( pool.Owns( a.Message().AddressPattern() ), true );
+        assertEqual( pool.Owns( b.Message().AddressPattern() ), true );
+        assertEqual( pool.Owns( c.Message().AddressPattern() ), false );
+        assertEqual( pool.Allocate() == 0, true );
+        assertEqual( c.Message().ArgumentsBegin()->AsInt32(), 7 );
+    }
+    void *p1 = pool.Allocate();
+    void *p2 = pool.Allocate();
+    assertEqual( p1 != 0 && p2 != 0, true );
+    pool.Deallocate( p1 );
+    pool.Deallocate( p2 );
+
+    // arena allocations are released together by Reset()
+
+    BumpArena arena( 128 );
+    {
+        BasicOwnedMessage< ArenaAllocator<char> > a( m, ArenaAllocator<char>( &arena ) );
+        assertEqual( arena.Owns( a.Message().AddressPattern() ), true );
+        assertEqual( std::strcmp( a.Message().AddressPattern(), "/pooled" ), 0 );
+    }
+    assertEqual( arena.Used(), (std::size_t)ps.Size() );
+    arena.Reset();
+    assertEqual( arena.Used(), (std::size_t)0 );
+    assertEqual( arena.Allocate( 129 ) == 0, true );
+}
+
+
+void test8()
+{
+    const int bufferSize = 256;
+    char buffer[bufferSize], typedBuffer[bufferSize];
+    std::memset( buffer, 0x74, bufferSize );
+    std::memset( typedBuffer, 0x74, bufferSize );
+
+    // typed messages are byte for byte the same as the equivalent untyped message
+
+    OutboundPacketStream ps( buffer, bufferSize );
+    ps << BeginBundleImmediate()
+        << BeginMessage( "/typed" ) << 1 << 2.5f << "abc" << true << oscpack::EndMessage()
+        << BeginMessage( "/abc" ) << oscpack::EndMessage()
+        << EndBundle();
+
+    OutboundPacketStream typed( typedBuffer, bufferSize );
+    typed << BeginBundleImmediate()
+        << BeginTypedMessage( "/typed", "ifsT" ) << 1 << 2.5f << "abc" << true;
+    assertEqual( typed.Size(), ps.Size() - 16 ); // less the second message
+    typed << oscpack::EndMessage()
+        << BeginTypedMessage( "/abc", "," ) << oscpack::EndMessage()
+        << EndBundle();
+
+    assertEqual( typed.IsReady(), true );
+    assertEqual( typed.Size(), ps.Size() );
+    assertEqual( std::memcmp( typed.Data(), ps.Data(), ps.Size() ), 0 );
+
+    // arguments which don't match the type tags
+
+    bool mismatchThrown = false;
+    try{
+        OutboundPacketStream s( typedBuffer, bufferSize );
+        s << BeginTypedMessage( "/f", "f" ) << 1;
+    }catch( TypeTagMismatchException& ){
+        mismatchThrown = true;
+    }
+    assertEqual( mismatchThrown, true );
+
+    bool excessThrown = false;
+    try{
+        OutboundPacketStream s( typedBuffer, bufferSize );
+        s << BeginTypedMessage( "/f", "f" ) << 1.f << 2.f;
+    }catch( TypeTagMismatchException& ){
+        excessThrown = true;
+    }
+    assertEqual( excessThrown, true );
+
+    bool missingThrown = false;
+    try{
+        OutboundPacketStream s( typedBuffer, bufferSize );
+        s << BeginTypedMessage( "/f", "ff" ) << 1.f << oscpack::EndMessage();
+    }catch( TypeTagMismatchException& ){
+        missingThrown = true;
+    }
+    assertEqual( missingThrown, true );
+
+    bool outOfMemoryThrown = false;
+    try{
+        OutboundPacketStream s( typedBuffer, 4 );
+        s << BeginTypedMessage( "/f", "ff" );
+    }catch( OutOfBufferMemoryException& ){
+        outOfMemoryThrown = true;
+    }
+    assertEqual( outOfMemoryThrown, true );
+}
+
+
+void test9()
+{
+    const int bufferSize = 256;
+    char buffer[bufferSize], writerBuffer[bufferSize];
+    std::memset( buffer, 0x74, bufferSize );
+    std::memset( writerBuffer, 0x74, bufferSize );
+
+    const char blobData[] = { 1, 2, 3, 4, 5 };
+
+    // MessageWriter produces the same bytes as the streaming interface
+
+    OutboundPacketStream ps( buffer, bufferSize );
+    ps << BeginBundleImmediate()
+        << BeginMessage( "/fader" ) << 3 << 0.5f << 1.25 << oscpack::EndMessage()
+        << BeginMessage( "/mixed/args" ) << "label" << (int64_t)-7 << Blob( blobData, 5 )
+            << Symbol( "sym" ) << OscNil() << oscpack::EndMessage()
+        << BeginMessage( "/none" ) << oscpack::EndMessage()
+        << EndBundle();
+
+    MessageWriter<int32_t, float, double> fader( "/fader" );
+    MessageWriter<const char*, int64_t, Blob, Symbol, NilType> mixed( "/mixed/args" );
+    MessageWriter<> none( "/none" );
+
+    OutboundPacketStream ws( writerBuffer, bufferSize );
+    ws << BeginBundleImmediate();
+    fader.Write( ws, 3, 0.5f, 1.25 );
+    mixed.Write( ws, "label", -7, Blob( blobData, 5 ), Symbol( "sym" ), OscNil() );
+    none.Write( ws );
+    ws << EndBundle();
+
+    assertEqual( ws.IsReady(), true );
+    assertEqual( ws.Size(), ps.Size() );
+    assertEqual( std::memcmp( ws.Data(), ps.Data(), ps.Size() ), 0 );
+    assertEqual( fader.Size( 3, 0.5f, 1.25 ), (std::size_t)32 );
+
+    // a whole message is bounds checked at once
+
+    bool outOfMemoryThrown = false;
+    try{
+        OutboundPacketStream small( writerBuffer, 20 );
+        fader.Write( small, 3, 0.5f, 1.25 );
+    }catch( OutOfBufferMemoryException& ){
+        outOfMemoryThrown = true;
+    }
+    assertEqual( outOfMemoryThrown, true );
+}
+
+void test10()
+{
+    const int bufferSize = 256;
+    char buffer[bufferSize];
+
+    OutboundPacketStream ps( buffer, bufferSize );
+    ps << BeginMessage( "/fader" ) << 3 << 0.5f << 1.25 << (int64_t)-7
+        << TimeTag( 42 ) << OscNil() << oscpack::EndMessage();
+
+    TypedMessageView<int32_t, float, double, int64_t, TimeTag, NilType> view( ps.Data(), ps.Size() );
+    assertEqual( view.IsValid(), true );
+    assertEqual( std::strcmp( view.AddressPattern(), "/fader" ), 0 );
+    assertEqual( view.Get<0>(), 3 );
+    assertEqual( view.Get<1>(), 0.5f );
+    assertEqual( view.Get<2>(), 1.25 );
+    assertEqual( view.Get<3>(), (int64_t)-7 );
+    assertEqual( (uint64_t)view.Get<4>(), (uint64_t)42 );
+
+    auto values = view.Values();
+    assertEqual( std::get<0>( values ), 3 );
+    assertEqual( std::get<3>( values ), (int64_t)-7 );
+
+    ReceivedMessage m( ReceivedPacket( ps.Data(), ps.Size() ) );
+    assertEqual( (TypedMessageView<int32_t, float, double, int64_t, TimeTag, NilType>( m ).IsValid()), true );
+
+    // other shapes, prefixes and truncated messages are rejected
+
+    assertEqual( (TypedMessageView<int32_t, float, double, int64_t, TimeTag>( m ).IsValid()), false );
+    assertEqual( (TypedMessageView<int32_t, float, float, int64_t, TimeTag, NilType>( m ).IsValid()), false );
+    assertEqual( (TypedMessageView<int32_t>( m ).IsValid()), false );
+    assertEqual( (TypedMessageView<int32_t, float, double, int64_t, TimeTag, NilType>( ps.Data(), ps.Size() - 8 ).IsValid()), false );
+    assertEqual( (TypedMessageView<int32_t, float, double, int64_t, TimeTag, NilType>( ps.Data(), 6 ).IsValid()), false );
+
+    // empty and unaligned sizes are rejected without reading past the end,
+    // e.g. of a short datagram
+    std::vector<char> shortPacket( ps.Data(), ps.Data() + 5 );
+    assertEqual( TypedMessageView<int32_t>( &shortPacket[0], shortPacket.size() ).IsValid(), false );
+    assertEqual( TypedMessageView<int32_t>( &shortPacket[0], 0 ).IsValid(), false );
+    std::vector<char> unaligned( ps.Data(), ps.Data() + ps.Size() - 2 );
+    assertEqual( (TypedMessageView<int32_t, float, double, int64_t, TimeTag, NilType>( &unaligned[0], unaligned.size() ).IsValid()), false );
+
+    // messages without arguments, with and without the type tag string
+
+    OutboundPacketStream empty( buffer, bufferSize );
+    empty << BeginMessage( "/none" ) << oscpack::EndMessage();
+    assertEqual( TypedMessageView<>( empty.Data(), empty.Size() ).IsValid(), true );
+
+    const char noTypeTags[] = "/none\0\0";
+    assertEqual( TypedMessageView<>( noTypeTags, 8 ).IsValid(), false );
+}
+
+// the scalar FindStr4End() loop, which the vectorised one must agree with
+const char* ReferenceFindStr4End( const char *p, const char *end )
+{
+    if( p >= end )
+        return 0;
+
+    if( p[0] == '\0' )
+        return p + 4;
+
+    p += 3;
+    end -= 1;
+
+    while( p < end && *p )
+        p += 4;
+
+    return *p ? 0 : p + 1;
+}
+
+
+void test11()
+{
+    // terminators at every word of strings that cross 16 byte boundaries
+
+    bool agrees = true;
+    char buffer[96];
+    for( int length = 4; length <= 64; length += 4 ){
+        for( int terminator = 0; terminator < length; ++terminator ){
+            std::memset( buffer, 'x', sizeof(buffer) );
+            buffer[terminator] = '\0';
+            for( int offset = 0; offset <= 8; offset += 4 ){
+                const char *p = buffer + offset;
+                if( FindStr4End( p, p + length ) != ReferenceFindStr4End( p, p + length ) )
+                    agrees = false;
+            }
+        }
+    }
+    assertEqual( agrees, true );
+
+    // long runs of fixed size arguments, interrupted by other arguments
+
+    const int bufferSize = 8192;
+    char *message = AllocateAligned4( bufferSize );
+
+    OutboundPacketStream ps( message, bufferSize );
+    ps << BeginMessage( "/spectrum" );
+    for( int i=0; i < 512; ++i )
+        ps << (float)i;
+    ps << oscpack::EndMessage();
+
+    ReceivedMessage spectrum( ReceivedPacket( ps.Data(), ps.Size() ) );
+    assertEqual( spectrum.ArgumentCount(), (uint32_t)512 );
+    ReceivedMessage::const_iterator last = spectrum.ArgumentsBegin();
+    for( int i=0; i < 511; ++i )
+        ++last;
+    assertEqual( last->AsFloat(), 511.f );
+
+    bool exceedsThrown = false;
+    try{
+        ReceivedMessage truncated( ReceivedPacket( ps.Data(), ps.Size() - 4 ) );
+    }catch( MalformedMessageException& ){
+        exceedsThrown = true;
+    }
+    assertEqual( exceedsThrown, true );
+
+    ps.Clear();
+    ps << BeginMessage( "/mixed" );
+    for( int i=0; i < 20; ++i )
+        ps << i;
+    ps << "text" << (int64_t)1 << true << OscNil() << 2.5;
+    ps << BeginArray();
+    for( int i=0; i < 18; ++i )
+        ps << (float)i;
+    ps << EndArray() << Symbol( "end" ) << oscpack::EndMessage();
+
+    ReceivedMessage mixed( ReceivedPacket( ps.Data(), ps.Size() ) );
+    assertEqual( mixed.ArgumentCount(), (uint32_t)46 );
+    ReceivedMessageArgumentStream args = mixed.ArgumentStream();
+    int32_t n;
+    for( int i=0; i < 20; ++i )
+        args >> n;
+    assertEqual( n, 19 );
+    const char *text;
+    int64_t h;
+    bool b;
+    double d;
+    args >> text >> h >> b;
+    assertEqual( std::strcmp( text, "text" ), 0 );
+    assertEqual( h, (int64_t)1 );
+    assertEqual( b, true );
+
+    ReceivedMessage::const_iterator i = mixed.ArgumentsBegin();
+    for( int j=0; j < 24; ++j )
+        ++i;
+    assertEqual( i->IsDouble(), true );
+    d = i->AsDouble();
+    assertEqual( d, 2.5 );
+    for( int j=0; j < 21; ++j )
+        ++i;
+    assertEqual( i->IsSymbol(), true );
+
+    ps.Clear();
+    ps << BeginMessage( "/alternating" );
+    for( int i=0; i < 20; ++i )
+        ps << i << (double)i << OscNil() << TimeTag( i );
+    ps << oscpack::EndMessage();
+
+    ReceivedMessage alternating( ReceivedPacket( ps.Data(), ps.Size() ) );
+    assertEqual( alternating.ArgumentCount(), (uint32_t)80 );
+    assertEqual( (std::size_t)(alternating.size()), ps.Size() );
+
+    bool alternatingExceedsThrown = false;
+    try{
+        ReceivedMessage truncated( ReceivedPacket( ps.Data(), ps.Size() - 8 ) );
+    }catch( MalformedMessageException& ){
+        alternatingExceedsThrown = true;
+    }
+    assertEqual( alternatingExceedsThrown, true );
+
+    ps.Clear();
+    ps << BeginMessage( "/mixed" );
+    for( int i=0; i < 20; ++i )
+        ps << i;
+    ps << "text" << (int64_t)1 << true << OscNil() << 2.5;
+    ps << BeginArray();
+    for( int i=0; i < 18; ++i )
+        ps << (float)i;
+    ps << EndArray() << Symbol( "end" ) << oscpack::EndMessage();
+
+    bool unknownThrown = false;
+    message[ 8 + 1 + 5 ] = 'x'; // a tag inside the leading int32 run
+    try{
+        ReceivedMessage unknown( ReceivedPacket( ps.Data(), ps.Size() ) );
+    }catch( MalformedMessageException& ){
+        unknownThrown = true;
+    }
+    assertEqual( unknownThrown, true );
+}
+
+void test12()
+{
+    const int bufferSize = 16384;
+    char *buffer = AllocateAligned4( bufferSize );
+    char *bulkBuffer = AllocateAligned4( bufferSize );
+
+    std::vector<float> floats( 1000 );
+    std::vector<int32_t> ints( 1000 );
+    for( std::size_t i=0; i < floats.size(); ++i ){
+        floats[i] = (float)i * 0.5f - 3.f;
+        ints[i] = (int32_t)(i * 2654435761u);
+    }
+
+    // the bulk writers produce the same bytes as streaming the values,
+    // for counts which exercise the vector loop and its remainder
+
+    bool same = true;
+    const std::size_t counts[] = { 0, 1, 7, 8, 9, 33, 1000 };
+    for( std::size_t count : counts ){
+        OutboundPacketStream ps( buffer, bufferSize );
+        ps << BeginMessage( "/values" ) << 1;
+        for( std::size_t i=0; i < count; ++i )
+            ps << floats[i];
+        ps << BeginArray();
+        for( std::size_t i=0; i < count; ++i )
+            ps << ints[i];
+        ps << EndArray() << oscpack::EndMessage();
+
+        OutboundPacketStream bulk( bulkBuffer, bufferSize );
+        bulk << BeginMessage( "/values" ) << 1;
+        bulk.WriteFloats( floats.data(), count );
+        bulk.WriteInt32Array( ints.data(), count );
+        bulk << oscpack::EndMessage();
+
+        if( bulk.Size() != ps.Size() || std::memcmp( bulk.Data(), ps.Data(), ps.Size() ) != 0 )
+            same = false;
+    }
+    assertEqual( same, true );
+
+    OutboundPacketStream typed( bulkBuffer, bufferSize );
+    typed << BeginTypedMessage( "/xy", "[ff]i" );
+    typed.WriteFloatArray( floats.data(), 2 );
+    typed.WriteInt32s( ints.data(), 1 );
+    typed << oscpack::EndMessage();
+
+    OutboundPacketStream ps( buffer, bufferSize );
+    ps << BeginMessage( "/xy" ) << BeginArray() << floats[0] << floats[1] << EndArray()
+        << ints[0] << oscpack::EndMessage();
+    assertEqual( typed.Size(), ps.Size() );
+    assertEqual( std::memcmp( typed.Data(), ps.Data(), ps.Size() ), 0 );
+
+    bool mismatchThrown = false;
+    try{
+        typed.Clear();
+        typed << BeginTypedMessage( "/xy", "ffi" );
+        typed.WriteFloats( floats.data(), 3 );
+    }catch( TypeTagMismatchException& ){
+        mismatchThrown = true;
+    }
+    assertEqual( mismatchThrown, true );
+
+    bool outOfMemoryThrown = false;
+    try{
+        OutboundPacketStream small( bulkBuffer, 64 );
+        small << BeginMessage( "/values" );
+        small.WriteFloats( floats.data(), 11 ); // 44 bytes of arguments, 16 of type tags
+    }catch( OutOfBufferMemoryException& ){
+        outOfMemoryThrown = true;
+    }
+    assertEqual( outOfMemoryThrown, true );
+
+    // ReadFloats() and ReadInt32s() read back what was written
+
+    OutboundPacketStream bulk( bulkBuffer, bufferSize );
+    bulk << BeginMessage( "/values" ) << 1;
+    bulk.WriteFloats( floats.data(), floats.size() );
+    bulk.WriteInt32Array( ints.data(), ints.size() );
+    bulk << oscpack::EndMessage();
+
+    ReceivedMessage m( ReceivedPacket( bulk.Data(), bulk.Size() ) );
+    ReceivedMessageArgumentStream args = m.ArgumentStream();
+
+    int32_t first;
+    std::vector<float> readFloats( floats.size() );
+    std::vector<int32_t> readInts( ints.size() );
+    args >> first;
+    args.ReadFloats( readFloats.data(), readFloats.size() );
+    args >> BeginArray();
+    args.ReadInt32s( readInts.data(), readInts.size() );
+    args >> EndArray();
+    assertEqual( args.Eos(), true );
+    assertEqual( first, 1 );
+    assertEqual( (readFloats == floats), true );
+    assertEqual( (readInts == ints), true );
+
+    bool wrongTypeThrown = false;
+    args = m.ArgumentStream();
+    try{
+        args.ReadFloats( readFloats.data(), 2 ); // the first argument is an int32
+    }catch( WrongArgumentTypeException& ){
+        wrongTypeThrown = true;
+    }
+    assertEqual( wrongTypeThrown, true );
+
+    bool bracketThrown = false;
+    args = m.ArgumentStream();
+    args >> first;
+    args.ReadFloats( readFloats.data(), readFloats.size() );
+    args >> BeginArray();
+    try{
+        args.ReadInt32s( readInts.data(), readInts.size() + 1 ); // reaches the closing bracket
+    }catch( WrongArgumentTypeException& ){
+        bracketThrown = true;
+    }
+    assertEqual( bracketThrown, true );
+
+    bulk.Clear();
+    bulk << BeginMessage( "/floats" );
+    bulk.WriteFloats( floats.data(), 20 );
+    bulk << oscpack::EndMessage();
+
+    bool missingThrown = false;
+    ReceivedMessage floatsMessage( ReceivedPacket( bulk.Data(), bulk.Size() ) );
+    args = floatsMessage.ArgumentStream();
+    try{
+        args.ReadFloats( readFloats.data(), 21 );
+    }catch( MissingArgumentException& ){
+        missingThrown = true;
+    }
+    assertEqual( missingThrown, true );
+}
+
+
+// waits up to a second for count to reach expected
+bool WaitForCount( const std::atomic<std::size_t>& count, std::size_t expected )
+{
+    for( int i=0; i < 1000 && count.load() < expected; ++i )
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    return count.load() >= expected;
+}
+
+
+// records the packets sent by a CoalescingTransmitter
+struct RecordingSocket{
+    std::vector< std::vector<char> > packets;
+
+    void Send( const char *data, std::size_t size )
+    {
+        packets.push_back( std::vector<char>( data, data + size ) );
+    }
+};
+
+
+// the number of messages in a packet, 0 if it isn't a bundle
+std::size_t BundleElementCount( const std::vector<char>& packet )
+{
+    ReceivedPacket p( &packet[0], packet.size() );
+    if( !p.IsBundle() )
+        return 0;
+
+    ReceivedBundle bundle( p );
+    assertEqual( bundle.TimeTag(), (uint64_t)1 );
+    return (std::size_t)bundle.ElementCount();
+}
+
+
+void test13()
+{
+    const int bufferSize = 2048;
+    char *buffer = AllocateAligned4( bufferSize );
+
+    OutboundPacketStream ps( buffer, bufferSize );
+    ps << BeginMessage( "/fader" ) << 0.5f << EndMessage(); // 16 bytes
+
+    RecordingSocket socket;
+    {
+        // 16 bytes of bundle header, 20 bytes per message: 3 messages fit
+        BasicCoalescingTransmitter<RecordingSocket> transmitter( socket, 80, 1000. );
+
+        double expiryMs = 0;
+        assertEqual( transmitter.NextExpiryMs( expiryMs ), false );
+
+        transmitter.Send( ps );
+        transmitter.Send( ps.Data(), ps.Size() );
+        assertEqual( transmitter.NextExpiryMs( expiryMs ), true );
+        assertEqual( transmitter.PendingMessageCount(), (std::size_t)2 );
+        assertEqual( socket.packets.size(), (std::size_t)0 );
+
+        // the third message fills the bundle, which is sent right away
+        transmitter.Send( ps );
+        assertEqual( socket.packets.size(), (std::size_t)1 );
+        assertEqual( BundleElementCount( socket.packets[0] ), (std::size_t)3 );
+        assertEqual( socket.packets[0].size(), (std::size_t)76 );
+        assertEqual( transmitter.NextExpiryMs( expiryMs ), false );
+
+        // a bundle holding one message is sent as the bare message
+        transmitter.Send( ps );
+        transmitter.Flush();
+        assertEqual( socket.packets.size(), (std::size_t)2 );
+        assertEqual( socket.packets[1].size(), (std::size_t)ps.Size() );
+        assertEqual( std::memcmp( &socket.packets[1][0], ps.Data(), ps.Size() ), 0 );
+
+        transmitter.Flush();
+        assertEqual( socket.packets.size(), (std::size_t)2 );
+
+        // messages written in place, then one which doesn't fit in the
+        // pending bundle and one which doesn't fit in any bundle
+        MessageWriter<int32_t, float> writer( "/w" );
+        transmitter.Send( writer, 1, 2.5f );
+        transmitter.Send( writer, 3, 4.5f );
+
+        OutboundPacketStream big( buffer + 1024, 1024 );
+        big << BeginMessage( "/big" ) << Blob( buffer, 64 ) << EndMessage();
+        transmitter.Send( big );
+        assertEqual( socket.packets.size(), (std::size_t)4 );
+        assertEqual( BundleElementCount( socket.packets[2] ), (std::size_t)2 );
+        assertEqual( socket.packets[3].size(), (std::size_t)big.Size() );
+
+        ReceivedBundle bundle( ReceivedPacket( &socket.packets[2][0], socket.packets[2].size() ) );
+        ReceivedMessage second( *(++bundle.ElementsBegin()) );
+        assertEqual( std::strcmp( second.AddressPattern(), "/w" ), 0 );
+        assertEqual( second.ArgumentsBegin()->AsInt32(), 3 );
+
+        // the timer sends whatever is pending
+        transmitter.Send( ps );
+        transmitter.Send( ps );
+        transmitter.TimerExpired();
+        assertEqual( socket.packets.size(), (std::size_t)5 );
+        assertEqual( BundleElementCount( socket.packets[4] ), (std::size_t)2 );
+        assertEqual( transmitter.PacketCount(), (std::size_t)5 );
+        assertEqual( transmitter.SentMessageCount(), (std::size_t)9 );
+
+        // pending messages are sent on destruction
+        transmitter.Send( ps );
+    }
+    assertEqual( socket.packets.size(), (std::size_t)6 );
+
+    // sizes which aren't a non-zero multiple of 4 are rejected
+    {
+        BasicCoalescingTransmitter<RecordingSocket> transmitter( socket );
+        bool threw = false;
+        try{
+            transmitter.Send( ps.Data(), ps.Size() - 1 );
+        }catch( MalformedPacketException& ){
+            threw = true;
+        }
+        assertEqual( threw, true );
+
+        threw = false;
+        try{
+            transmitter.Send( ps.Data(), 0 );
+        }catch( MalformedPacketException& ){
+            threw = true;
+        }
+        assertEqual( threw, true );
+        assertEqual( transmitter.PendingMessageCount(), (std::size_t)0 );
+    }
+    assertEqual( socket.packets.size(), (std::size_t)6 );
+
+    // a message sent from another thread wakes the multiplexer, which
+    // flushes it after the delay rather than when it next wakes up
+    {
+        struct CountingSocket{
+            std::atomic<std::size_t> count{ 0 };
+            void Send( const char *, std::size_t ) { count.fetch_add( 1 ); }
+        };
+        CountingSocket counting;
+        BasicCoalescingTransmitter<CountingSocket> transmitter( counting, 1472, 5. );
+        detail::SocketReceiveMultiplexer<detail::Implementation> mux;
+        mux.AttachScheduledTimerListener( &transmitter );
+        std::thread runner( [&mux](){ mux.Run(); } );
+
+        for( std::size_t i=1; i <= 3; ++i ){
+            std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) ); // until it waits without a timeout
+            transmitter.Send( ps );
+            assertEqual( WaitForCount( counting.count, i ), true );
+        }
+
+        mux.AsynchronousBreak();
+        runner.join();
+        mux.DetachScheduledTimerListener( &transmitter );
+    }
+}
+
+
+// write a bundle exercising every kind of element and argument
+void WriteGrowthTestPacket( OutboundPacketStream& ps )
+{
+    const char blobData[24] = { 1, 2, 3 };
+    std::vector<float> floats( 40, 0.25f );
+
+    ps << BeginBundle( 1234 )
+        << BeginMessage( "/untyped" ) << 1 << 2.5f << "a string argument"
+            << Blob( blobData, sizeof(blobData) ) << (int64_t)3 << true << EndMessage()
+        << BeginBundleImmediate()
+            << BeginTypedMessage( "/typed", "ifsd" ) << 4 << 5.5f << "x" << 6.5 << EndMessage()
+            << BeginMessage( "/floats" );
+    ps.WriteFloatArray( floats.data(), floats.size() );
+    ps << EndMessage()
+        << EndBundle();
+
+    MessageWriter<int32_t, const char*> writer( "/writer" );
+    writer.Write( ps, 7, "eight" );
+
+    ps << EndBundle();
+}
+
+
+void test14()
+{
+    const int bufferSize = 4096;
+    char *buffer = AllocateAligned4( bufferSize );
+
+    OutboundPacketStream reference( buffer, bufferSize );
+    WriteGrowthTestPacket( reference );
+
+    // growing from a tiny buffer, including in the middle of messages,
+    // produces the same packet as a large enough buffer
+    GrowableOutboundPacketStream grown( 4 );
+    WriteGrowthTestPacket( grown );
+    assertEqual( grown.Size(), reference.Size() );
+    assertEqual( std::memcmp( grown.Data(), reference.Data(), reference.Size() ), 0 );
+    assertEqual( grown.Capacity() >= reference.Size(), true );
+
+    // Clear() keeps the buffer
+    std::size_t capacity = grown.Capacity();
+    grown.Clear();
+    WriteGrowthTestPacket( grown );
+    assertEqual( grown.Capacity(), capacity );
+    assertEqual( std::memcmp( grown.Data(), reference.Data(), reference.Size() ), 0 );
+
+    grown.Reserve( capacity * 4 );
+    assertEqual( grown.Capacity(), capacity * 4 );
+    assertEqual( std::memcmp( grown.Data(), reference.Data(), reference.Size() ), 0 );
+
+    // growth stops at the maximum capacity
+    GrowableOutboundPacketStream limited( 16, 64 );
+    bool outOfMemoryThrown = false;
+    try{
+        limited << BeginMessage( "/limited" );
+        for( int i=0; i < 20; ++i )
+            limited << i;
+    }catch( OutOfBufferMemoryException& ){
+        outOfMemoryThrown = true;
+    }
+    assertEqual( outOfMemoryThrown, true );
+    assertEqual( limited.Capacity(), (std::size_t)64 );
+
+    // the failed message can be rolled back and the stream reused
+    limited.RollbackMessage();
+    assertEqual( limited.IsReady(), true );
+    assertEqual( limited.Size(), (std::size_t)0 );
+    limited << BeginMessage( "/ok" ) << 1 << EndMessage();
+    assertEqual( limited.Size(), (std::size_t)12 );
+
+    // rolling back messages in bundles, including typed and half written
+    // ones, leaves the packet as if they were never begun
+    OutboundPacketStream ps( buffer + 2048, 2048 );
+    ps << BeginBundle( 1234 )
+        << BeginMessage( "/discarded" ) << 1 << "string";
+    ps.RollbackMessage();
+    ps << BeginMessage( "/untyped" ) << 1 << 2.5f << "a string argument"
+            << Blob( buffer, 24 ) << (int64_t)3 << true;
+    ps.RollbackMessage();
+    ps << BeginMessage( "/untyped" ) << 1 << 2.5f << "a string argument";
+    {
+        const char blobData[24] = { 1, 2, 3 };
+        ps << Blob( blobData, sizeof(blobData) ) << (int64_t)3 << true << EndMessage();
+    }
+    ps << BeginBundleImmediate()
+            << BeginTypedMessage( "/typed", "ifsd" ) << 4;
+    ps.RollbackMessage();
+    ps << BeginTypedMessage( "/typed", "ifsd" ) << 4 << 5.5f << "x" << 6.5 << EndMessage()
+            << BeginMessage( "/floats" );
+    {
+        std::vector<float> floats( 40, 0.25f );
+        ps.WriteFloatArray( floats.data(), floats.size() );
+    }
+    ps << EndMessage()
+        << EndBundle();
+    MessageWriter<int32_t, const char*> writer( "/writer" );
+    writer.Write( ps, 7, "eight" );
+    ps << EndBundle();
+
+    assertEqual( ps.Size(), reference.Size() );
+    assertEqual( std::memcmp( ps.Data(), reference.Data(), reference.Size() ), 0 );
+
+    bool notInProgressThrown = false;
+    try{
+        ps.RollbackMessage();
+    }catch( MessageNotInProgressException& ){
+        notInProgressThrown = true;
+    }
+    assertEqual( notInProgressThrown, true );
+}
+
+
+class RecordingOscPacketListener : public OscPacketListener{
+public:
+    std::vector<std::string> addresses;
+
+protected:
+    void ProcessMessage( const ReceivedMessage& m, const IpEndpointName& ) override
+    {
+        addresses.push_back( m.AddressPattern() );
+    }
+};
+
+
+void test15()
+{
+    const int bufferSize = 4096;
+    char *buffer = AllocateAligned4( bufferSize );
+
+    OutboundPacketStream ps( buffer, bufferSize );
+    ps << BeginBundleImmediate()
+            << BeginMessage( "/a" ) << EndMessage()
+            << BeginBundleImmediate()
+                << BeginMessage( "/b" ) << EndMessage()
+                << BeginBundleImmediate()
+                    << BeginMessage( "/c" ) << EndMessage()
+                << EndBundle()
+                << BeginMessage( "/d" ) << EndMessage()
+            << EndBundle()
+            << BeginMessage( "/e" ) << EndMessage()
+        << EndBundle();
+
+    // eager and lazy bundles visit the same elements
+    ReceivedPacket p( ps.Data(), ps.Size() );
+    ReceivedBundle eager( p );
+    ReceivedBundle lazy( p, LazyBundleValidation() );
+    assertEqual( lazy.IsLazilyValidated(), true );
+    assertEqual( lazy.ElementCount(), eager.ElementCount() );
+    assertEqual( lazy.ElementCount(), (uint32_t)3 );
+
+    for( int lazyValidation = 0; lazyValidation < 2; ++lazyValidation ){
+        RecordingOscPacketListener listener;
+        listener.SetLazyBundleValidation( lazyValidation != 0 );
+        listener.ProcessPacket( ps.Data(), (int)ps.Size(), IpEndpointName() );
+        assertEqual( listener.addresses.size(), (std::size_t)5 );
+        assertEqual( listener.addresses.front() == "/a", true );
+        assertEqual( listener.addresses[2] == "/c", true );
+        assertEqual( listener.addresses.back() == "/e", true );
+
+        // the innermost bundle is at depth 3
+        listener.addresses.clear();
+        listener.SetMaximumBundleDepth( 2 );
+        bool tooDeepThrown = false;
+        try{
+            listener.ProcessPacket( ps.Data(), (int)ps.Size(), IpEndpointName() );
+        }catch( MalformedBundleException& ){
+            tooDeepThrown = true;
+        }
+        assertEqual( tooDeepThrown, true );
+        assertEqual( listener.addresses.size(), (std::size_t)2 );
+    }
+
+    // deep nesting is limited by the maximum depth, not the call stack
+    GrowableOutboundPacketStream deep;
+    const int depth = 2000;
+    for( int i=0; i < depth; ++i )
+        deep << BeginBundleImmediate();
+    deep << BeginMessage( "/deep" ) << EndMessage();
+    for( int i=0; i < depth; ++i )
+        deep << EndBundle();
+
+    RecordingOscPacketListener deepListener;
+    bool tooDeepThrown = false;
+    try{
+        deepListener.ProcessPacket( deep.Data(), (int)deep.Size(), IpEndpointName() );
+    }catch( MalformedBundleException& ){
+        tooDeepThrown = true;
+    }
+    assertEqual( tooDeepThrown, true );
+    deepListener.SetMaximumBundleDepth( depth );
+    deepListener.ProcessPacket( deep.Data(), (int)deep.Size(), IpEndpointName() );
+    assertEqual( deepListener.addresses.size(), (std::size_t)1 );
+
+    // a malformed last element: eager construction rejects the bundle,
+    // lazy iteration visits the preceding elements and then throws
+    char *corrupt = AllocateAligned4( ps.Size() );
+    std::memcpy( corrupt, ps.Data(), ps.Size() );
+    // the size of the last element ("/e", 8 bytes) now overruns the bundle
+    corrupt[ ps.Size() - 12 + 3 ] = 12;
+
+    ReceivedPacket corruptPacket( corrupt, ps.Size() );
+    bool eagerThrown = false;
+    try{
+        ReceivedBundle b( corruptPacket );
+    }catch( MalformedBundleException& ){
+        eagerThrown = true;
+    }
+    assertEqual( eagerThrown, true );
+
+    ReceivedBundle lazyCorrupt( corruptPacket, LazyBundleValidation() );
+    int visited = 0;
+    bool lazyThrown = false;
+    try{
+        for( ReceivedBundle::const_iterator i = lazyCorrupt.ElementsBegin();
+                i != lazyCorrupt.ElementsEnd(); ++i )
+            ++visited;
+    }catch( MalformedBundleException& ){
+        lazyThrown = true;
+    }
+    assertEqual( lazyThrown, true );
+    assertEqual( visited, 2 );
+
+    // ElementCount() of a lazy bundle validates the elements it counts
+    bool countThrown = false;
+    try{
+        lazyCorrupt.ElementCount();
+    }catch( MalformedBundleException& ){
+        countThrown = true;
+    }
+    assertEqual( countThrown, true );
+}
+
+
+void test16()
+{
+    const int bufferSize = 1024;
+    char *buffer = AllocateAligned4( bufferSize );
+
+    OutboundPacketStream ps( buffer, bufferSize );
+    {
+        const char blobData[6] = { 1, 2, 3, 4, 5, 6 };
+        ps << BeginMessage( "/try" ) << 1 << 2.5f << "s" << Blob( blobData, sizeof(blobData) )
+                << (int64_t)3 << true << EndMessage();
+    }
+
+    std::optional<ReceivedPacket> packet;
+    assertEqual( ReceivedPacket::TryParse( ps.Data(), ps.Size(), packet ), PARSE_OK );
+    assertEqual( packet.has_value(), true );
+
+    std::optional<ReceivedMessage> message;
+    assertEqual( ReceivedMessage::TryParse( *packet, message ), PARSE_OK );
+    assertEqual( message->ArgumentCount(), (uint32_t)6 );
+
+    ReceivedMessage::const_iterator i = message->ArgumentsBegin();
+    assertEqual( *i->TryAsInt32(), 1 );
+    assertEqual( i->TryAsFloat().has_value(), false );
+    ++i;
+    assertEqual( *i->TryAsFloat(), 2.5f );
+    assertEqual( i->TryAsInt32().has_value(), false );
+    ++i;
+    assertEqual( std::strcmp( *i->TryAsString(), "s" ), 0 );
+    assertEqual( i->TryAsSymbol().has_value(), false );
+    ++i;
+    std::optional<Blob> blob = i->TryAsBlob();
+    assertEqual( blob->size, (osc_bundle_element_size_t)6 );
+    assertEqual( ((const char*)blob->data)[5], (char)6 );
+    ++i;
+    assertEqual( *i->TryAsInt64(), (int64_t)3 );
+    assertEqual( i->TryAsDouble().has_value(), false );
+    ++i;
+    assertEqual( *i->TryAsBool(), true );
+    assertEqual( i->TryAsChar().has_value(), false );
+    ++i;
+    // past the last argument
+    assertEqual( i->TryAsBool().has_value(), false );
+
+    // malformed elements report the reason the constructors would throw
+    std::optional<ReceivedPacket> badPacket;
+    assertEqual( ReceivedPacket::TryParse( buffer, 6, badPacket ), PARSE_PACKET_SIZE_NOT_MULTIPLE_OF_4 );
+    assertEqual( ReceivedPacket::TryParse( buffer, (std::size_t)0, badPacket ), PARSE_ZERO_LENGTH_PACKET );
+    assertEqual( badPacket.has_value(), false );
+
+    std::optional<ReceivedMessage> badMessage;
+    const char *unterminated = NewMessageBuffer( "/abc", 4 );
+    assertEqual( ReceivedMessage::TryParse( ReceivedPacket( unterminated, 4 ), badMessage ),
+            PARSE_UNTERMINATED_ADDRESS_PATTERN );
+    assertEqual( badMessage.has_value(), false );
+
+    const char *unknownTag = NewMessageBuffer( "/a\0\0,X\0\0", 8 );
+    assertEqual( ReceivedMessage::TryParse( ReceivedPacket( unknownTag, 8 ), badMessage ),
+            PARSE_UNKNOWN_TYPE_TAG );
+    assertEqual( std::strcmp( ParseStatusString( PARSE_UNKNOWN_TYPE_TAG ), "unknown type tag" ), 0 );
+
+    // a blob whose size runs past the end of the message is rejected
+    // (and the constructor throws), rather than being accepted
+    const char *longBlob = NewMessageBuffer( "/a\0\0,b\0\0\0\0\0\x10", 12 );
+    assertEqual( ReceivedMessage::TryParse( ReceivedPacket( longBlob, 12 ), badMessage ),
+            PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE );
+    const char *hugeBlob = NewMessageBuffer( "/a\0\0,b\0\0\xFF\xFF\xFF\xFF", 12 );
+    assertEqual( ReceivedMessage::TryParse( ReceivedPacket( hugeBlob, 12 ), badMessage ),
+            PARSE_ARGUMENTS_EXCEED_MESSAGE_SIZE );
+    bool blobThrown = false;
+    try{
+        ReceivedMessage m( ReceivedPacket( longBlob, 12 ) );
+    }catch( MalformedMessageException& ){
+        blobThrown = true;
+    }
+    assertEqual( blobThrown, true );
+
+    // bundles
+    OutboundPacketStream bps( buffer + 512, 512 );
+    bps << BeginBundleImmediate()
+            << BeginMessage( "/a" ) << EndMessage()
+            << BeginMessage( "/b" ) << EndMessage()
+        << EndBundle();
+
+    std::optional<ReceivedBundle> bundle;
+    assertEqual( ReceivedBundle::TryParse( ReceivedPacket( bps.Data(), bps.Size() ), bundle ), PARSE_OK );
+    assertEqual( bundle->ElementCount(), (uint32_t)2 );
+    assertEqual( ReceivedMessage::TryParse( *bundle->ElementsBegin(), message ), PARSE_OK );
+    assertEqual( std::strcmp( message->AddressPattern(), "/a" ), 0 );
+
+    std::optional<ReceivedBundle> badBundle;
+    assertEqual( ReceivedBundle::TryParse( ReceivedPacket( bps.Data(), 12 ), badBundle ),
+            PARSE_BUNDLE_TOO_SHORT );
+    assertEqual( ReceivedBundle::TryParse( ReceivedPacket( bps.Data(), bps.Size() - 4 ), badBundle ),
+            PARSE_BUNDLE_ELEMENT_TRUNCATED );
+    assertEqual( ReceivedBundle::TryParse( ReceivedPacket( ps.Data(), ps.Size() ), badBundle ),
+            PARSE_BAD_BUNDLE_ADDRESS_PATTERN );
+    assertEqual( badBundle.has_value(), false );
+}
+
+
+void test17()
+{
+    // histogram buckets are exact below 32 and within 1/16 above
+    typedef LatencyHistogramSnapshot H;
+    assertEqual( H::BucketIndex( 0 ), (std::size_t)0 );
+    assertEqual( H::BucketIndex( 31 ), (std::size_t)31 );
+    assertEqual( H::BucketUpperBound( H::BucketIndex( 32 ) ), (uint64_t)33 );
+    assertEqual( H::BucketUpperBound( H::BucketIndex( 1000000 ) ) >= 1000000, true );
+    assertEqual( H::BucketUpperBound( H::BucketIndex( 1000000 ) ) <= 1000000 + 1000000 / 16, true );
+    assertEqual( H::BucketIndex( uint64_t(1) << 40 ), H::BUCKET_COUNT - 1 );
+    bool contiguous = true;
+    for( std::size_t i=1; i < H::BUCKET_COUNT; ++i )
+        contiguous = contiguous && H::BucketIndex( H::BucketUpperBound( i - 1 ) + 1 ) == i;
+    assertEqual( contiguous, true );
+
+    H h;
+    assertEqual( h.PercentileNs( 0.5 ), (uint64_t)0 );
+    for( uint64_t ns = 1; ns <= 100; ++ns ){
+        ++h.counts[ H::BucketIndex( ns * 1000 ) ];
+        ++h.count;
+    }
+    h.maximumNs = 100000;
+    assertEqual( h.PercentileNs( 0.5 ) >= 50000 && h.PercentileNs( 0.5 ) <= 50000 + 50000 / 16, true );
+    assertEqual( h.PercentileNs( 1.0 ), (uint64_t)100000 );
+
+    SocketMetrics a, b;
+    a.receivedDatagramCount = 2;
+    b.receivedDatagramCount = 3;
+    b.kernelDropCount = 1;
+    a += b;
+    assertEqual( a.receivedDatagramCount, (uint64_t)5 );
+    assertEqual( a.kernelDropCount, (uint64_t)1 );
+
+    // listener and socket counters. they read as zero unless
+    // OSCPACK_ENABLE_METRICS is defined
+    const uint64_t enabled = METRICS_ENABLED ? 1 : 0;
+
+    // an empty datagram is received, not a failed receive
+    {
+        UdpReceiveSocket receiveSocket( IpEndpointName( "127.0.0.1", IpEndpointName::ANY_PORT ) );
+        UdpTransmitSocket sender( IpEndpointName( "127.0.0.1", receiveSocket.LocalPort() ) );
+        sender.Send( "", 0 );
+        char data[16];
+        IpEndpointName remoteEndpoint;
+        assertEqual( receiveSocket.ReceiveFrom( remoteEndpoint, data, sizeof(data) ), (std::size_t)0 );
+        SocketMetrics metrics = receiveSocket.Metrics();
+        assertEqual( metrics.failedReceiveCount, (uint64_t)0 );
+        assertEqual( metrics.receivedDatagramCount, enabled );
+    }
+
+    const int bufferSize = 1024;
+    char *buffer = AllocateAligned4( bufferSize );
+    OutboundPacketStream ps( buffer, bufferSize );
+    ps << BeginBundleImmediate()
+            << BeginMessage( "/synth/1/freq" ) << 440 << EndMessage()
+            << BeginMessage( "/synth/*/freq" ) << 220 << EndMessage()
+            << BeginMessage( "/unknown" ) << EndMessage()
+            << BeginMessage( "/x/*" ) << EndMessage()
+        << EndBundle();
+
+    MappingTestListener listener;
+    listener.ProcessPacket( ps.Data(), (int)ps.Size(), IpEndpointName() );
+    assertEqual( listener.aCount, 2 );
+    assertEqual( listener.bCount, 1 );
+
+    bool thrown = false;
+    try{
+        listener.ProcessPacket( ps.Data(), 6, IpEndpointName() );
+    }catch( MalformedPacketException& ){
+        thrown = true;
+    }
+    assertEqual( thrown, true );
+
+    thrown = false;
+    try{
+        listener.ProcessPacket( ps.Data(), (int)ps.Size() - 4, IpEndpointName() );
+    }catch( MalformedBundleException& ){
+        thrown = true;
+    }
+    assertEqual( thrown, true );
+
+    OscPacketListenerMetrics m = listener.Metrics();
+    assertEqual( m.packetCount, 3 * enabled );
+    assertEqual( m.messageCount, 4 * enabled );
+    assertEqual( m.unmatchedMessageCount, 2 * enabled );
+    assertEqual( m.malformedPacketCount, enabled );
+    assertEqual( m.malformedMessageCount, (uint64_t)0 );
+    assertEqual( m.malformedBundleCount, enabled );
+    assertEqual( m.handlerLatency.count, 4 * enabled );
+}
+
+
+void test18()
+{
+    const int bufferSize = 1024;
+    char *buffer = AllocateAligned4( bufferSize );
+
+    OutboundPacketStream ps( buffer, bufferSize );
+    ps << BeginMessage( "/strip" ) << "vocals" << 0.f << (int64_t)0 << true
+            << Blob( "xyz", 3 ) << 0.0 << EndMessage();
+
+    PreparedMessage strip( ps );
+    assertEqual( strip.ArgumentCount(), (std::size_t)6 );
+    assertEqual( strip.TypeTag( 3 ), (char)TRUE_TYPE_TAG );
+    strip.Set( 1, 0.5f );
+    strip.Set( 2, (int64_t)-3 );
+    strip.Set( 3, false );
+    strip.Set( 5, 2.25 );
+
+    bool thrown = false;
+    try{
+        strip.Set( 1, (int32_t)1 );
+    }catch( TypeTagMismatchException& ){
+        thrown = true;
+    }
+    assertEqual( thrown, true );
+
+    {
+        ReceivedMessage m( ReceivedPacket( strip.Data(), strip.Size() ) );
+        ReceivedMessage::const_iterator i = m.ArgumentsBegin();
+        assertEqual( std::strcmp( (i++)->AsString(), "vocals" ), 0 );
+        assertEqual( (i++)->AsFloat(), 0.5f );
+        assertEqual( (i++)->AsInt64(), (int64_t)-3 );
+        assertEqual( (i++)->AsBool(), false );
+        ++i;
+        assertEqual( (i++)->AsDouble(), 2.25 );
+        assertEqual( strip.Size(), ps.Size() );
+    }
+
+    // arguments are numbered across the messages of nested bundles
+    ps.Clear();
+    ps << BeginBundle( 5 )
+            << BeginMessage( "/a" ) << 1 << EndMessage()
+            << BeginBundle( 6 )
+                << BeginMessage( "/b" ) << BeginArray() << 2 << EndArray() << 3.f << EndMessage()
+            << EndBundle()
+        << EndBundle();
+
+    PreparedMessage bundle( ps );
+    assertEqual( bundle.BundleCount(), (std::size_t)2 );
+    assertEqual( bundle.ArgumentCount(), (std::size_t)5 );
+    bundle.Set( 0, (int32_t)10 );
+    bundle.Set( 2, (int32_t)20 );
+    bundle.Set( 4, 30.f );
+    bundle.SetTimeTag( 7 );
+    bundle.SetTimeTag( 8, 1 );
+    {
+        ReceivedBundle outer( ReceivedPacket( bundle.Data(), bundle.Size() ) );
+        assertEqual( outer.TimeTag(), (uint64_t)7 );
+        ReceivedBundle::const_iterator e = outer.ElementsBegin();
+        assertEqual( ReceivedMessage( *e ).ArgumentsBegin()->AsInt32(), 10 );
+        ++e;
+        ReceivedBundle inner( *e );
+        assertEqual( inner.TimeTag(), (uint64_t)8 );
+        ReceivedMessage b( *inner.ElementsBegin() );
+        ReceivedMessage::const_iterator i = b.ArgumentsBegin();
+        ++i;
+        assertEqual( (i++)->AsInt32(), 20 );
+        ++i;
+        assertEqual( i->AsFloat(), 30.f );
+    }
+
+    // pooled streams reuse the buffers of the calling thread
+    std::size_t pooled = PooledOutboundPacketStream::PooledBufferCount();
+    PooledOutboundPacketStream::Preallocate( 2, 256 );
+    assertEqual( PooledOutboundPacketStream::PooledBufferCount(), pooled + 2 );
+    const char *firstData;
+    {
+        PooledOutboundPacketStream a( 256 ), b( 128 );
+        assertEqual( PooledOutboundPacketStream::PooledBufferCount(), pooled );
+        assertEqual( b.Capacity() >= 128, true );
+        a << BeginMessage( "/pooled" ) << 1 << EndMessage();
+        assertEqual( ReceivedMessage( ReceivedPacket( a.Data(), a.Size() ) ).ArgumentCount(), (uint32_t)1 );
+        firstData = a.Data();
+    }
+    assertEqual( PooledOutboundPacketStream::PooledBufferCount(), pooled + 2 );
+    {
+        PooledOutboundPacketStream a( 200 ), b( 200 );
+        assertEqual( a.Data() == firstData || b.Data() == firstData, true );
+    }
+}
+
+
+class RecordingResolveListener : public ResolveListener{
+public:
+    int resolvedCount = 0;
+    bool succeeded = false;
+    IpEndpointName endpoint;
+
+    void EndpointResolved( const char *, const IpEndpointName& e, bool s ) override
+    {
+        ++resolvedCount;
+        endpoint = e;
+        succeeded = s;
+    }
+};
+
+
+// copies of the datagrams a socket receives, for the loopback tests below.
+// onDatagram, if set, is called after each datagram is recorded.
+class RecordingPacketListener : public PacketListener{
+public:
+    struct Datagram{
+        std::string data;
+        IpEndpointName remoteEndpoint;
+        IpEndpointName localEndpoint;
+        int64_t receiveTimeNs;
+    };
+
+    std::vector<Datagram> datagrams;
+    std::vector<std::size_t> batchSizes; // of ProcessPackets() calls
+    std::atomic<std::size_t> count{ 0 };
+    std::function<void( const ReceivedDatagram& )> onDatagram;
+
+    void ProcessPacket( const char *data, int size, const IpEndpointName& remoteEndpoint ) override
+    {
+        ReceivedDatagram datagram = { data, size, remoteEndpoint };
+        ProcessDatagram( datagram );
+    }
+
+    void ProcessPackets( const ReceivedDatagram *datagrams, std::size_t count ) override
+    {
+        batchSizes.push_back( count );
+        PacketListener::ProcessPackets( datagrams, count );
+    }
+
+    void ProcessDatagram( const ReceivedDatagram& datagram ) override
+    {
+        datagrams.push_back( Datagram{ std::string( datagram.data, (std::size_t)datagram.size ),
+                datagram.remoteEndpoint, datagram.localEndpoint, datagram.receiveTimeNs } );
+        count.fetch_add( 1 );
+        if( onDatagram )
+            onDatagram( datagram );
+    }
+};
+
+
+// breaks a multiplexer from its own thread once done() returns true, or
+// after timeoutTicks expiries so that a lost datagram fails the test
+// instead of hanging it
+class BreakingTimerListener : public TimerListener{
+public:
+    std::function<bool()> done;
+    std::function<void()> breakMultiplexer;
+    int ticks = 0;
+    int timeoutTicks = 200;
+
+    void TimerExpired() override
+    {
+        ++ticks;
+        if( done() || ticks >= timeoutTicks )
+            breakMultiplexer();
+    }
+};
+
+
+// a lookup which blocks until released for names starting with "slow",
+// to act on requests in progress. other names resolve to 127.0.0.2 at once
+struct SlowLookup{
+    static std::mutex mutex;
+    static std::condition_variable changed;
+    static bool entered;
+    static bool released;
+
+    static bool Lookup( const char *hostName, unsigned long& address )
+    {
+        if( std::strncmp( hostName, "slow", 4 ) != 0 ){
+            address = 0x7F000002;
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock( mutex );
+        entered = true;
+        changed.notify_all();
+        changed.wait( lock, [](){ return released; } );
+        address = 0x7F000001;
+        return true;
+    }
+
+    static void WaitUntilEntered()
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+        changed.wait( lock, [](){ return entered; } );
+    }
+
+    static void Release()
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        released = true;
+        changed.notify_all();
+    }
+
+    static void Reset()
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        entered = false;
+        released = false;
+    }
+};
+std::mutex SlowLookup::mutex;
+std::condition_variable SlowLookup::changed;
+bool SlowLookup::entered = false;
+bool SlowLookup::released = false;
+
+
+void test19()
+{
+    char s[ IpEndpointName::ADDRESS_AND_PORT_STRING_LENGTH ];
+    IpEndpointName( 192, 168, 0, 10, 57120 ).AddressAndPortAsString( s );
+    assertEqual( std::strcmp( s, "192.168.0.10:57120" ), 0 );
+    IpEndpointName( 255, 255, 255, 254, 65535 ).AddressAndPortAsString( s );
+    assertEqual( std::strcmp( s, "255.255.255.254:65535" ), 0 );
+    IpEndpointName( 0, 0, 0, 0 ).AddressAndPortAsString( s );
+    assertEqual( std::strcmp( s, "0.0.0.0:<any>" ), 0 );
+    IpEndpointName( 7000 ).AddressAndPortAsString( s );
+    assertEqual( std::strcmp( s, "<any>:7000" ), 0 );
+    IpEndpointName().AddressAsString( s );
+    assertEqual( std::strcmp( s, "<any>" ), 0 );
+    IpEndpointName( 10, 0, 0, 1 ).AddressAsString( s );
+    assertEqual( std::strcmp( s, "10.0.0.1" ), 0 );
+
+    // numeric host names resolve without DNS
+    EndpointResolver resolver;
+    IpEndpointName endpoint;
+    assertEqual( resolver.Lookup( "127.0.0.1", 9000, endpoint ), false );
+    assertEqual( resolver.Resolve( "127.0.0.1", 9000, endpoint ), true );
+    assertEqual( endpoint == IpEndpointName( 127, 0, 0, 1, 9000 ), true );
+    assertEqual( resolver.Lookup( "127.0.0.1", 9001, endpoint ), true );
+    assertEqual( endpoint == IpEndpointName( 127, 0, 0, 1, 9001 ), true );
+
+    double expiryMs;
+    assertEqual( resolver.NextExpiryMs( expiryMs ), false );
+
+    // cached names complete on the next TimerExpired()
+    RecordingResolveListener listener;
+    resolver.ResolveAsync( "127.0.0.1", 9002, &listener );
+    assertEqual( resolver.NextExpiryMs( expiryMs ), true );
+    resolver.TimerExpired();
+    assertEqual( listener.resolvedCount, 1 );
+    assertEqual( listener.succeeded, true );
+    assertEqual( listener.endpoint == IpEndpointName( 127, 0, 0, 1, 9002 ), true );
+
+    // others on the worker thread
+    resolver.Clear();
+    assertEqual( resolver.Lookup( "127.0.0.1", 9000, endpoint ), false );
+    resolver.ResolveAsync( "127.0.0.1", 9003, &listener );
+    for( int i=0; i < 1000 && listener.resolvedCount == 1; ++i ){
+        std::this_thread::sleep_for( std::chrono::milliseconds( 2 ) );
+        resolver.TimerExpired();
+    }
+    assertEqual( listener.resolvedCount, 2 );
+    assertEqual( listener.endpoint == IpEndpointName( 127, 0, 0, 1, 9003 ), true );
+    assertEqual( resolver.Lookup( "127.0.0.1", 9000, endpoint ), true );
+    assertEqual( resolver.NextExpiryMs( expiryMs ), false );
+
+    resolver.ResolveAsync( "127.0.0.1", 9004, &listener );
+    resolver.Cancel( &listener );
+    resolver.TimerExpired();
+    assertEqual( listener.resolvedCount, 2 );
+
+    // cancelled while the worker is looking it up
+    {
+        EndpointResolver slowResolver( 60., 5., 64, &SlowLookup::Lookup );
+        RecordingResolveListener cancelled;
+        slowResolver.ResolveAsync( "slow.example", 9005, &cancelled );
+        SlowLookup::WaitUntilEntered();
+        slowResolver.Cancel( &cancelled );
+        SlowLookup::Release();
+
+        // the result is cached and would be pending at the same time
+        for( int i=0; i < 1000 && !slowResolver.Lookup( "slow.example", 9005, endpoint ); ++i )
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        assertEqual( slowResolver.Lookup( "slow.example", 9005, endpoint ), true );
+        assertEqual( slowResolver.NextExpiryMs( expiryMs ), false );
+        slowResolver.TimerExpired();
+        assertEqual( cancelled.resolvedCount, 0 );
+    }
+
+    // requested from another thread while the multiplexer is idle
+    {
+        struct CountingResolveListener : public ResolveListener{
+            std::atomic<std::size_t> count{ 0 };
+            void EndpointResolved( const char *, const IpEndpointName&, bool ) override { count.fetch_add( 1 ); }
+        };
+        CountingResolveListener counting;
+        EndpointResolver idleResolver;
+        detail::SocketReceiveMultiplexer<detail::Implementation> mux;
+        mux.AttachScheduledTimerListener( &idleResolver );
+        std::thread runner( [&mux](){ mux.Run(); } );
+
+        for( std::size_t i=1; i <= 3; ++i ){
+            std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) ); // until it waits without a timeout
+            idleResolver.ResolveAsync( "127.0.0.1", 9006, &counting );  // cached after the first
+            assertEqual( WaitForCount( counting.count, i ), true );
+        }
+
+        mux.AsynchronousBreak();
+        runner.join();
+        mux.DetachScheduledTimerListener( &idleResolver );
+    }
+
+    // a slow lookup doesn't hold up others, and results wake the
+    // multiplexer rather than it polling for them
+    {
+        struct CountingResolver : public EndpointResolver{
+            std::atomic<int> nextExpiryCount{ 0 };
+            CountingResolver() : EndpointResolver( 60., 5., 64, &SlowLookup::Lookup ) {}
+            bool NextExpiryMs( double& expiryMs ) override
+            {
+                nextExpiryCount.fetch_add( 1 );
+                return EndpointResolver::NextExpiryMs( expiryMs );
+            }
+        };
+        struct CountingResolveListener : public ResolveListener{
+            std::atomic<std::size_t> count{ 0 };
+            void EndpointResolved( const char *, const IpEndpointName&, bool ) override { count.fetch_add( 1 ); }
+        };
+        SlowLookup::Reset();
+        CountingResolver poolResolver;
+        CountingResolveListener slow, fast;
+        detail::SocketReceiveMultiplexer<detail::Implementation> mux;
+        mux.AttachScheduledTimerListener( &poolResolver );
+        std::thread runner( [&mux](){ mux.Run(); } );
+
+        poolResolver.ResolveAsync( "slow.example", 9007, &slow );
+        SlowLookup::WaitUntilEntered();
+        poolResolver.ResolveAsync( "fast.example", 9007, &fast );
+        assertEqual( WaitForCount( fast.count, 1 ), true );
+        assertEqual( slow.count.load(), (std::size_t)0 );
+
+        int before = poolResolver.nextExpiryCount;
+        std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+        assertEqual( poolResolver.nextExpiryCount - before < 3, true );
+
+        SlowLookup::Release();
+        assertEqual( WaitForCount( slow.count, 1 ), true );
+
+        mux.AsynchronousBreak();
+        runner.join();
+        mux.DetachScheduledTimerListener( &poolResolver );
+    }
+
+    // a wakeup from another thread doesn't outlive the multiplexer
+    {
+        struct WakingListener : public ScheduledTimerListener{
+            bool NextExpiryMs( double& ) override { return false; }
+            void TimerExpired() override {}
+            void Wake() { WakeMultiplexer(); }
+        };
+        WakingListener waking;
+        std::atomic<bool> stop{ false };
+        std::thread waker( [&waking, &stop](){
+            while( !stop )
+                waking.Wake();
+        } );
+        for( int i=0; i < 200; ++i ){
+            std::unique_ptr< detail::SocketReceiveMultiplexer<detail::Implementation> > mux(
+                    new detail::SocketReceiveMultiplexer<detail::Implementation> );
+            mux->AttachScheduledTimerListener( &waking );
+            std::this_thread::yield();
+            mux.reset(); // without detaching
+        }
+        stop = true;
+        waker.join();
+    }
+}
+
+
+void test20()
+{
+    assertEqual( IpEndpointName( 239, 255, 0, 1 ).IsMulticastAddress(), true );
+    assertEqual( IpEndpointName( 192, 168, 0, 1 ).IsMulticastAddress(), false );
+
+    // arguments are checked before the system is asked, so these fail the
+    // same way whether or not the host has a multicast route
+    detail::UdpSocket<detail::Implementation> socket;
+
+    bool exceptionThrown = false;
+    try{
+        socket.JoinMulticastGroup( IpEndpointName( 192, 168, 0, 1 ) );
+    }catch( std::runtime_error& ){
+        exceptionThrown = true;
+    }
+    assertEqual( exceptionThrown, true );
+
+    exceptionThrown = false;
+    try{
+        socket.JoinSourceGroup( IpEndpointName( 232, 1, 1, 1 ), IpEndpointName() );
+    }catch( std::runtime_error& ){
+        exceptionThrown = true;
+    }
+    assertEqual( exceptionThrown, true );
+
+    exceptionThrown = false;
+    try{
+        socket.SetMulticastTtl( 256 );
+    }catch( std::runtime_error& ){
+        exceptionThrown = true;
+    }
+    assertEqual( exceptionThrown, true );
+
+    // sender side options don't need a route either
+    bool unexpectedExceptionCaught = false;
+    try{
+        socket.SetMulticastTtl( 4 );
+        socket.SetMulticastLoopback( false );
+        socket.SetMulticastInterface( IpEndpointName() );
+    }catch( std::runtime_error& e ){
+        std::cout << "unexpected exception: " << e.what();
+        unexpectedExceptionCaught = true;
+    }
+    assertEqual( unexpectedExceptionCaught, false );
+
+    // both members of a group on the loopback interface receive, until
+    // one leaves. the second joins on the port assigned to the first
+    IpEndpointName group( 239, 255, 0, 7, IpEndpointName::ANY_PORT );
+    IpEndpointName loopbackInterface( "127.0.0.1" );
+    RecordingPacketListener firstListener, secondListener;
+    std::unique_ptr<UdpListeningMulticastReceiveSocket> first, second;
+    std::unique_ptr<UdpMulticastTransmitSocket> sender;
+    try{
+        first.reset( new UdpListeningMulticastReceiveSocket( group, &firstListener, loopbackInterface ) );
+        group.port = first->LocalPort();
+        second.reset( new UdpListeningMulticastReceiveSocket( group, &secondListener, loopbackInterface ) );
+        sender.reset( new UdpMulticastTransmitSocket( group, loopbackInterface ) );
+    }catch( std::runtime_error& e ){
+        std::cout << "skipping multicast delivery test: " << e.what();
+        return;
+    }
+
+    std::thread firstRunner( [&first](){ first->Run(); } );
+    std::thread secondRunner( [&second](){ second->Run(); } );
+
+    sender->Send( "joined", 6 );
+    assertEqual( WaitForCount( firstListener.count, 1 ), true );
+    assertEqual( WaitForCount( secondListener.count, 1 ), true );
+
+    second->LeaveMulticastGroup( group, loopbackInterface );
+    sender->Send( "left", 4 );
+    assertEqual( WaitForCount( firstListener.count, 2 ), true );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+    assertEqual( secondListener.count.load(), (std::size_t)1 );
+
+    first->AsynchronousBreak();
+    second->AsynchronousBreak();
+    firstRunner.join();
+    secondRunner.join();
+
+    assertEqual( firstListener.datagrams.size(), (std::size_t)2 );
+    if( firstListener.datagrams.size() == 2 ){
+        assertEqual( firstListener.datagrams[0].data, std::string( "joined" ) );
+        assertEqual( firstListener.datagrams[1].data, std::string( "left" ) );
+    }
+    if( secondListener.datagrams.size() == 1 )
+        assertEqual( secondListener.datagrams[0].data, std::string( "joined" ) );
+
+#if defined(__linux__)
+    // a socket bound to the port of a group which another socket joined
+    // receives the group as well, unless it only receives its own
+    // memberships
+    using Impl = detail::Implementation;
+    Impl::udp_socket_t member, all, own;
+    IpEndpointName otherGroup( 239, 255, 0, 8 );
+    member.SetAllowReuse( true );
+    member.SetReceiveOwnMembershipsOnly( true );
+    member.Bind( IpEndpointName() );
+    const int port = member.LocalPort();
+    try{
+        member.JoinMulticastGroup( otherGroup, loopbackInterface );
+    }catch( std::runtime_error& e ){
+        std::cout << "skipping multicast membership test: " << e.what();
+        return;
+    }
+    all.SetAllowReuse( true );
+    all.Bind( IpEndpointName( port ) );
+    own.SetAllowReuse( true );
+    own.SetReceiveOwnMembershipsOnly( true );
+    own.Bind( IpEndpointName( port ) );
+
+    RecordingPacketListener memberListener, allListener, ownListener;
+    detail::SocketReceiveMultiplexer<Impl> mux;
+    mux.AttachSocketListener( &member, &memberListener );
+    mux.AttachSocketListener( &all, &allListener );
+    mux.AttachSocketListener( &own, &ownListener );
+    BreakingTimerListener timer;
+    timer.breakMultiplexer = [&mux]() { mux.Break(); };
+    timer.done = [&]() { return timer.ticks >= 10 && memberListener.count == 1 && allListener.count == 1; };
+    mux.AttachPeriodicTimerListener( 5, &timer );
+
+    UdpMulticastTransmitSocket otherSender( IpEndpointName( otherGroup.address, port ), loopbackInterface );
+    otherSender.Send( "m", 1 );
+    mux.Run();
+    assertEqual( memberListener.count.load(), (std::size_t)1 );
+    assertEqual( allListener.count.load(), (std::size_t)1 );
+    assertEqual( ownListener.count.load(), (std::size_t)0 );
+
+    mux.DetachPeriodicTimerListener( &timer );
+    mux.DetachSocketListener( &own, &ownListener );
+    mux.DetachSocketListener( &all, &allListener );
+    mux.DetachSocketListener( &member, &memberListener );
+#endif
+}
+
+
+#if defined(__linux__)
+void test21()
+{
+    using Impl = posix::SharedMemoryImplementation;
+
+    // the port only names the shared memory ring, no network is involved
+    RecordingOscPacketListener listener;
+    detail::UdpListeningReceiveSocket<Impl> receiveSocket( IpEndpointName( "127.0.0.1", IpEndpointName::ANY_PORT ), &listener );
+    receiveSocket.SetMaximumPacketSize( 65536 );
+    const int port = receiveSocket.LocalPort();
+    assertEqual( port > 0, true );
+
+    bool exceptionThrown = false;
+    try{
+        IpEndpointName endpoint( port );
+        detail::UdpReceiveSocket<Impl> sameEndpoint( endpoint );
+    }catch( std::runtime_error& ){
+        exceptionThrown = true;
+    }
+    assertEqual( exceptionThrown, true );
+
+    IpEndpointName anyPort;
+    detail::UdpReceiveSocket<Impl> replySocket( anyPort );
+    assertEqual( replySocket.LocalPort() > 0, true );
+    int unboundPort;
+    {
+        detail::UdpReceiveSocket<Impl> closed( anyPort );
+        unboundPort = closed.LocalPort();
+    }
+
+    // larger than DEFAULT_MAXIMUM_PACKET_SIZE
+    std::vector<char> blob( 20000, 'x' );
+    std::vector<char> buffer( 32768 );
+    OutboundPacketStream ps( &buffer[0], buffer.size() );
+    ps << BeginMessage( "/a" ) << Blob( &blob[0], (osc_bundle_element_size_t)blob.size() ) << EndMessage();
+
+    detail::BatchSender<Impl> sender( replySocket );
+    sender.Add( IpEndpointName( "127.0.0.1", port ), ps );
+    sender.Add( IpEndpointName( unboundPort ), ps ); // nobody bound
+    char smallBuffer[16];
+    OutboundPacketStream small( smallBuffer, sizeof(smallBuffer) );
+    small << BeginMessage( "/b" ) << EndMessage();
+    sender.Add( IpEndpointName( port ), small );
+    sender.Add( IpEndpointName( port ), "__stop_", 8 );
+    assertEqual( sender.Flush(), (std::size_t)1 );
+    assertEqual( sender.Datagram( 0 ).error, 0 );
+    assertEqual( sender.Datagram( 1 ).error, ECONNREFUSED );
+
+    receiveSocket.Run();
+    assertEqual( listener.addresses.size(), (std::size_t)2 );
+    if( listener.addresses.size() == 2 ){
+        assertEqual( listener.addresses[0], std::string( "/a" ) );
+        assertEqual( listener.addresses[1], std::string( "/b" ) );
+    }
+
+    // replies reach the sender's port
+    receiveSocket.SendTo( IpEndpointName( replySocket.LocalPort() ), "reply", 5 );
+    char reply[8];
+    IpEndpointName remoteEndpoint;
+    assertEqual( replySocket.ReceiveFrom( remoteEndpoint, reply, sizeof(reply) ), (std::size_t)5 );
+    assertEqual( remoteEndpoint == IpEndpointName( 127, 0, 0, 1, port ), true );
+    assertEqual( std::memcmp( reply, "reply", 5 ), 0 );
+
+    // a 64k ring takes datagrams of up to half its size, and drops those
+    // which arrive while it's full
+    Impl::udp_socket_t smallRing;
+    smallRing.SetReceiveBufferSize( 65536 );
+    smallRing.Bind( anyPort );
+    assertEqual( smallRing.ReceiveBufferSize(), 65536 );
+    std::size_t maximumSize = smallRing.MaximumDatagramSize();
+    assertEqual( maximumSize < (std::size_t)32768 && maximumSize > (std::size_t)32000, true );
+
+    std::vector<char> maximum( maximumSize + 1, 'm' );
+    std::vector<char> filler( 1000, 'f' );
+    const std::size_t fillerCount = 64;
+    sender.Add( IpEndpointName( smallRing.LocalPort() ), &maximum[0], maximumSize + 1 );
+    sender.Add( IpEndpointName( smallRing.LocalPort() ), &maximum[0], maximumSize );
+    for( std::size_t i=0; i < fillerCount; ++i )
+        sender.Add( IpEndpointName( smallRing.LocalPort() ), &filler[0], filler.size() );
+    std::size_t failedCount = sender.Flush();
+    assertEqual( sender.Datagram( 0 ).error, EMSGSIZE );
+    assertEqual( sender.Datagram( 1 ).error, 0 );
+    assertEqual( smallRing.TruncatedDatagramCount(), (std::size_t)1 );
+
+    // the fillers fit until the ring is full
+    std::size_t sentFillerCount = 0;
+    while( sentFillerCount < fillerCount && sender.Datagram( 2 + sentFillerCount ).error == 0 )
+        ++sentFillerCount;
+    bool droppedAfterFull = true;
+    for( std::size_t i=sentFillerCount; i < fillerCount; ++i )
+        droppedAfterFull = droppedAfterFull && sender.Datagram( 2 + i ).error == ENOBUFS;
+    std::size_t droppedCount = fillerCount - sentFillerCount;
+    assertEqual( sentFillerCount > 0 && droppedCount > 0, true );
+    assertEqual( droppedAfterFull, true );
+    assertEqual( failedCount, 1 + droppedCount );
+    assertEqual( smallRing.Metrics().kernelDropCount, METRICS_ENABLED ? (uint64_t)droppedCount : (uint64_t)0 );
+
+    std::vector<char> received( maximumSize );
+    assertEqual( smallRing.ReceiveFrom( remoteEndpoint, &received[0], received.size() ), maximumSize );
+    assertEqual( received == std::vector<char>( maximumSize, 'm' ), true );
+
+    // a record reserved by a sender which died before writing it is
+    // skipped once the abandoned record timeout has passed
+    {
+        Impl::udp_socket_t stalledRing;
+        stalledRing.SetAbandonedRecordTimeout( 50 );
+        stalledRing.Bind( anyPort );
+        stalledRing.Ring().Header().tail.fetch_add( 64 );
+        replySocket.SendTo( IpEndpointName( stalledRing.LocalPort() ), "after", 5 );
+
+        auto start = std::chrono::steady_clock::now();
+        assertEqual( stalledRing.ReceiveFrom( remoteEndpoint, reply, sizeof(reply) ), (std::size_t)5 );
+        assertEqual( std::chrono::steady_clock::now() - start >= std::chrono::milliseconds( 40 ), true );
+        assertEqual( std::memcmp( reply, "after", 5 ), 0 );
+        assertEqual( stalledRing.AbandonedRecordCount(), (uint64_t)1 );
+
+        // the multiplexer wakes up to skip it when the timeout expires,
+        // the datagram written after it doesn't make it readable
+        RecordingPacketListener stalledListener;
+        detail::SocketReceiveMultiplexer<Impl> mux;
+        mux.AttachSocketListener( &stalledRing, &stalledListener );
+        replySocket.SendTo( IpEndpointName( stalledRing.LocalPort() ), "before", 6 );
+        stalledRing.Ring().Header().tail.fetch_add( 32 );
+        std::thread sendLater( [&](){
+            std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+            replySocket.SendTo( IpEndpointName( stalledRing.LocalPort() ), "__stop_", 8 );
+        } );
+        mux.Run();
+        sendLater.join();
+        mux.DetachSocketListener( &stalledRing, &stalledListener );
+        assertEqual( stalledListener.datagrams.size(), (std::size_t)1 );
+        assertEqual( stalledRing.AbandonedRecordCount(), (uint64_t)2 );
+    }
+}
+#endif
+
+
+void test22()
+{
+    const int64_t startNs = 1700000000123456789LL;
+    assertEqual( UnixTimeNsFromTimeTag( TimeTagFromUnixTimeNs( startNs ) ), startNs );
+
+    const char *path = "oscpack_unit_test_capture.oscpcap";
+    const int recordCount = 3000; // several index entries
+    {
+        PacketCaptureWriter writer( path );
+        PacketCaptureListener recorder( writer );
+
+        char buffer[64];
+        for( int i=0; i < recordCount; ++i ){
+            OutboundPacketStream ps( buffer, sizeof(buffer) );
+            ps << BeginMessage( "/capture/test" ) << (int32_t)i << EndMessage();
+
+            // 1ms apart
+            ReceivedDatagram datagram = { ps.Data(), (int)ps.Size(), IpEndpointName( 10, 0, 0, 1, 9000 + i ),
+                    IpEndpointName( 10, 0, 0, 2, 7000 ), startNs + (int64_t)i * 1000000 };
+            recorder.ProcessDatagram( datagram );
+        }
+
+        // records are readable before the writer is closed, without the index
+        PacketCaptureReader unclosed( path );
+        assertEqual( unclosed.RecordCount(), (std::size_t)recordCount );
+        writer.Close();
+        assertEqual( writer.RecordCount(), (std::size_t)recordCount );
+    }
+
+    {
+        PacketCaptureReader reader( path );
+        assertEqual( reader.RecordCount(), (std::size_t)recordCount );
+
+        // the file is a size prefixed OSC stream
+        std::size_t offset = reader.Begin();
+        std::size_t next = offset;
+        ReceivedDatagram datagram;
+        uint64_t timeTag = 0;
+        assertEqual( reader.Next( next, datagram, timeTag ), true );
+        std::vector<char> record( next - offset - 4 );
+        {
+            std::ifstream file( path, std::ios::binary );
+            file.seekg( (std::streamoff)( offset + 4 ) );
+            file.read( &record[0], (std::streamsize)record.size() );
+        }
+        ReceivedPacket packet( &record[0], (osc_bundle_element_size_t)record.size() );
+        assertEqual( packet.IsBundle(), true );
+        ReceivedBundle bundle( packet );
+        assertEqual( bundle.TimeTag(), TimeTagFromUnixTimeNs( startNs ) );
+        ReceivedMessage recordMessage( *bundle.ElementsBegin() );
+        assertEqual( std::strcmp( recordMessage.AddressPattern(), "/capture/datagram" ), 0 );
+
+        int i = 0;
+        for( offset = reader.Begin(); reader.Next( offset, datagram, timeTag ); ++i ){
+            ReceivedMessage m( ReceivedPacket( datagram.data, datagram.size ) );
+            if( m.ArgumentsBegin()->AsInt32() != i || datagram.remoteEndpoint != IpEndpointName( 10, 0, 0, 1, 9000 + i )
+                    || datagram.localEndpoint != IpEndpointName( 10, 0, 0, 2, 7000 )
+                    || datagram.receiveTimeNs != startNs + (int64_t)i * 1000000 )
+                break;
+        }
+        assertEqual( i, recordCount );
+        assertEqual( offset, reader.End() );
+
+        offset = reader.Seek( TimeTagFromUnixTimeNs( startNs + 2500 * 1000000LL - 10 ) );
+        assertEqual( reader.Next( offset, datagram, timeTag ), true );
+        assertEqual( ReceivedMessage( ReceivedPacket( datagram.data, datagram.size ) ).ArgumentsBegin()->AsInt32(), 2500 );
+        assertEqual( reader.Seek( TimeTagFromUnixTimeNs( startNs + recordCount * 1000000LL ) ), reader.End() );
+
+        PacketCaptureReplayer replayer( reader );
+        replayer.SetSpeed( 0 );
+        RecordingOscPacketListener listener;
+        assertEqual( replayer.Deliver( listener ), (std::size_t)recordCount );
+        assertEqual( listener.addresses.size(), (std::size_t)recordCount );
+
+        // 20ms of traffic at 10x
+        replayer.SetSpeed( 10 );
+        replayer.SetTimeRange( TimeTagFromUnixTimeNs( startNs + 1000 * 1000000LL ),
+                TimeTagFromUnixTimeNs( startNs + 1020 * 1000000LL ) );
+        auto start = std::chrono::steady_clock::now();
+        assertEqual( replayer.Deliver( listener ), (std::size_t)20 );
+        assertEqual( std::chrono::steady_clock::now() - start >= std::chrono::microseconds( 1900 ), true );
+    }
+
+    // corrupt offsets are rejected without reading outside the file
+    {
+        std::size_t indexOffset;
+        {
+            PacketCaptureReader reader( path );
+            indexOffset = reader.End();
+        }
+        auto patch = [&]( std::size_t offset, uint64_t value, int size ){
+            char bytes[8];
+            FromUInt64( bytes, value );
+            std::fstream file( path, std::ios::binary | std::ios::in | std::ios::out );
+            file.seekp( (std::streamoff)offset );
+            file.write( bytes + 8 - size, size );
+        };
+        auto checkScanned = [&](){
+            PacketCaptureReader reader( path );
+            assertEqual( reader.RecordCount(), (std::size_t)recordCount );
+            assertEqual( reader.End(), indexOffset );
+            std::size_t offset = reader.Seek( TimeTagFromUnixTimeNs( startNs + 2500 * 1000000LL - 10 ) );
+            ReceivedDatagram datagram;
+            uint64_t timeTag;
+            assertEqual( reader.Next( offset, datagram, timeTag ), true );
+            assertEqual( ReceivedMessage( ReceivedPacket( datagram.data, datagram.size ) ).ArgumentsBegin()->AsInt32(), 2500 );
+        };
+
+        const std::size_t indexOffsetOffset = detail::CaptureFormat::INDEX_OFFSET_OFFSET;
+        const std::size_t entryOffset = indexOffset + detail::CaptureFormat::INDEX_HEADER_SIZE + 8;
+
+        patch( indexOffsetOffset, 0xFFFFFFFFFFFFFFF0ULL, 8 );
+        checkScanned();
+        patch( indexOffsetOffset, indexOffset, 8 );
+
+        // index entries pointing outside the records, or not at a record
+        const uint64_t firstRecord = detail::CaptureFormat::HEADER_SIZE;
+        const uint64_t badEntries[] = { 0xFFFFFFFFFFFFFFF0ULL, indexOffset, firstRecord + 4 };
+        for( uint64_t badEntry : badEntries ){
+            patch( entryOffset + 16, badEntry, 8 );
+            checkScanned();
+        }
+        patch( entryOffset + 16, 0, 8 );
+        checkScanned();
+
+        // a record size beyond the end of the file
+        patch( firstRecord, 0xFFFFFFFFu, 4 );
+        {
+            PacketCaptureReader reader( path );
+            std::size_t offset = reader.Begin();
+            ReceivedDatagram datagram;
+            uint64_t timeTag;
+            assertEqual( reader.Next( offset, datagram, timeTag ), false );
+        }
+    }
+
+#if defined(__linux__)
+    // failing to grow the file throws, and leaves the records written so
+    // far intact
+    {
+        struct rlimit limit;
+        getrlimit( RLIMIT_FSIZE, &limit );
+        struct rlimit smallLimit = limit;
+        smallLimit.rlim_cur = 6 << 20;
+        std::signal( SIGXFSZ, SIG_IGN );
+        setrlimit( RLIMIT_FSIZE, &smallLimit );
+
+        std::size_t written = 0;
+        int failures = 0;
+        {
+            PacketCaptureWriter writer( path );
+            char data[1024] = {};
+            ReceivedDatagram datagram = { data, (int)sizeof(data), IpEndpointName( 10, 0, 0, 1, 9000 ),
+                    IpEndpointName( 10, 0, 0, 2, 7000 ), startNs };
+            for( int i=0; i < 10000 && failures < 2; ++i ){
+                try{
+                    writer.Write( datagram );
+                }catch( std::runtime_error& ){
+                    ++failures;
+                }
+            }
+            written = writer.RecordCount();
+        }
+
+        setrlimit( RLIMIT_FSIZE, &limit );
+        std::signal( SIGXFSZ, SIG_DFL );
+
+        assertEqual( failures, 2 );
+        assertEqual( written > 0, true );
+        PacketCaptureReader reader( path );
+        assertEqual( reader.RecordCount(), written );
+    }
+#endif
+
+    std::remove( path );
+}
+
+
+class LatestValueListener : public OscPacketListener{
+public:
+    std::vector<std::string> addresses;
+    std::vector<int32_t> values;
+    std::vector<IpEndpointName> remoteEndpoints;
+
+protected:
+    void ProcessMessage( const ReceivedMessage& m, const IpEndpointName& remoteEndpoint ) override
+    {
+        addresses.push_back( m.AddressPattern() );
+        values.push_back( m.ArgumentsBegin()->AsInt32() );
+        remoteEndpoints.push_back( remoteEndpoint );
+    }
+};
+
+
+void SendValue( PacketListener& listener, const char *address, int32_t value,
+        const IpEndpointName& remoteEndpoint=IpEndpointName( 10, 0, 0, 1, 9000 ) )
+{
+    char buffer[64];
+    OutboundPacketStream ps( buffer, sizeof(buffer) );
+    ps << BeginMessage( address ) << value << EndMessage();
+    listener.ProcessPacket( ps.Data(), (int)ps.Size(), remoteEndpoint );
+}
+
+
+void test23()
+{
+    LatestValueListener latest;
+    CoalescingOscPacketListener coalescer( &latest );
+
+    for( int32_t i=0; i < 100; ++i ){
+        SendValue( coalescer, "/fader/2", i );
+        if( i < 50 )
+            SendValue( coalescer, "/fader/1", 1000 + i, IpEndpointName( 10, 0, 0, 2, 9000 ) );
+    }
+
+    char buffer[128];
+    OutboundPacketStream ps( buffer, sizeof(buffer) );
+    ps << BeginBundleImmediate()
+            << BeginMessage( "/fader/3" ) << (int32_t)3 << EndMessage()
+            << BeginMessage( "/fader/1" ) << (int32_t)7 << EndMessage()
+        << EndBundle();
+    coalescer.ProcessPacket( ps.Data(), (int)ps.Size(), IpEndpointName( 10, 0, 0, 1, 9000 ) );
+
+    assertEqual( coalescer.SlotCount(), (std::size_t)3 );
+    assertEqual( coalescer.ChangedCount(), (std::size_t)3 );
+    assertEqual( coalescer.SupersededCount(), (std::size_t)(99 + 49 + 1) );
+
+    // in the order the slots changed, with the latest sender
+    assertEqual( coalescer.Drain(), (std::size_t)3 );
+    assertEqual( latest.addresses.size(), (std::size_t)3 );
+    if( latest.addresses.size() == 3 ){
+        assertEqual( latest.addresses[0], std::string( "/fader/2" ) );
+        assertEqual( latest.values[0], 99 );
+        assertEqual( latest.addresses[1], std::string( "/fader/1" ) );
+        assertEqual( latest.values[1], 7 );
+        assertEqual( latest.remoteEndpoints[1] == IpEndpointName( 10, 0, 0, 1, 9000 ), true );
+        assertEqual( latest.addresses[2], std::string( "/fader/3" ) );
+        assertEqual( latest.values[2], 3 );
+    }
+    assertEqual( coalescer.ChangedCount(), (std::size_t)0 );
+    assertEqual( coalescer.Drain(), (std::size_t)0 );
+
+    SendValue( coalescer, "/fader/3", 4 );
+    coalescer.TimerExpired();
+    assertEqual( latest.values.back(), 4 );
+
+    // by sender, with room for two slots
+    LatestValueListener bySource;
+    CoalescingOscPacketListener sourceCoalescer( &bySource, true, 2 );
+    SendValue( sourceCoalescer, "/x", 1, IpEndpointName( 10, 0, 0, 1, 9000 ) );
+    SendValue( sourceCoalescer, "/x", 2, IpEndpointName( 10, 0, 0, 2, 9000 ) );
+    SendValue( sourceCoalescer, "/x", 3, IpEndpointName( 10, 0, 0, 1, 9000 ) );
+    SendValue( sourceCoalescer, "/x", 4, IpEndpointName( 10, 0, 0, 3, 9000 ) );
+    SendValue( sourceCoalescer, "/y", 5 );
+    assertEqual( sourceCoalescer.SlotCount(), (std::size_t)2 );
+    assertEqual( sourceCoalescer.DroppedCount(), (std::size_t)2 );
+    assertEqual( sourceCoalescer.Drain(), (std::size_t)2 );
+    assertEqual( bySource.values.size(), (std::size_t)2 );
+    if( bySource.values.size() == 2 ){
+        assertEqual( bySource.values[0], 3 );
+        assertEqual( bySource.values[1], 2 );
+        assertEqual( bySource.remoteEndpoints[1] == IpEndpointName( 10, 0, 0, 2, 9000 ), true );
+    }
+
+    // draining while another thread receives
+    LatestValueListener threaded;
+    CoalescingOscPacketListener threadedCoalescer( &threaded );
+    std::thread receiver( [&](){
+        for( int32_t i=0; i < 20000; ++i )
+            SendValue( threadedCoalescer, ( i % 2 ) ? "/a" : "/b", i );
+    } );
+    for( int i=0; i < 100; ++i ){
+        threadedCoalescer.Drain();
+        std::this_thread::yield();
+    }
+    receiver.join();
+    threadedCoalescer.Drain();
+
+    bool increasing = true;
+    int32_t lastA = -1, lastB = -1;
+    for( std::size_t i=0; i < threaded.values.size(); ++i ){
+        int32_t& last = ( threaded.addresses[i] == "/a" ) ? lastA : lastB;
+        increasing = increasing && threaded.values[i] > last;
+        last = threaded.values[i];
+    }
+    assertEqual( increasing, true );
+    assertEqual( lastA, 19999 );
+    assertEqual( lastB, 19998 );
+}
+
+
+// a loopback port which was free a moment ago, for a receive group
+// which can't bind an ephemeral port
+int UnusedLoopbackPort()
+{
+    UdpReceiveSocket socket( IpEndpointName( "127.0.0.1", IpEndpointName::ANY_PORT ) );
+    return socket.LocalPort();
+}
+
+
+void test24()
+{
+    RecordingPacketListener first, second;
+    std::vector<PacketListener*> listeners = { &first, &second };
+    const int port = UnusedLoopbackPort();
+    UdpReceiveGroup group( IpEndpointName( "127.0.0.1", port ), listeners );
+    assertEqual( group.Size(), (std::size_t)2 );
+
+    // stopping before the threads have entered Run() mustn't hang
+    for( int i=0; i < 20; ++i ){
+        group.Start();
+        group.Stop();
+    }
+#if !defined(_WIN32)
+    {
+        detail::UdpReceiveGroup<posix::EventImplementation> eventGroup( IpEndpointName( "127.0.0.1", UnusedLoopbackPort() ), listeners );
+        for( int i=0; i < 20; ++i ){
+            eventGroup.Start();
+            eventGroup.Stop();
+        }
+    }
+#endif
+
+    // each sender's datagrams go to one listener, in order
+    group.Start();
+    const int senderCount = 8;
+    const int datagramCount = 20;
+    std::vector< std::unique_ptr<UdpTransmitSocket> > senders;
+    for( int i=0; i < senderCount; ++i )
+        senders.emplace_back( new UdpTransmitSocket( IpEndpointName( "127.0.0.1", port ) ) );
+    for( int j=0; j < datagramCount; ++j ){
+        for( int i=0; i < senderCount; ++i ){
+            std::string datagram = std::to_string( i ) + "/" + std::to_string( j );
+            senders[i]->Send( datagram.data(), datagram.size() );
+        }
+    }
+
+    for( int i=0; i < 1000 && first.count + second.count < (std::size_t)(senderCount * datagramCount); ++i )
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    group.Stop();
+    assertEqual( first.count + second.count, (std::size_t)(senderCount * datagramCount) );
+
+    bool ordered = true;
+    for( int i=0; i < senderCount; ++i ){
+        std::string prefix = std::to_string( i ) + "/";
+        int receivedBy = 0;
+        for( RecordingPacketListener *listener : { &first, &second } ){
+            int next = 0;
+            for( const RecordingPacketListener::Datagram& d : listener->datagrams ){
+                if( d.data.compare( 0, prefix.size(), prefix ) == 0 )
+                    ordered = ordered && d.data == prefix + std::to_string( next++ );
+            }
+            if( next > 0 )
+                ++receivedBy;
+        }
+        ordered = ordered && receivedBy == 1;
+    }
+    assertEqual( ordered, true );
+}
+
+
+#if defined(__linux__)
+void test25()
+{
+    using Impl = posix::UringImplementation;
+
+    std::unique_ptr< detail::SocketReceiveMultiplexer<Impl> > mux;
+    try{
+        mux.reset( new detail::SocketReceiveMultiplexer<Impl> );
+    }catch( std::runtime_error& e ){
+        std::cout << "skipping io_uring test: " << e.what();
+        return;
+    }
+
+    Impl::udp_socket_t first, second;
+    first.Bind( IpEndpointName( "127.0.0.1", IpEndpointName::ANY_PORT ) );
+    second.Bind( IpEndpointName( "127.0.0.1", IpEndpointName::ANY_PORT ) );
+    IpEndpointName firstEndpoint( "127.0.0.1", first.LocalPort() );
+    IpEndpointName secondEndpoint( "127.0.0.1", second.LocalPort() );
+
+    // the first socket answers "ping" through the multiplexer's send queue,
+    // the second throws when it receives "throw"
+    RecordingPacketListener firstListener, secondListener;
+    firstListener.onDatagram = [&first]( const ReceivedDatagram& datagram ){
+        if( datagram.size == 4 && std::memcmp( datagram.data, "ping", 4 ) == 0 )
+            first.SendTo( datagram.remoteEndpoint, "pong", 4 );
+    };
+    secondListener.onDatagram = []( const ReceivedDatagram& datagram ){
+        if( datagram.size == 5 && std::memcmp( datagram.data, "throw", 5 ) == 0 )
+            throw std::runtime_error( "listener failed\n" );
+    };
+    mux->AttachSocketListener( &first, &firstListener );
+    mux->AttachSocketListener( &second, &secondListener );
+
+    BreakingTimerListener timer;
+    timer.breakMultiplexer = [&mux]() { mux->Break(); };
+    mux->AttachPeriodicTimerListener( 5, &timer );
+
+    detail::UdpSocket<detail::Implementation> client;
+    client.Bind( IpEndpointName( "127.0.0.1", IpEndpointName::ANY_PORT ) );
+    IpEndpointName clientEndpoint( "127.0.0.1", client.LocalPort() );
+
+    client.SendTo( firstEndpoint, "ping", 4 );
+    client.SendTo( secondEndpoint, "b1", 2 );
+    client.SendTo( secondEndpoint, "b2", 2 );
+    timer.done = [&]() { return timer.ticks >= 3 && firstListener.count == 1 && secondListener.count == 2; };
+
+    bool unsupported = false;
+    try{
+        mux->Run();
+    }catch( std::runtime_error& e ){
+        std::cout << "skipping io_uring test: " << e.what();
+        unsupported = true;
+    }
+    if( unsupported )
+        return;
+
+    assertEqual( timer.ticks >= 3, true );
+    assertEqual( firstListener.datagrams.size(), (std::size_t)1 );
+    assertEqual( secondListener.datagrams.size(), (std::size_t)2 );
+    if( firstListener.datagrams.size() == 1 ){
+        assertEqual( firstListener.datagrams[0].data, std::string( "ping" ) );
+        assertEqual( firstListener.datagrams[0].remoteEndpoint == clientEndpoint, true );
+    }
+    if( secondListener.datagrams.size() == 2 ){
+        assertEqual( secondListener.datagrams[0].data, std::string( "b1" ) );
+        assertEqual( secondListener.datagrams[1].data, std::string( "b2" ) );
+    }
+
+    // the queued reply has been sent by the time Run() returns
+    char reply[8];
+    IpEndpointName remoteEndpoint;
+    assertEqual( client.ReceiveFrom( remoteEndpoint, reply, sizeof(reply) ), (std::size_t)4 );
+    assertEqual( remoteEndpoint == firstEndpoint, true );
+    assertEqual( std::memcmp( reply, "pong", 4 ), 0 );
+
+    // an exception from a listener leaves Run(), which can be called again
+    client.SendTo( secondEndpoint, "throw", 5 );
+    timer.ticks = 0;
+    timer.done = [&]() { return false; };
+    bool exceptionThrown = false;
+    try{
+        mux->Run();
+    }catch( std::runtime_error& ){
+        exceptionThrown = true;
+    }
+    assertEqual( exceptionThrown, true );
+    assertEqual( timer.ticks < timer.timeoutTicks, true );
+    assertEqual( secondListener.datagrams.size(), (std::size_t)3 );
+
+    client.SendTo( secondEndpoint, "b3", 2 );
+    client.SendTo( firstEndpoint, "ping", 4 );
+    timer.ticks = 0;
+    timer.done = [&]() { return firstListener.count == 2 && secondListener.count == 4; };
+    mux->Run();
+    assertEqual( timer.ticks < timer.timeoutTicks, true );
+    assertEqual( secondListener.datagrams.size(), (std::size_t)4 );
+    if( secondListener.datagrams.size() == 4 )
+        assertEqual( secondListener.datagrams[3].data, std::string( "b3" ) );
+    assertEqual( client.ReceiveFrom( remoteEndpoint, reply, sizeof(reply) ), (std::size_t)4 );
+    assertEqual( std::memcmp( reply, "pong", 4 ), 0 );
+
+    mux->DetachPeriodicTimerListener( &timer );
+    mux->DetachSocketListener( &second, &secondListener );
+    mux->DetachSocketListener( &first, &firstListener );
+}
+#endif
+
+
+#if defined(__linux__)
+void test26()
+{
+    using Impl = detail::Implementation;
+
+    detail::SocketReceiveMultiplexer<Impl> mux;
+    mux.SetReceiveBatchSize( 8 );
+    Impl::udp_socket_t receiveSocket;
+    receiveSocket.Bind( IpEndpointName( "127.0.0.1", IpEndpointName::ANY_PORT ) );
+    RecordingPacketListener listener;
+    mux.AttachSocketListener( &receiveSocket, &listener );
+
+    BreakingTimerListener timer;
+    timer.done = []() { return false; };
+    timer.breakMultiplexer = [&mux]() { mux.Break(); };
+    mux.AttachPeriodicTimerListener( 5, &timer );
+
+    // datagrams queued before Run() arrive in batches of up to 8. the stop
+    // packet ends Run() and isn't delivered
+    UdpTransmitSocket sender( IpEndpointName( "127.0.0.1", receiveSocket.LocalPort() ) );
+    const int datagramCount = 20;
+    for( int i=0; i < datagramCount; ++i ){
+        std::string datagram = std::to_string( i );
+        sender.Send( datagram.data(), datagram.size() );
+    }
+    sender.Send( "__stop_", 8 );
+
+    mux.Run();
+    assertEqual( timer.ticks < timer.timeoutTicks, true );
+    assertEqual( listener.datagrams.size(), (std::size_t)datagramCount );
+    bool ordered = listener.datagrams.size() == (std::size_t)datagramCount;
+    for( std::size_t i=0; ordered && i < listener.datagrams.size(); ++i )
+        ordered = listener.datagrams[i].data == std::to_string( i );
+    assertEqual( ordered, true );
+
+    std::size_t batchTotal = 0, largestBatch = 0;
+    for( std::size_t size : listener.batchSizes ){
+        batchTotal += size;
+        largestBatch = std::max( largestBatch, size );
+    }
+    assertEqual( batchTotal, (std::size_t)datagramCount );
+    assertEqual( largestBatch, (std::size_t)8 );
+
+    // a Break() from a listener takes effect once the batch is delivered
+    listener.datagrams.clear();
+    listener.batchSizes.clear();
+    listener.onDatagram = [&mux]( const ReceivedDatagram& datagram ){
+        if( datagram.size == 5 && std::memcmp( datagram.data, "break", 5 ) == 0 )
+            mux.Break();
+    };
+    sender.Send( "a", 1 );
+    sender.Send( "break", 5 );
+    sender.Send( "c", 1 );
+
+    timer.ticks = 0;
+    mux.Run();
+    assertEqual( timer.ticks < timer.timeoutTicks, true );
+    assertEqual( listener.batchSizes.size(), (std::size_t)1 );
+    assertEqual( listener.datagrams.size(), (std::size_t)3 );
+    if( listener.datagrams.size() == 3 ){
+        assertEqual( listener.datagrams[0].data, std::string( "a" ) );
+        assertEqual( listener.datagrams[1].data, std::string( "break" ) );
+        assertEqual( listener.datagrams[2].data, std::string( "c" ) );
+    }
+
+    mux.DetachPeriodicTimerListener( &timer );
+    mux.DetachSocketListener( &receiveSocket, &listener );
+}
+#endif
+
+
+#if !defined(_WIN32)
+void test27()
+{
+    using Impl = posix::EventImplementation;
+
+    struct CountingTimerListener : public TimerListener{
+        std::atomic<std::size_t> count{ 0 };
+        void TimerExpired() override { count.fetch_add( 1 ); }
+    };
+
+    detail::SocketReceiveMultiplexer<Impl> mux;
+    Impl::udp_socket_t first, second;
+    first.Bind( IpEndpointName( "127.0.0.1", IpEndpointName::ANY_PORT ) );
+    second.Bind( IpEndpointName( "127.0.0.1", IpEndpointName::ANY_PORT ) );
+    RecordingPacketListener firstListener, secondListener;
+    mux.AttachSocketListener( &first, &firstListener );
+    mux.AttachSocketListener( &second, &secondListener );
+    CountingTimerListener timer;
+    mux.AttachPeriodicTimerListener( 5, &timer );
+
+    std::thread runner( [&mux](){ mux.Run(); } );
+
+    UdpTransmitSocket firstSender( IpEndpointName( "127.0.0.1", first.LocalPort() ) );
+    UdpTransmitSocket secondSender( IpEndpointName( "127.0.0.1", second.LocalPort() ) );
+    const int datagramCount = 10;
+    for( int i=0; i < datagramCount; ++i ){
+        std::string datagram = std::to_string( i );
+        firstSender.Send( datagram.data(), datagram.size() );
+        secondSender.Send( datagram.data(), datagram.size() );
+    }
+    assertEqual( WaitForCount( firstListener.count, datagramCount ), true );
+    assertEqual( WaitForCount( secondListener.count, datagramCount ), true );
+    assertEqual( WaitForCount( timer.count, 3 ), true );
+
+    mux.AsynchronousBreak();
+    runner.join();
+
+    bool ordered = true;
+    for( RecordingPacketListener *listener : { &firstListener, &secondListener } ){
+        ordered = ordered && listener->datagrams.size() == (std::size_t)datagramCount;
+        for( std::size_t i=0; ordered && i < listener->datagrams.size(); ++i )
+            ordered = listener->datagrams[i].data == std::to_string( i );
+    }
+    assertEqual( ordered, true );
+
+    // also wakes a multiplexer waiting without a timeout
+    mux.DetachPeriodicTimerListener( &timer );
+    std::thread idleRunner( [&mux](){ mux.Run(); } );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+    secondSender.Send( "idle", 4 );
+    assertEqual( WaitForCount( secondListener.count, datagramCount + 1 ), true );
+    mux.AsynchronousBreak();
+    idleRunner.join();
+
+    mux.DetachSocketListener( &second, &secondListener );
+    mux.DetachSocketListener( &first, &firstListener );
+}
+#endif
+
+
+void test28()
+{
+    QueuedPacketListener<16, 4> queue;
+    RecordingPacketListener listener;
+    assertEqual( queue.Capacity(), (std::size_t)4 );
+    assertEqual( queue.MaximumPacketSize(), (std::size_t)16 );
+
+    // by default the queue takes the largest datagram a multiplexer delivers
+    {
+        std::unique_ptr< QueuedPacketListener<> > defaultQueue( new QueuedPacketListener<> );
+        assertEqual( defaultQueue->MaximumPacketSize(), DEFAULT_MAXIMUM_PACKET_SIZE );
+        std::vector<char> largest( DEFAULT_MAXIMUM_PACKET_SIZE, 'l' );
+        defaultQueue->ProcessPacket( &largest[0], (int)largest.size(), IpEndpointName() );
+        assertEqual( defaultQueue->QueuedCount(), (std::size_t)1 );
+    }
+
+    // delivered in order, at most maxPackets per Poll(). the source only
+    // labels the datagrams (a TEST-NET-1 address) and isn't bound
+    IpEndpointName source( 192, 0, 2, 1, 7240 );
+    queue.ProcessPacket( "0", 1, source );
+    queue.ProcessPacket( "1", 1, source );
+    queue.ProcessPacket( "2", 1, source );
+    assertEqual( queue.QueuedCount(), (std::size_t)3 );
+    assertEqual( queue.Poll( listener, 2 ), (std::size_t)2 );
+    assertEqual( queue.QueuedCount(), (std::size_t)1 );
+    assertEqual( queue.Poll( listener ), (std::size_t)1 );
+    assertEqual( queue.Poll( listener ), (std::size_t)0 );
+    assertEqual( listener.datagrams.size(), (std::size_t)3 );
+    if( listener.datagrams.size() == 3 ){
+        assertEqual( listener.datagrams[0].data, std::string( "0" ) );
+        assertEqual( listener.datagrams[1].data, std::string( "1" ) );
+        assertEqual( listener.datagrams[2].data, std::string( "2" ) );
+        assertEqual( listener.datagrams[2].remoteEndpoint == source, true );
+    }
+
+    // datagrams larger than MaxPacketSize, or arriving while the ring is
+    // full, are counted and dropped
+    char large[17] = {};
+    queue.ProcessPacket( large, 17, source );
+    queue.ProcessPacket( large, 16, source );
+    assertEqual( queue.OversizeCount(), (uint64_t)1 );
+    assertEqual( queue.QueuedCount(), (std::size_t)1 );
+
+    ReceivedDatagram batch[5];
+    const char *names[5] = { "a", "b", "c", "d", "e" };
+    for( int i=0; i < 5; ++i ){
+        batch[i].data = names[i];
+        batch[i].size = 1;
+        batch[i].remoteEndpoint = source;
+    }
+    queue.ProcessPackets( batch, 5 );
+    assertEqual( queue.QueuedCount(), (std::size_t)4 );
+    assertEqual( queue.OverrunCount(), (uint64_t)2 );
+    assertEqual( queue.OversizeCount(), (uint64_t)1 );
+
+    listener.datagrams.clear();
+    assertEqual( queue.Poll( listener ), (std::size_t)4 );
+    assertEqual( listener.datagrams.size(), (std::size_t)4 );
+    if( listener.datagrams.size() == 4 ){
+        assertEqual( listener.datagrams[0].data.size(), (std::size_t)16 );
+        assertEqual( listener.datagrams[1].data, std::string( "a" ) );
+        assertEqual( listener.datagrams[3].data, std::string( "c" ) );
+    }
+
+    // a slot is released even if the listener throws
+    listener.datagrams.clear();
+    listener.onDatagram = []( const ReceivedDatagram& datagram ){
+        if( datagram.size == 1 && datagram.data[0] == 't' )
+            throw std::runtime_error( "listener failed\n" );
+    };
+    queue.ProcessPacket( "t", 1, source );
+    queue.ProcessPacket( "u", 1, source );
+    bool exceptionThrown = false;
+    try{
+        queue.Poll( listener );
+    }catch( std::runtime_error& ){
+        exceptionThrown = true;
+    }
+    assertEqual( exceptionThrown, true );
+    assertEqual( queue.QueuedCount(), (std::size_t)1 );
+    queue.ProcessPackets( batch, 3 );
+    assertEqual( queue.QueuedCount(), (std::size_t)4 );
+    assertEqual( queue.OverrunCount(), (uint64_t)2 );
+    assertEqual( queue.Poll( listener ), (std::size_t)4 );
+    assertEqual( listener.datagrams.size(), (std::size_t)5 );
+    if( listener.datagrams.size() == 5 )
+        assertEqual( listener.datagrams[1].data, std::string( "u" ) );
+
+    // a producer and a consumer thread
+    struct SequenceListener : public PacketListener{
+        uint32_t next = 0;
+        bool ordered = true;
+        void ProcessPacket( const char *data, int size, const IpEndpointName& ) override
+        {
+            uint32_t value = 0;
+            if( size == (int)sizeof(value) )
+                std::memcpy( &value, data, sizeof(value) );
+            ordered = ordered && size == (int)sizeof(value) && value == next;
+            ++next;
+        }
+    };
+    const uint32_t datagramCount = 100000;
+    QueuedPacketListener<16, 64> threadedQueue;
+    std::thread producer( [&threadedQueue, &source, datagramCount](){
+        for( uint32_t i=0; i < datagramCount; ++i ){
+            // only the consumer frees slots, so this can't overrun
+            while( threadedQueue.QueuedCount() == threadedQueue.Capacity() )
+                std::this_thread::yield();
+            threadedQueue.ProcessPacket( (const char*)&i, (int)sizeof(i), source );
+        }
+    } );
+    SequenceListener sequence;
+    while( sequence.next < datagramCount ){
+        if( threadedQueue.Poll( sequence, 16 ) == 0 )
+            std::this_thread::yield();
+    }
+    producer.join();
+    assertEqual( sequence.ordered, true );
+    assertEqual( sequence.next, datagramCount );
+    assertEqual( threadedQueue.OverrunCount(), (uint64_t)0 );
+}
+
+
+#if !defined(_WIN32)
+void test29()
+{
+    using Impl = detail::Implementation;
+
+    detail::SocketReceiveMultiplexer<Impl> mux;
+    Impl::udp_socket_t first, second;
+    first.Bind( IpEndpointName( "127.0.0.1", IpEndpointName::ANY_PORT ) );
+    second.Bind( IpEndpointName( "127.0.0.1", IpEndpointName::ANY_PORT ) );
+    RecordingPacketListener firstListener, secondListener;
+    mux.AttachSocketListener( &first, &firstListener );
+    mux.AttachSocketListener( &second, &secondListener );
+
+    // runs of equal sized datagrams to one endpoint are sent with
+    // UDP_SEGMENT where it's supported. port 0 is rejected by sendto()
+    IpEndpointName firstEndpoint( "127.0.0.1", first.LocalPort() ), secondEndpoint( "127.0.0.1", second.LocalPort() );
+    detail::UdpSocket<Impl> sendSocket;
+    detail::BatchSender<Impl> sender( sendSocket );
+    for( int i=0; i < 3; ++i )
+        sender.Add( firstEndpoint, "aaaa", 4 );
+    sender.Add( secondEndpoint, "bb", 2 );
+    sender.Add( IpEndpointName( "127.0.0.1", 0 ), "x", 1 );
+    for( int i=0; i < 4; ++i )
+        sender.Add( firstEndpoint, "cccc", 4 );
+    sender.Add( secondEndpoint, "dd", 2 );
+    sender.Add( secondEndpoint, "dd", 2 );
+    sender.Add( firstEndpoint, "eee", 3 );
+    assertEqual( sender.Size(), (std::size_t)12 );
+
+    assertEqual( sender.Flush(), (std::size_t)1 );
+    bool errorsReported = true;
+    for( std::size_t i=0; i < sender.Size(); ++i )
+        errorsReported = errorsReported && sender.Datagram( i ).error == ( i == 4 ? EINVAL : 0 );
+    assertEqual( errorsReported, true );
+
+    BreakingTimerListener timer;
+    timer.done = [&]() { return firstListener.count == 8 && secondListener.count == 3; };
+    timer.breakMultiplexer = [&mux]() { mux.Break(); };
+    mux.AttachPeriodicTimerListener( 5, &timer );
+    mux.Run();
+    assertEqual( timer.ticks < timer.timeoutTicks, true );
+
+    const char *firstExpected[] = { "aaaa", "aaaa", "aaaa", "cccc", "cccc", "cccc", "cccc", "eee" };
+    const char *secondExpected[] = { "bb", "dd", "dd" };
+    assertEqual( firstListener.datagrams.size(), (std::size_t)8 );
+    assertEqual( secondListener.datagrams.size(), (std::size_t)3 );
+    bool delivered = firstListener.datagrams.size() == 8 && secondListener.datagrams.size() == 3;
+    for( std::size_t i=0; delivered && i < 8; ++i )
+        delivered = firstListener.datagrams[i].data == firstExpected[i];
+    for( std::size_t i=0; delivered && i < 3; ++i )
+        delivered = secondListener.datagrams[i].data == secondExpected[i];
+    assertEqual( delivered, true );
+
+    // the next Add() starts a new batch
+    sender.Add( secondEndpoint, "ff", 2 );
+    assertEqual( sender.Size(), (std::size_t)1 );
+    assertEqual( sender.Flush(), (std::size_t)0 );
+    assertEqual( sender.Datagram( 0 ).error, 0 );
+
+    mux.DetachPeriodicTimerListener( &timer );
+    mux.DetachSocketListener( &second, &secondListener );
+    mux.DetachSocketListener( &first, &firstListener );
+}
+#endif
+
+
+#if !defined(_WIN32)
+void test30()
+{
+    using Impl = detail::Implementation;
+
+    // the system may round buffer sizes up (Linux doubles them)
+    detail::UdpSocket<Impl> bufferSocket;
+    bufferSocket.SetReceiveBufferSize( 8192 );
+    int smallReceiveBuffer = bufferSocket.ReceiveBufferSize();
+    bufferSocket.SetReceiveBufferSize( 65536 );
+    assertEqual( smallReceiveBuffer >= 8192, true );
+    assertEqual( bufferSocket.ReceiveBufferSize() >= 65536, true );
+    assertEqual( bufferSocket.ReceiveBufferSize() > smallReceiveBuffer, true );
+    bufferSocket.SetSendBufferSize( 8192 );
+    int smallSendBuffer = bufferSocket.SendBufferSize();
+    bufferSocket.SetSendBufferSize( 65536 );
+    assertEqual( smallSendBuffer >= 8192, true );
+    assertEqual( bufferSocket.SendBufferSize() >= 65536, true );
+    assertEqual( bufferSocket.SendBufferSize() > smallSendBuffer, true );
+
+    detail::SocketReceiveMultiplexer<Impl> mux;
+    mux.SetMaximumPacketSize( 1024 );
+    Impl::udp_socket_t receiveSocket;
+    receiveSocket.Bind( IpEndpointName( "127.0.0.1", IpEndpointName::ANY_PORT ) );
+    RecordingPacketListener listener;
+    mux.AttachSocketListener( &receiveSocket, &listener );
+
+    BreakingTimerListener timer;
+    timer.breakMultiplexer = [&mux]() { mux.Break(); };
+    mux.AttachPeriodicTimerListener( 5, &timer );
+
+    // datagrams larger than the maximum packet size are counted and dropped
+    IpEndpointName receiveEndpoint( "127.0.0.1", receiveSocket.LocalPort() );
+    UdpTransmitSocket sender( receiveEndpoint );
+    std::vector<char> large( 5000, 'x' );
+    sender.Send( &large[0], large.size() );
+    sender.Send( "small", 5 );
+    timer.done = [&]() { return listener.count == 1; };
+    mux.Run();
+    assertEqual( timer.ticks < timer.timeoutTicks, true );
+    assertEqual( receiveSocket.TruncatedDatagramCount(), (std::size_t)1 );
+    assertEqual( listener.datagrams.size(), (std::size_t)1 );
+    if( listener.datagrams.size() == 1 )
+        assertEqual( listener.datagrams[0].data, std::string( "small" ) );
+
+    // as are datagrams truncated by ReceiveFrom()
+    sender.Send( &large[0], large.size() );
+    char buffer[1024];
+    IpEndpointName remoteEndpoint;
+    assertEqual( receiveSocket.ReceiveFrom( remoteEndpoint, buffer, sizeof(buffer) ), sizeof(buffer) );
+    assertEqual( receiveSocket.TruncatedDatagramCount(), (std::size_t)2 );
+
+#if defined(__linux__)
+    // a coalesced receive offload buffer is split into its datagrams
+    bool receiveOffloadSupported = true;
+    try{
+        receiveSocket.SetEnableReceiveOffload( true );
+    }catch( std::runtime_error& e ){
+        std::cout << "skipping UDP_GRO test: " << e.what();
+        receiveOffloadSupported = false;
+    }
+    if( receiveOffloadSupported ){
+        listener.datagrams.clear();
+        listener.count = 0;
+        detail::UdpSocket<Impl> batchSocket;
+        detail::BatchSender<Impl> batchSender( batchSocket );
+        std::vector<std::string> segments;
+        for( char c='a'; c < 'e'; ++c ){
+            segments.push_back( std::string( 100, c ) );
+            batchSender.Add( receiveEndpoint, segments.back().data(), segments.back().size() );
+        }
+        assertEqual( batchSender.Flush(), (std::size_t)0 );
+
+        timer.ticks = 0;
+        timer.done = [&]() { return listener.count == segments.size(); };
+        mux.Run();
+        assertEqual( timer.ticks < timer.timeoutTicks, true );
+        assertEqual( listener.datagrams.size(), segments.size() );
+        bool split = listener.datagrams.size() == segments.size();
+        for( std::size_t i=0; split && i < segments.size(); ++i )
+            split = listener.datagrams[i].data == segments[i];
+        assertEqual( split, true );
+        assertEqual( receiveSocket.TruncatedDatagramCount(), (std::size_t)2 );
+    }
+#endif
+
+    mux.DetachPeriodicTimerListener( &timer );
+    mux.DetachSocketListener( &receiveSocket, &listener );
+}
+#endif
+
+
+#if !defined(_WIN32)
+void test31()
+{
+    using Impl = detail::Implementation;
+
+    auto unixTimeNs = [](){
+        return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch() ).count();
+    };
+
+    detail::SocketReceiveMultiplexer<Impl> mux;
+    Impl::udp_socket_t receiveSocket;
+    receiveSocket.Bind( IpEndpointName( IpEndpointName::ANY_PORT ) ); // any address
+    receiveSocket.SetEnableReceiveLocalEndpoint( true );
+    RecordingPacketListener listener;
+    mux.AttachSocketListener( &receiveSocket, &listener );
+
+    BreakingTimerListener timer;
+    timer.breakMultiplexer = [&mux]() { mux.Break(); };
+    mux.AttachPeriodicTimerListener( 5, &timer );
+
+    IpEndpointName localEndpoint( "127.0.0.1", receiveSocket.LocalPort() );
+    UdpTransmitSocket sender( localEndpoint );
+    const int64_t slackNs = 10000000; // 10ms
+
+    // the receive time is between sending and processing, and the local
+    // endpoint is the address the datagrams were sent to
+    for( bool preferHardware : { false, true } ){
+        receiveSocket.SetEnableReceiveTimestamps( true, preferHardware );
+        listener.datagrams.clear();
+        listener.count = 0;
+        int64_t sentNs = unixTimeNs();
+        sender.Send( "a", 1 );
+        sender.Send( "b", 1 );
+        timer.ticks = 0;
+        timer.done = [&]() { return listener.count == 2; };
+        mux.Run();
+        int64_t processedNs = unixTimeNs();
+
+        assertEqual( timer.ticks < timer.timeoutTicks, true );
+        assertEqual( listener.datagrams.size(), (std::size_t)2 );
+        bool stamped = listener.datagrams.size() == 2;
+        for( const RecordingPacketListener::Datagram& d : listener.datagrams ){
+            stamped = stamped && d.receiveTimeNs != 0
+                    && d.receiveTimeNs >= sentNs - slackNs && d.receiveTimeNs <= processedNs + slackNs
+                    && d.localEndpoint == localEndpoint;
+        }
+        assertEqual( stamped, true );
+    }
+
+    // neither is set once disabled
+    receiveSocket.SetEnableReceiveTimestamps( false, false );
+    receiveSocket.SetEnableReceiveLocalEndpoint( false );
+    listener.datagrams.clear();
+    listener.count = 0;
+    sender.Send( "c", 1 );
+    timer.ticks = 0;
+    timer.done = [&]() { return listener.count == 1; };
+    mux.Run();
+    assertEqual( listener.datagrams.size(), (std::size_t)1 );
+    if( listener.datagrams.size() == 1 ){
+        assertEqual( listener.datagrams[0].receiveTimeNs, (int64_t)0 );
+        assertEqual( listener.datagrams[0].localEndpoint == IpEndpointName(), true );
+    }
+
+    mux.DetachPeriodicTimerListener( &timer );
+    mux.DetachSocketListener( &receiveSocket, &listener );
+}
+#endif
+
+
+#if defined(_WIN32)
+// loopback datagrams through a win32 multiplexer are delivered in batches
+// of at most the receive batch size, up to the stop packet
+template<typename Impl>
+void TestWin32Loopback()
+{
+    typename Impl::udp_socket_t receiveSocket;
+    receiveSocket.Bind( IpEndpointName( "127.0.0.1", IpEndpointName::ANY_PORT ) );
+
+    RecordingPacketListener listener;
+    detail::SocketReceiveMultiplexer<Impl> mux;
+    mux.SetReceiveBatchSize( 4 );
+    mux.AttachSocketListener( &receiveSocket, &listener );
+
+    BreakingTimerListener timer;
+    timer.breakMultiplexer = [&mux]() { mux.Break(); };
+    timer.done = []() { return false; };
+    mux.AttachPeriodicTimerListener( 5, &timer );
+
+    UdpTransmitSocket sender( IpEndpointName( "127.0.0.1", receiveSocket.LocalPort() ) );
+    const int datagramCount = 10;
+    for( int i=0; i < datagramCount; ++i ){
+        std::string datagram = std::to_string( i );
+        sender.Send( datagram.data(), datagram.size() );
+    }
+    sender.Send( "__stop_", 8 );
+
+    mux.Run();
+    assertEqual( listener.datagrams.size(), (std::size_t)datagramCount );
+    bool ordered = true;
+    for( std::size_t i=0; i < listener.datagrams.size(); ++i )
+        ordered = ordered && listener.datagrams[i].data == std::to_string( i );
+    assertEqual( ordered, true );
+    assertEqual( *std::max_element( listener.batchSizes.begin(), listener.batchSizes.end() ) <= (std::size_t)4, true );
+    assertEqual( timer.ticks < timer.timeoutTicks, true );
+
+    mux.DetachPeriodicTimerListener( &timer );
+    mux.DetachSocketListener( &receiveSocket, &listener );
+}
+
+
+void test32()
+{
+    TestWin32Loopback<win32::Implementation>();
+    TestWin32Loopback<win32::CompletionPortImplementation>();
+}
+#endif
+
+
+void RunUnitTests()
+{
+    test1();
+    test2();
+    test3();
+    test4();
+    test5();
+    test6();
+    test7();
+    test8();
+    test9();
+    test10();
+    test11();
+    test12();
+    test13();
+    test14();
+    test15();
+    test16();
+    test17();
+    test18();
+    test19();
+    test20();
+#if defined(__linux__)
+    test21();
+#endif
+    test22();
+    test23();
+    test24();
+#if defined(__linux__)
+    test25();
+    test26();
+#endif
+#if !defined(_WIN32)
+    test27();
+#endif
+    test28();
+#if !defined(_WIN32)
+    test29();
+    test30();
+    test31();
+#else
+    test32();
+#endif
     PrintTestSummary();
 }
 
@@ -454,6 +3506,7 @@ int main(int argc, char* argv[])
     (void)argv;
     
     osc::RunUnitTests();
+    return osc::failCount_ == 0 ? 0 : 1;
 }
 
 #endif